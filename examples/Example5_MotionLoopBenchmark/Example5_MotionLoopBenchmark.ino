@@ -0,0 +1,141 @@
+//      *****************************************************
+//      *     Example to benchmark the motion loop          *
+//      *            Paul Kerspe                31.5.2020   *
+//      *****************************************************
+//
+// This example measures the loop rate of the motion controller task (iterations per second) for different stepper configurations.
+// The loop rate defines the maximum step rate the server can generate, since every iteration can send at most one step per stepper.
+// Steppers are configured with sparse ids (e.g. only id 9 or only the odd ids) to verify that the motion controller only iterates the configured axes,
+// no matter at which position of the configuration they are stored.
+// All configured steppers are moving back and forth while the loop rate is measured.
+// The results are printed to the serial console, the current loop rate is also reported as "motionLoopRate" by the /api/status endpoint.
+//
+// No stepper drivers need to be connected to run this benchmark, but make sure the used IO pins are not connected to anything else.
+//
+// for a detailed manual on how to use this library please visit: https://github.com/pkerspe/ESP-StepperMotor-Server/blob/master/README.md
+// ***********************************************************************
+#include <Arduino.h>
+#include <ESPStepperMotorServer.h>
+#include <ESPStepperMotorServer_StepperConfiguration.h>
+#include <ESP_FlexyStepper.h>
+
+// the time to wait for the loop rate to settle after the configuration has been changed and the time to measure it afterwards
+#define SETTLE_TIME_MS 2000
+#define MEASURE_TIME_MS 5000
+// the largest number of steppers in one scenario, independent of ESPServerMaxSteppers
+#define SCENARIO_MAX_STEPPERS 10
+
+ESPStepperMotorServer *stepperMotorServer;
+
+// step and direction pins for the steppers with the id 0 to 9
+const byte stepPins[] = {4, 13, 16, 18, 21, 23, 26, 32, 2, 12};
+const byte directionPins[] = {5, 14, 17, 19, 22, 25, 27, 33, 15, 0};
+const byte pinTableSize = sizeof(stepPins) / sizeof(stepPins[0]);
+
+// the stepper ids to configure in each benchmark scenario, terminated by -1.
+// Ids that are not available with the configured ESPServerMaxSteppers (or that have no pins above) are skipped
+const int scenarios[][SCENARIO_MAX_STEPPERS + 1] = {
+    {-1},
+    {0, -1},
+    {9, -1},
+    {1, 3, 5, 7, 9, -1},
+    {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, -1},
+};
+const byte scenarioCount = sizeof(scenarios) / sizeof(scenarios[0]);
+
+bool isStepperIdAvailable(int stepperId)
+{
+  return (stepperId < ESPServerMaxSteppers && stepperId < pinTableSize);
+}
+
+void configureSteppers(const int *stepperIds)
+{
+  for (byte i = 0; i < ESPServerMaxSteppers; i++)
+  {
+    if (stepperMotorServer->getCurrentServerConfiguration()->getStepperConfiguration(i))
+    {
+      stepperMotorServer->removeStepper(i);
+    }
+  }
+  for (byte i = 0; stepperIds[i] != -1; i++)
+  {
+    const int stepperId = stepperIds[i];
+    if (!isStepperIdAvailable(stepperId))
+    {
+      continue;
+    }
+    ESPStepperMotorServer_StepperConfiguration *stepperConfiguration = new ESPStepperMotorServer_StepperConfiguration(stepPins[stepperId], directionPins[stepperId]);
+    stepperConfiguration->setDisplayName("Benchmark");
+    stepperMotorServer->addOrUpdateStepper(stepperConfiguration, stepperId);
+    ESP_FlexyStepper *flexyStepper = stepperConfiguration->getFlexyStepper();
+    flexyStepper->setSpeedInStepsPerSecond(2000);
+    flexyStepper->setAccelerationInStepsPerSecondPerSecond(4000);
+    flexyStepper->setDecelerationInStepsPerSecondPerSecond(4000);
+  }
+}
+
+// keep all configured steppers moving back and forth
+void keepSteppersMoving()
+{
+  for (byte i = 0; i < ESPServerMaxSteppers; i++)
+  {
+    ESPStepperMotorServer_StepperConfiguration *stepperConfiguration = stepperMotorServer->getCurrentServerConfiguration()->getStepperConfiguration(i);
+    if (stepperConfiguration && stepperConfiguration->getFlexyStepper()->motionComplete())
+    {
+      ESP_FlexyStepper *flexyStepper = stepperConfiguration->getFlexyStepper();
+      flexyStepper->setTargetPositionInSteps((flexyStepper->getCurrentPositionInSteps() > 0) ? 0 : 2000);
+    }
+  }
+}
+
+void setup()
+{
+  Serial.begin(115200);
+  // the server is only started with the serial command line interface, to measure the motion loop without any network load
+  stepperMotorServer = new ESPStepperMotorServer(ESPServerSerialEnabled, ESPServerLogLevel_WARNING);
+  stepperMotorServer->setWifiMode(ESPServerWifiModeDisabled);
+  stepperMotorServer->start();
+}
+
+void loop()
+{
+  for (byte scenario = 0; scenario < scenarioCount; scenario++)
+  {
+    configureSteppers(scenarios[scenario]);
+    Serial.print("Configured stepper ids: ");
+    for (byte i = 0; scenarios[scenario][i] != -1; i++)
+    {
+      if (isStepperIdAvailable(scenarios[scenario][i]))
+      {
+        Serial.printf("%i ", scenarios[scenario][i]);
+      }
+    }
+    Serial.println();
+
+    unsigned long minLoopRate = 0xFFFFFFFF;
+    unsigned long maxLoopRate = 0;
+    unsigned long loopRateSum = 0;
+    unsigned int sampleCount = 0;
+    const unsigned long startTime = millis();
+    while (millis() - startTime < SETTLE_TIME_MS + MEASURE_TIME_MS)
+    {
+      keepSteppersMoving();
+      // the loop rate is updated once per second by the motion controller
+      if (millis() - startTime >= SETTLE_TIME_MS + (sampleCount + 1) * 1000)
+      {
+        const unsigned long loopRate = stepperMotorServer->getMotionController()->getLoopRate();
+        minLoopRate = min(minLoopRate, loopRate);
+        maxLoopRate = max(maxLoopRate, loopRate);
+        loopRateSum += loopRate;
+        sampleCount++;
+      }
+      delay(10);
+    }
+    Serial.printf("Motion loop rate: avg %lu, min %lu, max %lu iterations per second\n", loopRateSum / sampleCount, minLoopRate, maxLoopRate);
+  }
+  Serial.println("Benchmark completed");
+  while (true)
+  {
+    delay(1000);
+  }
+}
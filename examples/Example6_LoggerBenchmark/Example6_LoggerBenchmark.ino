@@ -0,0 +1,148 @@
+//      *****************************************************
+//      *     Example to benchmark the logger               *
+//      *            Paul Kerspe                31.5.2020   *
+//      *****************************************************
+//
+// This example measures how long a call to the log functions blocks the calling task, e.g. the motion controller when it logs a warning.
+// With async logging (the default once the server is started) the message is formatted by the caller and copied into the log ring buffer,
+// writing it to the serial port and the log sinks is done later by the logger task. Only the *FromISR functions also defer the formatting,
+// they store the format string and up to 4 integer arguments in the ring buffer.
+// Each scenario calls a log function in bursts of a few calls and pauses in between, so the logger task can empty the ring buffer
+// and no messages are dropped. The min/avg/max time per call is printed to the serial console in CPU cycles and microseconds.
+// The serial output of the logger is disabled while the async scenarios are measured, so the results are not buried in log messages.
+//
+// No stepper drivers or other hardware needs to be connected to run this benchmark.
+//
+// for a detailed manual on how to use this library please visit: https://github.com/pkerspe/ESP-StepperMotor-Server/blob/master/README.md
+// ***********************************************************************
+#include <Arduino.h>
+#include <ESPStepperMotorServer.h>
+#include <ESPStepperMotorServer_Logger.h>
+
+// number of calls per burst, number of bursts per scenario and the pause between the bursts
+#define BURST_SIZE 10
+#define BURST_COUNT 50
+#define BURST_PAUSE_MS 20
+
+ESPStepperMotorServer *stepperMotorServer;
+
+enum Scenario
+{
+  FILTERED_OUT,
+  PLAIN_MESSAGE,
+  INTEGER_ARGUMENTS,
+  FLOAT_ARGUMENT,
+  STRING_ARGUMENT,
+  FROM_ISR,
+  SYNCHRONOUS_INTEGER_ARGUMENTS
+};
+
+const char *scenarioNames[] = {
+    "logDebugf filtered out by the log level",
+    "logWarning without formatting",
+    "logWarningf with 2 integers",
+    "logWarningf with a float",
+    "logWarningf with a string",
+    "logWarningfFromISR with 2 integers",
+    "logWarningf with 2 integers, synchronous to serial"};
+const byte scenarioCount = sizeof(scenarioNames) / sizeof(scenarioNames[0]);
+
+void logMessage(byte scenario, uint32_t sequence)
+{
+  switch (scenario)
+  {
+  case FILTERED_OUT:
+    ESPStepperMotorServer_Logger::logDebugf("stepper %i reached position %i", 3, (int)sequence);
+    break;
+  case PLAIN_MESSAGE:
+    ESPStepperMotorServer_Logger::logWarning("stepper reached its target position");
+    break;
+  case INTEGER_ARGUMENTS:
+  case SYNCHRONOUS_INTEGER_ARGUMENTS:
+    ESPStepperMotorServer_Logger::logWarningf("stepper %i reached position %i", 3, (int)sequence);
+    break;
+  case FLOAT_ARGUMENT:
+    ESPStepperMotorServer_Logger::logWarningf("stepper speed changed to %f steps per second", sequence * 0.25f);
+    break;
+  case STRING_ARGUMENT:
+    ESPStepperMotorServer_Logger::logWarningf("stepper %s reached its target position", "X-Axis");
+    break;
+  case FROM_ISR:
+    ESPStepperMotorServer_Logger::logWarningfFromISR("stepper %i reached position %i", 3, sequence);
+    break;
+  }
+}
+
+void runScenario(byte scenario)
+{
+  const bool isSynchronous = (scenario == SYNCHRONOUS_INTEGER_ARGUMENTS);
+  if (isSynchronous)
+  {
+    ESPStepperMotorServer_Logger::stopAsyncLogging();
+  }
+  else
+  {
+    ESPStepperMotorServer_Logger::setSerialOutputEnabled(false);
+  }
+  const unsigned long droppedMessageCountBefore = ESPStepperMotorServer_Logger::getDroppedMessageCount();
+
+  uint32_t minCycles = 0xFFFFFFFF;
+  uint32_t maxCycles = 0;
+  uint64_t cycleSum = 0;
+  uint32_t callCount = 0;
+  for (int burst = 0; burst < BURST_COUNT; burst++)
+  {
+    for (int i = 0; i < BURST_SIZE; i++)
+    {
+      const uint32_t startCycles = ESP.getCycleCount();
+      logMessage(scenario, callCount);
+      const uint32_t cycles = ESP.getCycleCount() - startCycles;
+      minCycles = min(minCycles, cycles);
+      maxCycles = max(maxCycles, cycles);
+      cycleSum += cycles;
+      callCount++;
+    }
+    delay(BURST_PAUSE_MS);
+  }
+
+  if (isSynchronous)
+  {
+    ESPStepperMotorServer_Logger::startAsyncLogging();
+  }
+  else
+  {
+    ESPStepperMotorServer_Logger::setSerialOutputEnabled(true);
+  }
+  const float cyclesPerMicrosecond = ESP.getCpuFreqMHz();
+  const uint32_t avgCycles = cycleSum / callCount;
+  Serial.printf("%s: avg %u cycles (%.2f us), min %u cycles (%.2f us), max %u cycles (%.2f us), %lu dropped\n",
+                scenarioNames[scenario],
+                avgCycles, avgCycles / cyclesPerMicrosecond,
+                minCycles, minCycles / cyclesPerMicrosecond,
+                maxCycles, maxCycles / cyclesPerMicrosecond,
+                ESPStepperMotorServer_Logger::getDroppedMessageCount() - droppedMessageCountBefore);
+}
+
+void setup()
+{
+  Serial.begin(115200);
+  // the server is only started with the serial command line interface, to measure the logger without any network load
+  stepperMotorServer = new ESPStepperMotorServer(ESPServerSerialEnabled, ESPServerLogLevel_WARNING);
+  stepperMotorServer->setWifiMode(ESPServerWifiModeDisabled);
+  stepperMotorServer->start();
+}
+
+void loop()
+{
+  // give the logger task time to write the start up messages
+  delay(1000);
+  for (byte scenario = 0; scenario < scenarioCount; scenario++)
+  {
+    runScenario(scenario);
+  }
+  Serial.println("Benchmark completed");
+  while (true)
+  {
+    delay(1000);
+  }
+}
@@ -0,0 +1,133 @@
+//      *****************************************************
+//      *     Example to measure the latency of macros      *
+//      *            Paul Kerspe                31.5.2020   *
+//      *****************************************************
+//
+// This example measures the time from a switch edge to the start of its macro and to the first step of the macro's move action.
+// Connect the TRIGGER_PIN output with a wire to the SWITCH_PIN input: the example toggles the output, the switch ISR queues the
+// macro for the macro executor task, which sets the target of the stepper, and the motion controller task sends the first step.
+// Two latencies are measured for each trigger:
+// - dispatch: from the switch edge until the macro executor task starts the macro
+// - first step: from the switch edge until the motion controller has sent the first step of the move action
+// After all triggers, the distribution of both latencies is printed to the serial console together with the min/avg/max values,
+// which are also reported as "macroLatency" by the /api/status endpoint.
+//
+// No stepper driver needs to be connected to run this example, but make sure the used IO pins are not connected to anything else.
+//
+// for a detailed manual on how to use this library please visit: https://github.com/pkerspe/ESP-StepperMotor-Server/blob/master/README.md
+// ***********************************************************************
+#include <Arduino.h>
+#include <ESPStepperMotorServer.h>
+#include <ESPStepperMotorServer_MacroAction.h>
+#include <ESPStepperMotorServer_PositionSwitch.h>
+#include <ESPStepperMotorServer_StepperConfiguration.h>
+#include <ESP_FlexyStepper.h>
+
+#define STEP_PIN 16
+#define DIRECTION_PIN 17
+#define SWITCH_PIN 18
+#define TRIGGER_PIN 19
+
+// number of switch triggers to measure and the width and number of the histogram buckets (the last bucket counts all larger latencies)
+#define TRIGGER_COUNT 500
+#define BUCKET_WIDTH_MICROS 50
+#define BUCKET_COUNT 20
+
+ESPStepperMotorServer *stepperMotorServer;
+ESPStepperMotorServer_StepperConfiguration *stepperConfiguration;
+
+unsigned int dispatchHistogram[BUCKET_COUNT];
+unsigned int firstStepHistogram[BUCKET_COUNT];
+
+void addToHistogram(unsigned int *histogram, unsigned long latencyMicros)
+{
+  const unsigned long bucket = latencyMicros / BUCKET_WIDTH_MICROS;
+  histogram[min(bucket, (unsigned long)(BUCKET_COUNT - 1))]++;
+}
+
+void printLatency(const char *name, const ESPStepperMotorServer_LatencyStatistics &latency, const unsigned int *histogram)
+{
+  Serial.printf("%s latency: %lu samples, min %lu us, avg %lu us, max %lu us\n", name, latency.getSampleCount(), latency.getMinMicros(), latency.getAverageMicros(), latency.getMaxMicros());
+  for (byte i = 0; i < BUCKET_COUNT; i++)
+  {
+    if (i < BUCKET_COUNT - 1)
+    {
+      Serial.printf("  %4i - %4i us: %u\n", i * BUCKET_WIDTH_MICROS, (i + 1) * BUCKET_WIDTH_MICROS - 1, histogram[i]);
+    }
+    else
+    {
+      Serial.printf("  >= %4i us:     %u\n", i * BUCKET_WIDTH_MICROS, histogram[i]);
+    }
+  }
+}
+
+void setup()
+{
+  Serial.begin(115200);
+  pinMode(TRIGGER_PIN, OUTPUT);
+  digitalWrite(TRIGGER_PIN, LOW);
+
+  // the server is only started with the serial command line interface, to measure the latency without any network load
+  stepperMotorServer = new ESPStepperMotorServer(ESPServerSerialEnabled, ESPServerLogLevel_WARNING);
+  stepperMotorServer->setWifiMode(ESPServerWifiModeDisabled);
+
+  stepperConfiguration = new ESPStepperMotorServer_StepperConfiguration(STEP_PIN, DIRECTION_PIN);
+  stepperConfiguration->setDisplayName("X-Axis");
+  unsigned int stepperId = stepperMotorServer->addOrUpdateStepper(stepperConfiguration);
+  ESP_FlexyStepper *flexyStepper = stepperConfiguration->getFlexyStepper();
+  flexyStepper->setSpeedInStepsPerSecond(5000);
+  flexyStepper->setAccelerationInStepsPerSecondPerSecond(50000);
+  flexyStepper->setDecelerationInStepsPerSecondPerSecond(50000);
+
+  // an active high position switch, whose macro moves the stepper by 20 steps
+  ESPStepperMotorServer_PositionSwitch *positionSwitch = new ESPStepperMotorServer_PositionSwitch(SWITCH_PIN, stepperId, (1 << (SWITCHTYPE_POSITION_SWITCH_BIT - 1)) | (1 << (SWITCHTYPE_STATE_ACTIVE_HIGH_BIT - 1)), "Trigger");
+  positionSwitch->addMacroAction(new ESPStepperMotorServer_MacroAction(MacroActionType::moveBy, stepperId, 20));
+  stepperMotorServer->addOrUpdatePositionSwitch(positionSwitch);
+
+  stepperMotorServer->start();
+}
+
+void loop()
+{
+  const ESPStepperMotorServer_LatencyStatistics &dispatchLatency = stepperMotorServer->getMacroExecutor()->getDispatchLatency();
+  const ESPStepperMotorServer_LatencyStatistics &firstStepLatency = stepperMotorServer->getMotionController()->getMacroFirstStepLatency();
+  ESP_FlexyStepper *flexyStepper = stepperConfiguration->getFlexyStepper();
+  // give the server time to start all tasks
+  delay(1000);
+
+  for (int i = 0; i < TRIGGER_COUNT; i++)
+  {
+    const unsigned long dispatchCount = dispatchLatency.getSampleCount();
+    const unsigned long firstStepCount = firstStepLatency.getSampleCount();
+    digitalWrite(TRIGGER_PIN, HIGH);
+    // wait for the macro to be started and its move to be completed, the switch is released afterwards so the next edge starts the macro again
+    const unsigned long startTime = millis();
+    while ((firstStepLatency.getSampleCount() == firstStepCount || !flexyStepper->motionComplete()) && millis() - startTime < 1000)
+    {
+      delay(1);
+    }
+    digitalWrite(TRIGGER_PIN, LOW);
+    if (dispatchLatency.getSampleCount() != dispatchCount)
+    {
+      addToHistogram(dispatchHistogram, dispatchLatency.getLastMicros());
+    }
+    if (firstStepLatency.getSampleCount() != firstStepCount)
+    {
+      addToHistogram(firstStepHistogram, firstStepLatency.getLastMicros());
+    }
+    else
+    {
+      Serial.println("No step has been measured for the last trigger, check the wire between the trigger and switch pins");
+    }
+    // the switch input is not debounced in this example, so wait a bit before the next edge
+    delay(20);
+  }
+
+  printLatency("Dispatch", dispatchLatency, dispatchHistogram);
+  printLatency("First step", firstStepLatency, firstStepHistogram);
+  Serial.println("Measurement completed");
+  while (true)
+  {
+    delay(1000);
+  }
+}
@@ -53,6 +53,8 @@
 //        server.start();
 //
 
+#define ESPServerLogModule ESPServerLogModule_Server
+
 #include <ESPStepperMotorServer.h>
 
 // ---------------------------------------------------------------------------------
@@ -93,6 +95,28 @@ ESPStepperMotorServer::ESPStepperMotorServer(const ESPStepperMotorServer &espSte
         *this->motionControllerHandler = *espStepperMotorServer.motionControllerHandler;
     }
 
+    if (espStepperMotorServer.macroExecutorHandler)
+    {
+        this->macroExecutorHandler = new ESPStepperMotorServer_MacroExecutor(this);
+        *this->macroExecutorHandler = *espStepperMotorServer.macroExecutorHandler;
+    }
+
+#ifndef ESPStepperMotorServer_COMPILE_NO_WEB
+    if (espStepperMotorServer.eventPublisherHandler)
+    {
+        // the event queue and task are not shared, the copy gets its own publisher
+        this->eventPublisherHandler = new ESPStepperMotorServer_EventPublisher();
+    }
+#endif
+
+#ifndef ESPStepperMotorServer_COMPILE_NO_GCODE
+    if (espStepperMotorServer.gcodeInterpreterHandler)
+    {
+        // the line queue and task are not shared, the copy gets its own interpreter
+        this->gcodeInterpreterHandler = new ESPStepperMotorServer_GCodeInterpreter(this);
+    }
+#endif
+
 #ifndef ESPStepperMotorServer_COMPILE_NO_WEB
     if (espStepperMotorServer.httpServer)
     {
@@ -111,13 +135,25 @@ ESPStepperMotorServer::ESPStepperMotorServer(const ESPStepperMotorServer &espSte
 
 ESPStepperMotorServer::~ESPStepperMotorServer()
 {
+    // make sure the logger task does not use the sinks anymore before they are deleted
+    this->disableRemoteLogSinks();
+    ESPStepperMotorServer_Logger::stopAsyncLogging();
     delete this->serverConfiguration;
 #ifndef ESPStepperMotorServer_COMPILE_NO_WEB
     delete this->webInterfaceHandler;
     delete this->restApiHandler;
+    delete this->eventPublisherHandler;
+    delete this->webSocketLogSink;
 #endif
+    delete this->syslogLogSink;
+    delete this->positionJournal;
+    delete this->syncController;
     delete this->cliHandler;
     delete this->motionControllerHandler;
+    delete this->macroExecutorHandler;
+#ifndef ESPStepperMotorServer_COMPILE_NO_GCODE
+    delete this->gcodeInterpreterHandler;
+#endif
 }
 
 //
@@ -143,6 +179,7 @@ ESPStepperMotorServer::ESPStepperMotorServer(byte serverMode, byte logLevel)
     {
         this->isRestApiEnabled = true;
         this->restApiHandler = new ESPStepperMotorServer_RestAPI(this);
+        this->eventPublisherHandler = new ESPStepperMotorServer_EventPublisher();
     }
 #endif
 
@@ -153,6 +190,10 @@ ESPStepperMotorServer::ESPStepperMotorServer(byte serverMode, byte logLevel)
     }
 
     this->motionControllerHandler = new ESPStepperMotorServer_MotionController(this);
+    this->macroExecutorHandler = new ESPStepperMotorServer_MacroExecutor(this);
+#ifndef ESPStepperMotorServer_COMPILE_NO_GCODE
+    this->gcodeInterpreterHandler = new ESPStepperMotorServer_GCodeInterpreter(this);
+#endif
 
     if (ESPStepperMotorServer::anchor != NULL)
     {
@@ -180,7 +221,8 @@ void ESPStepperMotorServer::requestReboot(String rebootReason)
 
 void ESPStepperMotorServer::start()
 {
-    ESPStepperMotorServer_Logger::logInfof("Starting ESP-StepperMotor-Server (v. %s)\n", this->version);
+    ESPStepperMotorServer_Logger::startAsyncLogging();
+    ESPServerLogInfof("Starting ESP-StepperMotor-Server (v. %s)\n", this->version);
 #ifndef ESPStepperMotorServer_COMPILE_NO_DEBUG
     this->printCompileSettings();
 #endif
@@ -203,7 +245,7 @@ void ESPStepperMotorServer::start()
     }
     else if (this->serverConfiguration->wifiMode == ESPServerWifiModeDisabled)
     {
-        ESPStepperMotorServer_Logger::logInfo("WiFi mode is disabled, only serial control interface will be used for controls");
+        ESPServerLogInfo("WiFi mode is disabled, only serial control interface will be used for controls");
     }
 
 #ifndef ESPStepperMotorServer_COMPILE_NO_WEB
@@ -213,26 +255,64 @@ void ESPStepperMotorServer::start()
     this->setupAllIOPins();
     this->attachAllInterrupts();
 
+    if (this->positionJournal)
+    {
+        this->positionJournal->restorePositions(this->serverConfiguration);
+        this->positionJournal->start();
+    }
+    if (this->syncController)
+    {
+        this->syncController->start();
+    }
+
     if (this->isCLIEnabled)
     {
         this->cliHandler->start();
     }
+#ifndef ESPStepperMotorServer_COMPILE_NO_WEB
+    if (this->eventPublisherHandler)
+    {
+        this->eventPublisherHandler->start();
+    }
+#endif
     this->motionControllerHandler->start();
+    this->macroExecutorHandler->start();
+#ifndef ESPStepperMotorServer_COMPILE_NO_GCODE
+    this->gcodeInterpreterHandler->start();
+#endif
     this->isServerStarted = true;
 }
 
 void ESPStepperMotorServer::stop()
 {
-    ESPStepperMotorServer_Logger::logInfo("Stopping ESP-StepperMotor-Server");
+    ESPServerLogInfo("Stopping ESP-StepperMotor-Server");
+    if (this->syncController)
+    {
+        this->syncController->stop();
+    }
+#ifndef ESPStepperMotorServer_COMPILE_NO_GCODE
+    this->gcodeInterpreterHandler->stop();
+#endif
     this->motionControllerHandler->stop();
+    if (this->positionJournal)
+    {
+        // the motion controller task is stopped, so no more steps are sent and the positions are final
+        this->positionJournal->writePositions(this->serverConfiguration);
+        this->positionJournal->stop();
+    }
     this->detachAllInterrupts();
-    ESPStepperMotorServer_Logger::logInfo("detached interrupt handlers");
+    this->macroExecutorHandler->stop();
+    ESPServerLogInfo("detached interrupt handlers");
 
 #ifndef ESPStepperMotorServer_COMPILE_NO_WEB
+    if (this->eventPublisherHandler)
+    {
+        this->eventPublisherHandler->stop();
+    }
     if (isWebserverEnabled || isRestApiEnabled)
     {
         this->httpServer->end();
-        ESPStepperMotorServer_Logger::logInfo("stopped web server");
+        ESPServerLogInfo("stopped web server");
     }
 #endif
 
@@ -241,7 +321,8 @@ void ESPStepperMotorServer::stop()
         this->cliHandler->stop();
     }
     this->isServerStarted = false;
-    ESPStepperMotorServer_Logger::logInfo("ESP-StepperMotor-Server stopped");
+    ESPServerLogInfo("ESP-StepperMotor-Server stopped");
+    ESPStepperMotorServer_Logger::stopAsyncLogging();
 }
 
 // ---------------------------------------------------------------------------------
@@ -265,6 +346,12 @@ int ESPStepperMotorServer::addOrUpdateRotaryEncoder(ESPStepperMotorServer_Rotary
     // add encoder to configuration
     if (encoderIndex > -1)
     {
+        // the replaced encoder gets released, so its ISRs must not be called anymore
+        ESPStepperMotorServer_RotaryEncoder *replacedEncoder = this->serverConfiguration->getRotaryEncoder(encoderIndex);
+        if (replacedEncoder && replacedEncoder != encoder)
+        {
+            this->detachInterruptForRotaryEncoder(replacedEncoder);
+        }
         this->serverConfiguration->setRotaryEncoder(encoder, encoderIndex);
     }
     else
@@ -288,32 +375,66 @@ int ESPStepperMotorServer::addOrUpdateStepper(ESPStepperMotorServer_StepperConfi
         ESPStepperMotorServer_Logger::logWarningf("Either the step IO pin (%i) or direction IO (%i) pin, or both, are not set correctly. Use a valid IO Pin value between 0 and the highest available IO Pin on your ESP\n", stepper->getStepIoPin(), stepper->getDirectionIoPin());
         return -1;
     }
-    // set IO Pins for stepper
-    pinMode(stepper->getDirectionIoPin(), OUTPUT);
-    digitalWrite(stepper->getDirectionIoPin(), LOW);
-    pinMode(stepper->getStepIoPin(), OUTPUT);
-    digitalWrite(stepper->getStepIoPin(), LOW);
+    // set IO Pins for stepper (outputs of the shift register chain are driven by the motion controller)
+    if (!ESPServerIsShiftRegisterPin(stepper->getDirectionIoPin()))
+    {
+        pinMode(stepper->getDirectionIoPin(), OUTPUT);
+        digitalWrite(stepper->getDirectionIoPin(), LOW);
+    }
+    if (!ESPServerIsShiftRegisterPin(stepper->getStepIoPin()))
+    {
+        pinMode(stepper->getStepIoPin(), OUTPUT);
+        digitalWrite(stepper->getStepIoPin(), LOW);
+    }
     // add stepper to configuration or update existing one
     if (stepperIndex > -1)
     {
+        // a running homing procedure must not continue with the new configuration
+        if (this->motionControllerHandler->isRunning())
+        {
+            this->motionControllerHandler->abortHoming(stepperIndex);
+        }
         this->serverConfiguration->setStepperConfiguration(stepper, stepperIndex);
     }
     else
     {
         stepperIndex = this->serverConfiguration->addStepperConfiguration(stepper);
     }
+    this->releaseRetiredConfigurationEntities();
 
     return stepperIndex;
 }
 
 /**
  * remove the stepper configuration with the given index/id
+ * switches and rotary encoders that are linked to the stepper are removed as well
  */
 void ESPStepperMotorServer::removeStepper(byte id)
 {
     if (this->serverConfiguration->getStepperConfiguration(id))
     {
+        if (this->motionControllerHandler->isRunning())
+        {
+            this->motionControllerHandler->abortHoming(id);
+        }
+        for (byte switchIndex = 0; switchIndex < ESPServerMaxSwitches; switchIndex++)
+        {
+            ESPStepperMotorServer_PositionSwitch *switchConfig = this->serverConfiguration->getSwitch(switchIndex);
+            if (switchConfig && switchConfig->getStepperIndex() == id)
+            {
+                this->detachInterruptForPositionSwitch(switchConfig);
+            }
+        }
+        for (byte encoderIndex = 0; encoderIndex < ESPServerMaxRotaryEncoders; encoderIndex++)
+        {
+            ESPStepperMotorServer_RotaryEncoder *encoderConfig = this->serverConfiguration->getRotaryEncoder(encoderIndex);
+            if (encoderConfig && encoderConfig->getStepperIndex() == id)
+            {
+                this->detachInterruptForRotaryEncoder(encoderConfig);
+            }
+        }
         this->serverConfiguration->removeStepperConfiguration(id);
+        this->releaseRetiredConfigurationEntities();
     }
     else
     {
@@ -334,7 +455,7 @@ int ESPStepperMotorServer::addOrUpdatePositionSwitch(ESPStepperMotorServer_Posit
     // Setup IO Pin
     this->setupPositionSwitchIOPin(posSwitchToAdd);
 
-    ESPStepperMotorServer_Logger::logInfof("Added switch '%s' for IO pin %i at configuration index %i\n", this->serverConfiguration->getSwitch(switchIndex)->getPositionName().c_str(), this->serverConfiguration->getSwitch(switchIndex)->getIoPinNumber(), switchIndex);
+    ESPServerLogInfof("Added switch '%s' for IO pin %i at configuration index %i\n", this->serverConfiguration->getSwitch(switchIndex)->getPositionName().c_str(), this->serverConfiguration->getSwitch(switchIndex)->getIoPinNumber(), switchIndex);
     return switchIndex;
 }
 
@@ -344,9 +465,7 @@ void ESPStepperMotorServer::removePositionSwitch(int positionSwitchIndex)
     if (posSwitch)
     {
         this->detachInterruptForPositionSwitch(posSwitch);
-#ifndef ESPStepperMotorServer_COMPILE_NO_DEBUG
-        ESPStepperMotorServer_Logger::logDebugf("Removing position switch '%s' (id: %i) from configured switches\n", posSwitch->getPositionName().c_str(), positionSwitchIndex);
-#endif
+        ESPServerLogDebugf("Removing position switch '%s' (id: %i) from configured switches\n", posSwitch->getPositionName().c_str(), positionSwitchIndex);
         this->serverConfiguration->removeSwitch(positionSwitchIndex);
     }
     else
@@ -357,8 +476,10 @@ void ESPStepperMotorServer::removePositionSwitch(int positionSwitchIndex)
 
 void ESPStepperMotorServer::removeRotaryEncoder(byte id)
 {
-    if (this->serverConfiguration->getRotaryEncoder(id))
+    ESPStepperMotorServer_RotaryEncoder *rotaryEncoder = this->serverConfiguration->getRotaryEncoder(id);
+    if (rotaryEncoder)
     {
+        this->detachInterruptForRotaryEncoder(rotaryEncoder);
         this->serverConfiguration->removeRotaryEncoder(id);
     }
     else
@@ -367,6 +488,38 @@ void ESPStepperMotorServer::removeRotaryEncoder(byte id)
     }
 }
 
+/**
+ * release the removed or replaced stepper configurations, once the motion controller and macro executor tasks
+ * do not work with a configuration revision that still contains them
+ */
+void ESPStepperMotorServer::releaseRetiredConfigurationEntities()
+{
+    if (this->serverConfiguration->getRetiredStepperConfigurationCount() == 0)
+    {
+        return;
+    }
+    unsigned int appliedRevision = this->serverConfiguration->getConfigurationRevision();
+    unsigned int taskRevision;
+    if (this->motionControllerHandler->isRunning())
+    {
+        taskRevision = this->motionControllerHandler->getAppliedConfigurationRevision();
+        //signed difference, so the comparison still works once the revision counter overflows
+        if ((int)(taskRevision - appliedRevision) < 0)
+        {
+            appliedRevision = taskRevision;
+        }
+    }
+    if (this->macroExecutorHandler->isRunning())
+    {
+        taskRevision = this->macroExecutorHandler->getAppliedConfigurationRevision();
+        if ((int)(taskRevision - appliedRevision) < 0)
+        {
+            appliedRevision = taskRevision;
+        }
+    }
+    this->serverConfiguration->releaseRetiredStepperConfigurations(appliedRevision);
+}
+
 // ---------------------------------------------------------------------------------
 //                                  Status and Service Functions
 // ---------------------------------------------------------------------------------
@@ -481,21 +634,44 @@ ESPStepperMotorServer_CLI *ESPStepperMotorServer::getCLIHandler() const
     return this->cliHandler;
 }
 
+ESPStepperMotorServer_MacroExecutor *ESPStepperMotorServer::getMacroExecutor() const
+{
+    return this->macroExecutorHandler;
+}
+
+ESPStepperMotorServer_MotionController *ESPStepperMotorServer::getMotionController() const
+{
+    return this->motionControllerHandler;
+}
+
+/**
+ * get the sync controller, NULL if neither enableSyncMaster() nor enableSyncFollower() has been called
+ */
+ESPStepperMotorServer_SyncController *ESPStepperMotorServer::getSyncController() const
+{
+    return this->syncController;
+}
+
+#ifndef ESPStepperMotorServer_COMPILE_NO_GCODE
+ESPStepperMotorServer_GCodeInterpreter *ESPStepperMotorServer::getGCodeInterpreter() const
+{
+    return this->gcodeInterpreterHandler;
+}
+#endif
+
 // ---------------------------------------------------------------------------------
 //                          Web Server and REST API functions
 // ---------------------------------------------------------------------------------
 void ESPStepperMotorServer::startSPIFFS()
 {
-#ifndef ESPStepperMotorServer_COMPILE_NO_DEBUG
-    ESPStepperMotorServer_Logger::logDebug("Checking SPIFFS for existance and free space");
-#endif
+    ESPServerLogDebug("Checking SPIFFS for existance and free space");
     bool spiffsBeginSuccess = SPIFFS.begin();
     if (!spiffsBeginSuccess)
     {
         ESPStepperMotorServer_Logger::logWarning("SPIFFS cannot be mounted, trying to format SPIFFS");
         if (SPIFFS.format())
         {
-            ESPStepperMotorServer_Logger::logInfo("SPIFFS formatted, trying to mount again");
+            ESPServerLogInfo("SPIFFS formatted, trying to mount again");
             spiffsBeginSuccess = SPIFFS.begin();
         }
         else
@@ -510,7 +686,7 @@ void ESPStepperMotorServer::startSPIFFS()
 #ifndef ESPStepperMotorServer_COMPILE_NO_DEBUG
         if (ESPStepperMotorServer_Logger::getLogLevel() >= ESPServerLogLevel_DEBUG)
         {
-            ESPStepperMotorServer_Logger::logDebug("SPIFFS started");
+            ESPServerLogDebug("SPIFFS started");
             printSPIFFSStats();
         }
 #endif
@@ -557,11 +733,11 @@ void ESPStepperMotorServer::printSPIFFSRootFolderContents()
         }
         if (root.isDirectory())
         {
-            ESPStepperMotorServer_Logger::logInfo("Listing files in root folder of SPIFFS:");
+            ESPServerLogInfo("Listing files in root folder of SPIFFS:");
             File file = root.openNextFile();
             while (file)
             {
-                ESPStepperMotorServer_Logger::logInfof("File: %s (%i) %ld\n", file.name(), file.size(), file.getLastWrite());
+                ESPServerLogInfof("File: %s (%i) %ld\n", file.name(), file.size(), file.getLastWrite());
                 file = root.openNextFile();
             }
             root.close();
@@ -591,13 +767,13 @@ void ESPStepperMotorServer::onWebSocketEvent(AsyncWebSocket *server, AsyncWebSoc
 {
     if (type == WS_EVT_CONNECT)
     {
-        ESPStepperMotorServer_Logger::logInfof("ws[%s][%u] connect\n", server->url(), client->id());
+        ESPServerLogInfof("ws[%s][%u] connect\n", server->url(), client->id());
         client->printf("Hello Client %u :)", client->id());
         client->ping();
     }
     else if (type == WS_EVT_DISCONNECT)
     {
-        ESPStepperMotorServer_Logger::logInfof("ws[%s][%i] disconnect: %i\n", server->url(), client->id(), client->id());
+        ESPServerLogInfof("ws[%s][%i] disconnect: %i\n", server->url(), client->id(), client->id());
     }
     else if (type == WS_EVT_ERROR)
     {
@@ -605,7 +781,7 @@ void ESPStepperMotorServer::onWebSocketEvent(AsyncWebSocket *server, AsyncWebSoc
     }
     else if (type == WS_EVT_PONG)
     {
-        ESPStepperMotorServer_Logger::logInfof("ws[%s][%i] pong[%i]: %s\n", server->url(), client->id(), (int)len, (len) ? (char *)data : "");
+        ESPServerLogInfof("ws[%s][%i] pong[%i]: %s\n", server->url(), client->id(), (int)len, (len) ? (char *)data : "");
     }
     else if (type == WS_EVT_DATA)
     {
@@ -697,11 +873,15 @@ void ESPStepperMotorServer::startWebserver()
         printSPIFFSRootFolderContents();
 
         httpServer = new AsyncWebServer(this->serverConfiguration->serverPort);
-        ESPStepperMotorServer_Logger::logInfof("Starting webserver on port %i\n", this->serverConfiguration->serverPort);
+        ESPServerLogInfof("Starting webserver on port %i\n", this->serverConfiguration->serverPort);
 
         webSockerServer = new AsyncWebSocket("/ws");
         webSockerServer->onEvent(std::bind(&ESPStepperMotorServer::onWebSocketEvent, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4, std::placeholders::_5, std::placeholders::_6));
         httpServer->addHandler(webSockerServer);
+        if (this->webSocketLogSink)
+        {
+            this->webSocketLogSink->setWebSocket(webSockerServer);
+        }
 
         if (isWebserverEnabled)
         {
@@ -709,7 +889,11 @@ void ESPStepperMotorServer::startWebserver()
         }
         if (isRestApiEnabled)
         {
+            this->eventPublisherHandler->registerEventSource(this->httpServer);
             this->restApiHandler->registerRestEndpoints(this->httpServer);
+#ifndef ESPStepperMotorServer_COMPILE_NO_GCODE
+            this->gcodeInterpreterHandler->registerWebSocket(this->httpServer);
+#endif
         }
         // SETUP CORS responses/headers
         DefaultHeaders::Instance().addHeader("Access-Control-Allow-Origin", "*");
@@ -728,7 +912,7 @@ void ESPStepperMotorServer::startWebserver()
                                    } });
 
         httpServer->begin();
-        ESPStepperMotorServer_Logger::logInfof("Webserver started, you can now open the user interface on http://%s:%i/\n", this->getIpAddress().c_str(), this->serverConfiguration->serverPort);
+        ESPServerLogInfof("Webserver started, you can now open the user interface on http://%s:%i/\n", this->getIpAddress().c_str(), this->serverConfiguration->serverPort);
     }
 }
 
@@ -740,8 +924,112 @@ void ESPStepperMotorServer::sendSocketMessageToAllClients(const char *message, s
         this->webSockerServer->textAll(message, len);
     }
 }
+
+/**
+ * send all log messages with the given level (or a lower level) as JSON objects to the clients of the web socket on /ws.
+ * The messages are still filtered by the log levels of the modules before they reach the sink
+ */
+void ESPStepperMotorServer::enableWebSocketLogSink(byte logLevel)
+{
+    if (this->webSocketLogSink == NULL)
+    {
+        this->webSocketLogSink = new ESPStepperMotorServer_WebSocketLogSink();
+    }
+    this->webSocketLogSink->setLogLevel(logLevel);
+    if (this->isServerStarted && (this->isWebserverEnabled || this->isRestApiEnabled))
+    {
+        this->webSocketLogSink->setWebSocket(this->webSockerServer);
+    }
+    if (!ESPStepperMotorServer_Logger::addLogSink(this->webSocketLogSink))
+    {
+        ESPStepperMotorServer_Logger::logWarning("Failed to register web socket log sink, too many log sinks registered");
+    }
+}
 #endif
 
+/**
+ * send all log messages with the given level (or a lower level) to the syslog server with the given address
+ */
+void ESPStepperMotorServer::enableSyslogLogSink(IPAddress host, uint16_t port, byte logLevel)
+{
+    if (this->syslogLogSink == NULL)
+    {
+        this->syslogLogSink = new ESPStepperMotorServer_SyslogLogSink(host, port);
+    }
+    else
+    {
+        this->syslogLogSink->setDestination(host, port);
+    }
+    this->syslogLogSink->setLogLevel(logLevel);
+    if (!ESPStepperMotorServer_Logger::addLogSink(this->syslogLogSink))
+    {
+        ESPStepperMotorServer_Logger::logWarning("Failed to register syslog log sink, too many log sinks registered");
+    }
+}
+
+/**
+ * store the positions of all steppers in the position journal, so they can be restored after a reboot without homing the steppers again.
+ * storageType: ESPServerPositionJournalStorage_RTC (survives software resets only) or ESPServerPositionJournalStorage_NVS (also survives a power loss).
+ * Must be called before start(), since the positions are restored when the server is started
+ */
+void ESPStepperMotorServer::enablePositionJournal(byte storageType)
+{
+    if (this->isServerStarted)
+    {
+        ESPStepperMotorServer_Logger::logWarning("The position journal must be enabled before the server is started");
+        return;
+    }
+    if (this->positionJournal == NULL)
+    {
+        this->positionJournal = new ESPStepperMotorServer_PositionJournal(storageType);
+    }
+}
+
+/**
+ * run this server as sync master: its clock and all segments sent with getSyncController()->sendSegment() are broadcast via UDP
+ * to the followers on the given port, so moves of steppers connected to different servers start at the same time.
+ * Must be called before start()
+ */
+void ESPStepperMotorServer::enableSyncMaster(uint16_t port)
+{
+    if (this->isServerStarted || this->syncController)
+    {
+        ESPStepperMotorServer_Logger::logWarning("The sync mode must be enabled once before the server is started");
+        return;
+    }
+    this->syncController = new ESPStepperMotorServer_SyncController(this, ESPServerSyncRole_Master, 0, port);
+}
+
+/**
+ * run this server as sync follower with the given node id (1-254): it tracks the clock of the master and starts the moves
+ * of the received segments that are addressed to this node id at the start time given by the master. Must be called before start()
+ */
+void ESPStepperMotorServer::enableSyncFollower(byte nodeId, uint16_t port)
+{
+    if (this->isServerStarted || this->syncController)
+    {
+        ESPStepperMotorServer_Logger::logWarning("The sync mode must be enabled once before the server is started");
+        return;
+    }
+    if (nodeId == 0 || nodeId == 255)
+    {
+        ESPStepperMotorServer_Logger::logWarningf("Invalid sync node id %i, must be in the range of 1 to 254\n", nodeId);
+        return;
+    }
+    this->syncController = new ESPStepperMotorServer_SyncController(this, ESPServerSyncRole_Follower, nodeId, port);
+}
+
+/**
+ * stop sending log messages to the web socket and syslog sinks. The sinks are kept and can be enabled again
+ */
+void ESPStepperMotorServer::disableRemoteLogSinks()
+{
+#ifndef ESPStepperMotorServer_COMPILE_NO_WEB
+    ESPStepperMotorServer_Logger::removeLogSink(this->webSocketLogSink);
+#endif
+    ESPStepperMotorServer_Logger::removeLogSink(this->syslogLogSink);
+}
+
 String ESPStepperMotorServer::getIpAddress()
 {
     if (this->serverConfiguration->wifiMode == ESPServerWifiModeAccessPoint)
@@ -764,7 +1052,7 @@ String ESPStepperMotorServer::getIpAddress()
  */
 void ESPStepperMotorServer::getServerStatusAsJsonString(String &statusString)
 {
-    StaticJsonDocument<200> doc;
+    StaticJsonDocument<1344> doc;
     JsonObject root = doc.to<JsonObject>();
     root["version"] = this->version;
 
@@ -788,6 +1076,50 @@ void ESPStepperMotorServer::getServerStatusAsJsonString(String &statusString)
     activeModules["rest_api"] = (this->isRestApiEnabled);
     activeModules["web_ui"] = (this->isWebserverEnabled);
 
+    ESPStepperMotorServer_Configuration::addPoolStatisticsToJsonObject(root.createNestedObject("objectPools"));
+    root["droppedLogMessages"] = ESPStepperMotorServer_Logger::getDroppedMessageCount();
+    root["motionLoopRate"] = this->motionControllerHandler->getLoopRate();
+
+    // time from a switch edge to the dispatch of its macro and to the first step of the first move action of the macro
+    JsonObject macroLatencyStatus = root.createNestedObject("macroLatency");
+    const ESPStepperMotorServer_LatencyStatistics *latencyStatistics[] = {&this->macroExecutorHandler->getDispatchLatency(), &this->motionControllerHandler->getMacroFirstStepLatency()};
+    const char *latencyNames[] = {"dispatch", "firstStep"};
+    for (byte i = 0; i < 2; i++)
+    {
+        JsonObject latencyStatus = macroLatencyStatus.createNestedObject(latencyNames[i]);
+        latencyStatus["count"] = latencyStatistics[i]->getSampleCount();
+        latencyStatus["minMicros"] = latencyStatistics[i]->getMinMicros();
+        latencyStatus["avgMicros"] = latencyStatistics[i]->getAverageMicros();
+        latencyStatus["maxMicros"] = latencyStatistics[i]->getMaxMicros();
+    }
+
+    JsonObject heapStatus = root.createNestedObject("heap");
+    heapStatus["free"] = ESP.getFreeHeap();
+    heapStatus["minFree"] = ESP.getMinFreeHeap();
+    heapStatus["maxAlloc"] = ESP.getMaxAllocHeap();
+    if (this->positionJournal)
+    {
+        JsonObject positionJournalStatus = root.createNestedObject("positionJournal");
+        positionJournalStatus["storage"] = (this->positionJournal->getStorageType() == ESPServerPositionJournalStorage_RTC) ? "rtc" : "nvs";
+        positionJournalStatus["restoredSteppers"] = this->positionJournal->getRestoredStepperCount();
+        positionJournalStatus["writes"] = this->positionJournal->getWriteCount();
+    }
+    if (this->syncController)
+    {
+        JsonObject syncStatus = root.createNestedObject("sync");
+        syncStatus["role"] = (this->syncController->getRole() == ESPServerSyncRole_Master) ? "master" : "follower";
+        syncStatus["nodeId"] = this->syncController->getNodeId();
+        syncStatus["clockSynchronized"] = this->syncController->isClockSynchronized();
+        syncStatus["clockErrorMicros"] = this->syncController->getLastClockErrorMicros();
+        syncStatus["networkDelayMicros"] = this->syncController->getNetworkDelayMicros();
+        syncStatus["clockDriftPpm"] = this->syncController->getClockDriftPpm();
+        syncStatus["clockResyncs"] = this->syncController->getClockResyncCount();
+        syncStatus["executedSegments"] = this->syncController->getExecutedSegmentCount();
+        syncStatus["droppedSegments"] = this->syncController->getDroppedSegmentCount();
+        syncStatus["maxStartDelayMicros"] = this->syncController->getMaxStartDelayMicros();
+        syncStatus["packetErrors"] = this->syncController->getPacketErrorCount();
+    }
+
     serializeJson(root, statusString);
 }
 
@@ -801,7 +1133,7 @@ bool ESPStepperMotorServer::isIoPinUsed(int pinToCheck)
     for (int i = 0; i < ESPServerMaxSteppers; i++)
     {
         ESPStepperMotorServer_StepperConfiguration *stepperConfig = this->serverConfiguration->getStepperConfiguration(i);
-        if (stepperConfig && (stepperConfig->getDirectionIoPin() == pinToCheck || stepperConfig->getStepIoPin() == pinToCheck || stepperConfig->getBrakeIoPin() == pinToCheck))
+        if (stepperConfig && (stepperConfig->getDirectionIoPin() == pinToCheck || stepperConfig->getStepIoPin() == pinToCheck || stepperConfig->getBrakeIoPin() == pinToCheck || stepperConfig->getEnableIoPin() == pinToCheck))
         {
             return true;
         }
@@ -815,6 +1147,14 @@ bool ESPStepperMotorServer::isIoPinUsed(int pinToCheck)
             return true;
         }
     }
+#ifdef ESPStepperMotorServer_USE_SHIFT_REGISTER_OUTPUT
+    // pins used to feed the shift register chain
+    if (pinToCheck == ESPServerShiftRegisterDataPin || pinToCheck == ESPServerShiftRegisterClockPin ||
+        pinToCheck == ESPServerShiftRegisterLatchPin || pinToCheck == ESPServerShiftRegisterPlaceholderPin)
+    {
+        return true;
+    }
+#endif
     return false;
 
     // check encoder configurations
@@ -864,7 +1204,7 @@ void ESPStepperMotorServer::setWifiMode(byte wifiMode)
 
 void ESPStepperMotorServer::printCompileSettings()
 {
-    ESPStepperMotorServer_Logger::logDebugf("ESPStepperMotorServer compile settings (marcos):\nMax steppers: %i\nMax switches: %i\nMax encoders: %i\n", ESPServerMaxSteppers, ESPServerMaxSwitches, ESPServerMaxRotaryEncoders);
+    ESPServerLogDebugf("ESPStepperMotorServer compile settings (marcos):\nMax steppers: %i\nMax switches: %i\nMax encoders: %i\n", ESPServerMaxSteppers, ESPServerMaxSwitches, ESPServerMaxRotaryEncoders);
 }
 
 /**
@@ -872,29 +1212,29 @@ void ESPStepperMotorServer::printCompileSettings()
  */
 void ESPStepperMotorServer::printWifiStatus()
 {
-    ESPStepperMotorServer_Logger::logInfo("ESPStepperMotorServer WiFi details:");
+    ESPServerLogInfo("ESPStepperMotorServer WiFi details:");
 
     if (this->serverConfiguration->staticIP != 0)
     {
-        ESPStepperMotorServer_Logger::logInfof("Static IP address has been configured:\nIP: %s\nGateway: %s\nSubnet Mask:%s\n", this->serverConfiguration->staticIP.toString().c_str(), this->serverConfiguration->gatewayIP.toString().c_str(), this->serverConfiguration->subnetMask.toString().c_str());
+        ESPServerLogInfof("Static IP address has been configured:\nIP: %s\nGateway: %s\nSubnet Mask:%s\n", this->serverConfiguration->staticIP.toString().c_str(), this->serverConfiguration->gatewayIP.toString().c_str(), this->serverConfiguration->subnetMask.toString().c_str());
     }
 
     if (this->serverConfiguration->wifiMode == ESPServerWifiModeClient)
     {
-        ESPStepperMotorServer_Logger::logInfo("WiFi status: server acts as wifi client in existing network with DHCP");
-        ESPStepperMotorServer_Logger::logInfof("SSID: %s\n", this->getCurrentServerConfiguration()->wifiSsid);
-        ESPStepperMotorServer_Logger::logInfof("IP address: %s\n", WiFi.localIP().toString().c_str());
-        ESPStepperMotorServer_Logger::logInfof("Strength: %i dBm\n", WiFi.RSSI()); // Received Signal Strength Indicator
+        ESPServerLogInfo("WiFi status: server acts as wifi client in existing network with DHCP");
+        ESPServerLogInfof("SSID: %s\n", this->getCurrentServerConfiguration()->wifiSsid);
+        ESPServerLogInfof("IP address: %s\n", WiFi.localIP().toString().c_str());
+        ESPServerLogInfof("Strength: %i dBm\n", WiFi.RSSI()); // Received Signal Strength Indicator
     }
     else if (this->serverConfiguration->wifiMode == ESPServerWifiModeAccessPoint)
     {
-        ESPStepperMotorServer_Logger::logInfo("WiFi status: access point started");
-        ESPStepperMotorServer_Logger::logInfof("SSID: %s\n", this->serverConfiguration->apName);
-        ESPStepperMotorServer_Logger::logInfof("IP Address: %s\n", WiFi.softAPIP().toString().c_str());
+        ESPServerLogInfo("WiFi status: access point started");
+        ESPServerLogInfof("SSID: %s\n", this->serverConfiguration->apName);
+        ESPServerLogInfof("IP Address: %s\n", WiFi.softAPIP().toString().c_str());
     }
     else
     {
-        ESPStepperMotorServer_Logger::logInfo("WiFi is disabled");
+        ESPServerLogInfo("WiFi is disabled");
     }
 }
 
@@ -926,20 +1266,20 @@ void ESPStepperMotorServer::setStaticIpAddress(IPAddress staticIP, IPAddress gat
 void ESPStepperMotorServer::startAccessPoint()
 {
     WiFi.softAP(this->serverConfiguration->apName, this->serverConfiguration->apPassword);
-    ESPStepperMotorServer_Logger::logInfof("Started Access Point with name %s and IP %s\n", this->serverConfiguration->apName, WiFi.softAPIP().toString().c_str());
+    ESPServerLogInfof("Started Access Point with name %s and IP %s\n", this->serverConfiguration->apName, WiFi.softAPIP().toString().c_str());
 }
 
 void ESPStepperMotorServer::connectToWifiNetwork()
 {
     if (WiFi.status() == WL_CONNECTED)
     {
-        ESPStepperMotorServer_Logger::logInfo("Module is already conencted to WiFi network. Will skip WiFi connection procedure");
+        ESPServerLogInfo("Module is already conencted to WiFi network. Will skip WiFi connection procedure");
         return;
     }
 
     if (this->serverConfiguration->staticIP != 0)
     {
-        ESPStepperMotorServer_Logger::logInfof("Static IP address has been configured, will use %s\n", this->serverConfiguration->staticIP.toString().c_str());
+        ESPServerLogInfof("Static IP address has been configured, will use %s\n", this->serverConfiguration->staticIP.toString().c_str());
         WiFi.config(this->serverConfiguration->staticIP, this->serverConfiguration->gatewayIP, this->serverConfiguration->subnetMask, this->serverConfiguration->dns1IP, this->serverConfiguration->dns2IP);
     }
 
@@ -950,7 +1290,7 @@ void ESPStepperMotorServer::connectToWifiNetwork()
     }
 
     bool noWifiPwd = (!this->getCurrentServerConfiguration()->wifiPassword || this->getCurrentServerConfiguration()->wifiPassword[0] == '\0');
-    ESPStepperMotorServer_Logger::logInfof("Trying to connect to WiFi with SSID '%s' %s...", this->getCurrentServerConfiguration()->wifiSsid, (noWifiPwd ? "without password" : ""));
+    ESPServerLogInfof("Trying to connect to WiFi with SSID '%s' %s...", this->getCurrentServerConfiguration()->wifiSsid, (noWifiPwd ? "without password" : ""));
     if (noWifiPwd)
     {
         WiFi.begin(this->getCurrentServerConfiguration()->wifiSsid);
@@ -964,25 +1304,23 @@ void ESPStepperMotorServer::connectToWifiNetwork()
     while (WiFi.status() != WL_CONNECTED && timeoutCounter > 0)
     {
         delay(retryIntervalMs);
-        ESPStepperMotorServer_Logger::logInfo(".", false, true);
+        ESPServerLogInfo(".", false, true);
         if (timeoutCounter == (this->wifiClientConnectionTimeoutSeconds * 2 - 3))
         {
             WiFi.reconnect();
         }
         timeoutCounter--;
     }
-    ESPStepperMotorServer_Logger::logInfo("\n", false, true);
+    ESPServerLogInfo("\n", false, true);
 
     if (timeoutCounter > 0)
     {
-        ESPStepperMotorServer_Logger::logInfof("Connected to network with IP address %s\n", WiFi.localIP().toString().c_str());
+        ESPServerLogInfof("Connected to network with IP address %s\n", WiFi.localIP().toString().c_str());
     }
     else
     {
         ESPStepperMotorServer_Logger::logWarningf("Connection to WiFi network with SSID '%s' failed with timeout\n", this->getCurrentServerConfiguration()->wifiSsid);
-#ifndef ESPStepperMotorServer_COMPILE_NO_DEBUG
-        ESPStepperMotorServer_Logger::logDebugf("Connection timeout is set to %i seconds\n", this->wifiClientConnectionTimeoutSeconds);
-#endif
+        ESPServerLogDebugf("Connection timeout is set to %i seconds\n", this->wifiClientConnectionTimeoutSeconds);
         ESPStepperMotorServer_Logger::logWarningf("starting server in access point mode with SSID '%s' and password '%s' as fallback\n", this->serverConfiguration->apName, this->serverConfiguration->apPassword);
         this->setWifiMode(ESPServerWifiModeAccessPoint);
         this->startAccessPoint();
@@ -1019,9 +1357,7 @@ void ESPStepperMotorServer::setupPositionSwitchIOPin(ESPStepperMotorServer_Posit
     {
         if (posSwitch->isActiveHigh())
         {
-#ifndef ESPStepperMotorServer_COMPILE_NO_DEBUG
-            ESPStepperMotorServer_Logger::logDebugf("Setting up IO pin %i as input for active high switch '%s' (%i)\n", posSwitch->getIoPinNumber(), posSwitch->getPositionName().c_str(), posSwitch->getId());
-#endif
+            ESPServerLogDebugf("Setting up IO pin %i as input for active high switch '%s' (%i)\n", posSwitch->getIoPinNumber(), posSwitch->getPositionName().c_str(), posSwitch->getId());
             pinMode(posSwitch->getIoPinNumber(), INPUT);
         }
         else
@@ -1030,9 +1366,7 @@ void ESPStepperMotorServer::setupPositionSwitchIOPin(ESPStepperMotorServer_Posit
             {
                 ESPStepperMotorServer_Logger::logWarningf("The configured IO pin %i cannot be used for active low switches unless an external pull up resistor is in place. The ESP does not provide internal pullups on this IO pin. Make sure you have a pull up resistor in place for the switch %s (%i)\n", posSwitch->getIoPinNumber(), posSwitch->getPositionName(), posSwitch->getId());
             }
-#ifndef ESPStepperMotorServer_COMPILE_NO_DEBUG
-            ESPStepperMotorServer_Logger::logDebugf("Setting up IO pin %i as input with pullup for active low switch '%s' (%i)\n", posSwitch->getIoPinNumber(), posSwitch->getPositionName().c_str(), posSwitch->getId());
-#endif
+            ESPServerLogDebugf("Setting up IO pin %i as input with pullup for active low switch '%s' (%i)\n", posSwitch->getIoPinNumber(), posSwitch->getPositionName().c_str(), posSwitch->getId());
             pinMode(posSwitch->getIoPinNumber(), INPUT_PULLUP);
         }
     }
@@ -1041,13 +1375,9 @@ void ESPStepperMotorServer::setupPositionSwitchIOPin(ESPStepperMotorServer_Posit
 void ESPStepperMotorServer::setupRotaryEncoderIOPin(ESPStepperMotorServer_RotaryEncoder *rotaryEncoder)
 {
 // set Pins for encoder
-#ifndef ESPStepperMotorServer_COMPILE_NO_DEBUG
-    ESPStepperMotorServer_Logger::logDebugf("Setting up IO pin %i as Pin A input with internal pullup for rotary encoder '%s' (%i)\n", rotaryEncoder->getPinAIOPin(), rotaryEncoder->getDisplayName().c_str(), rotaryEncoder->getId());
-#endif
+    ESPServerLogDebugf("Setting up IO pin %i as Pin A input with internal pullup for rotary encoder '%s' (%i)\n", rotaryEncoder->getPinAIOPin(), rotaryEncoder->getDisplayName().c_str(), rotaryEncoder->getId());
     pinMode(rotaryEncoder->getPinAIOPin(), INPUT_PULLUP);
-#ifndef ESPStepperMotorServer_COMPILE_NO_DEBUG
-    ESPStepperMotorServer_Logger::logDebugf("Setting up IO pin %i as Pin B input with internal pullup for rotary encoder '%s' (%i)\n", rotaryEncoder->getPinBIOPin(), rotaryEncoder->getDisplayName().c_str(), rotaryEncoder->getId());
-#endif
+    ESPServerLogDebugf("Setting up IO pin %i as Pin B input with internal pullup for rotary encoder '%s' (%i)\n", rotaryEncoder->getPinBIOPin(), rotaryEncoder->getDisplayName().c_str(), rotaryEncoder->getId());
     pinMode(rotaryEncoder->getPinBIOPin(), INPUT_PULLUP);
 }
 
@@ -1099,17 +1429,13 @@ void ESPStepperMotorServer::attachAllInterrupts()
                 // register emergency stop switches
                 if (posSwitch->isEmergencySwitch())
                 {
-#ifndef ESPStepperMotorServer_COMPILE_NO_DEBUG
-                    ESPStepperMotorServer_Logger::logDebugf("Attaching interrupt service routine for emergency stop switch '%s' on IO pin %i\n", posSwitch->getPositionName().c_str(), posSwitch->getIoPinNumber());
-#endif
+                    ESPServerLogDebugf("Attaching interrupt service routine for emergency stop switch '%s' on IO pin %i\n", posSwitch->getPositionName().c_str(), posSwitch->getIoPinNumber());
                     attachInterrupt(irqNum, staticEmergencySwitchISR, CHANGE);
                 }
                 // register limit switches
                 else if (posSwitch->isLimitSwitch())
                 {
-#ifndef ESPStepperMotorServer_COMPILE_NO_DEBUG
-                    ESPStepperMotorServer_Logger::logDebugf("Attaching interrupt service routine for limit switch '%s' on IO pin %i\n", posSwitch->getPositionName().c_str(), posSwitch->getIoPinNumber());
-#endif
+                    ESPServerLogDebugf("Attaching interrupt service routine for limit switch '%s' on IO pin %i\n", posSwitch->getPositionName().c_str(), posSwitch->getIoPinNumber());
                     if (posSwitch->isTypeBitSet(SWITCHTYPE_LIMITSWITCH_POS_END_BIT))
                     {
                         attachInterrupt(irqNum, staticLimitSwitchISR_POS_END, CHANGE);
@@ -1126,9 +1452,7 @@ void ESPStepperMotorServer::attachAllInterrupts()
                 // register general position switches & others
                 else
                 {
-#ifndef ESPStepperMotorServer_COMPILE_NO_DEBUG
-                    ESPStepperMotorServer_Logger::logDebugf("Attaching interrupt service routine for general position switch '%s' on IO pin %i\n", posSwitch->getPositionName().c_str(), posSwitch->getIoPinNumber());
-#endif
+                    ESPServerLogDebugf("Attaching interrupt service routine for general position switch '%s' on IO pin %i\n", posSwitch->getPositionName().c_str(), posSwitch->getIoPinNumber());
                     attachInterrupt(irqNum, staticPositionSwitchISR, CHANGE);
                 }
             }
@@ -1159,17 +1483,13 @@ void ESPStepperMotorServer::attachAllInterrupts()
 
 void ESPStepperMotorServer::detachInterruptForPositionSwitch(ESPStepperMotorServer_PositionSwitch *posSwitch)
 {
-#ifndef ESPStepperMotorServer_COMPILE_NO_DEBUG
-    ESPStepperMotorServer_Logger::logDebugf("detaching interrupt for position switch %s on IO Pin %i\n", posSwitch->getPositionName().c_str(), posSwitch->getIoPinNumber());
-#endif
+    ESPServerLogDebugf("detaching interrupt for position switch %s on IO Pin %i\n", posSwitch->getPositionName().c_str(), posSwitch->getIoPinNumber());
     detachInterrupt(digitalPinToInterrupt(posSwitch->getIoPinNumber()));
 }
 
 void ESPStepperMotorServer::detachInterruptForRotaryEncoder(ESPStepperMotorServer_RotaryEncoder *rotaryEncoder)
 {
-#ifndef ESPStepperMotorServer_COMPILE_NO_DEBUG
-    ESPStepperMotorServer_Logger::logDebugf("detaching interrupts for rotary encoder %s on IO Pins %i and %i\n", rotaryEncoder->getDisplayName().c_str(), rotaryEncoder->getPinAIOPin(), rotaryEncoder->getPinBIOPin());
-#endif
+    ESPServerLogDebugf("detaching interrupts for rotary encoder %s on IO Pins %i and %i\n", rotaryEncoder->getDisplayName().c_str(), rotaryEncoder->getPinAIOPin(), rotaryEncoder->getPinBIOPin());
     // Pin A of rotary encoder
     if (digitalPinToInterrupt(rotaryEncoder->getPinAIOPin()) != NOT_AN_INTERRUPT)
     {
@@ -1216,6 +1536,7 @@ void ESPStepperMotorServer::detachAllInterrupts()
 void ESPStepperMotorServer::performEmergencyStop(int stepperId)
 {
     this->emergencySwitchIsActive = true;
+    this->emergencyStopCounter++;
     // only perform emergency stop for one stepper
     if (stepperId > -1 && stepperId != 255)
     {
@@ -1228,17 +1549,11 @@ void ESPStepperMotorServer::performEmergencyStop(int stepperId)
     else
     {
         // perform complete stop on all steppers
-        ESP_FlexyStepper **configuredFlexySteppers = this->serverConfiguration->getConfiguredFlexySteppers();
-        for (byte i = 0; i < ESPServerMaxSteppers; i++)
+        ESPStepperMotorServer_ActiveAxis activeAxes[ESPServerMaxSteppers];
+        const byte activeAxisCount = this->serverConfiguration->copyActiveAxes(activeAxes);
+        for (byte i = 0; i < activeAxisCount; i++)
         {
-            if (configuredFlexySteppers[i])
-            {
-                configuredFlexySteppers[i]->emergencyStop();
-            }
-            else
-            {
-                break;
-            }
+            activeAxes[i].flexyStepper->emergencyStop();
         }
     }
 }
@@ -1274,19 +1589,13 @@ signed char ESPStepperMotorServer::updateSwitchStatusRegister()
 
             if (currentPinState == HIGH && previousPinState == LOW)
             {
-#ifndef ESPStepperMotorServer_COMPILE_NO_DEBUG
-                if (ESPStepperMotorServer_Logger::isDebugEnabled())
-                    ESPStepperMotorServer_Logger::logDebugf("Setting bit %i to high in register for switch %i with io pin %i\n", (switchIndex % 8), switchIndex, ioPin);
-#endif
+                ESPServerLogDebugf("Setting bit %i to high in register for switch %i with io pin %i\n", (switchIndex % 8), switchIndex, ioPin);
                 bitSet(this->buttonStatus[registerIndex], switchIndex % 8);
                 changedSwitchIndex = switchIndex;
             }
             else if (currentPinState == LOW && previousPinState == HIGH)
             {
-#ifndef ESPStepperMotorServer_COMPILE_NO_DEBUG
-                if (ESPStepperMotorServer_Logger::isDebugEnabled())
-                    ESPStepperMotorServer_Logger::logDebugf("Setting bit %i to low in register for switch %i with io pin %i\n", (switchIndex % 8), switchIndex, ioPin);
-#endif
+                ESPServerLogDebugf("Setting bit %i to low in register for switch %i with io pin %i\n", (switchIndex % 8), switchIndex, ioPin);
                 bitClear(buttonStatus[registerIndex], switchIndex % 8);
                 changedSwitchIndex = switchIndex;
             }
@@ -1366,6 +1675,27 @@ void IRAM_ATTR ESPStepperMotorServer::internalEmergencySwitchISR()
 void IRAM_ATTR ESPStepperMotorServer::internalSwitchISR(byte switchType)
 {
     signed char changedStausSwitchId = this->updateSwitchStatusRegister();
+    if (changedStausSwitchId > -1)
+    {
+        ESPStepperMotorServer_PositionSwitch *changedSwitch = this->serverConfiguration->allConfiguredSwitches[changedStausSwitchId];
+        if (changedSwitch)
+        {
+            bool isActiveHigh = changedSwitch->_switchType & (1 << (SWITCHTYPE_STATE_ACTIVE_HIGH_BIT - 1));
+            bool inputState = digitalRead(changedSwitch->_ioPinNumber);
+            if (inputState == isActiveHigh)
+            {
+                // the macro (if any) is executed by the macro executor task, not in the ISR
+                this->macroExecutorHandler->triggerMacroFromISR(changedStausSwitchId);
+            }
+#ifndef ESPStepperMotorServer_COMPILE_NO_WEB
+            if (this->eventPublisherHandler)
+            {
+                ESPStepperMotorServer_Event event = {ESPServerEventType_Switch, (byte)changedStausSwitchId, (inputState == isActiveHigh), 0, millis()};
+                this->eventPublisherHandler->publishFromISR(event);
+            }
+#endif
+        }
+    }
     if (changedStausSwitchId > -1 && (switchType == SWITCHTYPE_LIMITSWITCH_POS_BEGIN_BIT || switchType == SWITCHTYPE_LIMITSWITCH_POS_END_BIT || switchType == SWITCHTYPE_LIMITSWITCH_COMBINED_BEGIN_END_BIT))
     {
         ESPStepperMotorServer_Configuration *configuration = this->serverConfiguration;
@@ -1400,7 +1730,7 @@ void IRAM_ATTR ESPStepperMotorServer::internalSwitchISR(byte switchType)
         }
         else
         {
-            ESPStepperMotorServer_Logger::logWarningf("A IO Pin change has been detected for switch id %i which is not a limit switch, but the ISR was triggered for a switch of type limit switch. It is possible that a limit switch status change has not been detected properly\n", changedStausSwitchId);
+            ESPStepperMotorServer_Logger::logWarningfFromISR("A IO Pin change has been detected for switch id %i which is not a limit switch, but the ISR was triggered for a switch of type limit switch. It is possible that a limit switch status change has not been detected properly\n", changedStausSwitchId);
         }
     }
 }
@@ -1420,19 +1750,21 @@ void IRAM_ATTR ESPStepperMotorServer::internalRotaryEncoderISR()
             ESPStepperMotorServer_StepperConfiguration *stepperConfig = configuration->configuredSteppers[rotaryEncoder->_stepperIndex];
             if (stepperConfig)
             {
+                // the soft limits only need to be checked once per encoder step, rejected targets are simply dropped
                 if (result == DIR_CW)
                 {
-                    stepperConfig->_flexyStepper->setTargetPositionRelativeInSteps(1 * rotaryEncoder->_stepMultiplier);
+                    long newPosition = stepperConfig->_flexyStepper->getCurrentPositionInSteps() + (long)rotaryEncoder->_stepMultiplier;
+                    stepperConfig->setTargetPositionWithinSoftLimits(newPosition);
                 }
                 else if (result == DIR_CCW)
                 {
-                    signed long newPosition = -1L * rotaryEncoder->_stepMultiplier;
-                    stepperConfig->_flexyStepper->setTargetPositionRelativeInSteps(newPosition);
+                    long newPosition = stepperConfig->_flexyStepper->getCurrentPositionInSteps() - (long)rotaryEncoder->_stepMultiplier;
+                    stepperConfig->setTargetPositionWithinSoftLimits(newPosition);
                 }
             }
             else
             {
-                ESPStepperMotorServer_Logger::logWarningf("Invalid stepper config id %i for rotary enc. (id=%i)\n", rotaryEncoder->_stepperIndex, i);
+                ESPStepperMotorServer_Logger::logWarningfFromISR("Invalid stepper config id %i for rotary enc. (id=%i)\n", rotaryEncoder->_stepperIndex, i);
             }
         }
     }
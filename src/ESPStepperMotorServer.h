@@ -11,7 +11,7 @@
 // for a good Arduino/ESP base Gerber compatible controller Project see:
 // https://github.com/gnea/grbl
 // and for ESP32: https://github.com/bdring/Grbl_Esp32
-// currently no G-Code (http://linuxcnc.org/docs/html/gcode.html) parser is implemented, yet it might be part of a future release
+// a small subset of G-Code (http://linuxcnc.org/docs/html/gcode.html) is supported by the ESPStepperMotorServer_GCodeInterpreter (G0, G1, G28, G90, G91 and M400)
 // other usefull informaion when connecting your ESP32 board to your driver boards and you are not sure which pins to use: https://randomnerdtutorials.com/esp32-pinout-reference-gpios/
 
 // MIT License
@@ -39,12 +39,31 @@
 #ifndef ESPStepperMotorServer_h
 #define ESPStepperMotorServer_h
 
+// the capacity limits for the configuration entities. These can be overridden with build flags (e.g. -D ESPServerMaxSteppers=3)
+// to reduce the RAM usage for smaller setups or to allow more entities for larger setups (each value must be smaller than 255)
+#ifndef ESPServerMaxSwitches
 #define ESPServerMaxSwitches 10
-#define ESPServerSwitchStatusRegisterCount 2 //NOTE: this value must be chosen according to the value of ESPServerMaxSwitches: val = ceil(ESPServerMaxSwitches / 8)
+#endif
+#ifndef ESPServerMaxSteppers
 #define ESPServerMaxSteppers 10
+#endif
+#ifndef ESPServerMaxRotaryEncoders
 #define ESPServerMaxRotaryEncoders 5
+#endif
+// the maximum number of macro actions (summed up over all switches) that can be compiled for the macro executor
+#ifndef ESPServerMaxMacroInstructions
+#define ESPServerMaxMacroInstructions 64
+#endif
+// the number of macro action objects that are kept in the object pool (some spare slots are needed, since the new actions are created before the old ones get released when a switch is updated)
+#ifndef ESPServerMacroActionPoolSize
+#define ESPServerMacroActionPoolSize (ESPServerMaxMacroInstructions + 16)
+#endif
 #define ESPStepperMotorServer_SwitchDisplayName_MaxLength 20
 
+#include <ESPStepperMotorServer_Registry.h>
+// the number of 8 bit status registers needed to hold the status of all switches, derived at compile time from ESPServerMaxSwitches
+#define ESPServerSwitchStatusRegisterCount ESPStepperMotorServer_getRequiredRegisterCount(ESPServerMaxSwitches)
+
 #include <ESP_FlexyStepper.h>
 #include <SPIFFS.h>
 #include <ArduinoJson.h>
@@ -58,14 +77,23 @@
 #include <ESPStepperMotorServer_CLI.h>
 #include <ESPStepperMotorServer_Configuration.h>
 #include <ESPStepperMotorServer_MotionController.h>
+#include <ESPStepperMotorServer_MacroExecutor.h>
 #include <ESPStepperMotorServer_MacroAction.h>
 #include <ESPStepperMotorServer_PositionSwitch.h>
 #include <ESPStepperMotorServer_StepperConfiguration.h>
 #include <ESPStepperMotorServer_RotaryEncoder.h>
 #include <ESPStepperMotorServer_Logger.h>
+#include <ESPStepperMotorServer_LogSinks.h>
+#include <ESPStepperMotorServer_PositionJournal.h>
+#include <ESPStepperMotorServer_SyncController.h>
+#include <ESPStepperMotorServer_ShiftRegisterOutput.h>
+#ifndef ESPStepperMotorServer_COMPILE_NO_GCODE
+#include <ESPStepperMotorServer_GCodeInterpreter.h>
+#endif
 
 #ifndef ESPStepperMotorServer_COMPILE_NO_WEB
 #include <ESPStepperMotorServer_RestAPI.h>
+#include <ESPStepperMotorServer_EventPublisher.h>
 #endif
 
 #define ESPServerWifiModeDisabled 0
@@ -91,11 +119,17 @@ class ESPStepperMotorServer_CLI;
 class ESPStepperMotorServer_RestAPI;
 class ESPStepperMotorServer_Configuration;
 class ESPStepperMotorServer_MotionController;
+class ESPStepperMotorServer_MacroExecutor;
 class ESPStepperMotorServer_MacroAction;
+class ESPStepperMotorServer_SyncController;
+#ifndef ESPStepperMotorServer_COMPILE_NO_GCODE
+class ESPStepperMotorServer_GCodeInterpreter;
+#endif
 
 #ifndef ESPStepperMotorServer_COMPILE_NO_WEB
 class ESPStepperMotorServer_WebInterface;
 class ESPStepperMotorServer_RestAPI;
+class ESPStepperMotorServer_EventPublisher;
 #endif
 //
 // the ESPStepperMotorServer class
@@ -113,7 +147,13 @@ public:
   void setHttpPort(int portNumber);
   void onWebSocketEvent(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventType type, void *arg, uint8_t *data, size_t len);
   void sendSocketMessageToAllClients(const char *message, size_t len);
+  void enableWebSocketLogSink(byte logLevel = ESPServerLogLevel_INFO);
 #endif
+  void enableSyslogLogSink(IPAddress host, uint16_t port = ESPServerSyslogDefaultPort, byte logLevel = ESPServerLogLevel_INFO);
+  void disableRemoteLogSinks();
+  void enablePositionJournal(byte storageType = ESPServerPositionJournalStorage_NVS);
+  void enableSyncMaster(uint16_t port = ESPServerSyncDefaultPort);
+  void enableSyncFollower(byte nodeId, uint16_t port = ESPServerSyncDefaultPort);
 
   void setAccessPointName(const char *accessPointSSID);
   void setAccessPointPassword(const char *accessPointPassword);
@@ -130,6 +170,7 @@ public:
   void removePositionSwitch(int positionSwitchIndex);
   void removeStepper(byte stepperConfigurationIndex);
   void removeRotaryEncoder(byte rotaryEncoderConfigurationIndex);
+  void releaseRetiredConfigurationEntities();
   void getFormattedPositionSwitchStatusRegister(byte registerIndex, String &output);
   void printPositionSwitchStatus();
   void performEmergencyStop(int stepperIndex = -1);
@@ -141,6 +182,12 @@ public:
   String getIpAddress();
   ESPStepperMotorServer_Configuration *getCurrentServerConfiguration();
   ESPStepperMotorServer_CLI *getCLIHandler() const;
+  ESPStepperMotorServer_MacroExecutor *getMacroExecutor() const;
+  ESPStepperMotorServer_MotionController *getMotionController() const;
+  ESPStepperMotorServer_SyncController *getSyncController() const;
+#ifndef ESPStepperMotorServer_COMPILE_NO_GCODE
+  ESPStepperMotorServer_GCodeInterpreter *getGCodeInterpreter() const;
+#endif
   void requestReboot(String rebootReason);
   bool isSPIFFSMounted();
 
@@ -157,6 +204,8 @@ public:
   int wifiClientConnectionTimeoutSeconds = 25;
   // a boolean indicating if a position switch that has been configure as emegrency switch, has been triggered
   volatile boolean emergencySwitchIsActive = false;
+  // counts the calls of performEmergencyStop, used to find out if an emergency stop has been triggered again in the meantime
+  volatile unsigned int emergencyStopCounter = 0;
 
   const char *version = "0.4.7";
 
@@ -215,10 +264,19 @@ private:
   ESPStepperMotorServer_RestAPI *restApiHandler;
   AsyncWebServer *httpServer;
   AsyncWebSocket *webSockerServer;
+  ESPStepperMotorServer_WebSocketLogSink *webSocketLogSink = NULL;
+  ESPStepperMotorServer_EventPublisher *eventPublisherHandler = NULL;
 #endif
+  ESPStepperMotorServer_SyslogLogSink *syslogLogSink = NULL;
 
   ESPStepperMotorServer_CLI *cliHandler;
   ESPStepperMotorServer_MotionController *motionControllerHandler;
+  ESPStepperMotorServer_MacroExecutor *macroExecutorHandler;
+  ESPStepperMotorServer_PositionJournal *positionJournal = NULL;
+  ESPStepperMotorServer_SyncController *syncController = NULL;
+#ifndef ESPStepperMotorServer_COMPILE_NO_GCODE
+  ESPStepperMotorServer_GCodeInterpreter *gcodeInterpreterHandler = NULL;
+#endif
   static ESPStepperMotorServer *anchor; //used for self-reference in ISR
   // the button status register for all configured button switches
   volatile byte buttonStatus[ESPServerSwitchStatusRegisterCount] = {0};
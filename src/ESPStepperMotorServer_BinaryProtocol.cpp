@@ -0,0 +1,305 @@
+//      *********************************************************
+//      *                                                       *
+//      *      ESP32 Stepper Motor Server Binary Protocol       *
+//      *                                                       *
+//      *            Copyright (c) Paul Kerspe, 2019            *
+//      *                                                       *
+//      **********************************************************
+
+// MIT License
+//
+// Copyright (c) 2019 Paul Kerspe
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished
+// to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <ESPStepperMotorServer_BinaryProtocol.h>
+#include <ESPStepperMotorServer.h>
+
+ESPStepperMotorServer_BinaryProtocol::ESPStepperMotorServer_BinaryProtocol(ESPStepperMotorServer *serverRef)
+{
+  this->serverRef = serverRef;
+}
+
+/**
+ * feed one byte that has been received on the serial port into the frame decoder.
+ * A new frame is only started if allowFrameStart is true (the CLI passes false while a text command line is being received).
+ * Returns true if the byte has been consumed as part of a binary frame, false if it should be handled as text input
+ */
+bool ESPStepperMotorServer_BinaryProtocol::consumeByte(byte inputByte, bool allowFrameStart)
+{
+  if (this->receivingFrame && millis() - this->frameStartMillis > ESPServerBinaryProtocolFrameTimeoutMs)
+  {
+    // incomplete frame, drop it
+    this->receivingFrame = false;
+    if (this->receivedBytes > 0)
+    {
+      this->frameErrorCounter++;
+    }
+  }
+
+  if (!this->receivingFrame)
+  {
+    if (inputByte == ESPServerBinaryProtocolFrameDelimiter && allowFrameStart)
+    {
+      this->receivingFrame = true;
+      this->receivedBytes = 0;
+      this->frameStartMillis = millis();
+      return true;
+    }
+    return false;
+  }
+
+  if (inputByte == ESPServerBinaryProtocolFrameDelimiter)
+  {
+    if (this->receivedBytes == 0)
+    {
+      // repeated delimiter, still waiting for the frame content
+      this->frameStartMillis = millis();
+      return true;
+    }
+    this->receivingFrame = false;
+    if (this->receivedBytes > sizeof(this->receiveBuffer))
+    {
+      // frame was too long
+      this->frameErrorCounter++;
+      this->sendResponse(0, 0, ESPServerBinaryProtocolStatusInvalidLength);
+      return true;
+    }
+    byte frame[ESPServerBinaryProtocolMaxEncodedFrameLength];
+    size_t frameLength = ESPStepperMotorServer_FrameCodec::decodeCobs(this->receiveBuffer, this->receivedBytes, frame);
+    this->handleFrame(frame, frameLength);
+    return true;
+  }
+
+  if (this->receivedBytes < sizeof(this->receiveBuffer))
+  {
+    this->receiveBuffer[this->receivedBytes] = inputByte;
+  }
+  // keep counting beyond the buffer size, so an overlong frame gets discarded completely when the delimiter is received
+  if (this->receivedBytes <= sizeof(this->receiveBuffer))
+  {
+    this->receivedBytes++;
+  }
+  return true;
+}
+
+bool ESPStepperMotorServer_BinaryProtocol::isReceivingFrame()
+{
+  return this->receivingFrame;
+}
+
+unsigned long ESPStepperMotorServer_BinaryProtocol::getReceivedFrameCount()
+{
+  return this->receivedFrameCounter;
+}
+
+unsigned long ESPStepperMotorServer_BinaryProtocol::getFrameErrorCount()
+{
+  return this->frameErrorCounter;
+}
+
+void ESPStepperMotorServer_BinaryProtocol::handleFrame(const byte *frame, size_t length)
+{
+  // minimum frame: type, sequence and CRC
+  if (length < 4)
+  {
+    this->frameErrorCounter++;
+    this->sendResponse((length > 0) ? frame[0] : 0, (length > 1) ? frame[1] : 0, ESPServerBinaryProtocolStatusInvalidLength);
+    return;
+  }
+  const uint16_t receivedCrc = frame[length - 2] | (frame[length - 1] << 8);
+  if (receivedCrc != ESPStepperMotorServer_FrameCodec::calculateCrc16(frame, length - 2))
+  {
+    this->frameErrorCounter++;
+    this->sendResponse(frame[0], frame[1], ESPServerBinaryProtocolStatusCrcError);
+    return;
+  }
+  this->receivedFrameCounter++;
+
+  const byte requestType = frame[0];
+  const byte sequence = frame[1];
+  const byte *payload = &frame[2];
+  const size_t payloadLength = length - 4;
+  ESP_FlexyStepper *flexyStepper = NULL;
+
+  switch (requestType)
+  {
+  case ESPServerBinaryProtocolMoveTo:
+  case ESPServerBinaryProtocolMoveBy:
+    if (payloadLength != 5)
+    {
+      this->sendResponse(requestType, sequence, ESPServerBinaryProtocolStatusInvalidLength);
+      return;
+    }
+    if (this->serverRef->emergencySwitchIsActive)
+    {
+      this->sendResponse(requestType, sequence, ESPServerBinaryProtocolStatusEmergencyStopActive);
+      return;
+    }
+  {
+    ESPStepperMotorServer_StepperConfiguration *stepperConfiguration = this->getStepperConfiguration(payload[0]);
+    if (stepperConfiguration == NULL)
+    {
+      this->sendResponse(requestType, sequence, ESPServerBinaryProtocolStatusInvalidStepper);
+      return;
+    }
+    long targetPosition = readInt32(&payload[1]);
+    if (requestType == ESPServerBinaryProtocolMoveBy)
+    {
+      targetPosition += stepperConfiguration->getFlexyStepper()->getCurrentPositionInSteps();
+    }
+    switch (stepperConfiguration->setTargetPositionWithinSoftLimits(targetPosition))
+    {
+    case ESPServerSoftLimitResult_Rejected:
+      this->sendResponse(requestType, sequence, ESPServerBinaryProtocolStatusSoftLimitRejected);
+      break;
+    case ESPServerSoftLimitResult_Clamped:
+    {
+      byte response[4];
+      writeInt32(response, targetPosition);
+      this->sendResponse(requestType, sequence, ESPServerBinaryProtocolStatusSoftLimitClamped, response, sizeof(response));
+      break;
+    }
+    default:
+      this->sendResponse(requestType, sequence, ESPServerBinaryProtocolStatusOk);
+      break;
+    }
+    break;
+  }
+  case ESPServerBinaryProtocolGetPosition:
+  {
+    if (payloadLength != 1)
+    {
+      this->sendResponse(requestType, sequence, ESPServerBinaryProtocolStatusInvalidLength);
+      return;
+    }
+    flexyStepper = this->getFlexyStepper(payload[0]);
+    if (flexyStepper == NULL)
+    {
+      this->sendResponse(requestType, sequence, ESPServerBinaryProtocolStatusInvalidStepper);
+      return;
+    }
+    byte positionData[9];
+    writeInt32(&positionData[0], flexyStepper->getCurrentPositionInSteps());
+    // the ESP32 is little endian, so the float can be copied as is
+    float velocity = flexyStepper->getCurrentVelocityInStepsPerSecond();
+    memcpy(&positionData[4], &velocity, sizeof(velocity));
+    positionData[8] = flexyStepper->motionComplete() ? 1 : 0;
+    this->sendResponse(requestType, sequence, ESPServerBinaryProtocolStatusOk, positionData, sizeof(positionData));
+    break;
+  }
+  case ESPServerBinaryProtocolStop:
+  case ESPServerBinaryProtocolEmergencyStop:
+    if (payloadLength != 1)
+    {
+      this->sendResponse(requestType, sequence, ESPServerBinaryProtocolStatusInvalidLength);
+      return;
+    }
+    if (payload[0] != 255)
+    {
+      flexyStepper = this->getFlexyStepper(payload[0]);
+      if (flexyStepper == NULL)
+      {
+        this->sendResponse(requestType, sequence, ESPServerBinaryProtocolStatusInvalidStepper);
+        return;
+      }
+    }
+    if (requestType == ESPServerBinaryProtocolEmergencyStop)
+    {
+      this->serverRef->performEmergencyStop((payload[0] == 255) ? -1 : payload[0]);
+    }
+    else if (flexyStepper != NULL)
+    {
+      flexyStepper->setTargetPositionToStop();
+    }
+    else
+    {
+      ESPStepperMotorServer_Configuration *configuration = this->serverRef->getCurrentServerConfiguration();
+      ESPStepperMotorServer_ActiveAxis activeAxes[ESPServerMaxSteppers];
+      const byte activeAxisCount = configuration->copyActiveAxes(activeAxes);
+      for (byte i = 0; i < activeAxisCount; i++)
+      {
+        activeAxes[i].flexyStepper->setTargetPositionToStop();
+      }
+    }
+    this->sendResponse(requestType, sequence, ESPServerBinaryProtocolStatusOk);
+    break;
+  case ESPServerBinaryProtocolRevokeEmergencyStop:
+    this->serverRef->revokeEmergencyStop();
+    this->sendResponse(requestType, sequence, ESPServerBinaryProtocolStatusOk);
+    break;
+  default:
+    this->sendResponse(requestType, sequence, ESPServerBinaryProtocolStatusUnknownType);
+    break;
+  }
+}
+
+void ESPStepperMotorServer_BinaryProtocol::sendResponse(byte requestType, byte sequence, byte status, const byte *data, size_t dataLength)
+{
+  byte frame[ESPServerBinaryProtocolMaxFrameLength];
+  if (dataLength > ESPServerBinaryProtocolMaxFrameLength - 5)
+  {
+    dataLength = ESPServerBinaryProtocolMaxFrameLength - 5;
+  }
+  frame[0] = requestType | ESPServerBinaryProtocolResponseFlag;
+  frame[1] = sequence;
+  frame[2] = status;
+  if (dataLength > 0)
+  {
+    memcpy(&frame[3], data, dataLength);
+  }
+  const size_t crcOffset = 3 + dataLength;
+  const uint16_t crc = ESPStepperMotorServer_FrameCodec::calculateCrc16(frame, crcOffset);
+  frame[crcOffset] = crc & 0xFF;
+  frame[crcOffset + 1] = crc >> 8;
+
+  byte encodedFrame[ESPServerBinaryProtocolMaxEncodedFrameLength + 2];
+  encodedFrame[0] = ESPServerBinaryProtocolFrameDelimiter;
+  size_t encodedLength = ESPStepperMotorServer_FrameCodec::encodeCobs(frame, crcOffset + 2, &encodedFrame[1]);
+  encodedFrame[encodedLength + 1] = ESPServerBinaryProtocolFrameDelimiter;
+  Serial.write(encodedFrame, encodedLength + 2);
+}
+
+ESPStepperMotorServer_StepperConfiguration *ESPStepperMotorServer_BinaryProtocol::getStepperConfiguration(byte stepperId)
+{
+  if (stepperId >= ESPServerMaxSteppers)
+  {
+    return NULL;
+  }
+  return this->serverRef->getCurrentServerConfiguration()->getStepperConfiguration(stepperId);
+}
+
+ESP_FlexyStepper *ESPStepperMotorServer_BinaryProtocol::getFlexyStepper(byte stepperId)
+{
+  ESPStepperMotorServer_StepperConfiguration *stepperConfiguration = this->getStepperConfiguration(stepperId);
+  return (stepperConfiguration) ? stepperConfiguration->getFlexyStepper() : NULL;
+}
+
+long ESPStepperMotorServer_BinaryProtocol::readInt32(const byte *data)
+{
+  return (long)((uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24));
+}
+
+void ESPStepperMotorServer_BinaryProtocol::writeInt32(byte *data, long value)
+{
+  data[0] = value & 0xFF;
+  data[1] = (value >> 8) & 0xFF;
+  data[2] = (value >> 16) & 0xFF;
+  data[3] = (value >> 24) & 0xFF;
+}
@@ -0,0 +1,101 @@
+//      ******************************************************************
+//      *                                                                *
+//      *   Header file for ESPStepperMotorServer_BinaryProtocol.cpp     *
+//      *                                                                *
+//      *               Copyright (c) Paul Kerspe, 2019                  *
+//      *                                                                *
+//      ******************************************************************
+
+// MIT License
+//
+// Copyright (c) 2019 Paul Kerspe
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished
+// to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef ESPStepperMotorServer_BinaryProtocol_h
+#define ESPStepperMotorServer_BinaryProtocol_h
+
+#include <Arduino.h>
+#include <ESP_FlexyStepper.h>
+#include <ESPStepperMotorServer_FrameCodec.h>
+
+// frames are COBS encoded and delimited by a 0x00 byte on both ends, so they can never be confused with a text command line
+#define ESPServerBinaryProtocolFrameDelimiter 0x00
+// maximum length of a decoded frame (type + sequence + payload + CRC)
+#define ESPServerBinaryProtocolMaxFrameLength 32
+// COBS adds one overhead byte per 254 bytes (plus the leading code byte)
+#define ESPServerBinaryProtocolMaxEncodedFrameLength (ESPServerBinaryProtocolMaxFrameLength + 2)
+// a frame that has not been completed within this time is dropped, so a stray delimiter cannot swallow the following text commands
+#define ESPServerBinaryProtocolFrameTimeoutMs 100
+
+// request types. Responses use the request type with the highest bit set
+#define ESPServerBinaryProtocolMoveTo 0x01        // payload: stepper id (uint8), target position in steps (int32)
+#define ESPServerBinaryProtocolMoveBy 0x02        // payload: stepper id (uint8), distance in steps (int32)
+#define ESPServerBinaryProtocolGetPosition 0x03   // payload: stepper id (uint8). response: position in steps (int32), velocity in steps/s (float), motion complete (uint8)
+#define ESPServerBinaryProtocolStop 0x04          // payload: stepper id (uint8, 255 = all steppers). decelerates to a stop
+#define ESPServerBinaryProtocolEmergencyStop 0x05 // payload: stepper id (uint8, 255 = all steppers)
+#define ESPServerBinaryProtocolRevokeEmergencyStop 0x06
+#define ESPServerBinaryProtocolResponseFlag 0x80
+
+// status codes sent as first byte of each response payload
+#define ESPServerBinaryProtocolStatusOk 0
+#define ESPServerBinaryProtocolStatusCrcError 1
+#define ESPServerBinaryProtocolStatusUnknownType 2
+#define ESPServerBinaryProtocolStatusInvalidLength 3
+#define ESPServerBinaryProtocolStatusInvalidStepper 4
+#define ESPServerBinaryProtocolStatusEmergencyStopActive 5
+#define ESPServerBinaryProtocolStatusSoftLimitRejected 6 // target outside of the soft limits of the stepper, the target position has not been changed
+#define ESPServerBinaryProtocolStatusSoftLimitClamped 7  // target has been clamped to the soft limits. response: clamped target position in steps (int32)
+
+class ESPStepperMotorServer;
+class ESPStepperMotorServer_StepperConfiguration;
+
+//
+// the ESPStepperMotorServer_BinaryProtocol class
+// decodes COBS framed, CRC protected binary requests that are received on the serial port of the CLI
+// and sends framed responses. Decoded frame layout (all values little endian):
+// [type (uint8)] [sequence (uint8)] [payload (0-n bytes)] [CRC-16/CCITT-FALSE over type, sequence and payload (uint16)]
+// The sequence number is echoed in the response, the response payload starts with a status byte
+class ESPStepperMotorServer_BinaryProtocol
+{
+public:
+  ESPStepperMotorServer_BinaryProtocol(ESPStepperMotorServer *serverRef);
+  bool consumeByte(byte inputByte, bool allowFrameStart);
+  bool isReceivingFrame();
+  unsigned long getReceivedFrameCount();
+  unsigned long getFrameErrorCount();
+
+private:
+  void handleFrame(const byte *frame, size_t length);
+  void sendResponse(byte requestType, byte sequence, byte status, const byte *data = NULL, size_t dataLength = 0);
+  ESPStepperMotorServer_StepperConfiguration *getStepperConfiguration(byte stepperId);
+  ESP_FlexyStepper *getFlexyStepper(byte stepperId);
+  static long readInt32(const byte *data);
+  static void writeInt32(byte *data, long value);
+
+  ESPStepperMotorServer *serverRef;
+  byte receiveBuffer[ESPServerBinaryProtocolMaxEncodedFrameLength];
+  size_t receivedBytes = 0;
+  bool receivingFrame = false;
+  unsigned long frameStartMillis = 0;
+  unsigned long receivedFrameCounter = 0;
+  unsigned long frameErrorCounter = 0;
+};
+
+#endif
@@ -29,13 +29,23 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+#define ESPServerLogModule ESPServerLogModule_CLI
+
 #include <ESPStepperMotorServer_CLI.h>
 
 #define CR '\r'
 #define LF '\n'
 #define BS '\b'
 #define NULLCHAR '\0'
-#define COMMAND_BUFFER_LENGTH 50 //length of serial buffer for incoming commands
+#define COMMAND_BUFFER_LENGTH 96 //length of serial buffer for incoming commands (and G-code lines)
+#define SERIAL_READ_BUFFER_LENGTH 64 //number of bytes read from the UART at once
+// the CLI task gets woken up by the UART receive callback. The poll interval is only a fallback for cores without receive callbacks
+#if defined(ESP_ARDUINO_VERSION_MAJOR) && ESP_ARDUINO_VERSION_MAJOR >= 2
+#define CLI_SERIAL_RECEIVE_CALLBACK_SUPPORTED
+#define SERIAL_POLL_INTERVAL_MS 100
+#else
+#define SERIAL_POLL_INTERVAL_MS 10
+#endif
 
 // ---------------------------------------------------------------------------------
 //                                  Setup functions
@@ -45,6 +55,9 @@
 // creates a freeRTOS Task that runs in the background and polls the serial interface for input to parse
 //
 ESPStepperMotorServer_CLI::ESPStepperMotorServer_CLI(ESPStepperMotorServer *serverRef)
+#ifndef ESPStepperMotorServer_COMPILE_NO_BINARY_PROTOCOL
+    : binaryProtocol(serverRef)
+#endif
 {
   this->serverRef = serverRef;
 }
@@ -66,43 +79,63 @@ void ESPStepperMotorServer_CLI::start()
       this,                                          /* Parameter passed as input of the task */
       1,                                             /* Priority of the task. */
       &this->xHandle);                               /* Task handle. */
+#ifdef CLI_SERIAL_RECEIVE_CALLBACK_SUPPORTED
+  TaskHandle_t cliTaskHandle = this->xHandle;
+  Serial.onReceive([cliTaskHandle]() { xTaskNotifyGive(cliTaskHandle); });
+#endif
   this->registerCommands();
-  ESPStepperMotorServer_Logger::logInfof("Command Line Interface started, registered %i commands. Type 'help' to get a list of all supported commands\n", this->commandCounter);
+  ESPServerLogInfof("Command Line Interface started, registered %i commands. Type 'help' to get a list of all supported commands\n", this->commandCounter);
 }
 
 void ESPStepperMotorServer_CLI::stop()
 {
+#ifdef CLI_SERIAL_RECEIVE_CALLBACK_SUPPORTED
+  Serial.onReceive(NULL);
+#endif
   vTaskDelete(this->xHandle);
   this->xHandle = NULL;
-  ESPStepperMotorServer_Logger::logInfo("Command Line Interface stopped");
+  ESPServerLogInfo("Command Line Interface stopped");
 }
 
 void ESPStepperMotorServer_CLI::executeCommand(String cmd)
 {
   char cmdCharArray[cmd.length() + 1];
   strcpy(cmdCharArray, cmd.c_str());
-  char *pureCommand = strtok(cmdCharArray, _CMD_PARAM_SEPRATOR);
-  char *arguments = strtok(NULL, "=");
+  this->executeCommand(cmdCharArray);
+}
 
-  // first try the built in commands
-  for (int i = 0; i < this->commandCounter; i++)
+/**
+ * parse and execute the given command line. The command line is tokenized in place (see ESPStepperMotorServer_CommandParser::splitCommandLine),
+ * so no copies of the command or arguments are created
+ */
+void ESPStepperMotorServer_CLI::executeCommand(char *commandLine)
+{
+  char *arguments;
+  char *pureCommand = ESPStepperMotorServer_CommandParser::splitCommandLine(commandLine, &arguments);
+
+  int commandIndex = this->findCommandIndex(pureCommand, strlen(pureCommand));
+  if (commandIndex < 0)
   {
-    if (this->allRegisteredCommands[i].command.equals(pureCommand) || this->allRegisteredCommands[i].shortCut.equals(pureCommand))
-    {
-      (this->*command_functions[i])(pureCommand, arguments);
-      return;
-    }
+    Serial.printf("error: Command '%s' is unknown\n", pureCommand);
   }
-  // next, see if it's a user defined command
-  for (int i = 0; i < this->userCommandCounter; i++)
+  else if (commandIndex < MAX_CLI_CMD_COUNTER)
   {
-    if (this->allRegisteredUserCommands[i].command.equals(pureCommand) || this->allRegisteredUserCommands[i].shortCut.equals(pureCommand))
-    {
-      (this->user_command_functions[i])(pureCommand, arguments);
-      return;
-    }
+    (this->*command_functions[commandIndex])(pureCommand, arguments);
+  }
+  else
+  {
+    (this->user_command_functions[commandIndex - MAX_CLI_CMD_COUNTER])(pureCommand, arguments);
   }
-  Serial.printf("error: Command '%s' is unknown\n", cmd.c_str());
+}
+
+/**
+ * returns true if the command or shortcut of the command with the given index (see ESPStepperMotorServer_CommandTable) equals the given name
+ */
+bool ESPStepperMotorServer_CLI::commandMatchesName(byte commandIndex, const char *name, unsigned int length) const
+{
+  const commandDetailsStructure &commandDetails = (commandIndex < MAX_CLI_CMD_COUNTER) ? this->allRegisteredCommands[commandIndex] : this->allRegisteredUserCommands[commandIndex - MAX_CLI_CMD_COUNTER];
+  return isSameName(commandDetails.command.c_str(), commandDetails.command.length(), name, length) ||
+         isSameName(commandDetails.shortCut.c_str(), commandDetails.shortCut.length(), name, length);
 }
 
 void ESPStepperMotorServer_CLI::processSerialInput(void *parameter)
@@ -110,48 +143,72 @@ void ESPStepperMotorServer_CLI::processSerialInput(void *parameter)
   ESPStepperMotorServer_CLI *ref = static_cast<ESPStepperMotorServer_CLI *>(parameter);
   char commandLine[COMMAND_BUFFER_LENGTH + 1];
   uint8_t charsRead = 0;
-  char buffer[2];
+  char readBuffer[SERIAL_READ_BUFFER_LENGTH];
   char c;
+  size_t bytesAvailable;
   while (true)
   {
-    while (Serial.available())
+    // sleep until the UART signals received data or the next stream sample is due
+    ulTaskNotifyTake(pdTRUE, ref->getTicksUntilNextStreamSample(pdMS_TO_TICKS(SERIAL_POLL_INTERVAL_MS)));
+    while ((bytesAvailable = Serial.available()) > 0)
     {
-      Serial.readBytes(buffer, 1); //using this step to avoid the annoying warnings of code quality check to Check buffer boundaries
-      c = buffer[0];
-      switch (c)
+      size_t bytesRead = Serial.readBytes(readBuffer, min(bytesAvailable, sizeof(readBuffer)));
+      for (size_t i = 0; i < bytesRead; i++)
       {
-      case CR: //likely have full command in buffer now, commands are terminated by CR and/or LS
-      case LF:
-        commandLine[charsRead] = NULLCHAR; //null terminate our command char array
-        if (charsRead > 0)
+        c = readBuffer[i];
+#ifndef ESPStepperMotorServer_COMPILE_NO_BINARY_PROTOCOL
+        // binary frames can only start at the beginning of a line
+        if (ref->binaryProtocol.consumeByte(c, charsRead == 0))
+        {
+          continue;
+        }
+#endif
+        switch (c)
         {
-          charsRead = 0; //charsRead behaves like 'static' in this taks, so have to reset
-          try
+        case CR: //likely have full command in buffer now, commands are terminated by CR and/or LS
+        case LF:
+          commandLine[charsRead] = NULLCHAR; //null terminate our command char array
+          if (charsRead > 0)
           {
-            ref->executeCommand(String(commandLine));
+            charsRead = 0; //charsRead behaves like 'static' in this taks, so have to reset
+#ifndef ESPStepperMotorServer_COMPILE_NO_GCODE
+            if (ESPStepperMotorServer_GCodeParser::isGCodeLine(commandLine))
+            {
+              // the interpreter sends the response once the line has been executed
+              if (!ref->serverRef->getGCodeInterpreter()->submitLine(commandLine, ESPServerGCodeSource_Serial))
+              {
+                Serial.println("error:buffer full, wait for ok before sending the next line");
+              }
+              break;
+            }
+#endif
+            try
+            {
+              ref->executeCommand(commandLine);
+            }
+            catch (...)
+            {
+              ESPStepperMotorServer_Logger::logWarningf("Caught an exception wil trying to execute command line '%s'\n", commandLine);
+            }
           }
-          catch (...)
+          break;
+        case BS: // handle backspace in input: put a blank in last char
+          if (charsRead > 0)
+          { //and adjust commandLine and charsRead
+            commandLine[--charsRead] = NULLCHAR;
+          }
+          break;
+        default:
+          if (charsRead < COMMAND_BUFFER_LENGTH)
           {
-            ESPStepperMotorServer_Logger::logWarningf("Caught an exception wil trying to execute command line '%s'\n", commandLine);
+            commandLine[charsRead++] = c;
           }
+          commandLine[charsRead] = NULLCHAR; //just in case
+          break;
         }
-        break;
-      case BS: // handle backspace in input: put a blank in last char
-        if (charsRead > 0)
-        { //and adjust commandLine and charsRead
-          commandLine[--charsRead] = NULLCHAR;
-        }
-        break;
-      default:
-        if (charsRead < COMMAND_BUFFER_LENGTH)
-        {
-          commandLine[charsRead++] = c;
-        }
-        commandLine[charsRead] = NULLCHAR; //just in case
-        break;
       }
     }
-    vTaskDelay(10);
+    ref->processStream();
   }
 }
 
@@ -187,6 +244,12 @@ void ESPStepperMotorServer_CLI::registerCommands()
   this->registerNewCommand({String("setappwd"), String("sap"), emptyHelp, true}, &ESPStepperMotorServer_CLI::cmdSetApPassword);
   this->registerNewCommand({String("setwifissid"), String("sws"), emptyHelp, true}, &ESPStepperMotorServer_CLI::cmdSetSSID);
   this->registerNewCommand({String("setwifipwd"), String("swp"), emptyHelp, true}, &ESPStepperMotorServer_CLI::cmdSetWifiPassword);
+  this->registerNewCommand({String("stream"), String("sm"), emptyHelp, true}, &ESPStepperMotorServer_CLI::cmdStream);
+  this->registerNewCommand({String("softlimits"), String("sl"), emptyHelp, true}, &ESPStepperMotorServer_CLI::cmdSoftLimits);
+#ifndef ESPStepperMotorServer_COMPILE_NO_GCODE
+  this->registerNewCommand({String("gcodefile"), String("gf"), emptyHelp, true}, &ESPStepperMotorServer_CLI::cmdRunGCodeFile);
+  this->registerNewCommand({String("gcodejob"), String("gj"), emptyHelp, true}, &ESPStepperMotorServer_CLI::cmdGCodeJob);
+#endif
 #else
   this->registerNewCommand({String("help"), String("h"), String("show a list of all available commands"), false}, &ESPStepperMotorServer_CLI::cmdHelp);
   this->registerNewCommand({String("moveby"), String("mb"), String("move by a specified number of units. requires the id of the stepper to move, the amount of movement and also optional the unit for the movement (mm, steps, revs). If no unit is specified steps will be assumed as unit. Optionally you can also set the speed in steps/second, acceleration and deceleration, each in steps/second/second). Set speeds, acceleration and deceleration are rememebered until overwritten again. E.g. mb=0&v:-100&u:mm&s:200 to move the stepper with id 0 by -100 mm with a speed of 200 steps per second"), true}, &ESPStepperMotorServer_CLI::cmdMoveBy);
@@ -202,13 +265,19 @@ void ESPStepperMotorServer_CLI::registerCommands()
   this->registerNewCommand({String("reboot"), String("r"), String("reboot the ESP (config changes that have not been saved will be lost)"), false}, &ESPStepperMotorServer_CLI::cmdReboot);
   this->registerNewCommand({String("save"), String("s"), String("save the current configuration to the SPIFFS in config.json"), false}, &ESPStepperMotorServer_CLI::cmdSaveConfiguration);
   this->registerNewCommand({String("stop"), String("st"), String("stop the stepper server (also stops the CLI!)"), false}, &ESPStepperMotorServer_CLI::cmdStopServer);
-  this->registerNewCommand({String("loglevel"), String("ll"), String("set or get the current log level for serial output. valid values to set are: 1 (Warning) - 4 (ALL). E.g. to set to log level DEBUG use ll=3 to get the current loglevel call without parameter"), true}, &ESPStepperMotorServer_CLI::cmdSetLogLevel);
+  this->registerNewCommand({String("loglevel"), String("ll"), String("set or get the current log level for serial output. valid values to set are: 1 (Warning) - 4 (ALL). E.g. to set to log level DEBUG use ll=3 to get the current loglevel call without parameter. To set the level of a single module use the m parameter, e.g. ll=3&m:rest (modules: root, server, config, rest, webui, cli, motion, macro, journal, power, trajectory, gcode, sync, shiftreg, events). Level 0 makes a module use the global log level again"), true}, &ESPStepperMotorServer_CLI::cmdSetLogLevel);
   this->registerNewCommand({String("serverstatus"), String("ss"), String("print status details of the server as JSON formated string"), false}, &ESPStepperMotorServer_CLI::cmdServerStatus);
   this->registerNewCommand({String("switchstatus"), String("pss"), String("print the status of all input switches as JSON formated string"), false}, &ESPStepperMotorServer_CLI::cmdSwitchStatus);
   this->registerNewCommand({String("setapname"), String("san"), String("set the name of the access point to be opened up by the esp (if in AP mode)"), true}, &ESPStepperMotorServer_CLI::cmdSetApName);
   this->registerNewCommand({String("setappwd"), String("sap"), String("set the password for the access point to be opened by the esp"), true}, &ESPStepperMotorServer_CLI::cmdSetApPassword);
   this->registerNewCommand({String("setwifissid"), String("sws"), String("set the SSID of the WiFi to connect to (if in client mode)"), true}, &ESPStepperMotorServer_CLI::cmdSetSSID);
   this->registerNewCommand({String("setwifipwd"), String("swp"), String("set the password of the Wifi network to connect to"), true}, &ESPStepperMotorServer_CLI::cmdSetWifiPassword);
+  this->registerNewCommand({String("stream"), String("sm"), String("continuously print the position (in steps) and velocity (in steps/second) of all steppers as CSV lines with the given rate in Hz (1-1000). Samples are skipped if the serial port cannot keep up. E.g. sm=50 to print 50 lines per second. Call sm=0 or sm without parameter to stop streaming"), true}, &ESPStepperMotorServer_CLI::cmdStream);
+  this->registerNewCommand({String("softlimits"), String("sl"), String("get or set the software travel limits (soft endstops) of a stepper as absolute positions in steps. Mode 0 disables the limits, mode 1 rejects move commands with a target outside of the limits, mode 2 clamps the target to the nearest limit. E.g. sl=0 to print the limits of the stepper with id 0 or sl=0&min:0&max:20000&m:1 to set them. Use the save command to persist the changes"), true}, &ESPStepperMotorServer_CLI::cmdSoftLimits);
+#ifndef ESPStepperMotorServer_COMPILE_NO_GCODE
+  this->registerNewCommand({String("gcodefile"), String("gf"), String("run the G-code file with the given path from the SPIFFS. E.g. gf=/part.gcode. G-code lines (starting with G, M or N) can also be sent directly, each line is answered with 'ok' or 'error:<reason>' once it has been executed"), true}, &ESPStepperMotorServer_CLI::cmdRunGCodeFile);
+  this->registerNewCommand({String("gcodejob"), String("gj"), String("show the progress of the current G-code file job, or control it with gj=pause, gj=resume or gj=abort"), true}, &ESPStepperMotorServer_CLI::cmdGCodeJob);
+#endif
 
 #ifndef ESPStepperMotorServer_COMPILE_NO_WEB
   this->registerNewCommand({String("sethttpport"), String("shp"), String("set the http port to listen for for the web interface"), true}, &ESPStepperMotorServer_CLI::cmdSetHttpPort);
@@ -231,17 +300,16 @@ void ESPStepperMotorServer_CLI::registerNewCommand(commandDetailsStructure comma
 {
   if (this->commandCounter < MAX_CLI_CMD_COUNTER)
   {
-    //check if command is already registered
-    for (int i = 0; i < this->commandCounter; i++)
+    //check if command is already registered as a built in or user command
+    if (this->isCommandNameRegistered(commandDetails.command.c_str()) || this->isCommandNameRegistered(commandDetails.shortCut.c_str()))
     {
-      if (this->allRegisteredCommands[i].command.equals(commandDetails.command) || this->allRegisteredCommands[i].shortCut.equals(commandDetails.shortCut))
-      {
-        ESPStepperMotorServer_Logger::logWarningf("A command with the same name / shortcut is already registered. Will not add the command '%s' [%s] to the list of registered commands", commandDetails.command, commandDetails.shortCut);
-        return;
-      }
+      ESPStepperMotorServer_Logger::logWarningf("A command with the same name / shortcut is already registered. Will not add the command '%s' [%s] to the list of registered commands\n", commandDetails.command.c_str(), commandDetails.shortCut.c_str());
+      return;
     }
     this->allRegisteredCommands[this->commandCounter] = commandDetails;
     this->command_functions[this->commandCounter] = cmdFunction;
+    this->addCommandName(commandDetails.command.c_str(), this->commandCounter);
+    this->addCommandName(commandDetails.shortCut.c_str(), this->commandCounter);
     this->commandCounter++;
   }
   else
@@ -254,26 +322,16 @@ void ESPStepperMotorServer_CLI::registerNewUserCommand(commandDetailsStructure c
 {
   if (this->userCommandCounter < MAX_CLI_USER_CMD_COUNTER)
   {
-    //check if command is already registered as a built in command
-    for (int i = 0; i < this->commandCounter; i++)
+    //check if command is already registered as a built in or user command
+    if (this->isCommandNameRegistered(commandDetails.command.c_str()) || this->isCommandNameRegistered(commandDetails.shortCut.c_str()))
     {
-      if (this->allRegisteredCommands[i].command.equals(commandDetails.command) || this->allRegisteredCommands[i].shortCut.equals(commandDetails.shortCut))
-      {
-        ESPStepperMotorServer_Logger::logWarningf("A command with the same name / shortcut is already registered. Will not add the command '%s' [%s] to the list of registered user commands", commandDetails.command, commandDetails.shortCut);
-        return;
-      }
-    }
-    // next check if it's already registered as a user command
-    for (int i = 0; i < this->userCommandCounter; i++)
-    {
-      if (this->allRegisteredUserCommands[i].command.equals(commandDetails.command) || this->allRegisteredUserCommands[i].shortCut.equals(commandDetails.shortCut))
-      {
-        ESPStepperMotorServer_Logger::logWarningf("A user command with the same name / shortcut is already registered. Will not add the command '%s' [%s] to the list of registered user commands", commandDetails.command, commandDetails.shortCut);
-        return;
-      }
+      ESPStepperMotorServer_Logger::logWarningf("A command with the same name / shortcut is already registered. Will not add the command '%s' [%s] to the list of registered user commands\n", commandDetails.command.c_str(), commandDetails.shortCut.c_str());
+      return;
     }
     this->allRegisteredUserCommands[this->userCommandCounter] = commandDetails;
     this->user_command_functions[this->userCommandCounter] = cmdFunction;
+    this->addCommandName(commandDetails.command.c_str(), MAX_CLI_CMD_COUNTER + this->userCommandCounter);
+    this->addCommandName(commandDetails.shortCut.c_str(), MAX_CLI_CMD_COUNTER + this->userCommandCounter);
     this->userCommandCounter++;
   }
   else
@@ -407,6 +465,128 @@ void ESPStepperMotorServer_CLI::cmdServerStatus(char *cmd, char *args)
   Serial.println(result);
 }
 
+void ESPStepperMotorServer_CLI::cmdStream(char *cmd, char *args)
+{
+  long rate = (args != NULL) ? String(args).toInt() : 0;
+  if (rate <= 0)
+  {
+    if (this->streamIntervalMs > 0)
+    {
+      this->streamIntervalMs = 0;
+      Serial.printf("streaming stopped, %lu samples have been skipped due to a full serial buffer\n", this->droppedStreamSampleCounter);
+    }
+    else
+    {
+      Serial.println("streaming is not active. Usage is stream=<rate in Hz>");
+    }
+    return;
+  }
+  if (rate > CLI_STREAM_MAX_RATE)
+  {
+    Serial.printf("error: the maximum stream rate is %i Hz\n", CLI_STREAM_MAX_RATE);
+    return;
+  }
+  this->streamIntervalMs = 1000 / rate;
+  this->nextStreamSampleMillis = millis();
+  this->droppedStreamSampleCounter = 0;
+  this->printStreamHeader(this->takeStreamSnapshot());
+}
+
+/**
+ * returns the number of ticks the CLI task may sleep before the next stream sample is due (at most maxTicks)
+ */
+TickType_t ESPStepperMotorServer_CLI::getTicksUntilNextStreamSample(TickType_t maxTicks)
+{
+  if (this->streamIntervalMs == 0)
+  {
+    return maxTicks;
+  }
+  long millisUntilNextSample = (long)(this->nextStreamSampleMillis - millis());
+  if (millisUntilNextSample <= 0)
+  {
+    return 0;
+  }
+  return min(maxTicks, (TickType_t)pdMS_TO_TICKS(millisUntilNextSample));
+}
+
+/**
+ * copy the current position and velocity of all active axes into the snapshot buffer, so one sample is taken at (almost) the same time for all axes
+ * and the slow formatting can be done afterwards. Returns the number of axes in the snapshot
+ */
+byte ESPStepperMotorServer_CLI::takeStreamSnapshot()
+{
+  ESPStepperMotorServer_Configuration *configuration = this->serverRef->getCurrentServerConfiguration();
+  ESPStepperMotorServer_ActiveAxis activeAxes[ESPServerMaxSteppers];
+  const byte activeAxisCount = configuration->copyActiveAxes(activeAxes);
+  for (byte i = 0; i < activeAxisCount; i++)
+  {
+    this->streamSnapshot[i].stepperId = activeAxes[i].stepperId;
+    this->streamSnapshot[i].positionInSteps = activeAxes[i].flexyStepper->getCurrentPositionInSteps();
+    this->streamSnapshot[i].velocityInStepsPerSecond = activeAxes[i].flexyStepper->getCurrentVelocityInStepsPerSecond();
+  }
+  return activeAxisCount;
+}
+
+void ESPStepperMotorServer_CLI::printStreamHeader(byte axisCount)
+{
+  this->streamConfigurationRevision = this->serverRef->getCurrentServerConfiguration()->getConfigurationRevision();
+  Serial.print("time_ms");
+  for (byte i = 0; i < axisCount; i++)
+  {
+    Serial.printf(",position_%i,velocity_%i", this->streamSnapshot[i].stepperId, this->streamSnapshot[i].stepperId);
+  }
+  Serial.println();
+}
+
+/**
+ * print the next stream sample if it is due. If the UART transmit buffer does not have enough space for the line, the sample is skipped,
+ * so a slow connection never blocks the CLI task
+ */
+void ESPStepperMotorServer_CLI::processStream()
+{
+  if (this->streamIntervalMs == 0)
+  {
+    return;
+  }
+  const unsigned long now = millis();
+  if ((long)(now - this->nextStreamSampleMillis) < 0)
+  {
+    return;
+  }
+  this->nextStreamSampleMillis += this->streamIntervalMs;
+  if ((long)(now - this->nextStreamSampleMillis) >= 0)
+  {
+    // we fell behind (e.g. due to a long running command), do not try to catch up with a burst of samples
+    this->nextStreamSampleMillis = now + this->streamIntervalMs;
+  }
+
+  const byte axisCount = this->takeStreamSnapshot();
+  if (this->streamConfigurationRevision != this->serverRef->getCurrentServerConfiguration()->getConfigurationRevision())
+  {
+    this->printStreamHeader(axisCount);
+  }
+
+  // 10 chars for the time stamp, each axis needs at most 2 separators + 11 chars for the position + ~16 chars for the velocity
+  char line[12 + ESPServerMaxSteppers * 30];
+  int lineLength = snprintf(line, sizeof(line), "%lu", now);
+  for (byte i = 0; i < axisCount && lineLength < (int)sizeof(line); i++)
+  {
+    lineLength += snprintf(&line[lineLength], sizeof(line) - lineLength, ",%ld,%.2f", this->streamSnapshot[i].positionInSteps, this->streamSnapshot[i].velocityInStepsPerSecond);
+  }
+  if (lineLength >= (int)sizeof(line) - 1)
+  {
+    lineLength = sizeof(line) - 2;
+  }
+  line[lineLength++] = LF;
+
+  if (Serial.availableForWrite() < lineLength)
+  {
+    this->droppedStreamSampleCounter++;
+    return;
+  }
+  Serial.write((const uint8_t *)line, lineLength);
+}
+
 void ESPStepperMotorServer_CLI::cmdStopServer(char *cmd, char *args)
 {
   this->serverRef->stop();
@@ -481,9 +661,7 @@ void ESPStepperMotorServer_CLI::cmdGetCurrentVelocity(char *cmd, char *args)
   }
   else
   {
-#ifndef ESPStepperMotorServer_COMPILE_NO_DEBUG
-    ESPStepperMotorServer_Logger::logDebugf("%s called without parameter for stepper index\n", cmd);
-#endif
+    ESPServerLogDebugf("%s called without parameter for stepper index\n", cmd);
     for (stepperid = 0; stepperid < ESPServerMaxSteppers; stepperid++)
     {
       ESPStepperMotorServer_StepperConfiguration *stepper = this->serverRef->getCurrentServerConfiguration()->getStepperConfiguration(stepperid);
@@ -518,9 +696,7 @@ void ESPStepperMotorServer_CLI::cmdGetPosition(char *cmd, char *args)
   }
   else
   {
-#ifndef ESPStepperMotorServer_COMPILE_NO_DEBUG
-    ESPStepperMotorServer_Logger::logDebugf("%s called without parameter for stepper index\n", cmd);
-#endif
+    ESPServerLogDebugf("%s called without parameter for stepper index\n", cmd);
     for (stepperid = 0; stepperid < ESPServerMaxSteppers; stepperid++)
     {
       ESPStepperMotorServer_StepperConfiguration *stepper = config->getStepperConfiguration(stepperid);
@@ -541,43 +717,37 @@ void ESPStepperMotorServer_CLI::setMoveSpeedAccelHelper(ESP_FlexyStepper *flexyS
 {
   char buffer[20];
 
-  this->getParameterValue(args, "s", buffer);
+  this->getParameterValue(args, "s", buffer, sizeof(buffer));
   if (buffer[0] != NULLCHAR)
   {
     float speed = (String(buffer).toFloat());
     if (speed > 0)
     {
-#ifndef ESPStepperMotorServer_COMPILE_NO_DEBUG
-      ESPStepperMotorServer_Logger::logDebugf("Setting speed to %f steps / second\n", speed);
-#endif
+      ESPServerLogDebugf("Setting speed to %f steps / second\n", speed);
       flexyStepper->setSpeedInStepsPerSecond(speed);
     }
   }
 
-  this->getParameterValue(args, "a", buffer);
+  this->getParameterValue(args, "a", buffer, sizeof(buffer));
   if (buffer[0] != NULLCHAR)
   {
     float accel = (String(buffer).toFloat());
     if (accel > 0)
     {
-#ifndef ESPStepperMotorServer_COMPILE_NO_DEBUG
-      ESPStepperMotorServer_Logger::logDebugf("Setting acceleration to %f steps / second^2\n", accel);
-#endif
+      ESPServerLogDebugf("Setting acceleration to %f steps / second^2\n", accel);
       flexyStepper->setAccelerationInStepsPerSecondPerSecond(accel);
       //in case deceleration is not explicitly given, we just use the same value
       flexyStepper->setDecelerationInStepsPerSecondPerSecond(accel);
     }
   }
 
-  this->getParameterValue(args, "d", buffer);
+  this->getParameterValue(args, "d", buffer, sizeof(buffer));
   if (buffer[0] != NULLCHAR)
   {
     float decel = (String(buffer).toFloat());
     if (decel > 0)
     {
-#ifndef ESPStepperMotorServer_COMPILE_NO_DEBUG
-      ESPStepperMotorServer_Logger::logDebugf("Setting deceleration to %f steps / second^2\n", decel);
-#endif
+      ESPServerLogDebugf("Setting deceleration to %f steps / second^2\n", decel);
       flexyStepper->setDecelerationInStepsPerSecondPerSecond(decel);
     }
   }
@@ -588,42 +758,12 @@ void ESPStepperMotorServer_CLI::cmdMoveTo(char *cmd, char *args)
   int stepperid = this->getValidStepperIdFromArg(args);
   if (stepperid > -1)
   {
-    ESP_FlexyStepper *flexyStepper = this->serverRef->getCurrentServerConfiguration()->getStepperConfiguration(stepperid)->getFlexyStepper();
+    ESPStepperMotorServer_StepperConfiguration *stepper = this->serverRef->getCurrentServerConfiguration()->getStepperConfiguration(stepperid);
 
-    this->setMoveSpeedAccelHelper(flexyStepper, args);
-
-    char value[20];
-    this->getParameterValue(args, "v", value);
-    if (value[0] != NULLCHAR)
+    long targetPositionInSteps;
+    if (this->getTargetStepsFromArgs(stepper, args, targetPositionInSteps))
     {
-      char unit[10];
-      this->getParameterValue(args, "u", unit);
-      if (unit[0] == NULLCHAR || strcmp(unit, "steps") == 0)
-      {
-        if (unit[0] == NULLCHAR)
-        {
-          Serial.println("no unit provided, will use 'steps' as default");
-        }
-        flexyStepper->setTargetPositionInSteps((String(value).toInt()));
-      }
-      else if (strcmp(unit, "revs") == 0)
-      {
-        flexyStepper->setTargetPositionInRevolutions((String(value).toFloat()));
-      }
-      else if (strcmp(unit, "mm") == 0)
-      {
-        flexyStepper->setTargetPositionInMillimeters((String(value).toFloat()));
-      }
-      else
-      {
-        Serial.println("error: provided unit not supported. Must be one of mm, steps or revs");
-        return;
-      }
-      Serial.println(cmd);
-    }
-    else
-    {
-      Serial.println("error: missing required v parameter");
+      this->setTargetPositionHelper(cmd, stepper, targetPositionInSteps, args);
     }
   }
 }
@@ -631,66 +771,168 @@ void ESPStepperMotorServer_CLI::cmdMoveTo(char *cmd, char *args)
 void ESPStepperMotorServer_CLI::cmdMoveBy(char *cmd, char *args)
 {
   int stepperid = this->getValidStepperIdFromArg(args);
-#ifndef ESPStepperMotorServer_COMPILE_NO_DEBUG
-  ESPStepperMotorServer_Logger::logDebugf("%s called for stepper id %i\n", cmd, stepperid);
-#endif
+  ESPServerLogDebugf("%s called for stepper id %i\n", cmd, stepperid);
   if (stepperid > -1)
   {
-    ESP_FlexyStepper *flexyStepper = this->serverRef->getCurrentServerConfiguration()->getStepperConfiguration(stepperid)->getFlexyStepper();
+    ESPStepperMotorServer_StepperConfiguration *stepper = this->serverRef->getCurrentServerConfiguration()->getStepperConfiguration(stepperid);
 
-    this->setMoveSpeedAccelHelper(flexyStepper, args);
+    long distanceInSteps;
+    if (this->getTargetStepsFromArgs(stepper, args, distanceInSteps))
+    {
+      ESPServerLogDebugf("Setting target position relative by %ld steps\n", distanceInSteps);
+      this->setTargetPositionHelper(cmd, stepper, stepper->getFlexyStepper()->getCurrentPositionInSteps() + distanceInSteps, args);
+    }
+  }
+}
 
-    char value[20];
-    this->getParameterValue(args, "v", value);
-    if (value[0] != NULLCHAR)
+/**
+ * read the v and u parameters of a move command and convert the value to steps.
+ * Prints an error and returns false if the value is missing or the unit is not supported
+ */
+bool ESPStepperMotorServer_CLI::getTargetStepsFromArgs(ESPStepperMotorServer_StepperConfiguration *stepper, char *args, long &steps)
+{
+  char value[20];
+  this->getParameterValue(args, "v", value, sizeof(value));
+  if (value[0] == NULLCHAR)
+  {
+    Serial.println("error: missing required v parameter");
+    return false;
+  }
+  char unit[10];
+  this->getParameterValue(args, "u", unit, sizeof(unit));
+  if (unit[0] == NULLCHAR || strcmp(unit, "steps") == 0)
+  {
+    if (unit[0] == NULLCHAR)
     {
-#ifndef ESPStepperMotorServer_COMPILE_NO_DEBUG
-      ESPStepperMotorServer_Logger::logDebugf("cmdMoveBy called with v = %s\n", value);
-#endif
-      char unit[10];
-      this->getParameterValue(args, "u", unit);
-      if (unit[0] == NULLCHAR || strcmp(unit, "steps") == 0)
-      {
-        if (unit[0] == NULLCHAR)
-        {
-          Serial.println("no unit provided, will use 'steps' as default");
-        }
-        int targetPosition = (String(value).toInt());
-#ifndef ESPStepperMotorServer_COMPILE_NO_DEBUG
-        ESPStepperMotorServer_Logger::logDebugf("Setting target position to %i steps\n", targetPosition);
-#endif
-        flexyStepper->setTargetPositionRelativeInSteps(targetPosition);
-      }
-      else if (strcmp(unit, "revs") == 0)
-      {
-        float targetPosition = (String(value).toFloat());
-#ifndef ESPStepperMotorServer_COMPILE_NO_DEBUG
-        ESPStepperMotorServer_Logger::logDebugf("Setting target position to %f revs\n", targetPosition);
-#endif
-        flexyStepper->setTargetPositionRelativeInRevolutions(targetPosition);
-      }
-      else if (strcmp(unit, "mm") == 0)
-      {
-        float targetPosition = (String(value).toFloat());
-#ifndef ESPStepperMotorServer_COMPILE_NO_DEBUG
-        ESPStepperMotorServer_Logger::logDebugf("Setting target position to %f mm\n", targetPosition);
-#endif
-        flexyStepper->setTargetPositionRelativeInMillimeters(targetPosition);
-      }
-      else
-      {
-        Serial.println("error: provided unit not supported. Must be one of mm, steps or revs");
-        return;
-      }
-      Serial.println(cmd);
+      Serial.println("no unit provided, will use 'steps' as default");
     }
-    else
+    steps = String(value).toInt();
+  }
+  else if (strcmp(unit, "revs") == 0)
+  {
+    steps = stepper->getStepsForRevolutions(String(value).toFloat());
+  }
+  else if (strcmp(unit, "mm") == 0)
+  {
+    steps = stepper->getStepsForMillimeters(String(value).toFloat());
+  }
+  else
+  {
+    Serial.println("error: provided unit not supported. Must be one of mm, steps or revs");
+    return false;
+  }
+  return true;
+}
+
+/**
+ * check the given absolute target position against the soft limits of the stepper and set it, together with the optional speed and acceleration parameters.
+ * Targets that are rejected by the soft limits do not change the speed or acceleration settings of the stepper
+ */
+void ESPStepperMotorServer_CLI::setTargetPositionHelper(char *cmd, ESPStepperMotorServer_StepperConfiguration *stepper, long targetPositionInSteps, char *args)
+{
+  byte softLimitResult = stepper->applySoftLimits(targetPositionInSteps);
+  if (softLimitResult == ESPServerSoftLimitResult_Rejected)
+  {
+    Serial.printf("error: target position %ld steps is outside of the soft limits (%ld to %ld steps)\n", targetPositionInSteps, stepper->getSoftLimitMinPositionInSteps(), stepper->getSoftLimitMaxPositionInSteps());
+    return;
+  }
+  this->setMoveSpeedAccelHelper(stepper->getFlexyStepper(), args);
+  stepper->getFlexyStepper()->setTargetPositionInSteps(targetPositionInSteps);
+  if (softLimitResult == ESPServerSoftLimitResult_Clamped)
+  {
+    Serial.printf("warning: target position has been clamped to the soft limits, moving to %ld steps\n", targetPositionInSteps);
+  }
+  Serial.println(cmd);
+}
+
+void ESPStepperMotorServer_CLI::cmdSoftLimits(char *cmd, char *args)
+{
+  int stepperid = this->getValidStepperIdFromArg(args);
+  if (stepperid < 0)
+  {
+    return;
+  }
+  ESPStepperMotorServer_StepperConfiguration *stepper = this->serverRef->getCurrentServerConfiguration()->getStepperConfiguration(stepperid);
+
+  char minValue[20];
+  char maxValue[20];
+  char modeValue[4];
+  this->getParameterValue(args, "min", minValue, sizeof(minValue));
+  this->getParameterValue(args, "max", maxValue, sizeof(maxValue));
+  this->getParameterValue(args, "m", modeValue, sizeof(modeValue));
+  if (minValue[0] != NULLCHAR || maxValue[0] != NULLCHAR || modeValue[0] != NULLCHAR)
+  {
+    long minPosition = (minValue[0] != NULLCHAR) ? String(minValue).toInt() : stepper->getSoftLimitMinPositionInSteps();
+    long maxPosition = (maxValue[0] != NULLCHAR) ? String(maxValue).toInt() : stepper->getSoftLimitMaxPositionInSteps();
+    int mode = (modeValue[0] != NULLCHAR) ? String(modeValue).toInt() : stepper->getSoftLimitMode();
+    if (mode < ESPServerSoftLimitMode_Disabled || mode > ESPServerSoftLimitMode_Clamp || (mode != ESPServerSoftLimitMode_Disabled && minPosition > maxPosition))
     {
-      Serial.println("error: missing required v parameter");
+      Serial.println("error: invalid soft limits. Mode must be 0 (disabled), 1 (reject) or 2 (clamp) and min must not be larger than max");
+      return;
     }
+    stepper->setSoftLimits(minPosition, maxPosition, mode);
+  }
+  const char *modeNames[] = {"disabled", "reject", "clamp"};
+  Serial.printf("soft limits of stepper %i: %ld to %ld steps, mode: %s\n", stepperid, stepper->getSoftLimitMinPositionInSteps(), stepper->getSoftLimitMaxPositionInSteps(), modeNames[stepper->getSoftLimitMode()]);
+}
+
+#ifndef ESPStepperMotorServer_COMPILE_NO_GCODE
+void ESPStepperMotorServer_CLI::cmdRunGCodeFile(char *cmd, char *args)
+{
+  if (args == NULL)
+  {
+    Serial.printf(setterMissingParameterTemplate, cmd);
+    return;
   }
+  if (!this->serverRef->getGCodeInterpreter()->runFile(args))
+  {
+    Serial.printf("error: G-code file %s not found or another file is already running\n", args);
+    return;
+  }
+  Serial.println(cmd);
 }
 
+void ESPStepperMotorServer_CLI::cmdGCodeJob(char *cmd, char *args)
+{
+  ESPStepperMotorServer_GCodeInterpreter *interpreter = this->serverRef->getGCodeInterpreter();
+  if (args == NULL)
+  {
+    ESPStepperMotorServer_GCodeJobProgress progress;
+    interpreter->getJobProgress(progress);
+    Serial.printf("G-code job %s: %s\n", interpreter->getJobPath(), ESPStepperMotorServer_GCodeInterpreter::getJobStateName(progress.state));
+    Serial.printf("line %lu, %lu of %lu bytes, %lu lines executed\n", progress.lineNumber, progress.processedBytes, progress.fileSize, progress.executedLines);
+    Serial.printf("elapsed: %lu ms, remaining: %lu ms, %.1f lines/s, %lu buffer underruns\n", progress.elapsedMs, progress.remainingMs, progress.linesPerSecond, progress.bufferUnderruns);
+    return;
+  }
+
+  bool isAccepted = false;
+  if (strcmp(args, "pause") == 0)
+  {
+    isAccepted = interpreter->pauseJob();
+  }
+  else if (strcmp(args, "resume") == 0)
+  {
+    isAccepted = interpreter->resumeJob();
+  }
+  else if (strcmp(args, "abort") == 0)
+  {
+    isAccepted = interpreter->abortJob();
+  }
+  else
+  {
+    Serial.printf("error: invalid job command %s, use pause, resume or abort\n", args);
+    return;
+  }
+
+  if (!isAccepted)
+  {
+    Serial.printf("error: no G-code file job to %s\n", args);
+    return;
+  }
+  Serial.println(cmd);
+}
+#endif
+
 void ESPStepperMotorServer_CLI::cmdSaveConfiguration(char *cmd, char *args)
 {
   if (this->serverRef->getCurrentServerConfiguration()->saveCurrentConfiguationToSpiffs())
@@ -705,6 +947,14 @@ void ESPStepperMotorServer_CLI::cmdSaveConfiguration(char *cmd, char *args)
 
 void ESPStepperMotorServer_CLI::cmdSetLogLevel(char *cmd, char *args)
 {
+  char moduleName[ESPServerLogMaxModuleNameLength];
+  this->getParameterValue(args, "m", moduleName, sizeof(moduleName));
+  if (moduleName[0] != NULLCHAR)
+  {
+    this->setModuleLogLevel(cmd, args, moduleName);
+    return;
+  }
+
   unsigned int logLevelToSet = (String(args)).toInt();
   if (logLevelToSet == 0)
   {
@@ -720,6 +970,29 @@ void ESPStepperMotorServer_CLI::cmdSetLogLevel(char *cmd, char *args)
   }
 }
 
+/**
+ * get or set the log level of a single log module, e.g. ll=3&m:rest. Level 0 makes the module use the global log level again
+ */
+void ESPStepperMotorServer_CLI::setModuleLogLevel(char *cmd, char *args, const char *moduleName)
+{
+  byte module = ESPStepperMotorServer_Logger::getModuleId(moduleName);
+  if (module == 255)
+  {
+    Serial.printf("error: Unknown log module '%s'\n", moduleName);
+    return;
+  }
+  if (args == NULL || !isdigit(args[0]))
+  {
+    Serial.printf("%s=%i&m:%s\n", cmd, ESPStepperMotorServer_Logger::getModuleLogLevel(module), ESPStepperMotorServer_Logger::getModuleName(module));
+    return;
+  }
+  unsigned int logLevelToSet = (String(args)).toInt();
+  if (logLevelToSet > ESPServerLogLevel_ALL || !ESPStepperMotorServer_Logger::setModuleLogLevel(module, logLevelToSet))
+  {
+    Serial.printf("error: Invalid log level given. Must be in the range of %i (use global log level) and %i (All)\n", ESPServerLogLevel_INHERIT, ESPServerLogLevel_ALL);
+  }
+}
+
 /**
  * convert given char* to int value and check if it represents a valid stepper config id (within the allowed limits and with an existing stepper configuation existing)
  * -1 is returned if not valid and an error os printed to the serial interface
@@ -729,9 +1002,7 @@ int ESPStepperMotorServer_CLI::getValidStepperIdFromArg(char *arg)
   if (arg && isdigit(arg[0]))
   {
     int id = (String(arg)).toInt();
-#ifndef ESPStepperMotorServer_COMPILE_NO_DEBUG
-    ESPStepperMotorServer_Logger::logDebugf("extracted stepper id %i from argument string %s\n", id, arg);
-#endif
+    ESPServerLogDebugf("extracted stepper id %i from argument string %s\n", id, arg);
     if (id > ESPServerMaxSteppers || !this->serverRef->getCurrentServerConfiguration()->getStepperConfiguration((byte)id))
     {
       Serial.println("error: invalid stepper id given");
@@ -742,83 +1013,56 @@ int ESPStepperMotorServer_CLI::getValidStepperIdFromArg(char *arg)
 #ifndef ESPStepperMotorServer_COMPILE_NO_DEBUG
   else
   {
-    ESPStepperMotorServer_Logger::logDebug("no argument string given to extract stepper id from, will return -1");
+    ESPServerLogDebug("no argument string given to extract stepper id from, will return -1");
   }
 #endif
   return -1;
 }
 
 /**
- * helper function to extract parameters and values from the given argument string
+ * helper function to find the value of a parameter in the given argument string (e.g. "0&v:100&u:mm") without copying or modifying it.
+ * Returns true if the parameter has been found with a non empty value, in this case result points to the value inside of args
+ */
+bool ESPStepperMotorServer_CLI::getParameterSlice(const char *args, const char *parameterNameToGetValueFor, cliTokenSlice &result)
+{
+  return ESPStepperMotorServer_CommandParser::getParameterSlice(args, parameterNameToGetValueFor, result);
+}
+
+/**
+ * helper function to extract parameters and values from the given argument string.
+ * The value is copied to result, which must be large enough to hold the value (at most COMMAND_BUFFER_LENGTH chars for commands read from the serial port)
  */
 void ESPStepperMotorServer_CLI::getParameterValue(const char *args, const char *parameterNameToGetValueFor, char *result)
 {
-  if (args == NULL)
-  {
-#ifndef ESPStepperMotorServer_COMPILE_NO_DEBUG
-    ESPStepperMotorServer_Logger::logDebugf("getParameterValue called with on NULL and %s\n", parameterNameToGetValueFor);
-#endif
-    strcpy(result, "");
-    return;
-  }
-#ifndef ESPStepperMotorServer_COMPILE_NO_DEBUG
-  ESPStepperMotorServer_Logger::logDebugf("getParameterValue called with %s and %s\n", args, parameterNameToGetValueFor);
-#endif
-  char *parameterValue;
-  char *save_ptr;
-  String argumentString = String(args);
-  char workingCopy[argumentString.length() + 1];
-  strcpy(workingCopy, args);
+  this->getParameterValue(args, parameterNameToGetValueFor, result, COMMAND_BUFFER_LENGTH + 1);
+}
 
-  char *keyValuePairString = strtok_r(workingCopy, this->_PARAM_PARAM_SEPRATOR, &save_ptr);
-  while (keyValuePairString != NULL)
+/**
+ * helper function to extract parameters and values from the given argument string.
+ * Values longer than resultBufferSize - 1 chars get truncated
+ */
+void ESPStepperMotorServer_CLI::getParameterValue(const char *args, const char *parameterNameToGetValueFor, char *result, unsigned int resultBufferSize)
+{
+  cliTokenSlice value;
+  if (!this->getParameterSlice(args, parameterNameToGetValueFor, value))
   {
-#ifndef ESPStepperMotorServer_COMPILE_NO_DEBUG
-    ESPStepperMotorServer_Logger::logDebugf("Found a key value pair: %s\n", keyValuePairString);
-#endif
-    char *restKeyValuePair = keyValuePairString;
-    char *parameterName = strtok_r(restKeyValuePair, this->_PARAM_VALUE_SEPRATOR, &restKeyValuePair);
-    if (parameterName != NULL)
-    {
-#ifndef ESPStepperMotorServer_COMPILE_NO_DEBUG
-      ESPStepperMotorServer_Logger::logDebugf("Found parameter '%s'\n", parameterName);
-#endif
-      if (strcmp(parameterName, parameterNameToGetValueFor) == 0)
-      {
-        if (restKeyValuePair && strcmp(restKeyValuePair, "") != 0)
-        {
-          parameterValue = strtok_r(restKeyValuePair, this->_PARAM_VALUE_SEPRATOR, &restKeyValuePair);
-#ifndef ESPStepperMotorServer_COMPILE_NO_DEBUG
-          ESPStepperMotorServer_Logger::logDebugf("Found matching parameter: %s with value %s\n", parameterName, parameterValue);
-#endif
-          strcpy(result, parameterValue);
-          return;
-        }
-      }
-#ifndef ESPStepperMotorServer_COMPILE_NO_DEBUG
-      else
-      {
-        ESPStepperMotorServer_Logger::logDebug("parameter did not match requested parameter");
-      }
-#endif
-    }
-    keyValuePairString = strtok_r(NULL, this->_PARAM_PARAM_SEPRATOR, &save_ptr);
+    ESPServerLogDebugf("No value found for parameter %s\n", parameterNameToGetValueFor);
+    result[0] = NULLCHAR;
+    return;
   }
-#ifndef ESPStepperMotorServer_COMPILE_NO_DEBUG
-  ESPStepperMotorServer_Logger::logDebug("No match found");
-#endif
-  strcpy(result, "");
+  unsigned int length = min(value.length, resultBufferSize - 1);
+  memcpy(result, value.data, length);
+  result[length] = NULLCHAR;
+  ESPServerLogDebugf("Found matching parameter: %s with value %s\n", parameterNameToGetValueFor, result);
 }
 
 ////// internal helpers to prevent code duplication
 void ESPStepperMotorServer_CLI::getUnitWithFallback(char *args, char *unit)
 {
-  this->getParameterValue(args, "u", unit);
+  this->getParameterValue(args, "u", unit, 10); // all callers use a char[10] buffer for the unit
   if (unit[0] == NULLCHAR)
   {
-#ifndef ESPStepperMotorServer_COMPILE_NO_DEBUG
-    ESPStepperMotorServer_Logger::logDebug("no unit provided, will use 'steps' as default");
-#endif
+    ESPServerLogDebug("no unit provided, will use 'steps' as default");
     strcpy(unit, "steps");
   }
 }
@@ -31,11 +31,15 @@
 #ifndef ESPStepperMotorServer_CLI_h
 #define ESPStepperMotorServer_CLI_h
 
-#define MAX_CLI_CMD_COUNTER 50
-#define MAX_CLI_USER_CMD_COUNTER 5
+// maximum sample rate of the stream command in Hz
+#define CLI_STREAM_MAX_RATE 1000
 
+#include <ESPStepperMotorServer_CommandParser.h>
 #include <ESPStepperMotorServer.h>
 #include <ESPStepperMotorServer_Logger.h>
+#ifndef ESPStepperMotorServer_COMPILE_NO_BINARY_PROTOCOL
+#include <ESPStepperMotorServer_BinaryProtocol.h>
+#endif
 
 //need this forward declaration here due to circular dependency (use in constructor/member variable)
 class ESPStepperMotorServer;
@@ -48,18 +52,31 @@ struct commandDetailsStructure
   bool hasParameters;
 };
 
-class ESPStepperMotorServer_CLI
+// the values of one axis at the time a stream sample has been taken
+struct cliStreamAxisSnapshot
+{
+  byte stepperId;
+  long positionInSteps;
+  float velocityInStepsPerSecond;
+};
+
+// the command names and shortcuts are looked up in the command table, which calls commandMatchesName to compare the full names
+class ESPStepperMotorServer_CLI : public ESPStepperMotorServer_CommandTable
 {
 public:
   ESPStepperMotorServer_CLI(ESPStepperMotorServer *serverRef);
   ~ESPStepperMotorServer_CLI();
   static void processSerialInput(void *parameter);
   void executeCommand(String cmd);
+  void executeCommand(char *commandLine);
   void start();
   void stop();
   void registerNewUserCommand(commandDetailsStructure commandDetails, void (*f)(char *, char *));
   int getValidStepperIdFromArg(char *arg);
+  void setModuleLogLevel(char *cmd, char *args, const char *moduleName);
   void getParameterValue(const char *args, const char *parameterNameToGetValueFor, char *result);
+  void getParameterValue(const char *args, const char *parameterNameToGetValueFor, char *result, unsigned int resultBufferSize);
+  bool getParameterSlice(const char *args, const char *parameterNameToGetValueFor, cliTokenSlice &result);
   void getUnitWithFallback(char *args, char *unit);
 
 private:
@@ -87,9 +104,22 @@ private:
 #endif
   void cmdSetSSID(char *cmd, char *args);
   void cmdSetWifiPassword(char *cmd, char *args);
+  void cmdStream(char *cmd, char *args);
+  void cmdSoftLimits(char *cmd, char *args);
+#ifndef ESPStepperMotorServer_COMPILE_NO_GCODE
+  void cmdRunGCodeFile(char *cmd, char *args);
+  void cmdGCodeJob(char *cmd, char *args);
+#endif
+  void processStream();
+  TickType_t getTicksUntilNextStreamSample(TickType_t maxTicks);
+  byte takeStreamSnapshot();
+  void printStreamHeader(byte axisCount);
   void registerCommands();
   void registerNewCommand(commandDetailsStructure commandDetails, void (ESPStepperMotorServer_CLI::*f)(char *, char *));
   void setMoveSpeedAccelHelper(ESP_FlexyStepper *flexyStepper, char *args);
+  bool getTargetStepsFromArgs(ESPStepperMotorServer_StepperConfiguration *stepper, char *args, long &steps);
+  void setTargetPositionHelper(char *cmd, ESPStepperMotorServer_StepperConfiguration *stepper, long targetPositionInSteps, char *args);
+  bool commandMatchesName(byte commandIndex, const char *name, unsigned int length) const override;
 
   TaskHandle_t xHandle = NULL;
   ESPStepperMotorServer *serverRef;
@@ -100,10 +130,16 @@ private:
   commandDetailsStructure allRegisteredUserCommands[MAX_CLI_USER_CMD_COUNTER + 1];
   unsigned int commandCounter = 0;
   unsigned int userCommandCounter = 0;
-
-  const char *_CMD_PARAM_SEPRATOR = "=";
-  const char *_PARAM_PARAM_SEPRATOR = "&";
-  const char *_PARAM_VALUE_SEPRATOR = ":";
+#ifndef ESPStepperMotorServer_COMPILE_NO_BINARY_PROTOCOL
+  ESPStepperMotorServer_BinaryProtocol binaryProtocol;
+#endif
+  // interval between two samples of the stream command, 0 = streaming disabled
+  unsigned long streamIntervalMs = 0;
+  unsigned long nextStreamSampleMillis = 0;
+  unsigned long droppedStreamSampleCounter = 0;
+  // the configuration revision the last stream header has been printed for
+  unsigned int streamConfigurationRevision = 0;
+  cliStreamAxisSnapshot streamSnapshot[ESPServerMaxSteppers];
 };
 
 #endif
@@ -0,0 +1,189 @@
+//      ******************************************************************
+//      *                                                                *
+//      *              ESPStepperMotorServer_CommandParser               *
+//      *                                                                *
+//      *               Copyright (c) Paul Kerspe, 2019                  *
+//      *                                                                *
+//      ******************************************************************
+// MIT License
+//
+// Copyright (c) 2019 Paul Kerspe
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished
+// to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <ESPStepperMotorServer_CommandParser.h>
+
+/**
+ * split the given command line into the command name and its arguments. The command line is tokenized in place
+ * (the first '=' gets replaced by a null char), everything after a second '=' is ignored.
+ * Returns the command name, arguments is set to NULL if the command has no arguments
+ */
+char *ESPStepperMotorServer_CommandParser::splitCommandLine(char *commandLine, char **arguments)
+{
+  *arguments = strchr(commandLine, CLI_CMD_PARAM_SEPARATOR);
+  if (*arguments != NULL)
+  {
+    **arguments = '\0';
+    (*arguments)++;
+    char *argumentsEnd = strchr(*arguments, CLI_CMD_PARAM_SEPARATOR);
+    if (argumentsEnd != NULL)
+    {
+      *argumentsEnd = '\0';
+    }
+    if (**arguments == '\0')
+    {
+      *arguments = NULL;
+    }
+  }
+  return commandLine;
+}
+
+/**
+ * find the value of the parameter with the given name in the arguments of a command (e.g. "v" in "0&v:100&u:mm").
+ * Returns false if the parameter is missing or has no value
+ */
+bool ESPStepperMotorServer_CommandParser::getParameterSlice(const char *args, const char *parameterNameToGetValueFor, cliTokenSlice &result)
+{
+  result.data = NULL;
+  result.length = 0;
+  if (args == NULL)
+  {
+    return false;
+  }
+  const unsigned int parameterNameLength = strlen(parameterNameToGetValueFor);
+  const char *keyValuePair = args;
+  while (*keyValuePair != '\0')
+  {
+    const char *keyValuePairEnd = strchr(keyValuePair, CLI_PARAM_PARAM_SEPARATOR);
+    if (keyValuePairEnd == NULL)
+    {
+      keyValuePairEnd = keyValuePair + strlen(keyValuePair);
+    }
+    const char *valueSeparator = (const char *)memchr(keyValuePair, CLI_PARAM_VALUE_SEPARATOR, keyValuePairEnd - keyValuePair);
+    if (valueSeparator != NULL && (unsigned int)(valueSeparator - keyValuePair) == parameterNameLength && strncmp(keyValuePair, parameterNameToGetValueFor, parameterNameLength) == 0)
+    {
+      const char *value = valueSeparator + 1;
+      // a second ':' terminates the value
+      const char *valueEnd = (const char *)memchr(value, CLI_PARAM_VALUE_SEPARATOR, keyValuePairEnd - value);
+      if (valueEnd == NULL)
+      {
+        valueEnd = keyValuePairEnd;
+      }
+      if (valueEnd > value)
+      {
+        result.data = value;
+        result.length = valueEnd - value;
+        return true;
+      }
+    }
+    if (*keyValuePairEnd == '\0')
+    {
+      break;
+    }
+    keyValuePair = keyValuePairEnd + 1;
+  }
+  return false;
+}
+
+ESPStepperMotorServer_CommandTable::ESPStepperMotorServer_CommandTable()
+{
+  memset(this->commandHashTable, CLI_COMMAND_HASH_TABLE_EMPTY_SLOT, sizeof(this->commandHashTable));
+}
+
+/**
+ * FNV-1a hash of the given command name
+ */
+unsigned int ESPStepperMotorServer_CommandTable::hashCommandName(const char *name, unsigned int length)
+{
+  unsigned int hash = 2166136261u;
+  for (unsigned int i = 0; i < length; i++)
+  {
+    hash ^= (byte)name[i];
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+/**
+ * returns true if the given command name (or shortcut) equals the given name, which does not need to be null terminated
+ */
+bool ESPStepperMotorServer_CommandTable::isSameName(const char *commandName, unsigned int commandNameLength, const char *name, unsigned int length)
+{
+  return (commandNameLength == length && strncmp(commandName, name, length) == 0);
+}
+
+/**
+ * look up the command with the given name or shortcut, the name does not need to be null terminated.
+ * Returns the command index or -1 if no command matches. If several commands match, the lowest index is returned,
+ * so built in commands take precedence over user commands with the same name
+ */
+int ESPStepperMotorServer_CommandTable::findCommandIndex(const char *name, unsigned int length) const
+{
+  if (length == 0)
+  {
+    return -1;
+  }
+  int matchingCommandIndex = -1;
+  unsigned int slot = hashCommandName(name, length) & (CLI_COMMAND_HASH_TABLE_SIZE - 1);
+  for (unsigned int probes = 0; probes < CLI_COMMAND_HASH_TABLE_SIZE; probes++)
+  {
+    byte commandIndex = this->commandHashTable[slot];
+    if (commandIndex == CLI_COMMAND_HASH_TABLE_EMPTY_SLOT)
+    {
+      break;
+    }
+    if ((matchingCommandIndex < 0 || commandIndex < matchingCommandIndex) && this->commandMatchesName(commandIndex, name, length))
+    {
+      matchingCommandIndex = commandIndex;
+    }
+    slot = (slot + 1) & (CLI_COMMAND_HASH_TABLE_SIZE - 1);
+  }
+  return matchingCommandIndex;
+}
+
+/**
+ * returns true if the given name is already used as name or shortcut of a command
+ */
+bool ESPStepperMotorServer_CommandTable::isCommandNameRegistered(const char *name) const
+{
+  return (this->findCommandIndex(name, strlen(name)) >= 0);
+}
+
+/**
+ * add the given name (or shortcut) of the command with the given index to the table. Empty names are ignored.
+ * The caller must make sure the table does not run full (see CLI_COMMAND_HASH_TABLE_SIZE)
+ */
+void ESPStepperMotorServer_CommandTable::addCommandName(const char *name, byte commandIndex)
+{
+  const unsigned int length = strlen(name);
+  if (length == 0)
+  {
+    return;
+  }
+  unsigned int slot = hashCommandName(name, length) & (CLI_COMMAND_HASH_TABLE_SIZE - 1);
+  while (this->commandHashTable[slot] != CLI_COMMAND_HASH_TABLE_EMPTY_SLOT)
+  {
+    if (this->commandHashTable[slot] == commandIndex && this->commandMatchesName(commandIndex, name, length))
+    {
+      return; // command and shortcut are the same
+    }
+    slot = (slot + 1) & (CLI_COMMAND_HASH_TABLE_SIZE - 1);
+  }
+  this->commandHashTable[slot] = commandIndex;
+}
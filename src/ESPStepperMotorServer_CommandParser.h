@@ -0,0 +1,90 @@
+//      ******************************************************************
+//      *                                                                *
+//      *    Header file for ESPStepperMotorServer_CommandParser.cpp     *
+//      *                                                                *
+//      *               Copyright (c) Paul Kerspe, 2019                  *
+//      *                                                                *
+//      ******************************************************************
+// MIT License
+//
+// Copyright (c) 2019 Paul Kerspe
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished
+// to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef ESPStepperMotorServer_CommandParser_h
+#define ESPStepperMotorServer_CommandParser_h
+
+#include <Arduino.h>
+
+#define MAX_CLI_CMD_COUNTER 50
+#define MAX_CLI_USER_CMD_COUNTER 5
+// size of the hash table used to look up commands by name or shortcut. Must be a power of 2 and should be
+// at least twice the number of possible keys (2 * (MAX_CLI_CMD_COUNTER + MAX_CLI_USER_CMD_COUNTER))
+#define CLI_COMMAND_HASH_TABLE_SIZE 256
+#define CLI_COMMAND_HASH_TABLE_EMPTY_SLOT 255
+// separators of a command line like "moveto=0&v:100&u:mm"
+#define CLI_CMD_PARAM_SEPARATOR '='
+#define CLI_PARAM_PARAM_SEPARATOR '&'
+#define CLI_PARAM_VALUE_SEPARATOR ':'
+
+// a non owning reference to a part of a command line (like a string_view), used to parse commands without copying them
+struct cliTokenSlice
+{
+  const char *data;
+  unsigned int length;
+};
+
+//
+// the ESPStepperMotorServer_CommandParser class
+// splits a command line of the CLI into the command name and its arguments and finds the values of named parameters in the arguments.
+// All functions work on the command line in place, nothing is copied.
+// Does not depend on the ESP32 hardware, so it can also be tested on the host (see test/test_command_parser)
+class ESPStepperMotorServer_CommandParser
+{
+public:
+  static char *splitCommandLine(char *commandLine, char **arguments);
+  static bool getParameterSlice(const char *args, const char *parameterNameToGetValueFor, cliTokenSlice &result);
+};
+
+//
+// the ESPStepperMotorServer_CommandTable class
+// open addressing hash table for the command names and shortcuts of the CLI. Each slot contains the index of the command
+// (the CLI stores user commands with an offset of MAX_CLI_CMD_COUNTER) or CLI_COMMAND_HASH_TABLE_EMPTY_SLOT.
+// The names are not stored in the table, a hash match is confirmed by commandMatchesName, which compares the full names
+// and is implemented by the owner of the commands (e.g. ESPStepperMotorServer_CLI).
+// Does not depend on the ESP32 hardware, so it can also be tested on the host (see test/test_command_parser)
+class ESPStepperMotorServer_CommandTable
+{
+public:
+  ESPStepperMotorServer_CommandTable();
+  virtual ~ESPStepperMotorServer_CommandTable() {}
+  int findCommandIndex(const char *name, unsigned int length) const;
+  bool isCommandNameRegistered(const char *name) const;
+
+protected:
+  virtual bool commandMatchesName(byte commandIndex, const char *name, unsigned int length) const = 0;
+  void addCommandName(const char *name, byte commandIndex);
+  static unsigned int hashCommandName(const char *name, unsigned int length);
+  static bool isSameName(const char *commandName, unsigned int commandNameLength, const char *name, unsigned int length);
+
+private:
+  byte commandHashTable[CLI_COMMAND_HASH_TABLE_SIZE];
+};
+
+#endif
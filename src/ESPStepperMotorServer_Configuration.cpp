@@ -31,6 +31,8 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+#define ESPServerLogModule ESPServerLogModule_Configuration
+
 #include "ESPStepperMotorServer_Configuration.h"
 
 #define RESERVED_JSON_SIZE_ESPStepperMotorServer_Configuration 300
@@ -96,32 +98,32 @@ void ESPStepperMotorServer_Configuration::serializeServerConfiguration(JsonDocum
     doc[JSON_SECTION_NAME_SERVER_CONFIGURATION][JSON_PROPERTY_NAME_WIFI_AP_PASSWORD] = (includePasswords) ? this->apPassword : "*****";
     doc[JSON_SECTION_NAME_SERVER_CONFIGURATION][JSON_PROPERTY_NAME_CPUCORE_FOR_MOTIONCONTROLLER_SERVICE] = this->motionControllerCpuCore;
 
-    ESPStepperMotorServer_Logger::logInfof("Serializing config \n");
+    ESPServerLogInfof("Serializing config \n");
 
     if (this->staticIP != 0)
     {
-        ESPStepperMotorServer_Logger::logInfof("static ip = %s \n", this->staticIP.toString().c_str());
+        ESPServerLogInfof("static ip = %s \n", this->staticIP.toString().c_str());
         doc[JSON_SECTION_NAME_SERVER_CONFIGURATION][JSON_PROPERTY_NAME_WIFI_STATIC_IP_ADDRESS] = this->staticIP.toString();
     }
 
     if (this->gatewayIP != 0)
     {
-        ESPStepperMotorServer_Logger::logInfof("gateway ip = %s \n", this->gatewayIP.toString().c_str());
+        ESPServerLogInfof("gateway ip = %s \n", this->gatewayIP.toString().c_str());
         doc[JSON_SECTION_NAME_SERVER_CONFIGURATION][JSON_PROPERTY_NAME_WIFI_STATIC_IP_GATEWAY] = this->gatewayIP.toString();
     }
     if (this->subnetMask != 0)
     {
-        ESPStepperMotorServer_Logger::logInfof("subnetMask = %s \n", this->subnetMask.toString().c_str());
+        ESPServerLogInfof("subnetMask = %s \n", this->subnetMask.toString().c_str());
         doc[JSON_SECTION_NAME_SERVER_CONFIGURATION][JSON_PROPERTY_NAME_WIFI_STATIC_IP_SUBNETMASK] = this->subnetMask.toString();
     }
     if (this->dns1IP != 0)
     {
-        ESPStepperMotorServer_Logger::logInfof("DNS1 ip = %s \n", this->dns1IP.toString().c_str());
+        ESPServerLogInfof("DNS1 ip = %s \n", this->dns1IP.toString().c_str());
         doc[JSON_SECTION_NAME_SERVER_CONFIGURATION][JSON_PROPERTY_NAME_WIFI_STATIC_IP_DNS1] = this->dns1IP.toString();
     }
     if (this->dns2IP != 0)
     {
-        ESPStepperMotorServer_Logger::logInfof("DNS2 ip = %s \n", this->dns2IP.toString().c_str());
+        ESPServerLogInfof("DNS2 ip = %s \n", this->dns2IP.toString().c_str());
         doc[JSON_SECTION_NAME_SERVER_CONFIGURATION][JSON_PROPERTY_NAME_WIFI_STATIC_IP_DNS2] = this->dns2IP.toString();
     }
 
@@ -145,6 +147,12 @@ void ESPStepperMotorServer_Configuration::serializeServerConfiguration(JsonDocum
             nestedStepperConfig["breakPinActiveState"] = stepperConfig->getBrakePinActiveState();
             nestedStepperConfig["breakEngageDelay"] = stepperConfig->getBrakeEngageDelayMs();
             nestedStepperConfig["breakReleaseDelay"] = stepperConfig->getBrakeReleaseDelayMs();
+            nestedStepperConfig["enablePin"] = stepperConfig->getEnableIoPin();
+            nestedStepperConfig["enablePinActiveState"] = stepperConfig->getEnablePinActiveState();
+            nestedStepperConfig["driverDisableDelay"] = stepperConfig->getDriverDisableDelayMs();
+            nestedStepperConfig["softLimitMin"] = stepperConfig->getSoftLimitMinPositionInSteps();
+            nestedStepperConfig["softLimitMax"] = stepperConfig->getSoftLimitMaxPositionInSteps();
+            nestedStepperConfig["softLimitMode"] = stepperConfig->getSoftLimitMode();
         }
     }
 
@@ -222,7 +230,7 @@ bool ESPStepperMotorServer_Configuration::saveCurrentConfiguationToSpiffs(String
     }
     else
     {
-        ESPStepperMotorServer_Logger::logInfof("New configuration file written in SPIFFS to '%s'\n", filename.c_str());
+        ESPServerLogInfof("New configuration file written in SPIFFS to '%s'\n", filename.c_str());
         success = true;
     }
 
@@ -239,7 +247,7 @@ bool ESPStepperMotorServer_Configuration::loadConfiguationFromSpiffs(String file
 
     if (this->_isSPIFFSactive && SPIFFS.exists(filename))
     {
-        ESPStepperMotorServer_Logger::logInfof("Loading configuration file %s from SPIFFS\n", filename.c_str());
+        ESPServerLogInfof("Loading configuration file %s from SPIFFS\n", filename.c_str());
         File configFile = SPIFFS.open(filename, FILE_READ);
         DynamicJsonDocument doc(this->calculateRequiredJsonDocumentSizeForCurrentConfiguration());
         this->serializeServerConfiguration(doc);
@@ -250,7 +258,7 @@ bool ESPStepperMotorServer_Configuration::loadConfiguationFromSpiffs(String file
 #ifndef ESPStepperMotorServer_COMPILE_NO_DEBUG
         else
         {
-            ESPStepperMotorServer_Logger::logDebug("File loaded and deserialized");
+            ESPServerLogDebug("File loaded and deserialized");
         }
 #endif
         // Copy values from the JsonDocument to the Config
@@ -298,14 +306,14 @@ bool ESPStepperMotorServer_Configuration::loadConfiguationFromSpiffs(String file
         byte configCounter = 0;
         if (!configs)
         {
-            ESPStepperMotorServer_Logger::logInfo("No stepper configuration present in config file");
+            ESPServerLogInfo("No stepper configuration present in config file");
         }
         else
         {
             for (JsonVariant stepperConfigEntry : configs)
             {
                 const char *value = stepperConfigEntry["name"].as<const char *>();
-                ESPStepperMotorServer_StepperConfiguration *stepperConfig = new ESPStepperMotorServer_StepperConfiguration(
+                ESPStepperMotorServer_StepperConfiguration *stepperConfig = getStepperConfigurationPool().create(
                     (stepperConfigEntry["stepPin"] | 255),
                     (stepperConfigEntry["directionPin"] | 255),
                     ((value) ? value : "undefined"),
@@ -318,6 +326,11 @@ bool ESPStepperMotorServer_Configuration::loadConfiguationFromSpiffs(String file
                 stepperConfig->setBrakeIoPin(stepperConfigEntry["breakPin"] | stepperConfig->ESPServerStepperUnsetIoPinNumber, stepperConfigEntry["breakPinActiveState"] | 1);
                 stepperConfig->setBrakeEngageDelayMs(stepperConfigEntry["breakEngageDelay"] | 0);
                 stepperConfig->setBrakeReleaseDelayMs(stepperConfigEntry["breakReleaseDelay"] | -1);
+                //set driver enable settings
+                stepperConfig->setEnableIoPin(stepperConfigEntry["enablePin"] | stepperConfig->ESPServerStepperUnsetIoPinNumber, stepperConfigEntry["enablePinActiveState"] | 2);
+                stepperConfig->setDriverDisableDelayMs(stepperConfigEntry["driverDisableDelay"] | -1);
+                //set software travel limits
+                stepperConfig->setSoftLimits(stepperConfigEntry["softLimitMin"] | 0L, stepperConfigEntry["softLimitMax"] | 0L, stepperConfigEntry["softLimitMode"] | ESPServerSoftLimitMode_Disabled);
 
                 if (stepperConfigEntry["id"])
                 {
@@ -329,7 +342,7 @@ bool ESPStepperMotorServer_Configuration::loadConfiguationFromSpiffs(String file
                 }
                 configCounter++;
             }
-            ESPStepperMotorServer_Logger::logInfof("%i stepper configuration entr%s loaded from config file\n", configCounter, (configCounter == 1) ? "y" : "ies");
+            ESPServerLogInfof("%i stepper configuration entr%s loaded from config file\n", configCounter, (configCounter == 1) ? "y" : "ies");
         }
 
         // SWITCH CONFIG
@@ -337,14 +350,14 @@ bool ESPStepperMotorServer_Configuration::loadConfiguationFromSpiffs(String file
         configs = doc[JSON_SECTION_NAME_SWITCH_CONFIGURATIONS].as<JsonArray>();
         if (!configs)
         {
-            ESPStepperMotorServer_Logger::logInfo("No switch configuration present in config file");
+            ESPServerLogInfo("No switch configuration present in config file");
         }
         else
         {
             for (JsonVariant switchConfigEntry : configs)
             {
                 const char *value = switchConfigEntry["name"].as<const char *>();
-                ESPStepperMotorServer_PositionSwitch *switchConfig = new ESPStepperMotorServer_PositionSwitch(
+                ESPStepperMotorServer_PositionSwitch *switchConfig = getSwitchPool().create(
                     (switchConfigEntry["ioPin"] | 255),
                     (switchConfigEntry["stepperIndex"] | 255),
                     (switchConfigEntry["switchType"] | 255),
@@ -373,7 +386,7 @@ bool ESPStepperMotorServer_Configuration::loadConfiguationFromSpiffs(String file
                 }
                 configCounter++;
             }
-            ESPStepperMotorServer_Logger::logInfof("%i switch configuration entr%s loaded from config file\n", configCounter, (configCounter == 1) ? "y" : "ies");
+            ESPServerLogInfof("%i switch configuration entr%s loaded from config file\n", configCounter, (configCounter == 1) ? "y" : "ies");
         }
 
         // ENCODER CONFIG
@@ -381,7 +394,7 @@ bool ESPStepperMotorServer_Configuration::loadConfiguationFromSpiffs(String file
         configs = doc[JSON_SECTION_NAME_ROTARY_ENCODER_CONFIGURATIONS].as<JsonArray>();
         if (!configs)
         {
-            ESPStepperMotorServer_Logger::logInfo("No rotary encoder configuration present in config file");
+            ESPServerLogInfo("No rotary encoder configuration present in config file");
         }
         else
         {
@@ -389,7 +402,7 @@ bool ESPStepperMotorServer_Configuration::loadConfiguationFromSpiffs(String file
             {
                 const char *value = encoderConfigEntry["name"].as<const char *>();
                 //char pinA, char pinB, String displayName, int stepMultiplier, byte stepperIndex
-                ESPStepperMotorServer_RotaryEncoder *encoderConfig = new ESPStepperMotorServer_RotaryEncoder(
+                ESPStepperMotorServer_RotaryEncoder *encoderConfig = getRotaryEncoderPool().create(
                     (encoderConfigEntry["pinA"] | 255),
                     (encoderConfigEntry["pinB"] | 255),
                     ((value) ? value : "undefined"),
@@ -405,7 +418,7 @@ bool ESPStepperMotorServer_Configuration::loadConfiguationFromSpiffs(String file
                 }
                 configCounter++;
             }
-            ESPStepperMotorServer_Logger::logInfof("%i rotary encoder configuration entr%s loaded from config file\n", configCounter, (configCounter == 1) ? "y" : "ies");
+            ESPServerLogInfof("%i rotary encoder configuration entr%s loaded from config file\n", configCounter, (configCounter == 1) ? "y" : "ies");
         }
 
         // Close the file
@@ -474,16 +487,23 @@ byte ESPStepperMotorServer_Configuration::addRotaryEncoder(ESPStepperMotorServer
 
 void ESPStepperMotorServer_Configuration::setStepperConfiguration(ESPStepperMotorServer_StepperConfiguration *stepperConfig, byte id)
 {
+    ESPStepperMotorServer_StepperConfiguration *replacedStepperConfig = NULL;
     if (id >= ESPServerMaxSteppers)
     {
         ESPStepperMotorServer_Logger::logWarningf("The given stepper id/index (%i) exceeds the allowed max amount of %i. Stepper config will not be set\n", id, ESPServerMaxSteppers);
     }
     else
     {
+        replacedStepperConfig = this->configuredSteppers[id];
         stepperConfig->setId(id);
         this->configuredSteppers[id] = stepperConfig;
     }
     this->updateConfiguredFlexyStepperCache();
+    //the replaced config can only be released once it has been removed from the caches and no task uses it anymore
+    if (replacedStepperConfig != NULL && replacedStepperConfig != stepperConfig)
+    {
+        this->retireStepperConfiguration(replacedStepperConfig);
+    }
 }
 
 void ESPStepperMotorServer_Configuration::setSwitch(ESPStepperMotorServer_PositionSwitch *positionSwitch, byte id)
@@ -494,9 +514,14 @@ void ESPStepperMotorServer_Configuration::setSwitch(ESPStepperMotorServer_Positi
     }
     else
     {
+        ESPStepperMotorServer_PositionSwitch *replacedSwitch = this->allConfiguredSwitches[id];
         positionSwitch->setId(id);
         this->allConfiguredSwitches[id] = positionSwitch;
         this->updateSwitchCaches();
+        if (replacedSwitch != positionSwitch)
+        {
+            getSwitchPool().release(replacedSwitch);
+        }
     }
 }
 
@@ -508,8 +533,14 @@ void ESPStepperMotorServer_Configuration::setRotaryEncoder(ESPStepperMotorServer
     }
     else
     {
+        ESPStepperMotorServer_RotaryEncoder *replacedEncoder = this->configuredRotaryEncoders[id];
         encoder->setId(id);
         this->configuredRotaryEncoders[id] = encoder;
+        //the interrupts of the replaced encoder must already be detached by the caller (see ESPStepperMotorServer::addOrUpdateRotaryEncoder)
+        if (replacedEncoder != encoder)
+        {
+            getRotaryEncoderPool().release(replacedEncoder);
+        }
     }
 }
 
@@ -527,6 +558,7 @@ void ESPStepperMotorServer_Configuration::updateConfiguredFlexyStepperCache()
 {
     byte flexyStepperCounter = 0;
     ESPStepperMotorServer_StepperConfiguration *stepper;
+    ESPStepperMotorServer_ActiveAxis updatedActiveAxes[ESPServerMaxSteppers];
 
     //clear list first
     for (byte i = 0; i < ESPServerMaxSteppers; i++)
@@ -542,14 +574,78 @@ void ESPStepperMotorServer_Configuration::updateConfiguredFlexyStepperCache()
         if (stepper)
         {
             this->configuredFlexySteppers[flexyStepperCounter] = stepper->getFlexyStepper();
+            updatedActiveAxes[flexyStepperCounter].flexyStepper = stepper->getFlexyStepper();
+            updatedActiveAxes[flexyStepperCounter].stepperId = i;
+            updatedActiveAxes[flexyStepperCounter].isMoving = false;
             flexyStepperCounter++;
         }
     }
+    //publish the new index together with the new revision, so readers never see a partially rebuilt index
+    portENTER_CRITICAL(&this->activeAxisMux);
+    memcpy(this->activeAxes, updatedActiveAxes, flexyStepperCounter * sizeof(ESPStepperMotorServer_ActiveAxis));
+    this->activeAxisCount = flexyStepperCounter;
+    this->configurationRevision++;
+    portEXIT_CRITICAL(&this->activeAxisMux);
+}
+
+/**
+ * copy the packed array of active axes into the given array (which must have room for ESPServerMaxSteppers entries)
+ * and return the number of copied axes. If a revision pointer is given, it is set to the configuration revision the copy belongs to
+ */
+byte ESPStepperMotorServer_Configuration::copyActiveAxes(ESPStepperMotorServer_ActiveAxis *axes, unsigned int *revision)
+{
+    portENTER_CRITICAL(&this->activeAxisMux);
+    const byte axisCount = this->activeAxisCount;
+    memcpy(axes, this->activeAxes, axisCount * sizeof(ESPStepperMotorServer_ActiveAxis));
+    if (revision != NULL)
+    {
+        *revision = this->configurationRevision;
+    }
+    portEXIT_CRITICAL(&this->activeAxisMux);
+    return axisCount;
+}
+
+unsigned int ESPStepperMotorServer_Configuration::getConfigurationRevision()
+{
+    return this->configurationRevision;
+}
+
+// the pools are function local statics, so they are initialized on first use (also if the server is a global object)
+ESPStepperMotorServer_StepperConfigurationPool &ESPStepperMotorServer_Configuration::getStepperConfigurationPool()
+{
+    static ESPStepperMotorServer_StepperConfigurationPool pool;
+    return pool;
+}
+
+ESPStepperMotorServer_SwitchPool &ESPStepperMotorServer_Configuration::getSwitchPool()
+{
+    static ESPStepperMotorServer_SwitchPool pool;
+    return pool;
+}
+
+ESPStepperMotorServer_RotaryEncoderPool &ESPStepperMotorServer_Configuration::getRotaryEncoderPool()
+{
+    static ESPStepperMotorServer_RotaryEncoderPool pool;
+    return pool;
+}
+
+ESPStepperMotorServer_MacroActionPool &ESPStepperMotorServer_Configuration::getMacroActionPool()
+{
+    static ESPStepperMotorServer_MacroActionPool pool;
+    return pool;
+}
+
+void ESPStepperMotorServer_Configuration::addPoolStatisticsToJsonObject(JsonObject poolStatistics)
+{
+    getStepperConfigurationPool().addStatisticsToJsonObject(poolStatistics.createNestedObject("steppers"));
+    getSwitchPool().addStatisticsToJsonObject(poolStatistics.createNestedObject("switches"));
+    getRotaryEncoderPool().addStatisticsToJsonObject(poolStatistics.createNestedObject("encoders"));
+    getMacroActionPool().addStatisticsToJsonObject(poolStatistics.createNestedObject("macroActions"));
 }
 
 ESP_FlexyStepper **ESPStepperMotorServer_Configuration::getConfiguredFlexySteppers()
 {
-    return this->configuredFlexySteppers;
+    return this->configuredFlexySteppers.data();
 }
 
 ESPStepperMotorServer_PositionSwitch *ESPStepperMotorServer_Configuration::getSwitch(byte id)
@@ -593,9 +689,7 @@ void ESPStepperMotorServer_Configuration::removeStepperConfiguration(byte id)
         ESPStepperMotorServer_PositionSwitch *switchConfig = this->getSwitch(switchIndex);
         if (switchConfig && switchConfig->getStepperIndex() == id)
         {
-#ifndef ESPStepperMotorServer_COMPILE_NO_DEBUG
-            ESPStepperMotorServer_Logger::logDebugf("Found switch configuration (id=%i) that is linked to stepper config (id=%i) to be deleted. Will delete switch config as well\n", switchConfig->getId(), id);
-#endif
+            ESPServerLogDebugf("Found switch configuration (id=%i) that is linked to stepper config (id=%i) to be deleted. Will delete switch config as well\n", switchConfig->getId(), id);
             this->removeSwitch(switchIndex);
         }
     }
@@ -605,25 +699,88 @@ void ESPStepperMotorServer_Configuration::removeStepperConfiguration(byte id)
         ESPStepperMotorServer_RotaryEncoder *encoderConfig = this->getRotaryEncoder(encoderIndex);
         if (encoderConfig && encoderConfig->getStepperIndex() == id)
         {
-#ifndef ESPStepperMotorServer_COMPILE_NO_DEBUG
-            ESPStepperMotorServer_Logger::logDebugf("Found encoder configuration (id=%i) that is linked to stepper config (id=%i) to be deleted. Will delete encoder config as well\n", encoderConfig->getId(), id);
-#endif
+            ESPServerLogDebugf("Found encoder configuration (id=%i) that is linked to stepper config (id=%i) to be deleted. Will delete encoder config as well\n", encoderConfig->getId(), id);
             this->removeRotaryEncoder(encoderIndex);
         }
     }
     //finally delete the stepper config itself
-    //TODO: check if this delete call is appropriate, currently it casues kernel panic
-    //delete (this->configuredSteppers[id]);
+    //the caches must be updated before the entity is retired, since the motion controller uses them
+    ESPStepperMotorServer_StepperConfiguration *removedStepperConfig = this->configuredSteppers[id];
     this->configuredSteppers[id] = NULL;
     this->updateConfiguredFlexyStepperCache();
+    if (removedStepperConfig != NULL)
+    {
+        this->retireStepperConfiguration(removedStepperConfig);
+    }
+}
+
+/**
+ * keep the given stepper configuration until all tasks that use the flexy stepper instances (motion controller, macro executor)
+ * work with the current configuration revision (see releaseRetiredStepperConfigurations)
+ */
+void ESPStepperMotorServer_Configuration::retireStepperConfiguration(ESPStepperMotorServer_StepperConfiguration *stepperConfig)
+{
+    bool isRetired = false;
+    portENTER_CRITICAL(&this->retiredStepperConfigurationMux);
+    if (this->retiredStepperConfigurationCount < ESPServerMaxRetiredStepperConfigurations)
+    {
+        this->retiredStepperConfigurations[this->retiredStepperConfigurationCount].stepperConfiguration = stepperConfig;
+        this->retiredStepperConfigurations[this->retiredStepperConfigurationCount].revision = this->configurationRevision;
+        this->retiredStepperConfigurationCount++;
+        isRetired = true;
+    }
+    portEXIT_CRITICAL(&this->retiredStepperConfigurationMux);
+    if (!isRetired)
+    {
+        //releasing the configuration now could crash a task that still uses it, so it is kept in memory instead
+        ESPStepperMotorServer_Logger::logWarningf("The maximum amount of retired stepper configurations (%i) has been reached, the removed stepper configuration will not be released\n", ESPServerMaxRetiredStepperConfigurations);
+    }
+}
+
+/**
+ * release all retired stepper configurations that are not part of the given configuration revision anymore.
+ * Must be called with the oldest configuration revision that is still in use by any task
+ */
+void ESPStepperMotorServer_Configuration::releaseRetiredStepperConfigurations(unsigned int appliedRevision)
+{
+    ESPStepperMotorServer_StepperConfiguration *releasableStepperConfigurations[ESPServerMaxRetiredStepperConfigurations];
+    byte releasableCount = 0;
+    byte remainingCount = 0;
+
+    portENTER_CRITICAL(&this->retiredStepperConfigurationMux);
+    for (byte i = 0; i < this->retiredStepperConfigurationCount; i++)
+    {
+        //the difference is calculated as signed value, so the comparison still works once the revision counter overflows
+        if ((int)(appliedRevision - this->retiredStepperConfigurations[i].revision) >= 0)
+        {
+            releasableStepperConfigurations[releasableCount++] = this->retiredStepperConfigurations[i].stepperConfiguration;
+        }
+        else
+        {
+            this->retiredStepperConfigurations[remainingCount++] = this->retiredStepperConfigurations[i];
+        }
+    }
+    this->retiredStepperConfigurationCount = remainingCount;
+    portEXIT_CRITICAL(&this->retiredStepperConfigurationMux);
+
+    //the destructor frees heap memory, so the configurations are released outside of the critical section
+    for (byte i = 0; i < releasableCount; i++)
+    {
+        getStepperConfigurationPool().release(releasableStepperConfigurations[i]);
+    }
+}
+
+byte ESPStepperMotorServer_Configuration::getRetiredStepperConfigurationCount()
+{
+    return this->retiredStepperConfigurationCount;
 }
 
 void ESPStepperMotorServer_Configuration::removeSwitch(byte id)
 {
-    //TODO: check if this delete call is appropriate, currently it casues kernel panic
-    //delete (this->allConfiguredSwitches[id]);
+    ESPStepperMotorServer_PositionSwitch *removedSwitch = this->allConfiguredSwitches[id];
     this->allConfiguredSwitches[id] = NULL;
     this->updateSwitchCaches();
+    getSwitchPool().release(removedSwitch);
 }
 
 void ESPStepperMotorServer_Configuration::updateSwitchCaches()
@@ -662,11 +819,15 @@ void ESPStepperMotorServer_Configuration::updateSwitchCaches()
             }
         }
     }
+    this->configurationRevision++;
 }
 
+/**
+ * the interrupts of the encoder must already be detached by the caller (see ESPStepperMotorServer::removeRotaryEncoder)
+ */
 void ESPStepperMotorServer_Configuration::removeRotaryEncoder(byte id)
 {
-    //TODO: check if this delete call is appropriate, currently it casues kernel panic
-    //delete (this->configuredRotaryEncoders[id]);
+    ESPStepperMotorServer_RotaryEncoder *removedEncoder = this->configuredRotaryEncoders[id];
     this->configuredRotaryEncoders[id] = NULL;
+    getRotaryEncoderPool().release(removedEncoder);
 }
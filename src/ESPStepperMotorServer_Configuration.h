@@ -40,6 +40,8 @@
 #include <FS.h>
 #include <ESPStepperMotorServer.h>
 #include <ESPStepperMotorServer_Logger.h>
+#include <ESPStepperMotorServer_Registry.h>
+#include <ESPStepperMotorServer_ObjectPool.h>
 #include <ESPStepperMotorServer_PositionSwitch.h>
 #include <ESPStepperMotorServer_RotaryEncoder.h>
 #include <ESPStepperMotorServer_StepperConfiguration.h>
@@ -53,8 +55,42 @@
 
 #define DEFAULT_SERVER_PORT 80
 #define DEFAULT_WIFI_MODE 1
+// the maximum number of removed/replaced stepper configurations that can wait to be released
+#define ESPServerMaxRetiredStepperConfigurations (2 * ESPServerMaxSteppers)
 
 class ESPStepperMotorServer_PositionSwitch;
+
+typedef ESPStepperMotorServer_Registry<ESPStepperMotorServer_StepperConfiguration, ESPServerMaxSteppers> ESPStepperMotorServer_StepperRegistry;
+typedef ESPStepperMotorServer_Registry<ESP_FlexyStepper, ESPServerMaxSteppers> ESPStepperMotorServer_FlexyStepperRegistry;
+typedef ESPStepperMotorServer_Registry<ESPStepperMotorServer_PositionSwitch, ESPServerMaxSwitches> ESPStepperMotorServer_SwitchRegistry;
+typedef ESPStepperMotorServer_Registry<ESPStepperMotorServer_RotaryEncoder, ESPServerMaxRotaryEncoders> ESPStepperMotorServer_RotaryEncoderRegistry;
+
+// the pools hold one spare slot per entity type, since a new entity is created before the one it replaces gets released
+typedef ESPStepperMotorServer_ObjectPool<ESPStepperMotorServer_StepperConfiguration, ESPServerMaxSteppers + 1> ESPStepperMotorServer_StepperConfigurationPool;
+typedef ESPStepperMotorServer_ObjectPool<ESPStepperMotorServer_PositionSwitch, ESPServerMaxSwitches + 1> ESPStepperMotorServer_SwitchPool;
+typedef ESPStepperMotorServer_ObjectPool<ESPStepperMotorServer_RotaryEncoder, ESPServerMaxRotaryEncoders + 1> ESPStepperMotorServer_RotaryEncoderPool;
+typedef ESPStepperMotorServer_ObjectPool<ESPStepperMotorServer_MacroAction, ESPServerMacroActionPoolSize> ESPStepperMotorServer_MacroActionPool;
+
+// the hot state of one configured stepper as needed by the motion control loop.
+// all active axes are stored in one contiguous array without gaps (see ESPStepperMotorServer_Configuration::copyActiveAxes)
+struct ESPStepperMotorServer_ActiveAxis
+{
+  ESP_FlexyStepper *flexyStepper;
+  // the id of the stepper configuration this axis belongs to (not the index in the active axis array)
+  byte stepperId;
+  // result of the last motion update, true if the target position has not been reached yet
+  bool isMoving;
+};
+
+// a removed or replaced stepper configuration, which must not be released before all tasks work with a configuration revision
+// that does not contain it anymore, since they might still use its flexy stepper instance
+struct ESPStepperMotorServer_RetiredStepperConfiguration
+{
+  ESPStepperMotorServer_StepperConfiguration *stepperConfiguration;
+  // the first configuration revision without this stepper configuration
+  unsigned int revision;
+};
+
 //
 // the ESPStepperMotorServer_Configuration class
 class ESPStepperMotorServer_Configuration
@@ -86,6 +122,18 @@ public:
   ESPStepperMotorServer_PositionSwitch *getFirstConfiguredLimitSwitchForStepper(unsigned char id);
   ESPStepperMotorServer_RotaryEncoder *getRotaryEncoder(unsigned char id);
   ESP_FlexyStepper **getConfiguredFlexySteppers();
+  byte copyActiveAxes(ESPStepperMotorServer_ActiveAxis *axes, unsigned int *revision = NULL);
+  unsigned int getConfigurationRevision();
+  void releaseRetiredStepperConfigurations(unsigned int appliedRevision);
+  byte getRetiredStepperConfigurationCount();
+
+  // object pools for the configuration entities created by the server (when loading the config file or via the REST API).
+  // Entities from these pools are released again when they get removed or replaced in the configuration
+  static ESPStepperMotorServer_StepperConfigurationPool &getStepperConfigurationPool();
+  static ESPStepperMotorServer_SwitchPool &getSwitchPool();
+  static ESPStepperMotorServer_RotaryEncoderPool &getRotaryEncoderPool();
+  static ESPStepperMotorServer_MacroActionPool &getMacroActionPool();
+  static void addPoolStatisticsToJsonObject(JsonObject poolStatistics);
   // a cache containing all IO pins that are used by switches. The indexes matches the indexes in the configuredSwitches (=switch ID)
   // -1 is used to indicate an emtpy array slot
   signed char allSwitchIoPins[ESPServerMaxSwitches];
@@ -104,32 +152,46 @@ public:
   IPAddress dns2IP;
 
   //this "cache" should not be private since we need to use it in the ISRs and any getter to retrieve it would slow down processing
-  ESPStepperMotorServer_PositionSwitch *configuredEmergencySwitches[ESPServerMaxSwitches] = {NULL};
+  ESPStepperMotorServer_SwitchRegistry configuredEmergencySwitches;
 
 private:
   //
   // private member variables
   //
   bool isCurrentConfigurationSaved = false;
+  // incremented whenever the stepper or switch caches are rebuilt, so dependent modules (e.g. the macro executor) can detect changes
+  volatile unsigned int configurationRevision = 0;
   const char *_configFilePath;
   bool _isSPIFFSactive = false;
 
   /**** the follwoing variables represent the in-memory configuration settings *******/
   // an array to hold all configured stepper configurations
-  ESPStepperMotorServer_StepperConfiguration *configuredSteppers[ESPServerMaxSteppers] = {NULL};
+  ESPStepperMotorServer_StepperRegistry configuredSteppers;
 
   // this is a shortcut/cache for all configured flexy stepper instances, yet it will not have the same indexes as the configuredSteppers,
   // but solely an array that is filled from the beginnnig without emtpy slots.
   // it is used to have a quick access to configured flexy steppers in time critical functions
   void updateConfiguredFlexyStepperCache(void);
-  ESP_FlexyStepper *configuredFlexySteppers[ESPServerMaxSteppers] = {NULL};
+  void retireStepperConfiguration(ESPStepperMotorServer_StepperConfiguration *stepperConfig);
+  ESPStepperMotorServer_FlexyStepperRegistry configuredFlexySteppers;
+  // the active axis index: one entry per configured stepper, packed from the beginning of the array,
+  // so the motion controller only needs to iterate over the first activeAxisCount entries.
+  // The index is only accessed while holding activeAxisMux, readers work on a copy (see copyActiveAxes)
+  ESPStepperMotorServer_ActiveAxis activeAxes[ESPServerMaxSteppers];
+  byte activeAxisCount = 0;
+  portMUX_TYPE activeAxisMux = portMUX_INITIALIZER_UNLOCKED;
+
+  // removed or replaced stepper configurations that wait to be released (see releaseRetiredStepperConfigurations)
+  ESPStepperMotorServer_RetiredStepperConfiguration retiredStepperConfigurations[ESPServerMaxRetiredStepperConfigurations];
+  byte retiredStepperConfigurationCount = 0;
+  portMUX_TYPE retiredStepperConfigurationMux = portMUX_INITIALIZER_UNLOCKED;
   // an array to hold all configured switches
-  ESPStepperMotorServer_PositionSwitch *allConfiguredSwitches[ESPServerMaxSwitches] = {NULL};
+  ESPStepperMotorServer_SwitchRegistry allConfiguredSwitches;
   // update the caches for emergency and limit switches
   void updateSwitchCaches();
-  ESPStepperMotorServer_PositionSwitch *configuredLimitSwitches[ESPServerMaxSwitches] = {NULL};
+  ESPStepperMotorServer_SwitchRegistry configuredLimitSwitches;
   // an array to hold all configured rotary encoders
-  ESPStepperMotorServer_RotaryEncoder *configuredRotaryEncoders[ESPServerMaxRotaryEncoders] = {NULL};
+  ESPStepperMotorServer_RotaryEncoderRegistry configuredRotaryEncoders;
 
   /////////////////////////////////////////////////////
   // CONSTANTS FOR JSON CONFIGURATION PROPERTY NAMES //
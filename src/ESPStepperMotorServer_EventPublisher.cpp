@@ -0,0 +1,175 @@
+//      *********************************************************
+//      *                                                       *
+//      *      ESP32 Stepper Motor Server Event Publisher       *
+//      *                                                       *
+//      *            Copyright (c) Paul Kerspe, 2019            *
+//      *                                                       *
+//      **********************************************************
+
+// MIT License
+//
+// Copyright (c) 2019 Paul Kerspe
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished
+// to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#define ESPServerLogModule ESPServerLogModule_EventPublisher
+
+#include <ESPStepperMotorServer_EventPublisher.h>
+
+//
+// constructor for the event publisher module
+//
+ESPStepperMotorServer_EventPublisher::ESPStepperMotorServer_EventPublisher()
+{
+  this->eventQueue = xQueueCreate(ESPServerEventQueueLength, sizeof(ESPStepperMotorServer_Event));
+}
+
+/**
+ * register the Server-Sent Events endpoint /api/events in the given http server
+ */
+void ESPStepperMotorServer_EventPublisher::registerEventSource(AsyncWebServer *httpServer)
+{
+  this->eventSource = new AsyncEventSource("/api/events");
+  httpServer->addHandler(this->eventSource);
+}
+
+void ESPStepperMotorServer_EventPublisher::start()
+{
+  if (this->xHandle == NULL) //prevent multiple starts
+  {
+    xTaskCreate(
+        ESPStepperMotorServer_EventPublisher::processEvents, /* Task function. */
+        "EventPublisher",                                    /* String with name of task. */
+        3000,                                                /* Stack size in bytes. */
+        this,                                                /* Parameter passed as input of the task */
+        1,                                                   /* Priority of the task. */
+        &this->xHandle);                                     /* Task handle. */
+    ESPServerLogInfo("Event Publisher task started");
+  }
+}
+
+void ESPStepperMotorServer_EventPublisher::stop()
+{
+  if (this->xHandle != NULL)
+  {
+    vTaskDelete(this->xHandle);
+    this->xHandle = NULL;
+    if (this->eventSource)
+    {
+      this->eventSource->close();
+    }
+    ESPServerLogInfo("Event Publisher stopped");
+  }
+}
+
+/**
+ * queue the given event for publishing. Returns false if the event has been dropped (publisher not started or queue full)
+ */
+bool ESPStepperMotorServer_EventPublisher::publish(const ESPStepperMotorServer_Event &event)
+{
+  if (this->xHandle == NULL)
+  {
+    return false;
+  }
+  if (xQueueSend(this->eventQueue, &event, 0) != pdTRUE)
+  {
+    this->droppedEventCounter++;
+    return false;
+  }
+  return true;
+}
+
+/**
+ * queue the given event for publishing. Must only be called from an ISR
+ */
+bool IRAM_ATTR ESPStepperMotorServer_EventPublisher::publishFromISR(const ESPStepperMotorServer_Event &event)
+{
+  if (this->xHandle == NULL)
+  {
+    return false;
+  }
+  BaseType_t higherPriorityTaskWoken = pdFALSE;
+  bool isQueued = (xQueueSendFromISR(this->eventQueue, &event, &higherPriorityTaskWoken) == pdTRUE);
+  if (!isQueued)
+  {
+    this->droppedEventCounter++;
+  }
+  if (higherPriorityTaskWoken == pdTRUE)
+  {
+    portYIELD_FROM_ISR();
+  }
+  return isQueued;
+}
+
+/**
+ * the number of events that could not be published since the event queue was full
+ */
+unsigned long ESPStepperMotorServer_EventPublisher::getDroppedEventCount()
+{
+  return this->droppedEventCounter;
+}
+
+void ESPStepperMotorServer_EventPublisher::processEvents(void *parameter)
+{
+  ESPStepperMotorServer_EventPublisher *ref = static_cast<ESPStepperMotorServer_EventPublisher *>(parameter);
+  ESPStepperMotorServer_Event event;
+  while (true)
+  {
+    if (xQueueReceive(ref->eventQueue, &event, portMAX_DELAY) == pdTRUE)
+    {
+      ref->sendEvent(event);
+    }
+  }
+}
+
+void ESPStepperMotorServer_EventPublisher::sendEvent(const ESPStepperMotorServer_Event &event)
+{
+  // events are only serialized if there is anyone listening
+  if (this->eventSource == NULL || this->eventSource->count() == 0)
+  {
+    return;
+  }
+  char payload[96];
+  const char *eventName;
+  switch (event.type)
+  {
+  case ESPServerEventType_Switch:
+    eventName = "switch";
+    snprintf(payload, sizeof(payload), "{\"id\":%u,\"active\":%s,\"time\":%lu}", event.id, (event.isActive) ? "true" : "false", event.timestamp);
+    break;
+  case ESPServerEventType_EmergencyStop:
+    eventName = "emergencystop";
+    snprintf(payload, sizeof(payload), "{\"active\":%s,\"time\":%lu}", (event.isActive) ? "true" : "false", event.timestamp);
+    break;
+  case ESPServerEventType_MotionComplete:
+    eventName = "motioncomplete";
+    snprintf(payload, sizeof(payload), "{\"stepperId\":%u,\"position\":%ld,\"time\":%lu}", event.id, event.value, event.timestamp);
+    break;
+  case ESPServerEventType_Homing:
+    eventName = "homing";
+    snprintf(payload, sizeof(payload), "{\"stepperId\":%u,\"phase\":\"%s\",\"active\":%s,\"time\":%lu}", event.id, ESPStepperMotorServer_HomingStateMachine::getPhaseName(event.value), (event.isActive) ? "true" : "false", event.timestamp);
+    break;
+  default:
+    ESPServerLogDebugf("Ignoring unknown event type %i\n", event.type);
+    return;
+  }
+  this->eventSource->send(payload, eventName, ++this->lastEventId);
+}
+
+// -------------------------------------- End --------------------------------------
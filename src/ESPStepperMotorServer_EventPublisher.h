@@ -0,0 +1,85 @@
+//      ******************************************************************
+//      *                                                                *
+//      *   Header file for ESPStepperMotorServer_EventPublisher.cpp     *
+//      *                                                                *
+//      *               Copyright (c) Paul Kerspe, 2019                  *
+//      *                                                                *
+//      ******************************************************************
+
+// MIT License
+//
+// Copyright (c) 2019 Paul Kerspe
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished
+// to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef ESPStepperMotorServer_EventPublisher_h
+#define ESPStepperMotorServer_EventPublisher_h
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include <ESPStepperMotorServer_Logger.h>
+#include <ESPStepperMotorServer_Homing.h>
+
+// the number of events that can be queued up for the publisher task before new events get dropped
+#ifndef ESPServerEventQueueLength
+#define ESPServerEventQueueLength 16
+#endif
+
+#define ESPServerEventType_Switch 1
+#define ESPServerEventType_EmergencyStop 2
+#define ESPServerEventType_MotionComplete 3
+#define ESPServerEventType_Homing 4
+
+// one event as it is passed from the ISRs and the motion controller to the publisher task
+struct ESPStepperMotorServer_Event
+{
+  byte type;   // one of the ESPServerEventType_* values
+  byte id;     // the switch id for switch events, the stepper id for motion complete and homing events
+  bool isActive;
+  long value;  // the position in steps for motion complete events, the homing phase for homing events
+  unsigned long timestamp;
+};
+
+//
+// the ESPStepperMotorServer_EventPublisher class
+// pushes server events as Server-Sent Events to all clients connected to /api/events.
+// Events are only queued by the callers, the payload is serialized once by the publisher task and then sent to all clients
+class ESPStepperMotorServer_EventPublisher
+{
+public:
+  ESPStepperMotorServer_EventPublisher();
+  static void processEvents(void *parameter);
+  void registerEventSource(AsyncWebServer *httpServer);
+  void start();
+  void stop();
+  bool publish(const ESPStepperMotorServer_Event &event);
+  bool publishFromISR(const ESPStepperMotorServer_Event &event);
+  unsigned long getDroppedEventCount();
+
+private:
+  void sendEvent(const ESPStepperMotorServer_Event &event);
+
+  AsyncEventSource *eventSource = NULL;
+  QueueHandle_t eventQueue = NULL;
+  TaskHandle_t xHandle = NULL;
+  uint32_t lastEventId = 0;
+  volatile unsigned long droppedEventCounter = 0;
+};
+
+#endif
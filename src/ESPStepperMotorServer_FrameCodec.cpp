@@ -0,0 +1,111 @@
+//      *********************************************************
+//      *                                                       *
+//      *     ESP32 Stepper Motor Server -  Frame Codec         *
+//      *                                                       *
+//      *            Copyright (c) Paul Kerspe, 2019            *
+//      *                                                       *
+//      **********************************************************
+
+// MIT License
+//
+// Copyright (c) 2019 Paul Kerspe
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished
+// to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <ESPStepperMotorServer_FrameCodec.h>
+
+/**
+ * COBS encode the given data (without the frame delimiters).
+ * The output buffer must be at least length + length / 254 + 1 bytes long. Returns the number of bytes written to output
+ */
+size_t ESPStepperMotorServer_FrameCodec::encodeCobs(const byte *input, size_t length, byte *output)
+{
+  size_t readIndex = 0;
+  size_t writeIndex = 1;
+  size_t codeIndex = 0;
+  byte code = 1;
+  while (readIndex < length)
+  {
+    if (input[readIndex] == 0)
+    {
+      output[codeIndex] = code;
+      code = 1;
+      codeIndex = writeIndex++;
+      readIndex++;
+    }
+    else
+    {
+      output[writeIndex++] = input[readIndex++];
+      code++;
+      if (code == 0xFF)
+      {
+        output[codeIndex] = code;
+        code = 1;
+        codeIndex = writeIndex++;
+      }
+    }
+  }
+  output[codeIndex] = code;
+  return writeIndex;
+}
+
+/**
+ * decode COBS encoded data (without the frame delimiters). The output buffer must be at least length bytes long.
+ * Returns the number of decoded bytes or 0 if the input is not valid COBS data
+ */
+size_t ESPStepperMotorServer_FrameCodec::decodeCobs(const byte *input, size_t length, byte *output)
+{
+  size_t readIndex = 0;
+  size_t writeIndex = 0;
+  while (readIndex < length)
+  {
+    const byte code = input[readIndex];
+    if (code == 0 || readIndex + code > length)
+    {
+      return 0;
+    }
+    readIndex++;
+    for (byte i = 1; i < code; i++)
+    {
+      output[writeIndex++] = input[readIndex++];
+    }
+    if (code != 0xFF && readIndex < length)
+    {
+      output[writeIndex++] = 0;
+    }
+  }
+  return writeIndex;
+}
+
+/**
+ * CRC-16/CCITT-FALSE (polynomial 0x1021, initial value 0xFFFF)
+ */
+uint16_t ESPStepperMotorServer_FrameCodec::calculateCrc16(const byte *data, size_t length)
+{
+  uint16_t crc = 0xFFFF;
+  for (size_t i = 0; i < length; i++)
+  {
+    crc ^= (uint16_t)data[i] << 8;
+    for (byte bit = 0; bit < 8; bit++)
+    {
+      crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+    }
+  }
+  return crc;
+}
@@ -0,0 +1,48 @@
+//      ******************************************************************
+//      *                                                                *
+//      *     Header file for ESPStepperMotorServer_FrameCodec.cpp       *
+//      *                                                                *
+//      *               Copyright (c) Paul Kerspe, 2019                  *
+//      *                                                                *
+//      ******************************************************************
+
+// MIT License
+//
+// Copyright (c) 2019 Paul Kerspe
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished
+// to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef ESPStepperMotorServer_FrameCodec_h
+#define ESPStepperMotorServer_FrameCodec_h
+
+#include <Arduino.h>
+
+//
+// the ESPStepperMotorServer_FrameCodec class
+// COBS framing and CRC-16 checksum used by the binary serial protocol and the sync packets.
+// The functions do not depend on the server, so they can also be tested on the host (see test/test_frame_codec)
+class ESPStepperMotorServer_FrameCodec
+{
+public:
+  static size_t encodeCobs(const byte *input, size_t length, byte *output);
+  static size_t decodeCobs(const byte *input, size_t length, byte *output);
+  static uint16_t calculateCrc16(const byte *data, size_t length);
+};
+
+#endif
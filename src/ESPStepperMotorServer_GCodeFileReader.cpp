@@ -0,0 +1,192 @@
+//      ******************************************************************
+//      *                                                                *
+//      *     ESPStepperMotorServer double buffered G-code file reader   *
+//      *                                                                *
+//      *               Copyright (c) Paul Kerspe, 2019                  *
+//      *                                                                *
+//      ******************************************************************
+
+// MIT License
+//
+// Copyright (c) 2019 Paul Kerspe
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished
+// to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <ESPStepperMotorServer_GCodeFileReader.h>
+
+ESPStepperMotorServer_GCodeMemoryInput::ESPStepperMotorServer_GCodeMemoryInput(const char *program, size_t length)
+{
+  this->program = program;
+  this->length = length;
+}
+
+size_t ESPStepperMotorServer_GCodeMemoryInput::read(uint8_t *buffer, size_t size)
+{
+  size_t remainingLength = this->length - this->readPosition;
+  if (size > remainingLength)
+  {
+    size = remainingLength;
+  }
+  memcpy(buffer, &this->program[this->readPosition], size);
+  this->readPosition += size;
+  return size;
+}
+
+unsigned long ESPStepperMotorServer_GCodeMemoryInput::getSize()
+{
+  return this->length;
+}
+
+/**
+ * start reading from the given (already opened) input and fill the first buffer. The input is closed by close().
+ * Returns false if no input is given
+ */
+bool ESPStepperMotorServer_GCodeFileReader::open(ESPStepperMotorServer_GCodeInput *input)
+{
+  this->close();
+  if (input == NULL)
+  {
+    return false;
+  }
+  this->input = input;
+  this->isEndOfFile = false;
+  this->fileSize = input->getSize();
+  this->processedBytes = 0;
+  this->lineNumber = 0;
+  this->lineBreakCount = 0;
+  this->bufferUnderrunCount = 0;
+  this->bufferLengths[0] = 0;
+  this->bufferLengths[1] = 0;
+  this->activeBuffer = 0;
+  this->readPosition = 0;
+  this->isBackBufferFilled = false;
+  this->prefetch();
+  return true;
+}
+
+void ESPStepperMotorServer_GCodeFileReader::close()
+{
+  if (this->input)
+  {
+    this->input->close();
+    this->input = NULL;
+  }
+}
+
+bool ESPStepperMotorServer_GCodeFileReader::isOpen() const
+{
+  return (this->input != NULL);
+}
+
+/**
+ * read the next non empty line into the given buffer (which must be able to hold maxLength + 1 chars), longer lines are truncated.
+ * Returns false at the end of the file
+ */
+bool ESPStepperMotorServer_GCodeFileReader::readLine(char *line, unsigned int maxLength)
+{
+  unsigned int lineLength = 0;
+  while (this->input)
+  {
+    if (this->readPosition >= this->bufferLengths[this->activeBuffer])
+    {
+      if (!this->isBackBufferFilled && !this->isEndOfFile)
+      {
+        // the back buffer has not been filled in time, so the parser has to wait for the SPIFFS
+        this->bufferUnderrunCount++;
+        this->prefetch();
+      }
+      if (!this->isBackBufferFilled)
+      {
+        break;
+      }
+      this->activeBuffer ^= 1;
+      this->readPosition = 0;
+      this->isBackBufferFilled = false;
+    }
+
+    char c = this->buffers[this->activeBuffer][this->readPosition++];
+    this->processedBytes++;
+    if (c == '\n')
+    {
+      this->lineBreakCount++;
+    }
+    if (c == '\n' || c == '\r')
+    {
+      if (lineLength > 0)
+      {
+        break;
+      }
+      continue;
+    }
+    if (lineLength == 0)
+    {
+      this->lineNumber = this->lineBreakCount + 1;
+    }
+    if (lineLength < maxLength)
+    {
+      line[lineLength++] = c;
+    }
+  }
+  line[lineLength] = '\0';
+  return (lineLength > 0);
+}
+
+/**
+ * fill the back buffer, if it has been used up. Does nothing if the back buffer is still filled or the end of the file has been reached
+ */
+void ESPStepperMotorServer_GCodeFileReader::prefetch()
+{
+  if (!this->input || this->isBackBufferFilled || this->isEndOfFile)
+  {
+    return;
+  }
+  byte backBuffer = this->activeBuffer ^ 1;
+  this->bufferLengths[backBuffer] = this->input->read((uint8_t *)this->buffers[backBuffer], ESPServerGCodeFileBufferSize);
+  if (this->bufferLengths[backBuffer] == 0)
+  {
+    this->isEndOfFile = true;
+  }
+  else
+  {
+    this->isBackBufferFilled = true;
+  }
+}
+
+unsigned long ESPStepperMotorServer_GCodeFileReader::getFileSize() const
+{
+  return this->fileSize;
+}
+
+unsigned long ESPStepperMotorServer_GCodeFileReader::getProcessedBytes() const
+{
+  return this->processedBytes;
+}
+
+unsigned long ESPStepperMotorServer_GCodeFileReader::getLineNumber() const
+{
+  return this->lineNumber;
+}
+
+/**
+ * get the number of times the parser had to wait for the SPIFFS, because the back buffer had not been filled yet
+ */
+unsigned long ESPStepperMotorServer_GCodeFileReader::getBufferUnderrunCount() const
+{
+  return this->bufferUnderrunCount;
+}
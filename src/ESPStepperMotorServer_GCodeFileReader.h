@@ -0,0 +1,104 @@
+//      ******************************************************************
+//      *                                                                *
+//      *   Header file for ESPStepperMotorServer_GCodeFileReader.cpp    *
+//      *                                                                *
+//      *               Copyright (c) Paul Kerspe, 2019                  *
+//      *                                                                *
+//      ******************************************************************
+
+// MIT License
+//
+// Copyright (c) 2019 Paul Kerspe
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished
+// to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef ESPStepperMotorServer_GCodeFileReader_h
+#define ESPStepperMotorServer_GCodeFileReader_h
+
+#include <Arduino.h>
+
+// size of each of the two read buffers of the G-code file reader
+#ifndef ESPServerGCodeFileBufferSize
+#define ESPServerGCodeFileBufferSize 512
+#endif
+
+//
+// the source the G-code file reader reads from, e.g. a file on the SPIFFS or a program in memory
+class ESPStepperMotorServer_GCodeInput
+{
+public:
+  virtual ~ESPStepperMotorServer_GCodeInput() {}
+  // read up to size bytes into the buffer, returns the number of bytes read (0 at the end of the input)
+  virtual size_t read(uint8_t *buffer, size_t size) = 0;
+  virtual unsigned long getSize() = 0;
+  virtual void close() {}
+};
+
+//
+// a G-code program that is kept in memory. The program is not copied, so it must stay valid while it is read
+class ESPStepperMotorServer_GCodeMemoryInput : public ESPStepperMotorServer_GCodeInput
+{
+public:
+  ESPStepperMotorServer_GCodeMemoryInput(const char *program, size_t length);
+  size_t read(uint8_t *buffer, size_t size);
+  unsigned long getSize();
+
+private:
+  const char *program;
+  size_t length;
+  size_t readPosition = 0;
+};
+
+//
+// the ESPStepperMotorServer_GCodeFileReader class
+// reads a G-code file (or any other ESPStepperMotorServer_GCodeInput) line by line through two fixed buffers, so files of any size can be run without loading them into RAM.
+// While the lines of one buffer are parsed, the other buffer is filled with prefetch(), which the interpreter calls while it waits for a move to be completed.
+// This way the SPIFFS access time is hidden behind the motion, a read only blocks the parser if a buffer has been used up before it could be refilled (buffer underrun).
+// Does not depend on the ESP32 hardware, so it can also be tested on the host (see test/test_gcode_file_reader)
+class ESPStepperMotorServer_GCodeFileReader
+{
+public:
+  bool open(ESPStepperMotorServer_GCodeInput *input);
+  void close();
+  bool isOpen() const;
+  bool readLine(char *line, unsigned int maxLength);
+  void prefetch();
+  unsigned long getFileSize() const;
+  unsigned long getProcessedBytes() const;
+  unsigned long getLineNumber() const;
+  unsigned long getBufferUnderrunCount() const;
+
+private:
+  ESPStepperMotorServer_GCodeInput *input = NULL;
+  bool isEndOfFile = false;
+  char buffers[2][ESPServerGCodeFileBufferSize];
+  unsigned int bufferLengths[2] = {0, 0};
+  // the buffer the lines are currently read from, the other one is the back buffer that gets filled by prefetch()
+  byte activeBuffer = 0;
+  unsigned int readPosition = 0;
+  bool isBackBufferFilled = false;
+  unsigned long fileSize = 0;
+  volatile unsigned long processedBytes = 0;
+  // the number of the last line returned by readLine and the number of line breaks consumed so far
+  volatile unsigned long lineNumber = 0;
+  unsigned long lineBreakCount = 0;
+  volatile unsigned long bufferUnderrunCount = 0;
+};
+
+#endif
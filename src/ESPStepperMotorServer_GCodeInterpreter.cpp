@@ -0,0 +1,758 @@
+//      ******************************************************************
+//      *                                                                *
+//      *       ESPStepperMotorServer G-code interpreter module          *
+//      *                                                                *
+//      *               Copyright (c) Paul Kerspe, 2019                  *
+//      *                                                                *
+//      ******************************************************************
+
+// MIT License
+//
+// Copyright (c) 2019 Paul Kerspe
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished
+// to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#define ESPServerLogModule ESPServerLogModule_GCodeInterpreter
+
+#include <ESPStepperMotorServer_GCodeInterpreter.h>
+#include <float.h>
+
+//
+// constructor for the G-code interpreter module
+// the interpreter task and line queue are created in start()
+//
+ESPStepperMotorServer_GCodeInterpreter::ESPStepperMotorServer_GCodeInterpreter(ESPStepperMotorServer *serverRef)
+{
+  this->serverRef = serverRef;
+  for (byte axisIndex = 0; axisIndex < ESPServerGCodeAxisCount; axisIndex++)
+  {
+    this->axisStepperIds[axisIndex] = (axisIndex < ESPServerMaxSteppers) ? axisIndex : ESPServerGCodeUnmappedAxis;
+  }
+  ESPServerLogDebug("G-code Interpreter created");
+}
+
+ESPStepperMotorServer_GCodeInterpreter::~ESPStepperMotorServer_GCodeInterpreter()
+{
+  this->stop();
+}
+
+void ESPStepperMotorServer_GCodeInterpreter::start()
+{
+  if (this->xHandle == NULL) //prevent multiple starts
+  {
+    if (this->lineQueue == NULL)
+    {
+      this->lineQueue = xQueueCreate(ESPServerGCodeLineQueueLength, sizeof(ESPStepperMotorServer_GCodeLine));
+    }
+    xTaskCreate(
+        ESPStepperMotorServer_GCodeInterpreter::processGCodeLines, /* Task function. */
+        "GCodeInterpreter",                                        /* String with name of task. */
+        4000,                                                      /* Stack size in bytes. */
+        this,                                                      /* Parameter passed as input of the task */
+        1,                                                         /* Priority of the task. */
+        &this->xHandle);                                           /* Task handle. */
+    ESPServerLogInfo("G-code Interpreter task started");
+  }
+}
+
+void ESPStepperMotorServer_GCodeInterpreter::stop()
+{
+  if (this->xHandle != NULL)
+  {
+    vTaskDelete(this->xHandle);
+    this->xHandle = NULL;
+    if (this->isFileRunning())
+    {
+      this->finishJob(ESPServerGCodeJobState_Aborted);
+    }
+    ESPServerLogInfo("G-code Interpreter stopped");
+  }
+}
+
+#ifndef ESPStepperMotorServer_COMPILE_NO_WEB
+/**
+ * register the web socket on /gcode. Each text message may contain one or more G-code lines,
+ * every line is answered with a separate "ok" or "error:<reason>" message to the sending client only
+ */
+void ESPStepperMotorServer_GCodeInterpreter::registerWebSocket(AsyncWebServer *httpServer)
+{
+  this->webSocket = new AsyncWebSocket("/gcode");
+  this->webSocket->onEvent(std::bind(&ESPStepperMotorServer_GCodeInterpreter::onWebSocketEvent, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4, std::placeholders::_5, std::placeholders::_6));
+  httpServer->addHandler(this->webSocket);
+}
+
+void ESPStepperMotorServer_GCodeInterpreter::onWebSocketEvent(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventType type, void *arg, uint8_t *data, size_t len)
+{
+  if (type != WS_EVT_DATA)
+  {
+    return;
+  }
+  AwsFrameInfo *info = (AwsFrameInfo *)arg;
+  if (!info->final || info->index != 0 || info->len != len || info->opcode != WS_TEXT)
+  {
+    // G-code lines are short, so fragmented or binary messages are not supported
+    client->text("error:only single frame text messages are supported");
+    return;
+  }
+  char line[ESPServerGCodeMaxLineLength + 1];
+  size_t lineLength = 0;
+  for (size_t i = 0; i <= len; i++)
+  {
+    if (i == len || data[i] == '\n' || data[i] == '\r')
+    {
+      line[lineLength] = '\0';
+      if (lineLength > 0 && !this->submitLine(line, ESPServerGCodeSource_WebSocket, client->id()))
+      {
+        client->text("error:buffer full, wait for ok before sending the next line");
+      }
+      lineLength = 0;
+    }
+    else if (lineLength < ESPServerGCodeMaxLineLength)
+    {
+      line[lineLength++] = (char)data[i];
+    }
+  }
+}
+#endif
+
+/**
+ * queue the given G-code line for execution. The response is sent to the given source once the line has been executed.
+ * Returns false if the interpreter is not started or the queue is full, in this case the caller needs to send an error response
+ */
+bool ESPStepperMotorServer_GCodeInterpreter::submitLine(const char *line, byte source, uint32_t clientId)
+{
+  if (this->lineQueue == NULL)
+  {
+    return false;
+  }
+  ESPStepperMotorServer_GCodeLine entry;
+  entry.source = source;
+  entry.clientId = clientId;
+  strncpy(entry.text, line, ESPServerGCodeMaxLineLength);
+  entry.text[ESPServerGCodeMaxLineLength] = '\0';
+  return (xQueueSend(this->lineQueue, &entry, 0) == pdTRUE);
+}
+
+/**
+ * start a job that executes all lines of the given G-code file from the SPIFFS.
+ * The file is streamed by the interpreter task, while it is running lines from other sources are rejected.
+ * Returns false if the file does not exist or another job is already running
+ */
+bool ESPStepperMotorServer_GCodeInterpreter::runFile(const char *path)
+{
+  if (this->isFileRunning() || strlen(path) > ESPServerGCodeMaxPathLength || !this->serverRef->isSPIFFSMounted() || !SPIFFS.exists(path))
+  {
+    return false;
+  }
+  return this->submitLine(path, ESPServerGCodeSource_FileStart);
+}
+
+/**
+ * returns true while a job is running or paused
+ */
+bool ESPStepperMotorServer_GCodeInterpreter::isFileRunning() const
+{
+  return (this->jobState == ESPServerGCodeJobState_Running || this->jobState == ESPServerGCodeJobState_Paused);
+}
+
+/**
+ * pause the running job once the current line has been executed (a running move is completed).
+ * Returns false if no job is running
+ */
+bool ESPStepperMotorServer_GCodeInterpreter::pauseJob()
+{
+  if (this->jobState != ESPServerGCodeJobState_Running)
+  {
+    return false;
+  }
+  this->isJobPauseRequested = true;
+  return true;
+}
+
+/**
+ * continue a paused job. Returns false if no job is paused
+ */
+bool ESPStepperMotorServer_GCodeInterpreter::resumeJob()
+{
+  if (!this->isJobPauseRequested && this->jobState != ESPServerGCodeJobState_Paused)
+  {
+    return false;
+  }
+  this->isJobPauseRequested = false;
+  return true;
+}
+
+/**
+ * abort the running or paused job. A running move is stopped with the configured deceleration.
+ * Returns false if no job is running
+ */
+bool ESPStepperMotorServer_GCodeInterpreter::abortJob()
+{
+  if (!this->isFileRunning())
+  {
+    return false;
+  }
+  this->isJobAbortRequested = true;
+  return true;
+}
+
+void ESPStepperMotorServer_GCodeInterpreter::getJobProgress(ESPStepperMotorServer_GCodeJobProgress &progress)
+{
+  progress.state = this->jobState;
+  progress.fileSize = this->fileReader.getFileSize();
+  progress.processedBytes = this->fileReader.getProcessedBytes();
+  progress.lineNumber = this->fileReader.getLineNumber();
+  progress.executedLines = this->jobExecutedLines;
+  progress.bufferUnderruns = this->fileReader.getBufferUnderrunCount();
+  progress.elapsedMs = 0;
+  if (progress.state != ESPServerGCodeJobState_Idle)
+  {
+    unsigned long endMillis = (progress.state == ESPServerGCodeJobState_Running) ? millis() : this->jobStateChangeMillis;
+    progress.elapsedMs = endMillis - this->jobStartMillis - this->jobPausedMs;
+  }
+  progress.linesPerSecond = (progress.elapsedMs > 0) ? (float)progress.executedLines * 1000.0f / (float)progress.elapsedMs : 0;
+  progress.remainingMs = 0;
+  if (this->isFileRunning() && progress.processedBytes > 0 && progress.fileSize > progress.processedBytes)
+  {
+    progress.remainingMs = (unsigned long)((float)progress.elapsedMs * (float)(progress.fileSize - progress.processedBytes) / (float)progress.processedBytes);
+  }
+}
+
+/**
+ * get the path of the current (or last) job
+ */
+const char *ESPStepperMotorServer_GCodeInterpreter::getJobPath() const
+{
+  return this->jobPath;
+}
+
+const char *ESPStepperMotorServer_GCodeInterpreter::getJobStateName(byte state)
+{
+  switch (state)
+  {
+  case ESPServerGCodeJobState_Running:
+    return "running";
+  case ESPServerGCodeJobState_Paused:
+    return "paused";
+  case ESPServerGCodeJobState_Completed:
+    return "completed";
+  case ESPServerGCodeJobState_Failed:
+    return "failed";
+  case ESPServerGCodeJobState_Aborted:
+    return "aborted";
+  default:
+    return "idle";
+  }
+}
+
+/**
+ * map the given axis letter (X, Y, Z, A, B or C) to a stepper id. Use ESPServerGCodeUnmappedAxis to remove the mapping
+ */
+bool ESPStepperMotorServer_GCodeInterpreter::setAxisStepperId(char axisLetter, byte stepperId)
+{
+  int axisIndex = ESPStepperMotorServer_GCodeParser::getAxisIndex(axisLetter);
+  if (axisIndex < 0 || (stepperId >= ESPServerMaxSteppers && stepperId != ESPServerGCodeUnmappedAxis))
+  {
+    ESPStepperMotorServer_Logger::logWarningf("Invalid G-code axis mapping %c -> %i\n", axisLetter, stepperId);
+    return false;
+  }
+  this->axisStepperIds[axisIndex] = stepperId;
+  return true;
+}
+
+byte ESPStepperMotorServer_GCodeInterpreter::getAxisStepperId(char axisLetter) const
+{
+  int axisIndex = ESPStepperMotorServer_GCodeParser::getAxisIndex(axisLetter);
+  return (axisIndex < 0) ? ESPServerGCodeUnmappedAxis : this->axisStepperIds[axisIndex];
+}
+
+unsigned long ESPStepperMotorServer_GCodeInterpreter::getExecutedLineCount() const
+{
+  return this->executedLineCount;
+}
+
+void ESPStepperMotorServer_GCodeInterpreter::processGCodeLines(void *parameter)
+{
+  ESPStepperMotorServer_GCodeInterpreter *ref = static_cast<ESPStepperMotorServer_GCodeInterpreter *>(parameter);
+  ESPStepperMotorServer_GCodeLine line;
+  while (true)
+  {
+    // while a job is running, the queue is only polled to reject lines from other sources
+    TickType_t ticksToWait = portMAX_DELAY;
+    if (ref->jobState == ESPServerGCodeJobState_Running)
+    {
+      ticksToWait = 0;
+    }
+    else if (ref->jobState == ESPServerGCodeJobState_Paused)
+    {
+      ticksToWait = pdMS_TO_TICKS(ESPServerGCodeJobPollIntervalMs);
+    }
+
+    if (xQueueReceive(ref->lineQueue, &line, ticksToWait) == pdTRUE)
+    {
+      if (ref->isFileRunning())
+      {
+        ref->sendResponse(line, NULL, "busy, a G-code file is running");
+      }
+      else if (line.source == ESPServerGCodeSource_FileStart)
+      {
+        ref->startJob(line.text);
+      }
+      else
+      {
+        ref->processLine(line);
+      }
+    }
+    else if (ref->isFileRunning())
+    {
+      ref->processJob();
+    }
+  }
+}
+
+void ESPStepperMotorServer_GCodeInterpreter::processLine(ESPStepperMotorServer_GCodeLine &line)
+{
+  const char *errorMessage = NULL;
+  if (this->executeLine(line.text, errorMessage))
+  {
+    this->executedLineCount++;
+    if (line.source == ESPServerGCodeSource_File)
+    {
+      this->jobExecutedLines++;
+    }
+    this->sendResponse(line, "ok");
+  }
+  else if (line.source == ESPServerGCodeSource_File)
+  {
+    if (this->isJobAbortRequested)
+    {
+      this->finishJob(ESPServerGCodeJobState_Aborted);
+    }
+    else
+    {
+      ESPStepperMotorServer_Logger::logWarningf("G-code file %s failed in line %lu: %s\n", this->jobPath, this->fileReader.getLineNumber(), errorMessage);
+      this->finishJob(ESPServerGCodeJobState_Failed);
+    }
+  }
+  else
+  {
+    this->sendResponse(line, NULL, errorMessage);
+  }
+}
+
+/**
+ * parse and execute one line of G-code. The modal state (G0/G1, G90/G91, F) is only changed if the whole line is valid.
+ * Returns false and sets the error message if the line could not be executed
+ */
+bool ESPStepperMotorServer_GCodeInterpreter::executeLine(const char *text, const char *&errorMessage)
+{
+  ESPStepperMotorServer_GCodeBlock block;
+  block.motionMode = this->motionMode;
+  block.isRelativeMode = this->isRelativeMode;
+  block.feedRate = this->feedRate;
+  if (!ESPStepperMotorServer_GCodeParser::parseLine(text, block, errorMessage))
+  {
+    return false;
+  }
+
+  this->motionMode = block.motionMode;
+  this->isRelativeMode = block.isRelativeMode;
+  this->feedRate = block.feedRate;
+
+  if ((block.hasAxisWords || block.isHomingRequested || block.isWaitRequested) && this->serverRef->emergencySwitchIsActive)
+  {
+    errorMessage = "emergency stop active";
+    return false;
+  }
+  if (block.isHomingRequested)
+  {
+    // axis words of G28 only select the axes to home, their values are ignored
+    if (!this->executeHoming(block.isAxisGiven, block.hasAxisWords, errorMessage))
+    {
+      return false;
+    }
+  }
+  else if (block.hasAxisWords && !this->executeLinearMove(block.axisValues, block.isAxisGiven, (block.motionMode == 0), block.isRelativeMode, errorMessage))
+  {
+    return false;
+  }
+  if (block.isWaitRequested && !this->waitForMotionComplete(errorMessage))
+  {
+    return false;
+  }
+  return true;
+}
+
+/**
+ * start a linear move of the given axes, after the previous move has been completed.
+ * The speed and acceleration of each axis are scaled with its share of the path length, so all axes arrive at the same time.
+ * G0 moves use the highest feed rate that does not exceed the rpm limit of any of the steppers, G1 moves are also limited to the feed rate
+ */
+bool ESPStepperMotorServer_GCodeInterpreter::executeLinearMove(const float axisValues[], const bool isAxisGiven[], bool isRapidMove, bool isRelativeMove, const char *&errorMessage)
+{
+  if (!this->waitForMotionComplete(errorMessage))
+  {
+    return false;
+  }
+
+  ESPStepperMotorServer_Configuration *configuration = this->serverRef->getCurrentServerConfiguration();
+  ESPStepperMotorServer_StepperConfiguration *steppers[ESPServerGCodeAxisCount] = {NULL};
+  long targetPositions[ESPServerGCodeAxisCount] = {0};
+  long distancesInSteps[ESPServerGCodeAxisCount] = {0};
+  float maxAxisSpeeds[ESPServerGCodeAxisCount] = {0};
+  float distancesInMillimeters[ESPServerGCodeAxisCount] = {0};
+  float squaredPathLength = 0;
+
+  for (byte axisIndex = 0; axisIndex < ESPServerGCodeAxisCount; axisIndex++)
+  {
+    if (!isAxisGiven[axisIndex])
+    {
+      continue;
+    }
+    ESPStepperMotorServer_StepperConfiguration *stepper = (this->axisStepperIds[axisIndex] == ESPServerGCodeUnmappedAxis) ? NULL : configuration->getStepperConfiguration(this->axisStepperIds[axisIndex]);
+    float stepsPerMillimeter = (stepper) ? (float)(stepper->getStepsPerMM() * stepper->getMicrostepsPerStep()) : 0;
+    if (stepsPerMillimeter <= 0)
+    {
+      errorMessage = "axis is not mapped to a configured stepper";
+      return false;
+    }
+    long currentPosition = stepper->getFlexyStepper()->getCurrentPositionInSteps();
+    long targetPosition = stepper->getStepsForMillimeters(axisValues[axisIndex]);
+    if (isRelativeMove)
+    {
+      targetPosition += currentPosition;
+    }
+    if (stepper->applySoftLimits(targetPosition) == ESPServerSoftLimitResult_Rejected)
+    {
+      errorMessage = "target position is outside of the soft limits";
+      return false;
+    }
+    steppers[axisIndex] = stepper;
+    targetPositions[axisIndex] = targetPosition;
+    distancesInSteps[axisIndex] = abs(targetPosition - currentPosition);
+    distancesInMillimeters[axisIndex] = (float)distancesInSteps[axisIndex] / stepsPerMillimeter;
+    maxAxisSpeeds[axisIndex] = (float)stepper->getRpmLimit() * (float)(stepper->getStepsPerRev() * stepper->getMicrostepsPerStep()) / 60.0f / stepsPerMillimeter;
+    squaredPathLength += distancesInMillimeters[axisIndex] * distancesInMillimeters[axisIndex];
+  }
+
+  float pathLength = sqrtf(squaredPathLength);
+  if (pathLength <= 0)
+  {
+    return true;
+  }
+  // the feed rate along the path in mm/s, limited so no axis exceeds its maximum speed
+  float pathSpeed = (isRapidMove) ? FLT_MAX : this->feedRate / 60.0f;
+  for (byte axisIndex = 0; axisIndex < ESPServerGCodeAxisCount; axisIndex++)
+  {
+    if (distancesInSteps[axisIndex] > 0)
+    {
+      pathSpeed = min(pathSpeed, maxAxisSpeeds[axisIndex] * pathLength / distancesInMillimeters[axisIndex]);
+    }
+  }
+
+  for (byte axisIndex = 0; axisIndex < ESPServerGCodeAxisCount; axisIndex++)
+  {
+    if (distancesInSteps[axisIndex] == 0)
+    {
+      continue;
+    }
+    ESP_FlexyStepper *flexyStepper = steppers[axisIndex]->getFlexyStepper();
+    float axisShare = (float)distancesInSteps[axisIndex] / pathLength; // steps per mm along the path
+    flexyStepper->setSpeedInStepsPerSecond(pathSpeed * axisShare);
+    flexyStepper->setAccelerationInStepsPerSecondPerSecond(ESPServerGCodeAcceleration * axisShare);
+    flexyStepper->setDecelerationInStepsPerSecondPerSecond(ESPServerGCodeAcceleration * axisShare);
+    flexyStepper->setTargetPositionInSteps(targetPositions[axisIndex]);
+  }
+  return true;
+}
+
+/**
+ * home the given axes (or all mapped axes with a configured limit switch if no axis is given) in parallel and wait until all of them are homed.
+ * The current feed rate is used as fast seek speed
+ */
+bool ESPStepperMotorServer_GCodeInterpreter::executeHoming(const bool isAxisGiven[], bool hasAxisWords, const char *&errorMessage)
+{
+  if (!this->waitForMotionComplete(errorMessage))
+  {
+    return false;
+  }
+
+  ESPStepperMotorServer_Configuration *configuration = this->serverRef->getCurrentServerConfiguration();
+  ESPStepperMotorServer_MotionController *motionController = this->serverRef->getMotionController();
+  bool isHomingStepper[ESPServerMaxSteppers] = {false};
+  unsigned int homingStartCounts[ESPServerMaxSteppers] = {0};
+  byte homingStepperCount = 0;
+
+  for (byte axisIndex = 0; axisIndex < ESPServerGCodeAxisCount; axisIndex++)
+  {
+    byte stepperId = this->axisStepperIds[axisIndex];
+    if ((hasAxisWords && !isAxisGiven[axisIndex]) || (!hasAxisWords && stepperId == ESPServerGCodeUnmappedAxis))
+    {
+      continue;
+    }
+    ESPStepperMotorServer_StepperConfiguration *stepper = (stepperId == ESPServerGCodeUnmappedAxis) ? NULL : configuration->getStepperConfiguration(stepperId);
+    ESPStepperMotorServer_PositionSwitch *limitSwitch = (stepper) ? configuration->getFirstConfiguredLimitSwitchForStepper(stepperId) : NULL;
+    if (limitSwitch == NULL || isHomingStepper[stepperId])
+    {
+      if (hasAxisWords)
+      {
+        errorMessage = "axis is not mapped to a stepper with a configured limit switch";
+        return false;
+      }
+      continue;
+    }
+
+    float stepsPerMillimeter = (float)(stepper->getStepsPerMM() * stepper->getMicrostepsPerStep());
+    float maxSpeed = (float)stepper->getRpmLimit() * (float)(stepper->getStepsPerRev() * stepper->getMicrostepsPerStep()) / 60.0f;
+    ESPStepperMotorServer_HomingParameters parameters = {};
+    parameters.fastSpeed = min(this->feedRate / 60.0f * stepsPerMillimeter, maxSpeed);
+    parameters.slowSpeed = parameters.fastSpeed / ESPServerHomingDefaultSlowSpeedDivider;
+    parameters.acceleration = ESPServerGCodeAcceleration * stepsPerMillimeter;
+    parameters.backOffSteps = ESPServerHomingDefaultBackOffSteps;
+    parameters.maxSteps = 2000000000;
+    parameters.directionTowardHome = (limitSwitch->isTypeBitSet(SWITCHTYPE_LIMITSWITCH_POS_BEGIN_BIT)) ? -1 : 1;
+    stepper->getFlexyStepper()->setDirectionToHome(parameters.directionTowardHome);
+
+    homingStartCounts[stepperId] = motionController->getHomingStartCount(stepperId);
+    if (parameters.fastSpeed <= 0 || !motionController->startHoming(stepperId, limitSwitch->getId(), parameters))
+    {
+      motionController->abortHoming();
+      errorMessage = "homing could not be started";
+      return false;
+    }
+    isHomingStepper[stepperId] = true;
+    homingStepperCount++;
+  }
+
+  if (homingStepperCount == 0)
+  {
+    errorMessage = "no stepper with a configured limit switch found";
+    return false;
+  }
+
+  // the homing requests are processed by the motion controller task, so first wait until all of them have been started
+  unsigned long startMillis = millis();
+  bool isHomingFinished = false;
+  while (!isHomingFinished)
+  {
+    if (this->isJobAbortRequested)
+    {
+      motionController->abortHoming();
+      errorMessage = "job aborted";
+      return false;
+    }
+    this->fileReader.prefetch();
+    vTaskDelay(1);
+    isHomingFinished = true;
+    for (byte stepperId = 0; stepperId < ESPServerMaxSteppers; stepperId++)
+    {
+      if (!isHomingStepper[stepperId])
+      {
+        continue;
+      }
+      if (motionController->getHomingStartCount(stepperId) == homingStartCounts[stepperId])
+      {
+        if (millis() - startMillis > ESPServerGCodeHomingStartTimeoutMs)
+        {
+          motionController->abortHoming();
+          errorMessage = "homing could not be started";
+          return false;
+        }
+        isHomingFinished = false;
+      }
+      else if (motionController->getHomingPhase(stepperId) < ESPServerHomingPhase_Completed)
+      {
+        isHomingFinished = false;
+      }
+    }
+  }
+
+  for (byte stepperId = 0; stepperId < ESPServerMaxSteppers; stepperId++)
+  {
+    if (isHomingStepper[stepperId] && motionController->getHomingPhase(stepperId) != ESPServerHomingPhase_Completed)
+    {
+      errorMessage = "homing failed";
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * wait until all mapped steppers reached their target positions. While waiting, the back buffer of a running job is filled.
+ * Returns false if the emergency stop is or gets activated or the running job gets aborted
+ */
+bool ESPStepperMotorServer_GCodeInterpreter::waitForMotionComplete(const char *&errorMessage)
+{
+  ESPStepperMotorServer_Configuration *configuration = this->serverRef->getCurrentServerConfiguration();
+  while (true)
+  {
+    if (this->serverRef->emergencySwitchIsActive)
+    {
+      errorMessage = "emergency stop active";
+      return false;
+    }
+    if (this->isJobAbortRequested)
+    {
+      errorMessage = "job aborted";
+      return false;
+    }
+    bool isMotionComplete = true;
+    for (byte axisIndex = 0; axisIndex < ESPServerGCodeAxisCount && isMotionComplete; axisIndex++)
+    {
+      ESPStepperMotorServer_StepperConfiguration *stepper = (this->axisStepperIds[axisIndex] == ESPServerGCodeUnmappedAxis) ? NULL : configuration->getStepperConfiguration(this->axisStepperIds[axisIndex]);
+      isMotionComplete = (stepper == NULL || stepper->getFlexyStepper()->motionComplete());
+    }
+    if (isMotionComplete)
+    {
+      return true;
+    }
+    this->fileReader.prefetch();
+    vTaskDelay(1);
+  }
+}
+
+/**
+ * send the response for the given line to its source. Lines from files are not answered
+ */
+void ESPStepperMotorServer_GCodeInterpreter::sendResponse(const ESPStepperMotorServer_GCodeLine &line, const char *response, const char *errorMessage)
+{
+  char responseBuffer[80];
+  if (errorMessage != NULL)
+  {
+    snprintf(responseBuffer, sizeof(responseBuffer), "error:%s", errorMessage);
+    response = responseBuffer;
+  }
+  if (line.source == ESPServerGCodeSource_Serial)
+  {
+    Serial.println(response);
+  }
+#ifndef ESPStepperMotorServer_COMPILE_NO_WEB
+  else if (line.source == ESPServerGCodeSource_WebSocket && this->webSocket != NULL)
+  {
+    this->webSocket->text(line.clientId, response);
+  }
+#endif
+}
+
+void ESPStepperMotorServer_GCodeInterpreter::startJob(const char *path)
+{
+  strncpy(this->jobPath, path, ESPServerGCodeMaxPathLength);
+  this->jobPath[ESPServerGCodeMaxPathLength] = '\0';
+  this->isJobPauseRequested = false;
+  this->isJobAbortRequested = false;
+  this->jobExecutedLines = 0;
+  this->jobPausedMs = 0;
+  this->jobStartMillis = millis();
+  if (!this->fileInput.open(path) || !this->fileReader.open(&this->fileInput))
+  {
+    ESPStepperMotorServer_Logger::logWarningf("G-code file %s could not be opened\n", path);
+    this->jobStateChangeMillis = this->jobStartMillis;
+    this->jobState = ESPServerGCodeJobState_Failed;
+    return;
+  }
+  this->jobState = ESPServerGCodeJobState_Running;
+  ESPServerLogInfof("Running G-code file %s (%lu bytes)\n", path, this->fileReader.getFileSize());
+}
+
+/**
+ * handle pause, resume and abort requests and execute the next line of the running job
+ */
+void ESPStepperMotorServer_GCodeInterpreter::processJob()
+{
+  if (this->isJobAbortRequested)
+  {
+    this->finishJob(ESPServerGCodeJobState_Aborted);
+  }
+  else if (this->jobState == ESPServerGCodeJobState_Paused)
+  {
+    if (!this->isJobPauseRequested)
+    {
+      this->jobPausedMs += millis() - this->jobStateChangeMillis;
+      this->jobState = ESPServerGCodeJobState_Running;
+      ESPServerLogInfof("G-code file %s resumed\n", this->jobPath);
+    }
+  }
+  else if (this->isJobPauseRequested)
+  {
+    this->jobStateChangeMillis = millis();
+    this->jobState = ESPServerGCodeJobState_Paused;
+    ESPServerLogInfof("G-code file %s paused after line %lu\n", this->jobPath, this->fileReader.getLineNumber());
+  }
+  else
+  {
+    ESPStepperMotorServer_GCodeLine line;
+    line.source = ESPServerGCodeSource_File;
+    line.clientId = 0;
+    if (this->fileReader.readLine(line.text, ESPServerGCodeMaxLineLength))
+    {
+      this->processLine(line);
+    }
+    else
+    {
+      this->finishJob(ESPServerGCodeJobState_Completed);
+    }
+  }
+}
+
+/**
+ * close the file of the running job. If the job has been aborted, all mapped steppers are stopped
+ */
+void ESPStepperMotorServer_GCodeInterpreter::finishJob(byte state)
+{
+  this->fileReader.close();
+  this->jobStateChangeMillis = millis();
+  this->jobState = state;
+  this->isJobPauseRequested = false;
+  this->isJobAbortRequested = false;
+  if (state == ESPServerGCodeJobState_Aborted)
+  {
+    ESPStepperMotorServer_Configuration *configuration = this->serverRef->getCurrentServerConfiguration();
+    for (byte axisIndex = 0; axisIndex < ESPServerGCodeAxisCount; axisIndex++)
+    {
+      ESPStepperMotorServer_StepperConfiguration *stepper = (this->axisStepperIds[axisIndex] == ESPServerGCodeUnmappedAxis) ? NULL : configuration->getStepperConfiguration(this->axisStepperIds[axisIndex]);
+      if (stepper)
+      {
+        stepper->getFlexyStepper()->setTargetPositionToStop();
+      }
+    }
+  }
+  ESPServerLogInfof("G-code file %s %s after %lu lines (%lu ms)\n", this->jobPath, getJobStateName(state), this->jobExecutedLines, this->jobStateChangeMillis - this->jobStartMillis - this->jobPausedMs);
+}
+
+bool ESPStepperMotorServer_GCodeSPIFFSInput::open(const char *path)
+{
+  this->file = SPIFFS.open(path, FILE_READ);
+  return (bool)this->file;
+}
+
+size_t ESPStepperMotorServer_GCodeSPIFFSInput::read(uint8_t *buffer, size_t size)
+{
+  return this->file.read(buffer, size);
+}
+
+unsigned long ESPStepperMotorServer_GCodeSPIFFSInput::getSize()
+{
+  return this->file.size();
+}
+
+void ESPStepperMotorServer_GCodeSPIFFSInput::close()
+{
+  this->file.close();
+}
@@ -0,0 +1,181 @@
+//      ******************************************************************
+//      *                                                                *
+//      *   Header file for ESPStepperMotorServer_GCodeInterpreter.cpp   *
+//      *                                                                *
+//      *               Copyright (c) Paul Kerspe, 2019                  *
+//      *                                                                *
+//      ******************************************************************
+
+// MIT License
+//
+// Copyright (c) 2019 Paul Kerspe
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished
+// to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef ESPStepperMotorServer_GCodeInterpreter_h
+#define ESPStepperMotorServer_GCodeInterpreter_h
+
+#include <Arduino.h>
+#include <ESPStepperMotorServer.h>
+#include <ESPStepperMotorServer_Logger.h>
+#include <ESPStepperMotorServer_GCodeFileReader.h>
+#include <ESPStepperMotorServer_GCodeParser.h>
+
+// the number of G-code lines that can be queued up for the interpreter task. Further lines are answered with an error
+#ifndef ESPServerGCodeLineQueueLength
+#define ESPServerGCodeLineQueueLength 4
+#endif
+// the feed rate in mm/min for G1 moves until a feed rate is set with the F word
+#ifndef ESPServerGCodeDefaultFeedRate
+#define ESPServerGCodeDefaultFeedRate 600
+#endif
+// the acceleration in mm/s^2 along the path of G0 and G1 moves
+#ifndef ESPServerGCodeAcceleration
+#define ESPServerGCodeAcceleration 500
+#endif
+// the time in ms the homing procedures started by G28 may take to be picked up by the motion controller
+#define ESPServerGCodeHomingStartTimeoutMs 1000
+#define ESPServerGCodeMaxLineLength 96
+// the maximum length of a SPIFFS path
+#define ESPServerGCodeMaxPathLength 32
+// the interval in ms the interpreter task checks for a resume or abort request while a job is paused
+#define ESPServerGCodeJobPollIntervalMs 10
+
+#define ESPServerGCodeSource_Serial 0
+#define ESPServerGCodeSource_WebSocket 1
+#define ESPServerGCodeSource_File 2
+// queue entry that asks the interpreter task to run the file with the path given as text
+#define ESPServerGCodeSource_FileStart 3
+
+#define ESPServerGCodeJobState_Idle 0
+#define ESPServerGCodeJobState_Running 1
+#define ESPServerGCodeJobState_Paused 2
+#define ESPServerGCodeJobState_Completed 3
+#define ESPServerGCodeJobState_Failed 4
+#define ESPServerGCodeJobState_Aborted 5
+
+class ESPStepperMotorServer;
+
+// one line of G-code as it is passed from the serial port, the web socket or the REST API to the interpreter task
+struct ESPStepperMotorServer_GCodeLine
+{
+  byte source;       // one of the ESPServerGCodeSource_* values, the response is sent back to the source
+  uint32_t clientId; // the id of the web socket client for lines received via the web socket
+  char text[ESPServerGCodeMaxLineLength + 1];
+};
+
+// the progress of the current (or last) G-code file job
+struct ESPStepperMotorServer_GCodeJobProgress
+{
+  byte state; // one of the ESPServerGCodeJobState_* values
+  unsigned long fileSize;
+  unsigned long processedBytes;
+  unsigned long lineNumber;       // the number of the line that is executed
+  unsigned long executedLines;    // the number of executed lines (without empty lines)
+  unsigned long elapsedMs;        // the time the job has been running, without the time it has been paused
+  unsigned long remainingMs;      // estimated from the processed bytes, 0 if unknown
+  float linesPerSecond;           // average line throughput of the job
+  unsigned long bufferUnderruns;  // number of times the parser had to wait for the SPIFFS
+};
+
+// the input of the G-code file reader for files on the SPIFFS
+class ESPStepperMotorServer_GCodeSPIFFSInput : public ESPStepperMotorServer_GCodeInput
+{
+public:
+  bool open(const char *path);
+  size_t read(uint8_t *buffer, size_t size);
+  unsigned long getSize();
+  void close();
+
+private:
+  File file;
+};
+
+//
+// the ESPStepperMotorServer_GCodeInterpreter class
+// executes a subset of G-code (G0, G1, G21, G28, G90, G91 and M400) in a dedicated task.
+// Each line is answered with "ok" once it has been executed (for moves: once the previous move is completed and the new one has been started)
+// or with "error:<reason>", so hosts can stream large files by sending the next line after each response.
+// The axis letters are mapped to stepper ids (X = 0, Y = 1, Z = 2, A = 3, B = 4, C = 5 by default), all distances are in mm
+class ESPStepperMotorServer_GCodeInterpreter
+{
+public:
+  ESPStepperMotorServer_GCodeInterpreter(ESPStepperMotorServer *serverRef);
+  ~ESPStepperMotorServer_GCodeInterpreter();
+  static void processGCodeLines(void *parameter);
+  void start();
+  void stop();
+#ifndef ESPStepperMotorServer_COMPILE_NO_WEB
+  void registerWebSocket(AsyncWebServer *httpServer);
+#endif
+  bool submitLine(const char *line, byte source, uint32_t clientId = 0);
+  bool runFile(const char *path);
+  bool isFileRunning() const;
+  bool pauseJob();
+  bool resumeJob();
+  bool abortJob();
+  void getJobProgress(ESPStepperMotorServer_GCodeJobProgress &progress);
+  const char *getJobPath() const;
+  static const char *getJobStateName(byte state);
+  bool setAxisStepperId(char axisLetter, byte stepperId);
+  byte getAxisStepperId(char axisLetter) const;
+  unsigned long getExecutedLineCount() const;
+
+private:
+#ifndef ESPStepperMotorServer_COMPILE_NO_WEB
+  void onWebSocketEvent(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventType type, void *arg, uint8_t *data, size_t len);
+#endif
+  void processLine(ESPStepperMotorServer_GCodeLine &line);
+  bool executeLine(const char *text, const char *&errorMessage);
+  bool executeLinearMove(const float axisValues[], const bool isAxisGiven[], bool isRapidMove, bool isRelativeMove, const char *&errorMessage);
+  bool executeHoming(const bool isAxisGiven[], bool hasAxisWords, const char *&errorMessage);
+  bool waitForMotionComplete(const char *&errorMessage);
+  void sendResponse(const ESPStepperMotorServer_GCodeLine &line, const char *response, const char *errorMessage = NULL);
+  void startJob(const char *path);
+  void processJob();
+  void finishJob(byte state);
+
+  ESPStepperMotorServer *serverRef;
+  TaskHandle_t xHandle = NULL;
+  QueueHandle_t lineQueue = NULL;
+#ifndef ESPStepperMotorServer_COMPILE_NO_WEB
+  AsyncWebSocket *webSocket = NULL;
+#endif
+  byte axisStepperIds[ESPServerGCodeAxisCount];
+  // modal state of the interpreter
+  byte motionMode = 0; // 0 = G0, 1 = G1
+  bool isRelativeMode = false;
+  float feedRate = ESPServerGCodeDefaultFeedRate;
+  volatile unsigned long executedLineCount = 0;
+
+  // the G-code file job. The job state is only changed by the interpreter task, other tasks request changes with the flags
+  ESPStepperMotorServer_GCodeSPIFFSInput fileInput;
+  ESPStepperMotorServer_GCodeFileReader fileReader;
+  char jobPath[ESPServerGCodeMaxPathLength + 1] = "";
+  volatile byte jobState = ESPServerGCodeJobState_Idle;
+  volatile bool isJobPauseRequested = false;
+  volatile bool isJobAbortRequested = false;
+  volatile unsigned long jobExecutedLines = 0;
+  unsigned long jobStartMillis = 0;
+  // the time the job has been paused or finished, and the sum of all pauses
+  unsigned long jobStateChangeMillis = 0;
+  unsigned long jobPausedMs = 0;
+};
+
+#endif
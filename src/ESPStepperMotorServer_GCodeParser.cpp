@@ -0,0 +1,212 @@
+//      *********************************************************
+//      *                                                       *
+//      *     ESP32 Stepper Motor Server -  G-code Parser       *
+//      *                                                       *
+//      *            Copyright (c) Paul Kerspe, 2019            *
+//      *                                                       *
+//      **********************************************************
+
+// MIT License
+//
+// Copyright (c) 2019 Paul Kerspe
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished
+// to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <ESPStepperMotorServer_GCodeParser.h>
+
+/**
+ * parse one line of G-code into the given block. The modal state of the block (motion mode, relative mode and feed rate) must be set
+ * to the current modal state of the interpreter before, it is updated with the modal words of the line.
+ * Returns false and sets the error message if the line is not valid, the block must not be executed in this case
+ */
+bool ESPStepperMotorServer_GCodeParser::parseLine(const char *text, ESPStepperMotorServer_GCodeBlock &block, const char *&errorMessage)
+{
+  for (byte axisIndex = 0; axisIndex < ESPServerGCodeAxisCount; axisIndex++)
+  {
+    block.axisValues[axisIndex] = 0;
+    block.isAxisGiven[axisIndex] = false;
+  }
+  block.hasAxisWords = false;
+  block.isHomingRequested = false;
+  block.isWaitRequested = false;
+
+  const char *position = text;
+  while (*position != '\0')
+  {
+    char letter = toupper(*position);
+    if (letter == ';' || letter == '*')
+    {
+      break; // comment or checksum until the end of the line
+    }
+    if (letter == '(')
+    {
+      position = strchr(position, ')');
+      if (position == NULL)
+      {
+        break;
+      }
+      position++;
+      continue;
+    }
+    if (letter == ' ' || letter == '\t')
+    {
+      position++;
+      continue;
+    }
+    float value;
+    unsigned int numberLength = parseNumber(position + 1, value);
+    if (letter < 'A' || letter > 'Z' || numberLength == 0)
+    {
+      errorMessage = "invalid word, expected a letter followed by a number";
+      return false;
+    }
+    position += numberLength + 1;
+
+    int code = (int)value;
+    if ((letter == 'G' || letter == 'M') && (float)code != value)
+    {
+      errorMessage = "unsupported command";
+      return false;
+    }
+    int axisIndex = getAxisIndex(letter);
+    if (axisIndex >= 0)
+    {
+      block.axisValues[axisIndex] = value;
+      block.isAxisGiven[axisIndex] = true;
+      block.hasAxisWords = true;
+    }
+    else if (letter == 'G' && (code == 0 || code == 1))
+    {
+      block.motionMode = code;
+    }
+    else if (letter == 'G' && code == 28)
+    {
+      block.isHomingRequested = true;
+    }
+    else if (letter == 'G' && (code == 90 || code == 91))
+    {
+      block.isRelativeMode = (code == 91);
+    }
+    else if (letter == 'M' && code == 400)
+    {
+      block.isWaitRequested = true;
+    }
+    else if (letter == 'F')
+    {
+      if (value <= 0)
+      {
+        errorMessage = "feed rate must be larger than 0";
+        return false;
+      }
+      block.feedRate = value;
+    }
+    else if ((letter == 'G' && code == 21) || letter == 'N')
+    {
+      // G21 (mm) is the only supported unit, line numbers are ignored
+    }
+    else
+    {
+      errorMessage = (letter == 'G' || letter == 'M') ? "unsupported command" : "unsupported word";
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * returns true if the given line looks like G-code (starts with a G, M or N word or a comment), used to separate G-code from CLI commands
+ */
+bool ESPStepperMotorServer_GCodeParser::isGCodeLine(const char *line)
+{
+  while (*line == ' ' || *line == '\t')
+  {
+    line++;
+  }
+  if (*line == ';' || *line == '(')
+  {
+    return true;
+  }
+  char letter = toupper(*line);
+  return (letter == 'G' || letter == 'M' || letter == 'N') && isdigit(line[1]);
+}
+
+/**
+ * get the index of the given axis letter in the axis mapping, -1 if the letter is not an axis
+ */
+int ESPStepperMotorServer_GCodeParser::getAxisIndex(char axisLetter)
+{
+  switch (toupper(axisLetter))
+  {
+  case 'X':
+    return 0;
+  case 'Y':
+    return 1;
+  case 'Z':
+    return 2;
+  case 'A':
+    return 3;
+  case 'B':
+    return 4;
+  case 'C':
+    return 5;
+  default:
+    return -1;
+  }
+}
+
+/**
+ * parse a decimal number with optional sign and fraction (no exponent or hex notation, since e.g. "G0X10" must not be read as hex number).
+ * Returns the number of characters consumed, 0 if the text does not start with a number
+ */
+unsigned int ESPStepperMotorServer_GCodeParser::parseNumber(const char *text, float &value)
+{
+  unsigned int length = 0;
+  bool isNegative = (text[0] == '-');
+  if (text[0] == '-' || text[0] == '+')
+  {
+    length++;
+  }
+  float result = 0;
+  float fractionDivider = 0;
+  bool hasDigits = false;
+  for (; isdigit(text[length]) || (text[length] == '.' && fractionDivider == 0); length++)
+  {
+    if (text[length] == '.')
+    {
+      fractionDivider = 1;
+      continue;
+    }
+    hasDigits = true;
+    if (fractionDivider == 0)
+    {
+      result = result * 10 + (text[length] - '0');
+    }
+    else
+    {
+      fractionDivider *= 10;
+      result += (text[length] - '0') / fractionDivider;
+    }
+  }
+  if (!hasDigits)
+  {
+    return 0;
+  }
+  value = (isNegative) ? -result : result;
+  return length;
+}
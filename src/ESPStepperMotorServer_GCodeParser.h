@@ -0,0 +1,67 @@
+//      ******************************************************************
+//      *                                                                *
+//      *     Header file for ESPStepperMotorServer_GCodeParser.cpp      *
+//      *                                                                *
+//      *               Copyright (c) Paul Kerspe, 2019                  *
+//      *                                                                *
+//      ******************************************************************
+
+// MIT License
+//
+// Copyright (c) 2019 Paul Kerspe
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished
+// to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef ESPStepperMotorServer_GCodeParser_h
+#define ESPStepperMotorServer_GCodeParser_h
+
+#include <Arduino.h>
+
+// the axis letters X, Y, Z, A, B and C can be mapped to steppers
+#define ESPServerGCodeAxisCount 6
+#define ESPServerGCodeUnmappedAxis 255
+
+// the words of one parsed line of G-code and the modal state after the line
+struct ESPStepperMotorServer_GCodeBlock
+{
+  float axisValues[ESPServerGCodeAxisCount];
+  bool isAxisGiven[ESPServerGCodeAxisCount];
+  bool hasAxisWords;
+  bool isHomingRequested; // G28, the axis words only select the axes to home
+  bool isWaitRequested;   // M400
+  // modal state
+  byte motionMode; // 0 = G0, 1 = G1
+  bool isRelativeMode;
+  float feedRate; // in mm/min
+};
+
+//
+// the ESPStepperMotorServer_GCodeParser class
+// parses the supported subset of G-code into a block, the G-code interpreter executes the block.
+// The functions do not depend on the server, so they can also be tested on the host (see test/test_gcode_parser)
+class ESPStepperMotorServer_GCodeParser
+{
+public:
+  static bool parseLine(const char *text, ESPStepperMotorServer_GCodeBlock &block, const char *&errorMessage);
+  static bool isGCodeLine(const char *line);
+  static int getAxisIndex(char axisLetter);
+  static unsigned int parseNumber(const char *text, float &value);
+};
+
+#endif
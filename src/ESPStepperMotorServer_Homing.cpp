@@ -0,0 +1,198 @@
+//      *********************************************************
+//      *                                                       *
+//      *      ESP32 Stepper Motor Server Homing Procedure      *
+//      *                                                       *
+//      *            Copyright (c) Paul Kerspe, 2019            *
+//      *                                                       *
+//      **********************************************************
+
+// MIT License
+//
+// Copyright (c) 2019 Paul Kerspe
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished
+// to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <ESPStepperMotorServer_Homing.h>
+
+/**
+ * start the homing procedure for the given stepper. The procedure is performed by calling process() repeatedly
+ */
+void ESPStepperMotorServer_HomingStateMachine::start(ESP_FlexyStepper *flexyStepper, const ESPStepperMotorServer_HomingParameters &parameters)
+{
+  this->flexyStepper = flexyStepper;
+  this->parameters = parameters;
+  if (this->parameters.acceleration > 0)
+  {
+    this->flexyStepper->setAccelerationInStepsPerSecondPerSecond(this->parameters.acceleration);
+    this->flexyStepper->setDecelerationInStepsPerSecondPerSecond(this->parameters.acceleration);
+  }
+  this->enterPhase(ESPServerHomingPhase_FastSeek);
+}
+
+/**
+ * stop the stepper and cancel the homing procedure, if it is still running
+ */
+void ESPStepperMotorServer_HomingStateMachine::abort()
+{
+  if (this->isActive())
+  {
+    this->flexyStepper->setTargetPositionToStop();
+    this->phase = ESPServerHomingPhase_Aborted;
+  }
+}
+
+/**
+ * cancel the homing procedure without accessing the stepper anymore,
+ * used if the stepper configuration has been removed or replaced while the homing was running
+ */
+void ESPStepperMotorServer_HomingStateMachine::cancel()
+{
+  if (this->isActive())
+  {
+    this->phase = ESPServerHomingPhase_Aborted;
+  }
+  this->flexyStepper = NULL;
+}
+
+/**
+ * perform the next step of the homing procedure with the given status of the limit switch.
+ * Returns true if the phase has changed
+ */
+bool ESPStepperMotorServer_HomingStateMachine::process(bool isSwitchActive)
+{
+  const byte previousPhase = this->phase;
+  switch (previousPhase)
+  {
+  case ESPServerHomingPhase_FastSeek:
+    if (this->isStopping)
+    {
+      if (this->flexyStepper->motionComplete())
+      {
+        this->enterPhase(ESPServerHomingPhase_BackOff);
+      }
+    }
+    else if (isSwitchActive)
+    {
+      // decelerate, the switch position is latched in the slow approach
+      this->flexyStepper->setTargetPositionToStop();
+      this->isStopping = true;
+    }
+    else if (this->flexyStepper->motionComplete())
+    {
+      // max distance reached without hitting the switch
+      this->phase = ESPServerHomingPhase_Failed;
+    }
+    break;
+  case ESPServerHomingPhase_BackOff:
+    if (!this->isSwitchReleased && !isSwitchActive)
+    {
+      this->isSwitchReleased = true;
+      this->flexyStepper->setTargetPositionInSteps(this->flexyStepper->getCurrentPositionInSteps() - this->parameters.directionTowardHome * this->parameters.backOffSteps);
+    }
+    else if (this->flexyStepper->motionComplete())
+    {
+      this->enterPhase((this->isSwitchReleased) ? ESPServerHomingPhase_SlowApproach : ESPServerHomingPhase_Failed);
+    }
+    break;
+  case ESPServerHomingPhase_SlowApproach:
+    if (isSwitchActive)
+    {
+      this->flexyStepper->setCurrentPositionAsHomeAndStop();
+      this->enterPhase((this->parameters.latchOffsetSteps != 0) ? ESPServerHomingPhase_LatchOffset : ESPServerHomingPhase_Completed);
+    }
+    else if (this->flexyStepper->motionComplete())
+    {
+      this->phase = ESPServerHomingPhase_Failed;
+    }
+    break;
+  case ESPServerHomingPhase_LatchOffset:
+    if (this->flexyStepper->motionComplete())
+    {
+      this->flexyStepper->setCurrentPositionInSteps(0);
+      this->phase = ESPServerHomingPhase_Completed;
+    }
+    break;
+  }
+  return (previousPhase != this->phase);
+}
+
+void ESPStepperMotorServer_HomingStateMachine::enterPhase(byte phase)
+{
+  this->phase = phase;
+  switch (phase)
+  {
+  case ESPServerHomingPhase_FastSeek:
+    this->isStopping = false;
+    this->flexyStepper->setSpeedInStepsPerSecond(this->parameters.fastSpeed);
+    this->flexyStepper->setTargetPositionRelativeInSteps(this->parameters.directionTowardHome * this->parameters.maxSteps);
+    break;
+  case ESPServerHomingPhase_BackOff:
+    // move away until the switch is released, the back off distance is added once the switch has been released
+    this->isSwitchReleased = false;
+    this->flexyStepper->setTargetPositionRelativeInSteps(-this->parameters.directionTowardHome * this->parameters.maxSteps);
+    break;
+  case ESPServerHomingPhase_SlowApproach:
+    this->flexyStepper->setSpeedInStepsPerSecond(this->parameters.slowSpeed);
+    this->flexyStepper->setTargetPositionRelativeInSteps(this->parameters.directionTowardHome * this->parameters.maxSteps);
+    break;
+  case ESPServerHomingPhase_LatchOffset:
+    this->flexyStepper->setTargetPositionRelativeInSteps(-this->parameters.directionTowardHome * this->parameters.latchOffsetSteps);
+    break;
+  }
+}
+
+byte ESPStepperMotorServer_HomingStateMachine::getPhase() const
+{
+  return this->phase;
+}
+
+bool ESPStepperMotorServer_HomingStateMachine::isActive() const
+{
+  return (this->phase >= ESPServerHomingPhase_FastSeek && this->phase <= ESPServerHomingPhase_LatchOffset);
+}
+
+ESP_FlexyStepper *ESPStepperMotorServer_HomingStateMachine::getFlexyStepper() const
+{
+  return this->flexyStepper;
+}
+
+const char *ESPStepperMotorServer_HomingStateMachine::getPhaseName(byte phase)
+{
+  switch (phase)
+  {
+  case ESPServerHomingPhase_FastSeek:
+    return "fastseek";
+  case ESPServerHomingPhase_BackOff:
+    return "backoff";
+  case ESPServerHomingPhase_SlowApproach:
+    return "slowapproach";
+  case ESPServerHomingPhase_LatchOffset:
+    return "latchoffset";
+  case ESPServerHomingPhase_Completed:
+    return "completed";
+  case ESPServerHomingPhase_Failed:
+    return "failed";
+  case ESPServerHomingPhase_Aborted:
+    return "aborted";
+  default:
+    return "idle";
+  }
+}
+
+// -------------------------------------- End --------------------------------------
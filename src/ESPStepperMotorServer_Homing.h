@@ -0,0 +1,96 @@
+//      ******************************************************************
+//      *                                                                *
+//      *       Header file for ESPStepperMotorServer_Homing.cpp         *
+//      *                                                                *
+//      *               Copyright (c) Paul Kerspe, 2019                  *
+//      *                                                                *
+//      ******************************************************************
+
+// MIT License
+//
+// Copyright (c) 2019 Paul Kerspe
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished
+// to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef ESPStepperMotorServer_Homing_h
+#define ESPStepperMotorServer_Homing_h
+
+#include <Arduino.h>
+#include <ESP_FlexyStepper.h>
+
+// default distance in steps to move away from the limit switch after it has been released, before the slow approach starts
+#ifndef ESPServerHomingDefaultBackOffSteps
+#define ESPServerHomingDefaultBackOffSteps 200
+#endif
+// the slow approach speed is the fast seek speed divided by this value, if no explicit slow speed is given
+#ifndef ESPServerHomingDefaultSlowSpeedDivider
+#define ESPServerHomingDefaultSlowSpeedDivider 10
+#endif
+
+#define ESPServerHomingPhase_Idle 0
+#define ESPServerHomingPhase_FastSeek 1
+#define ESPServerHomingPhase_BackOff 2
+#define ESPServerHomingPhase_SlowApproach 3
+#define ESPServerHomingPhase_LatchOffset 4
+#define ESPServerHomingPhase_Completed 5
+#define ESPServerHomingPhase_Failed 6
+#define ESPServerHomingPhase_Aborted 7
+
+struct ESPStepperMotorServer_HomingParameters
+{
+  float fastSpeed;    // speed in steps per second to seek the limit switch
+  float slowSpeed;    // speed in steps per second for the final approach, the switch position gets latched at this speed
+  float acceleration; // acceleration in steps/sec^2, 0 to keep the current acceleration of the stepper
+  long backOffSteps;  // distance to move away from the switch after it has been released
+  long latchOffsetSteps; // distance between the latched switch position and the home position (0 = home is at the switch)
+  long maxSteps;      // maximum distance for the seek movements, the homing fails if the switch is not reached within this distance
+  signed char directionTowardHome; // 1 or -1
+};
+
+//
+// the ESPStepperMotorServer_HomingStateMachine class
+// homes one stepper motor in multiple phases: fast seek toward the limit switch, back off until the switch is released,
+// slow re-approach to latch the switch position and an optional move to the latch offset.
+// The state machine does not read the switch itself, the switch status is passed to process(),
+// so it can also be driven by a virtual switch (e.g. in a simulation)
+class ESPStepperMotorServer_HomingStateMachine
+{
+public:
+  void start(ESP_FlexyStepper *flexyStepper, const ESPStepperMotorServer_HomingParameters &parameters);
+  void abort();
+  void cancel();
+  bool process(bool isSwitchActive);
+  byte getPhase() const;
+  bool isActive() const;
+  ESP_FlexyStepper *getFlexyStepper() const;
+  static const char *getPhaseName(byte phase);
+
+private:
+  void enterPhase(byte phase);
+
+  ESP_FlexyStepper *flexyStepper = NULL;
+  ESPStepperMotorServer_HomingParameters parameters = {};
+  volatile byte phase = ESPServerHomingPhase_Idle;
+  // set while the stepper decelerates after the switch has been reached in the fast seek phase
+  bool isStopping = false;
+  // set in the back off phase as soon as the switch is not active anymore
+  bool isSwitchReleased = false;
+};
+
+#endif
@@ -0,0 +1,92 @@
+//      ******************************************************************
+//      *                                                                *
+//      *            ESPStepperMotorServer_LatencyStatistics             *
+//      *                                                                *
+//      *               Copyright (c) Paul Kerspe, 2019                  *
+//      *                                                                *
+//      ******************************************************************
+// MIT License
+//
+// Copyright (c) 2019 Paul Kerspe
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished
+// to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <ESPStepperMotorServer_LatencyStatistics.h>
+
+void ESPStepperMotorServer_LatencyStatistics::reset()
+{
+  this->sampleCount = 0;
+  this->minMicros = 0;
+  this->maxMicros = 0;
+  this->lastMicros = 0;
+  this->sumMicros = 0;
+}
+
+void ESPStepperMotorServer_LatencyStatistics::addSample(unsigned long latencyMicros)
+{
+  if (this->sampleCount == 0 || latencyMicros < this->minMicros)
+  {
+    this->minMicros = latencyMicros;
+  }
+  if (latencyMicros > this->maxMicros)
+  {
+    this->maxMicros = latencyMicros;
+  }
+  this->lastMicros = latencyMicros;
+  this->sumMicros += latencyMicros;
+  this->sampleCount++;
+}
+
+unsigned long ESPStepperMotorServer_LatencyStatistics::getSampleCount() const
+{
+  return this->sampleCount;
+}
+
+/**
+ * get the smallest latency since the last reset, 0 if no sample has been added yet
+ */
+unsigned long ESPStepperMotorServer_LatencyStatistics::getMinMicros() const
+{
+  return this->minMicros;
+}
+
+/**
+ * get the average latency since the last reset, 0 if no sample has been added yet
+ */
+unsigned long ESPStepperMotorServer_LatencyStatistics::getAverageMicros() const
+{
+  const unsigned long sampleCount = this->sampleCount;
+  return (sampleCount > 0) ? (unsigned long)(this->sumMicros / sampleCount) : 0;
+}
+
+/**
+ * get the largest latency since the last reset, 0 if no sample has been added yet
+ */
+unsigned long ESPStepperMotorServer_LatencyStatistics::getMaxMicros() const
+{
+  return this->maxMicros;
+}
+
+/**
+ * get the latency of the most recent sample, 0 if no sample has been added yet
+ */
+unsigned long ESPStepperMotorServer_LatencyStatistics::getLastMicros() const
+{
+  return this->lastMicros;
+}
@@ -0,0 +1,60 @@
+//      ******************************************************************
+//      *                                                                *
+//      *  Header file for ESPStepperMotorServer_LatencyStatistics.cpp   *
+//      *                                                                *
+//      *               Copyright (c) Paul Kerspe, 2019                  *
+//      *                                                                *
+//      ******************************************************************
+// MIT License
+//
+// Copyright (c) 2019 Paul Kerspe
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished
+// to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef ESPStepperMotorServer_LatencyStatistics_h
+#define ESPStepperMotorServer_LatencyStatistics_h
+
+#include <Arduino.h>
+
+//
+// the ESPStepperMotorServer_LatencyStatistics class
+// collects the minimum, average and maximum of a series of latencies (e.g. the time from a switch edge to the first step of a macro).
+// addSample must only be called by one task, the getters can be called from any task, but may return values of different samples while a sample is added.
+// Does not depend on the ESP32 hardware, so it can also be tested on the host (see test/test_latency_statistics)
+class ESPStepperMotorServer_LatencyStatistics
+{
+public:
+  void reset();
+  void addSample(unsigned long latencyMicros);
+  unsigned long getSampleCount() const;
+  unsigned long getMinMicros() const;
+  unsigned long getAverageMicros() const;
+  unsigned long getMaxMicros() const;
+  unsigned long getLastMicros() const;
+
+private:
+  volatile unsigned long sampleCount = 0;
+  volatile unsigned long minMicros = 0;
+  volatile unsigned long maxMicros = 0;
+  volatile unsigned long lastMicros = 0;
+  // the sum does not overflow before the sample count, even with latencies of more than an hour
+  volatile uint64_t sumMicros = 0;
+};
+
+#endif
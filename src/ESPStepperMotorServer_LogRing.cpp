@@ -0,0 +1,112 @@
+//      ******************************************************************
+//      *                                                                *
+//      *                 ESPStepperMotorServer_LogRing                  *
+//      *                                                                *
+//      *               Copyright (c) Paul Kerspe, 2019                  *
+//      *                                                                *
+//      ******************************************************************
+// MIT License
+//
+// Copyright (c) 2019 Paul Kerspe
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished
+// to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <ESPStepperMotorServer_LogRing.h>
+
+/**
+ * get the size a record with a message of the given size (including its terminating null char) takes in the ring.
+ * The size is rounded up to keep all records aligned
+ */
+size_t IRAM_ATTR ESPStepperMotorServer_LogRing::getRecordLength(size_t messageStorageLength)
+{
+  const size_t recordAlignment = alignof(ESPStepperMotorServer_LogRecord);
+  return (sizeof(ESPStepperMotorServer_LogRecord) + messageStorageLength + recordAlignment - 1) & ~(recordAlignment - 1);
+}
+
+/**
+ * reserve the given number of bytes (a result of getRecordLength) for a new record and return its start, the caller copies the record into it.
+ * Returns NULL if the ring does not have enough space left
+ */
+byte *IRAM_ATTR ESPStepperMotorServer_LogRing::reserve(size_t recordLength)
+{
+  size_t recordStart = this->head;
+  const size_t tail = this->tail;
+  size_t nextHead = 0;
+  if (recordStart >= tail)
+  {
+    const size_t spaceAtEnd = ESPServerLogBufferSize - recordStart;
+    if (recordLength < spaceAtEnd || (recordLength == spaceAtEnd && tail > 0))
+    {
+      nextHead = (recordStart + recordLength) % ESPServerLogBufferSize;
+    }
+    else if (recordLength < tail)
+    {
+      // not enough space at the end of the buffer, mark the rest as padding and continue at the start
+      ((ESPStepperMotorServer_LogRecord *)&this->buffer[recordStart])->flags = ESPServerLogRecordFlag_Padding;
+      recordStart = 0;
+      nextHead = recordLength;
+    }
+    else
+    {
+      return NULL;
+    }
+  }
+  else if (recordStart + recordLength < tail)
+  {
+    nextHead = recordStart + recordLength;
+  }
+  else
+  {
+    return NULL;
+  }
+  this->head = nextHead;
+  return &this->buffer[recordStart];
+}
+
+/**
+ * get the oldest record without removing it from the ring, padding records are skipped. Returns NULL if the ring is empty
+ */
+const ESPStepperMotorServer_LogRecord *ESPStepperMotorServer_LogRing::peek()
+{
+  while (this->tail != this->head)
+  {
+    const ESPStepperMotorServer_LogRecord *record = (const ESPStepperMotorServer_LogRecord *)&this->buffer[this->tail];
+    if (record->flags & ESPServerLogRecordFlag_Padding)
+    {
+      this->tail = 0;
+      continue;
+    }
+    return record;
+  }
+  return NULL;
+}
+
+/**
+ * remove the record returned by peek() from the ring. The record is only released after it has been written,
+ * so producers cannot overwrite it while it is being printed
+ */
+void ESPStepperMotorServer_LogRing::release(const ESPStepperMotorServer_LogRecord *record)
+{
+  this->tail = (this->tail + record->length) % ESPServerLogBufferSize;
+}
+
+bool ESPStepperMotorServer_LogRing::isEmpty() const
+{
+  return (this->tail == this->head);
+}
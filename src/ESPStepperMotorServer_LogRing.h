@@ -0,0 +1,87 @@
+//      ******************************************************************
+//      *                                                                *
+//      *       Header file for ESPStepperMotorServer_LogRing.cpp        *
+//      *                                                                *
+//      *               Copyright (c) Paul Kerspe, 2019                  *
+//      *                                                                *
+//      ******************************************************************
+// MIT License
+//
+// Copyright (c) 2019 Paul Kerspe
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished
+// to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef ESPStepperMotorServer_LogRing_h
+#define ESPStepperMotorServer_LogRing_h
+
+#include <Arduino.h>
+
+// size of the ring buffer (in bytes) that holds log messages until the logger task has written them to the serial port and the log sinks
+#ifndef ESPServerLogBufferSize
+#define ESPServerLogBufferSize 4096
+#endif
+// number of arguments that can be passed to the *FromISR log functions
+#define ESPServerLogMaxDeferredArguments 4
+// record flag of the unused space at the end of the ring buffer, reading continues at the start
+#define ESPServerLogRecordFlag_Padding 0x10
+
+// IRAM_ATTR is defined by the ESP32 core, on other platforms the functions that are called from ISRs need no special placement
+#ifndef IRAM_ATTR
+#define IRAM_ATTR
+#endif
+
+// header of one entry in the log ring buffer. The formatted message (if any) directly follows the header.
+// Entries logged from an ISR are not formatted in the ISR, instead the format string and raw arguments are stored and formatted by the logger task
+struct ESPStepperMotorServer_LogRecord
+{
+  uint16_t length; // total length of the record including the message, always a multiple of the alignment of this struct
+  byte level;
+  byte flags;
+  byte module;
+  const char *format;
+  uint32_t arguments[ESPServerLogMaxDeferredArguments];
+};
+
+static_assert(ESPServerLogBufferSize % alignof(ESPStepperMotorServer_LogRecord) == 0, "ESPServerLogBufferSize must be a multiple of the log record alignment");
+
+//
+// the ESPStepperMotorServer_LogRing class
+// the ring buffer of the logger: records are stored one after the other, a record that does not fit into the space left
+// at the end of the buffer is stored at the start and the rest of the buffer is marked with a padding record.
+// The head never catches up with the tail, since head == tail means the ring is empty, so one byte of the buffer always stays unused.
+// The class does not lock, reserve() and release() must be called with the lock of the logger held.
+// Does not depend on the ESP32 hardware, so it can also be tested on the host (see test/test_log_ring)
+class ESPStepperMotorServer_LogRing
+{
+public:
+  static size_t getRecordLength(size_t messageStorageLength);
+  byte *reserve(size_t recordLength);
+  const ESPStepperMotorServer_LogRecord *peek();
+  void release(const ESPStepperMotorServer_LogRecord *record);
+  bool isEmpty() const;
+
+private:
+  alignas(ESPStepperMotorServer_LogRecord) byte buffer[ESPServerLogBufferSize];
+  // written by the producers (all tasks and ISRs) and read by the logger task
+  volatile size_t head = 0;
+  // only changed by the logger task
+  volatile size_t tail = 0;
+};
+
+#endif
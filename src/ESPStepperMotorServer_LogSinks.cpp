@@ -0,0 +1,155 @@
+//      *********************************************************
+//      *                                                       *
+//      *          ESP32 Stepper Motor Server Log Sinks         *
+//      *                                                       *
+//      *            Copyright (c) Paul Kerspe, 2019            *
+//      *                                                       *
+//      **********************************************************
+
+// MIT License
+//
+// Copyright (c) 2019 Paul Kerspe
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished
+// to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <ESPStepperMotorServer_LogSinks.h>
+#include <ArduinoJson.h>
+
+#ifndef ESPStepperMotorServer_COMPILE_NO_WEB
+// ---------------------------------------------------------------------------------
+//                                  Web socket sink
+// ---------------------------------------------------------------------------------
+
+ESPStepperMotorServer_WebSocketLogSink::ESPStepperMotorServer_WebSocketLogSink(AsyncWebSocket *webSocket)
+{
+  this->webSocket = webSocket;
+}
+
+/**
+ * set the web socket to send the log messages to. Can be NULL (e.g. if the web server has not been started yet), in this case all messages are discarded
+ */
+void ESPStepperMotorServer_WebSocketLogSink::setWebSocket(AsyncWebSocket *webSocket)
+{
+  this->webSocket = webSocket;
+}
+
+void ESPStepperMotorServer_WebSocketLogSink::write(byte level, const char *levelName, const char *moduleName, const char *message)
+{
+  AsyncWebSocket *socket = this->webSocket;
+  if (socket == NULL || socket->count() == 0)
+  {
+    return;
+  }
+  if (!socket->availableForWriteAll())
+  {
+    this->droppedMessageCounter++;
+    return;
+  }
+
+  StaticJsonDocument<JSON_OBJECT_SIZE(1) + JSON_OBJECT_SIZE(3)> doc;
+  JsonObject logEntry = doc.createNestedObject("log");
+  logEntry["level"] = levelName;
+  logEntry["module"] = moduleName;
+  logEntry["message"] = message;
+
+  // every char of the message might need to be escaped
+  char buffer[2 * ESPServerLogMaxMessageLength + 64];
+  if (measureJson(doc) >= sizeof(buffer))
+  {
+    this->droppedMessageCounter++;
+    return;
+  }
+  size_t length = serializeJson(doc, buffer, sizeof(buffer));
+  socket->textAll(buffer, length);
+}
+
+/**
+ * the number of log messages that could not be sent, since the send buffers of the clients were full
+ */
+unsigned long ESPStepperMotorServer_WebSocketLogSink::getDroppedMessageCount() const
+{
+  return this->droppedMessageCounter;
+}
+#endif
+
+// ---------------------------------------------------------------------------------
+//                                  Syslog sink
+// ---------------------------------------------------------------------------------
+
+ESPStepperMotorServer_SyslogLogSink::ESPStepperMotorServer_SyslogLogSink(IPAddress host, uint16_t port, const char *appName)
+{
+  this->host = host;
+  this->port = port;
+  this->appName = appName;
+}
+
+/**
+ * change the address of the syslog server, the new address is used starting with the next log message
+ */
+void ESPStepperMotorServer_SyslogLogSink::setDestination(IPAddress host, uint16_t port)
+{
+  this->host = host;
+  this->port = port;
+}
+
+byte ESPStepperMotorServer_SyslogLogSink::getSeverity(byte level)
+{
+  switch (level)
+  {
+  case ESPServerLogLevel_WARNING:
+    return 4;
+  case ESPServerLogLevel_INFO:
+    return 6;
+  default:
+    return 7;
+  }
+}
+
+void ESPStepperMotorServer_SyslogLogSink::write(byte level, const char *levelName, const char *moduleName, const char *message)
+{
+  if (!WiFi.isConnected())
+  {
+    return;
+  }
+  // <PRI>VERSION TIMESTAMP HOSTNAME APP-NAME PROCID MSGID STRUCTURED-DATA MSG, timestamp and hostname are left empty ("-") since the ESP has no reliable clock
+  char packet[ESPServerLogMaxMessageLength + 64];
+  int length = snprintf(packet, sizeof(packet), "<%u>1 - - %s - %s - %s", ESPServerSyslogFacility * 8 + this->getSeverity(level), this->appName, moduleName, message);
+  if (length < 0)
+  {
+    return;
+  }
+  if (this->udp.beginPacket(this->host, this->port) == 0)
+  {
+    this->droppedMessageCounter++;
+    return;
+  }
+  this->udp.write((const uint8_t *)packet, min((size_t)length, sizeof(packet) - 1));
+  if (this->udp.endPacket() == 0)
+  {
+    this->droppedMessageCounter++;
+  }
+}
+
+/**
+ * the number of log messages that could not be sent to the syslog server
+ */
+unsigned long ESPStepperMotorServer_SyslogLogSink::getDroppedMessageCount() const
+{
+  return this->droppedMessageCounter;
+}
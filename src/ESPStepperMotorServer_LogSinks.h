@@ -0,0 +1,90 @@
+//      ******************************************************************
+//      *                                                                *
+//      *     Header file for ESPStepperMotorServer_LogSinks.cpp         *
+//      *                                                                *
+//      *               Copyright (c) Paul Kerspe, 2019                  *
+//      *                                                                *
+//      ******************************************************************
+
+// MIT License
+//
+// Copyright (c) 2019 Paul Kerspe
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished
+// to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef ESPStepperMotorServer_LogSinks_h
+#define ESPStepperMotorServer_LogSinks_h
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <WiFiUdp.h>
+#include <ESPStepperMotorServer_Logger.h>
+
+#ifndef ESPStepperMotorServer_COMPILE_NO_WEB
+#include <ESPAsyncWebServer.h>
+#endif
+
+// default port of syslog servers
+#define ESPServerSyslogDefaultPort 514
+// syslog facility used for all messages (local0)
+#define ESPServerSyslogFacility 16
+
+#ifndef ESPStepperMotorServer_COMPILE_NO_WEB
+//
+// the ESPStepperMotorServer_WebSocketLogSink class
+// sends each log message as JSON object to all clients connected to the web socket of the server, e.g.
+// {"log":{"level":"INFO","module":"rest","message":"..."}}
+// messages are dropped (not queued) while the send buffers of the web socket clients are full
+class ESPStepperMotorServer_WebSocketLogSink : public ESPStepperMotorServer_LogSink
+{
+public:
+  ESPStepperMotorServer_WebSocketLogSink(AsyncWebSocket *webSocket = NULL);
+  void setWebSocket(AsyncWebSocket *webSocket);
+  void write(byte level, const char *levelName, const char *moduleName, const char *message) override;
+  unsigned long getDroppedMessageCount() const;
+
+private:
+  AsyncWebSocket *volatile webSocket;
+  unsigned long droppedMessageCounter = 0;
+};
+#endif
+
+//
+// the ESPStepperMotorServer_SyslogLogSink class
+// sends each log message as RFC 5424 syslog message in a single UDP packet to the given syslog server.
+// The module name is used as MSGID of the syslog message
+class ESPStepperMotorServer_SyslogLogSink : public ESPStepperMotorServer_LogSink
+{
+public:
+  ESPStepperMotorServer_SyslogLogSink(IPAddress host, uint16_t port = ESPServerSyslogDefaultPort, const char *appName = "ESPStepperMotorServer");
+  void setDestination(IPAddress host, uint16_t port = ESPServerSyslogDefaultPort);
+  void write(byte level, const char *levelName, const char *moduleName, const char *message) override;
+  unsigned long getDroppedMessageCount() const;
+
+private:
+  byte getSeverity(byte level);
+
+  WiFiUDP udp;
+  IPAddress host;
+  uint16_t port;
+  const char *appName;
+  unsigned long droppedMessageCounter = 0;
+};
+
+#endif
@@ -30,22 +30,49 @@
 
 #include <ESPStepperMotorServer_Logger.h>
 
+// flags of the log records in the ring buffer
+#define LOG_RECORD_FLAG_NEW_LINE 0x01
+#define LOG_RECORD_FLAG_OMIT_LEVEL 0x02
+#define LOG_RECORD_FLAG_DEFERRED 0x04 // format string and arguments need to be formatted by the logger task
+#define LOG_RECORD_FLAG_RAW_FORMAT 0x08 // format string is printed as is (logged from an ISR with the varargs functions)
+// 0x10 is used by the log ring for padding records (ESPServerLogRecordFlag_Padding)
+
+static_assert(ESPServerLogBufferSize >= ESPServerLogMaxMessageLength + 2 * sizeof(ESPStepperMotorServer_LogRecord), "ESPServerLogBufferSize is too small for ESPServerLogMaxMessageLength");
+static_assert(ESPServerLogMaxModules >= ESPServerLogModule_BuiltInCount && ESPServerLogMaxModules < 255, "ESPServerLogMaxModules must be in the range of ESPServerLogModule_BuiltInCount and 254");
+
 byte ESPStepperMotorServer_Logger::_logLevel = ESPServerLogLevel_INFO;
 bool ESPStepperMotorServer_Logger::_isDebugLevelSet = false;
+ESPStepperMotorServer_LogRing ESPStepperMotorServer_Logger::_ring;
+volatile unsigned long ESPStepperMotorServer_Logger::_droppedMessageCounter = 0;
+unsigned long ESPStepperMotorServer_Logger::_reportedDroppedMessageCounter = 0;
+portMUX_TYPE ESPStepperMotorServer_Logger::_ringMux = portMUX_INITIALIZER_UNLOCKED;
+TaskHandle_t ESPStepperMotorServer_Logger::_loggerTaskHandle = NULL;
+TaskHandle_t ESPStepperMotorServer_Logger::_idleLoggerTaskHandle = NULL;
+volatile bool ESPStepperMotorServer_Logger::_isLoggerTaskStopRequested = false;
+// names of the built in modules, the order must match the ESPServerLogModule_* ids
+char ESPStepperMotorServer_Logger::_moduleNames[ESPServerLogMaxModules][ESPServerLogMaxModuleNameLength] = {"root", "server", "config", "rest", "webui", "cli", "motion", "macro", "journal", "power", "trajectory", "gcode", "sync", "shiftreg", "events"};
+byte ESPStepperMotorServer_Logger::_moduleLogLevels[ESPServerLogMaxModules] = {ESPServerLogLevel_INHERIT};
+byte ESPStepperMotorServer_Logger::_registeredModuleCount = ESPServerLogModule_BuiltInCount;
+ESPStepperMotorServer_LogSink *ESPStepperMotorServer_Logger::_sinks[ESPServerLogMaxSinks] = {NULL};
+bool ESPStepperMotorServer_Logger::_isSerialOutputEnabled = true;
 
 const char *LEVEL_STRING_ALL = "ALL";
 const char *LEVEL_STRING_DEBUG = "DEBUG";
 const char *LEVEL_STRING_INFO = "INFO";
 const char *LEVEL_STRING_WARNING = "WARNING";
 
+/**
+ * create a named logger. Loggers with the same name share the same module (and log level).
+ * Module names are truncated to ESPServerLogMaxModuleNameLength - 1 characters
+ */
 ESPStepperMotorServer_Logger::ESPStepperMotorServer_Logger(String loggerName)
 {
-    this->_loggerName = loggerName;
+    this->_moduleId = ESPStepperMotorServer_Logger::registerModule(loggerName.c_str());
 }
 
 ESPStepperMotorServer_Logger::ESPStepperMotorServer_Logger()
 {
-    this->_loggerName = "root";
+    this->_moduleId = ESPServerLogModule_Root;
 }
 
 void ESPStepperMotorServer_Logger::printBinaryWithLeadingZeros(char *result, byte var)
@@ -93,18 +120,63 @@ byte ESPStepperMotorServer_Logger::getLogLevel()
     return ESPStepperMotorServer_Logger::_logLevel;
 }
 
-void ESPStepperMotorServer_Logger::logf(const char *level, const char *format, va_list args)
+const char *ESPStepperMotorServer_Logger::getLevelString(byte level)
 {
-    char buf[1000];
+    switch (level)
+    {
+    case ESPServerLogLevel_ALL:
+        return LEVEL_STRING_ALL;
+    case ESPServerLogLevel_DEBUG:
+        return LEVEL_STRING_DEBUG;
+    case ESPServerLogLevel_INFO:
+        return LEVEL_STRING_INFO;
+    default:
+        return LEVEL_STRING_WARNING;
+    }
+}
+
+void ESPStepperMotorServer_Logger::logf(byte module, byte level, const char *format, va_list args)
+{
+    if (xPortInIsrContext())
+    {
+        // formatting is not safe in an ISR, print the format string as is
+        ESPStepperMotorServer_LogRecord record = {0, level, LOG_RECORD_FLAG_DEFERRED | LOG_RECORD_FLAG_RAW_FORMAT, module, format, {0}};
+        enqueueRecord(record, NULL, 0, true);
+        return;
+    }
+    char buf[ESPServerLogMaxMessageLength];
     vsnprintf(buf, sizeof(buf), format, args);
-    ESPStepperMotorServer_Logger::log(level, buf, false, false);
+    ESPStepperMotorServer_Logger::log(module, level, buf, false, false);
+}
+
+void ESPStepperMotorServer_Logger::log(byte module, byte level, const char *msg, boolean newLine, boolean ommitLogLevel)
+{
+    if (_loggerTaskHandle == NULL && !xPortInIsrContext())
+    {
+        // async logging has not been started yet, write directly to the serial port (the sinks are only served by the logger task)
+        ESPStepperMotorServer_Logger::writeToSerial(level, module, msg, newLine, ommitLogLevel);
+        return;
+    }
+    ESPStepperMotorServer_LogRecord record = {0, level, (byte)((newLine ? LOG_RECORD_FLAG_NEW_LINE : 0) | (ommitLogLevel ? LOG_RECORD_FLAG_OMIT_LEVEL : 0)), module, NULL, {0}};
+    enqueueRecord(record, msg, strnlen(msg, ESPServerLogMaxMessageLength - 1), xPortInIsrContext());
 }
 
-void ESPStepperMotorServer_Logger::log(const char *level, const char *msg, boolean newLine, boolean ommitLogLevel)
+void ESPStepperMotorServer_Logger::writeToSerial(byte level, byte module, const char *msg, boolean newLine, boolean ommitLogLevel)
 {
+    if (!_isSerialOutputEnabled)
+    {
+        return;
+    }
     if (!ommitLogLevel)
     {
-        Serial.printf("[%s] ", level);
+        if (module == ESPServerLogModule_Root)
+        {
+            Serial.printf("[%s] ", getLevelString(level));
+        }
+        else
+        {
+            Serial.printf("[%s][%s] ", getLevelString(level), getModuleName(module));
+        }
     }
     if (newLine == true)
     {
@@ -116,6 +188,239 @@ void ESPStepperMotorServer_Logger::log(const char *level, const char *msg, boole
     }
 }
 
+/**
+ * pass the given message to all registered sinks whose log level allows the given level.
+ * Trailing line breaks are removed, since the sinks send each message as a separate packet
+ */
+void ESPStepperMotorServer_Logger::writeToSinks(byte level, byte module, const char *msg)
+{
+    char message[ESPServerLogMaxMessageLength];
+    bool isMessagePrepared = false;
+    for (byte i = 0; i < ESPServerLogMaxSinks; i++)
+    {
+        ESPStepperMotorServer_LogSink *sink = _sinks[i];
+        if (sink == NULL || level > sink->getLogLevel())
+        {
+            continue;
+        }
+        if (!isMessagePrepared)
+        {
+            size_t length = strnlen(msg, sizeof(message) - 1);
+            while (length > 0 && (msg[length - 1] == '\n' || msg[length - 1] == '\r'))
+            {
+                length--;
+            }
+            if (length == 0)
+            {
+                return;
+            }
+            memcpy(message, msg, length);
+            message[length] = '\0';
+            isMessagePrepared = true;
+        }
+        sink->write(level, getLevelString(level), getModuleName(module), message);
+    }
+}
+
+/**
+ * log a warning from an interrupt service routine. The message is not formatted in the ISR, the format string (which must be a string literal)
+ * and the arguments are stored in the log ring buffer and formatted later by the logger task.
+ * Only integer and character conversions (%i, %d, %u, %x, %c) are supported, since all arguments are passed as 32 bit values
+ */
+void IRAM_ATTR ESPStepperMotorServer_Logger::logWarningfFromISR(const char *format, uint32_t argument1, uint32_t argument2, uint32_t argument3, uint32_t argument4)
+{
+    ESPStepperMotorServer_LogRecord record = {0, ESPServerLogLevel_WARNING, LOG_RECORD_FLAG_DEFERRED, ESPServerLogModule_Root, format, {argument1, argument2, argument3, argument4}};
+    enqueueRecord(record, NULL, 0, true);
+}
+
+/**
+ * copy the given record (and message) into the log ring buffer and wake up the logger task.
+ * Returns false if the ring buffer does not have enough space left, in this case the record is dropped and the dropped message counter is increased
+ */
+bool IRAM_ATTR ESPStepperMotorServer_Logger::enqueueRecord(ESPStepperMotorServer_LogRecord &record, const char *msg, size_t msgLength, bool isFromISR)
+{
+    // message is stored with a terminating null char
+    const size_t messageStorageLength = (msg != NULL) ? msgLength + 1 : 0;
+    record.length = ESPStepperMotorServer_LogRing::getRecordLength(messageStorageLength);
+
+    if (isFromISR)
+    {
+        portENTER_CRITICAL_ISR(&_ringMux);
+    }
+    else
+    {
+        portENTER_CRITICAL(&_ringMux);
+    }
+    byte *recordStorage = _ring.reserve(record.length);
+    if (recordStorage != NULL)
+    {
+        memcpy(recordStorage, &record, sizeof(ESPStepperMotorServer_LogRecord));
+        if (msg != NULL)
+        {
+            memcpy(&recordStorage[sizeof(ESPStepperMotorServer_LogRecord)], msg, msgLength);
+            recordStorage[sizeof(ESPStepperMotorServer_LogRecord) + msgLength] = '\0';
+        }
+    }
+    else
+    {
+        _droppedMessageCounter++;
+    }
+    if (isFromISR)
+    {
+        portEXIT_CRITICAL_ISR(&_ringMux);
+    }
+    else
+    {
+        portEXIT_CRITICAL(&_ringMux);
+    }
+
+    const bool isQueued = (recordStorage != NULL);
+    if (isQueued && _loggerTaskHandle != NULL)
+    {
+        if (isFromISR)
+        {
+            BaseType_t higherPriorityTaskWoken = pdFALSE;
+            vTaskNotifyGiveFromISR(_loggerTaskHandle, &higherPriorityTaskWoken);
+            if (higherPriorityTaskWoken)
+            {
+                portYIELD_FROM_ISR();
+            }
+        }
+        else
+        {
+            xTaskNotifyGive(_loggerTaskHandle);
+        }
+    }
+    return isQueued;
+}
+
+/**
+ * start the background task that writes the log messages to the serial port and the registered log sinks.
+ * Once started, all log functions only copy the message into the log ring buffer and return immediately
+ */
+void ESPStepperMotorServer_Logger::startAsyncLogging()
+{
+    if (_loggerTaskHandle != NULL)
+    {
+        return;
+    }
+    if (_idleLoggerTaskHandle != NULL)
+    {
+        _loggerTaskHandle = _idleLoggerTaskHandle;
+        _idleLoggerTaskHandle = NULL;
+        return;
+    }
+    xTaskCreate(
+        ESPStepperMotorServer_Logger::processLogRecords, /* Task function. */
+        "Logger",                                         /* String with name of task. */
+        4096,                                             /* Stack size in bytes (the sinks format the messages on this stack). */
+        NULL,                                             /* Parameter passed as input of the task */
+        1,                                                /* Priority of the task. */
+        &_loggerTaskHandle);                              /* Task handle. */
+}
+
+/**
+ * stop the logger task and write all pending log messages. After this call, messages are written directly to the serial port again.
+ * The logger task is signalled to write the queued messages and this call waits until it is done,
+ * so the task is never stopped in the middle of writing a message to the serial port or a log sink
+ */
+void ESPStepperMotorServer_Logger::stopAsyncLogging()
+{
+    TaskHandle_t loggerTaskHandle = _loggerTaskHandle;
+    if (loggerTaskHandle == NULL || loggerTaskHandle == xTaskGetCurrentTaskHandle())
+    {
+        return;
+    }
+    _isLoggerTaskStopRequested = true;
+    // new messages are written directly from now on
+    _loggerTaskHandle = NULL;
+    xTaskNotifyGive(loggerTaskHandle);
+    while (_isLoggerTaskStopRequested)
+    {
+        vTaskDelay(1);
+    }
+    _idleLoggerTaskHandle = loggerTaskHandle;
+    // messages that have been queued from ISRs while the logger task was stopped
+    writeQueuedRecords();
+}
+
+bool ESPStepperMotorServer_Logger::isAsyncLoggingActive()
+{
+    return (_loggerTaskHandle != NULL);
+}
+
+/**
+ * the number of log messages that have been dropped since the log ring buffer was full
+ */
+unsigned long ESPStepperMotorServer_Logger::getDroppedMessageCount()
+{
+    return _droppedMessageCounter;
+}
+
+void ESPStepperMotorServer_Logger::processLogRecords(void *parameter)
+{
+    while (true)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        // the task is also woken up by messages that have been queued while it was being stopped, those are written by stopAsyncLogging()
+        if (_loggerTaskHandle != NULL || _isLoggerTaskStopRequested)
+        {
+            writeQueuedRecords();
+        }
+        if (_isLoggerTaskStopRequested)
+        {
+            _isLoggerTaskStopRequested = false;
+        }
+    }
+}
+
+void ESPStepperMotorServer_Logger::writeQueuedRecords()
+{
+    const ESPStepperMotorServer_LogRecord *record;
+    while ((record = _ring.peek()) != NULL)
+    {
+        writeRecord(record);
+        portENTER_CRITICAL(&_ringMux);
+        _ring.release(record);
+        portEXIT_CRITICAL(&_ringMux);
+    }
+
+    const unsigned long droppedMessages = _droppedMessageCounter;
+    if (droppedMessages != _reportedDroppedMessageCounter)
+    {
+        char buf[80];
+        snprintf(buf, sizeof(buf), "%lu log messages have been dropped since the log buffer was full\n", droppedMessages - _reportedDroppedMessageCounter);
+        writeToSerial(ESPServerLogLevel_WARNING, ESPServerLogModule_Root, buf, false, false);
+        writeToSinks(ESPServerLogLevel_WARNING, ESPServerLogModule_Root, buf);
+        _reportedDroppedMessageCounter = droppedMessages;
+    }
+}
+
+void ESPStepperMotorServer_Logger::writeRecord(const ESPStepperMotorServer_LogRecord *record)
+{
+    char buf[ESPServerLogMaxMessageLength];
+    const char *msg;
+    if (record->flags & LOG_RECORD_FLAG_RAW_FORMAT)
+    {
+        msg = record->format;
+    }
+    else if (record->flags & LOG_RECORD_FLAG_DEFERRED)
+    {
+        snprintf(buf, sizeof(buf), record->format, record->arguments[0], record->arguments[1], record->arguments[2], record->arguments[3]);
+        msg = buf;
+    }
+    else
+    {
+        msg = (const char *)record + sizeof(ESPStepperMotorServer_LogRecord);
+    }
+    const bool isContinuation = (record->flags & LOG_RECORD_FLAG_OMIT_LEVEL);
+    writeToSerial(record->level, record->module, msg, (record->flags & LOG_RECORD_FLAG_NEW_LINE), isContinuation);
+    if (!isContinuation)
+    {
+        writeToSinks(record->level, record->module, msg);
+    }
+}
+
 bool ESPStepperMotorServer_Logger::isDebugEnabled()
 {
     return ESPStepperMotorServer_Logger::_isDebugLevelSet;
@@ -126,7 +431,7 @@ void ESPStepperMotorServer_Logger::logDebug(const char *msg, boolean newLine, bo
 {
     if (ESPStepperMotorServer_Logger::_isDebugLevelSet)
     {
-        ESPStepperMotorServer_Logger::log(LEVEL_STRING_DEBUG, msg, newLine, ommitLogLevel);
+        ESPStepperMotorServer_Logger::log(ESPServerLogModule_Root, ESPServerLogLevel_DEBUG, msg, newLine, ommitLogLevel);
     }
 }
 
@@ -136,7 +441,7 @@ void ESPStepperMotorServer_Logger::logDebugf(const char *format, ...)
     {
         va_list _argumentList;
         va_start(_argumentList, format);
-        ESPStepperMotorServer_Logger::logf(LEVEL_STRING_DEBUG, format, _argumentList);
+        ESPStepperMotorServer_Logger::logf(ESPServerLogModule_Root, ESPServerLogLevel_DEBUG, format, _argumentList);
         va_end(_argumentList);
     }
 }
@@ -154,7 +459,7 @@ void ESPStepperMotorServer_Logger::logInfo(const char *msg, boolean newLine, boo
 {
     if (getLogLevel() >= ESPServerLogLevel_INFO)
     {
-        ESPStepperMotorServer_Logger::log(LEVEL_STRING_INFO, msg, newLine, ommitLogLevel);
+        ESPStepperMotorServer_Logger::log(ESPServerLogModule_Root, ESPServerLogLevel_INFO, msg, newLine, ommitLogLevel);
     }
 }
 void ESPStepperMotorServer_Logger::logInfof(const char *format, ...)
@@ -163,20 +468,250 @@ void ESPStepperMotorServer_Logger::logInfof(const char *format, ...)
     {
         va_list args;
         va_start(args, format);
-        ESPStepperMotorServer_Logger::logf(LEVEL_STRING_INFO, format, args);
+        ESPStepperMotorServer_Logger::logf(ESPServerLogModule_Root, ESPServerLogLevel_INFO, format, args);
         va_end(args);
     }
 }
 
 void ESPStepperMotorServer_Logger::logWarning(const char *msg, boolean newLine, boolean ommitLogLevel)
 {
-    ESPStepperMotorServer_Logger::log(LEVEL_STRING_WARNING, msg, newLine, ommitLogLevel);
+    ESPStepperMotorServer_Logger::log(ESPServerLogModule_Root, ESPServerLogLevel_WARNING, msg, newLine, ommitLogLevel);
 }
 
 void ESPStepperMotorServer_Logger::logWarningf(const char *format, ...)
 {
     va_list args;
     va_start(args, format);
-    ESPStepperMotorServer_Logger::logf(LEVEL_STRING_WARNING, format, args);
+    ESPStepperMotorServer_Logger::logf(ESPServerLogModule_Root, ESPServerLogLevel_WARNING, format, args);
     va_end(args);
-}
\ No newline at end of file
+}
+// ---------------------------------------------------------------------------------
+//                                  Module functions
+// ---------------------------------------------------------------------------------
+
+void ESPStepperMotorServer_Logger::logModule(byte module, byte level, const char *msg, boolean newLine, boolean ommitLogLevel)
+{
+    if (ESPStepperMotorServer_Logger::isLevelEnabled(module, level))
+    {
+        ESPStepperMotorServer_Logger::log(module, level, msg, newLine, ommitLogLevel);
+    }
+}
+
+void ESPStepperMotorServer_Logger::logModule(byte module, byte level, String msg, boolean newLine, boolean ommitLogLevel)
+{
+    ESPStepperMotorServer_Logger::logModule(module, level, msg.c_str(), newLine, ommitLogLevel);
+}
+
+void ESPStepperMotorServer_Logger::logModulef(byte module, byte level, const char *format, ...)
+{
+    if (ESPStepperMotorServer_Logger::isLevelEnabled(module, level))
+    {
+        va_list args;
+        va_start(args, format);
+        ESPStepperMotorServer_Logger::logf(module, level, format, args);
+        va_end(args);
+    }
+}
+
+/**
+ * returns true if messages of the given level should be logged for the given module.
+ * Modules without an own log level (ESPServerLogLevel_INHERIT) use the global log level
+ */
+bool ESPStepperMotorServer_Logger::isLevelEnabled(byte module, byte level)
+{
+    const byte moduleLogLevel = (module < ESPServerLogMaxModules) ? _moduleLogLevels[module] : ESPServerLogLevel_INHERIT;
+    return (level <= ((moduleLogLevel != ESPServerLogLevel_INHERIT) ? moduleLogLevel : _logLevel));
+}
+
+/**
+ * returns the id of the module with the given name. If no such module exists yet, a new module is registered.
+ * If all ESPServerLogMaxModules modules are in use, the root module id is returned
+ */
+byte ESPStepperMotorServer_Logger::registerModule(const char *moduleName)
+{
+    byte module = ESPStepperMotorServer_Logger::getModuleId(moduleName);
+    if (module != 255)
+    {
+        return module;
+    }
+    portENTER_CRITICAL(&_ringMux);
+    if (_registeredModuleCount < ESPServerLogMaxModules)
+    {
+        module = _registeredModuleCount;
+        strncpy(_moduleNames[module], moduleName, ESPServerLogMaxModuleNameLength - 1);
+        _moduleNames[module][ESPServerLogMaxModuleNameLength - 1] = '\0';
+        _moduleLogLevels[module] = ESPServerLogLevel_INHERIT;
+        _registeredModuleCount++;
+    }
+    portEXIT_CRITICAL(&_ringMux);
+
+    if (module == 255)
+    {
+        ESPStepperMotorServer_Logger::logWarningf("No free log module left for logger %s, using root logger instead\n", moduleName);
+        return ESPServerLogModule_Root;
+    }
+    return module;
+}
+
+/**
+ * returns the id of the module with the given name or 255 if no such module exists
+ */
+byte ESPStepperMotorServer_Logger::getModuleId(const char *moduleName)
+{
+    for (byte module = 0; module < _registeredModuleCount; module++)
+    {
+        if (strncmp(_moduleNames[module], moduleName, ESPServerLogMaxModuleNameLength - 1) == 0)
+        {
+            return module;
+        }
+    }
+    return 255;
+}
+
+const char *ESPStepperMotorServer_Logger::getModuleName(byte module)
+{
+    return (module < _registeredModuleCount) ? _moduleNames[module] : _moduleNames[ESPServerLogModule_Root];
+}
+
+/**
+ * set the log level of a single module. Use ESPServerLogLevel_INHERIT to make the module follow the global log level again.
+ * Setting the level of the root module is the same as calling setLogLevel()
+ */
+bool ESPStepperMotorServer_Logger::setModuleLogLevel(byte module, byte logLevel)
+{
+    if (module >= _registeredModuleCount || logLevel > ESPServerLogLevel_ALL)
+    {
+        return false;
+    }
+    if (module == ESPServerLogModule_Root)
+    {
+        if (logLevel == ESPServerLogLevel_INHERIT)
+        {
+            return false;
+        }
+        ESPStepperMotorServer_Logger::setLogLevel(logLevel);
+        return true;
+    }
+    _moduleLogLevels[module] = logLevel;
+    return true;
+}
+
+/**
+ * returns the log level of the given module, ESPServerLogLevel_INHERIT if the module uses the global log level
+ */
+byte ESPStepperMotorServer_Logger::getModuleLogLevel(byte module)
+{
+    if (module == ESPServerLogModule_Root)
+    {
+        return _logLevel;
+    }
+    return (module < _registeredModuleCount) ? _moduleLogLevels[module] : ESPServerLogLevel_INHERIT;
+}
+
+// ---------------------------------------------------------------------------------
+//                                  Sink functions
+// ---------------------------------------------------------------------------------
+
+/**
+ * register an additional log output. Returns false if ESPServerLogMaxSinks sinks are registered already.
+ * The sink must stay valid until it has been removed again with removeLogSink()
+ */
+bool ESPStepperMotorServer_Logger::addLogSink(ESPStepperMotorServer_LogSink *sink)
+{
+    bool isAdded = false;
+    portENTER_CRITICAL(&_ringMux);
+    for (byte i = 0; i < ESPServerLogMaxSinks && !isAdded; i++)
+    {
+        if (_sinks[i] == NULL || _sinks[i] == sink)
+        {
+            _sinks[i] = sink;
+            isAdded = true;
+        }
+    }
+    portEXIT_CRITICAL(&_ringMux);
+    return isAdded;
+}
+
+/**
+ * unregister the given log output. Since the logger task might still write the current message to the sink,
+ * call stopAsyncLogging() before deleting a sink that has been in use
+ */
+bool ESPStepperMotorServer_Logger::removeLogSink(ESPStepperMotorServer_LogSink *sink)
+{
+    bool isRemoved = false;
+    portENTER_CRITICAL(&_ringMux);
+    for (byte i = 0; i < ESPServerLogMaxSinks; i++)
+    {
+        if (_sinks[i] == sink)
+        {
+            _sinks[i] = NULL;
+            isRemoved = true;
+        }
+    }
+    portEXIT_CRITICAL(&_ringMux);
+    return isRemoved;
+}
+
+/**
+ * enable or disable the output of log messages on the serial port, e.g. when the serial port is not connected and only remote sinks are used
+ */
+void ESPStepperMotorServer_Logger::setSerialOutputEnabled(bool isEnabled)
+{
+    _isSerialOutputEnabled = isEnabled;
+}
+
+// ---------------------------------------------------------------------------------
+//                                  Named logger functions
+// ---------------------------------------------------------------------------------
+
+byte ESPStepperMotorServer_Logger::getModuleId() const
+{
+    return this->_moduleId;
+}
+
+const char *ESPStepperMotorServer_Logger::getName() const
+{
+    return ESPStepperMotorServer_Logger::getModuleName(this->_moduleId);
+}
+
+void ESPStepperMotorServer_Logger::setLevel(byte logLevel)
+{
+    ESPStepperMotorServer_Logger::setModuleLogLevel(this->_moduleId, logLevel);
+}
+
+bool ESPStepperMotorServer_Logger::isEnabled(byte level) const
+{
+    return ESPStepperMotorServer_Logger::isLevelEnabled(this->_moduleId, level);
+}
+
+void ESPStepperMotorServer_Logger::debugf(const char *format, ...) const
+{
+#ifndef ESPStepperMotorServer_COMPILE_NO_DEBUG
+    if (this->isEnabled(ESPServerLogLevel_DEBUG))
+    {
+        va_list args;
+        va_start(args, format);
+        ESPStepperMotorServer_Logger::logf(this->_moduleId, ESPServerLogLevel_DEBUG, format, args);
+        va_end(args);
+    }
+#endif
+}
+
+void ESPStepperMotorServer_Logger::infof(const char *format, ...) const
+{
+    if (this->isEnabled(ESPServerLogLevel_INFO))
+    {
+        va_list args;
+        va_start(args, format);
+        ESPStepperMotorServer_Logger::logf(this->_moduleId, ESPServerLogLevel_INFO, format, args);
+        va_end(args);
+    }
+}
+
+void ESPStepperMotorServer_Logger::warningf(const char *format, ...) const
+{
+    va_list args;
+    va_start(args, format);
+    ESPStepperMotorServer_Logger::logf(this->_moduleId, ESPServerLogLevel_WARNING, format, args);
+    va_end(args);
+}
@@ -27,19 +27,160 @@
 // LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
-
 #ifndef ESPStepperMotorServer_Logger_h
 #define ESPStepperMotorServer_Logger_h
 
 #include <Arduino.h>
+#include <ESPStepperMotorServer_LogRing.h>
 
 #define ESPServerLogLevel_ALL 4
 #define ESPServerLogLevel_DEBUG 3
 #define ESPServerLogLevel_INFO 2
 #define ESPServerLogLevel_WARNING 1
+// module log level value that makes the module use the global log level
+#define ESPServerLogLevel_INHERIT 0
+
+// ids of the log modules of the library. Each source file of the library selects its module by defining ESPServerLogModule
+// before including any header, so the log level can be set per module (see ESPStepperMotorServer_Logger::setModuleLogLevel).
+// Named logger instances get the next free module id when they are created
+#define ESPServerLogModule_Root 0
+#define ESPServerLogModule_Server 1
+#define ESPServerLogModule_Configuration 2
+#define ESPServerLogModule_RestAPI 3
+#define ESPServerLogModule_WebInterface 4
+#define ESPServerLogModule_CLI 5
+#define ESPServerLogModule_MotionController 6
+#define ESPServerLogModule_MacroExecutor 7
+#define ESPServerLogModule_PositionJournal 8
+#define ESPServerLogModule_PowerManager 9
+#define ESPServerLogModule_TrajectoryRecorder 10
+#define ESPServerLogModule_GCodeInterpreter 11
+#define ESPServerLogModule_SyncController 12
+#define ESPServerLogModule_ShiftRegisterOutput 13
+#define ESPServerLogModule_EventPublisher 14
+#define ESPServerLogModule_BuiltInCount 15
+
+#ifndef ESPServerLogModule
+#define ESPServerLogModule ESPServerLogModule_Root
+#endif
+
+// maximum number of log modules, including the built in modules of the library
+#ifndef ESPServerLogMaxModules
+#define ESPServerLogMaxModules 24
+#endif
+// maximum length of a log module name including the terminating null char, longer names are truncated
+#define ESPServerLogMaxModuleNameLength 16
+// maximum number of log sinks that can be registered in addition to the serial output
+#ifndef ESPServerLogMaxSinks
+#define ESPServerLogMaxSinks 4
+#endif
+
+// the most verbose log level that is compiled into the firmware. The ESPServerLog* macros below remove all log calls
+// of more verbose levels at compile time, including the evaluation of their arguments.
+// E.g. build with -D ESPServerCompiledLogLevel=1 to only keep warnings
+#ifndef ESPServerCompiledLogLevel
+#ifdef ESPStepperMotorServer_COMPILE_NO_DEBUG
+#define ESPServerCompiledLogLevel ESPServerLogLevel_INFO
+#else
+#define ESPServerCompiledLogLevel ESPServerLogLevel_ALL
+#endif
+#endif
+
+#if defined(ESPStepperMotorServer_COMPILE_NO_DEBUG) && ESPServerCompiledLogLevel >= ESPServerLogLevel_DEBUG
+#error "ESPServerCompiledLogLevel must be lower than ESPServerLogLevel_DEBUG when ESPStepperMotorServer_COMPILE_NO_DEBUG is set"
+#endif
+
+// logging front end. Use these macros instead of calling the logDebug* / logInfo* functions directly:
+// the arguments are only evaluated if the level is compiled in and enabled at runtime for the module of the calling source file
+#if ESPServerCompiledLogLevel >= ESPServerLogLevel_DEBUG
+#define ESPServerLogDebug(...)                                                                                        \
+  do                                                                                                                  \
+  {                                                                                                                   \
+    if (ESPStepperMotorServer_Logger::isLevelEnabled(ESPServerLogModule, ESPServerLogLevel_DEBUG))                    \
+    {                                                                                                                 \
+      ESPStepperMotorServer_Logger::logModule(ESPServerLogModule, ESPServerLogLevel_DEBUG, __VA_ARGS__);              \
+    }                                                                                                                 \
+  } while (0)
+#define ESPServerLogDebugf(...)                                                                                       \
+  do                                                                                                                  \
+  {                                                                                                                   \
+    if (ESPStepperMotorServer_Logger::isLevelEnabled(ESPServerLogModule, ESPServerLogLevel_DEBUG))                    \
+    {                                                                                                                 \
+      ESPStepperMotorServer_Logger::logModulef(ESPServerLogModule, ESPServerLogLevel_DEBUG, __VA_ARGS__);             \
+    }                                                                                                                 \
+  } while (0)
+#else
+#define ESPServerLogDebug(...) \
+  do                           \
+  {                            \
+  } while (0)
+#define ESPServerLogDebugf(...) \
+  do                            \
+  {                             \
+  } while (0)
+#endif
+
+#if ESPServerCompiledLogLevel >= ESPServerLogLevel_INFO
+#define ESPServerLogInfo(...)                                                                                         \
+  do                                                                                                                  \
+  {                                                                                                                   \
+    if (ESPStepperMotorServer_Logger::isLevelEnabled(ESPServerLogModule, ESPServerLogLevel_INFO))                     \
+    {                                                                                                                 \
+      ESPStepperMotorServer_Logger::logModule(ESPServerLogModule, ESPServerLogLevel_INFO, __VA_ARGS__);               \
+    }                                                                                                                 \
+  } while (0)
+#define ESPServerLogInfof(...)                                                                                        \
+  do                                                                                                                  \
+  {                                                                                                                   \
+    if (ESPStepperMotorServer_Logger::isLevelEnabled(ESPServerLogModule, ESPServerLogLevel_INFO))                     \
+    {                                                                                                                 \
+      ESPStepperMotorServer_Logger::logModulef(ESPServerLogModule, ESPServerLogLevel_INFO, __VA_ARGS__);              \
+    }                                                                                                                 \
+  } while (0)
+#else
+#define ESPServerLogInfo(...) \
+  do                          \
+  {                           \
+  } while (0)
+#define ESPServerLogInfof(...) \
+  do                           \
+  {                            \
+  } while (0)
+#endif
+
+// maximum length of a single formatted log message, longer messages are truncated
+#ifndef ESPServerLogMaxMessageLength
+#define ESPServerLogMaxMessageLength 256
+#endif
+//
+// base class for log outputs in addition to the serial port (see ESPStepperMotorServer_LogSinks.h).
+// Sinks are only called from the logger task, so a slow sink delays the following log output but never blocks the code that logs a message.
+// Continuation messages (logged with ommitLogLevel = true) are only written to the serial port
+class ESPStepperMotorServer_LogSink
+{
+  public:
+    virtual ~ESPStepperMotorServer_LogSink() {}
+    // write one log message, the message does not contain a trailing line break
+    virtual void write(byte level, const char *levelName, const char *moduleName, const char *message) = 0;
+
+    void setLogLevel(byte logLevel)
+    {
+        this->_logLevel = logLevel;
+    }
+
+    byte getLogLevel() const
+    {
+        return this->_logLevel;
+    }
+
+  private:
+    byte _logLevel = ESPServerLogLevel_INFO;
+};
 
 //
 // the ESPStepperMotorServer_Logger class
+// the static functions log to the root module, while named logger instances log to their own module
+// that can have a different log level than the global log level
 class ESPStepperMotorServer_Logger
 {
   public:
@@ -54,15 +195,66 @@ class ESPStepperMotorServer_Logger
     static void logInfof(const char *format, ...);
     static void logWarning(const char *msg, boolean newLine = true, boolean ommitLogLevel = false);
     static void logWarningf(const char *format, ...);
+    static void logWarningfFromISR(const char *format, uint32_t argument1 = 0, uint32_t argument2 = 0, uint32_t argument3 = 0, uint32_t argument4 = 0);
     static bool isDebugEnabled();
+    static void startAsyncLogging();
+    static void stopAsyncLogging();
+    static bool isAsyncLoggingActive();
+    static unsigned long getDroppedMessageCount();
+
+    // module functions
+    static void logModule(byte module, byte level, const char *msg, boolean newLine = true, boolean ommitLogLevel = false);
+    static void logModule(byte module, byte level, String msg, boolean newLine = true, boolean ommitLogLevel = false);
+    static void logModulef(byte module, byte level, const char *format, ...);
+    static bool isLevelEnabled(byte module, byte level);
+    static byte registerModule(const char *moduleName);
+    static byte getModuleId(const char *moduleName);
+    static const char *getModuleName(byte module);
+    static bool setModuleLogLevel(byte module, byte logLevel);
+    static byte getModuleLogLevel(byte module);
+
+    // sink functions
+    static bool addLogSink(ESPStepperMotorServer_LogSink *sink);
+    static bool removeLogSink(ESPStepperMotorServer_LogSink *sink);
+    static void setSerialOutputEnabled(bool isEnabled);
+
+    // named logger functions
+    byte getModuleId() const;
+    const char *getName() const;
+    void setLevel(byte logLevel);
+    bool isEnabled(byte level) const;
+    void debugf(const char *format, ...) const;
+    void infof(const char *format, ...) const;
+    void warningf(const char *format, ...) const;
 
   private:
-    static void log(const char *level, const char *msg, boolean newLine, boolean ommitLogLevel);
+    static void writeToSerial(byte level, byte module, const char *msg, boolean newLine, boolean ommitLogLevel);
+    static void writeToSinks(byte level, byte module, const char *msg);
     static void printBinaryWithLeadingZeros(char *result, byte var);
-    static void logf(const char *level, const char *format, va_list args);
+    static void logf(byte module, byte level, const char *format, va_list args);
+    static void log(byte module, byte level, const char *msg, boolean newLine, boolean ommitLogLevel);
+    static const char *getLevelString(byte level);
+    static bool enqueueRecord(ESPStepperMotorServer_LogRecord &record, const char *msg, size_t msgLength, bool isFromISR);
+    static void processLogRecords(void *parameter);
+    static void writeQueuedRecords();
+    static void writeRecord(const ESPStepperMotorServer_LogRecord *record);
     static byte _logLevel;
     static bool _isDebugLevelSet;
-    String _loggerName;
+    // the log ring buffer is written by all tasks and ISRs, but only read by the logger task
+    static ESPStepperMotorServer_LogRing _ring;
+    static volatile unsigned long _droppedMessageCounter;
+    static unsigned long _reportedDroppedMessageCounter;
+    static portMUX_TYPE _ringMux;
+    static TaskHandle_t _loggerTaskHandle;
+    // the logger task is not deleted when async logging is stopped, but kept idle to be reused by startAsyncLogging()
+    static TaskHandle_t _idleLoggerTaskHandle;
+    static volatile bool _isLoggerTaskStopRequested;
+    static char _moduleNames[ESPServerLogMaxModules][ESPServerLogMaxModuleNameLength];
+    static byte _moduleLogLevels[ESPServerLogMaxModules];
+    static byte _registeredModuleCount;
+    static ESPStepperMotorServer_LogSink *_sinks[ESPServerLogMaxSinks];
+    static bool _isSerialOutputEnabled;
+    byte _moduleId;
 };
 
 #endif
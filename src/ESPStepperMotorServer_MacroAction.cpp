@@ -13,14 +13,19 @@ bool ESPStepperMotorServer_MacroAction::execute(ESPStepperMotorServer *serverRef
     case moveBy: {
         ESPStepperMotorServer_StepperConfiguration *stepper = serverRef->getCurrentServerConfiguration()->getStepperConfiguration(this->val1);
         if (stepper && stepper->getFlexyStepper()) {
-            stepper->getFlexyStepper()->moveRelativeInSteps(this->val2);
+            long currentPosition = stepper->getFlexyStepper()->getCurrentPositionInSteps();
+            long targetPosition = currentPosition + this->val2;
+            if (stepper->applySoftLimits(targetPosition) != ESPServerSoftLimitResult_Rejected) {
+                stepper->getFlexyStepper()->setTargetPositionRelativeInSteps(targetPosition - currentPosition);
+            }
         }
         break;
     }
     case MacroActionType::moveTo: {
         ESPStepperMotorServer_StepperConfiguration *stepper = serverRef->getCurrentServerConfiguration()->getStepperConfiguration(this->val1);
         if (stepper && stepper->getFlexyStepper()) {
-            stepper->getFlexyStepper()->setTargetPositionInSteps(this->val2);
+            long targetPosition = this->val2;
+            stepper->setTargetPositionWithinSoftLimits(targetPosition);
         }
         break;
     }
@@ -80,6 +85,12 @@ bool ESPStepperMotorServer_MacroAction::execute(ESPStepperMotorServer *serverRef
     case MacroActionType::setOutputLow:
         digitalWrite(this->val1, LOW);
         break;
+    case MacroActionType::waitUntilIdle:
+    case MacroActionType::waitMs:
+    case MacroActionType::waitForSwitch:
+    case MacroActionType::jumpIf:
+        // sequencing actions can only be run by the ESPStepperMotorServer_MacroExecutor
+        return false;
     default:
         break;
     }
@@ -97,8 +108,7 @@ ESPStepperMotorServer_MacroAction *ESPStepperMotorServer_MacroAction::fromJsonOb
     int val1 = macroActionJson["val1"];
     long val2 = (long)macroActionJson["val2"];
     MacroActionType type = macroActionJson["type"];
-    return new ESPStepperMotorServer_MacroAction(type, val1, val2
-    );
+    return ESPStepperMotorServer_Configuration::getMacroActionPool().create(type, val1, val2);
 }
 
 MacroActionType ESPStepperMotorServer_MacroAction::getType(void) {
@@ -6,8 +6,17 @@
 
 class ESPStepperMotorServer;
 
+// NOTE: the numeric values are persisted in the configuration, so new types must only be appended at the end.
+// moveTo and moveBy only set the new target position of stepper val1 and do not wait for the movement to be completed,
+// add a waitUntilIdle action after the move to continue the macro only once the target position has been reached.
+// The sequencing types (waitUntilIdle and following) are only supported by the macro executor:
+//  waitUntilIdle: wait until stepper val1 reached its target position (val1 = -1 waits for all steppers)
+//  waitMs: wait for val2 milliseconds (must not be negative)
+//  waitForSwitch: wait until switch val1 is active (val2 = 1) or inactive (val2 = 0)
+//  jumpIf: continue with the action at index val2 of the same macro if switch val1 is active (val1 = -1 jumps unconditionally)
 enum MacroActionType {
-    moveTo, moveBy, setSpeed, setAcceleration, setDeceleration, setHome, setLimitA, setLimitB, setOutputHigh, setOutputLow, triggerEmergencyStop, releaseEmergencyStop
+    moveTo, moveBy, setSpeed, setAcceleration, setDeceleration, setHome, setLimitA, setLimitB, setOutputHigh, setOutputLow, triggerEmergencyStop, releaseEmergencyStop,
+    waitUntilIdle, waitMs, waitForSwitch, jumpIf
 };
 
 class ESPStepperMotorServer_MacroAction
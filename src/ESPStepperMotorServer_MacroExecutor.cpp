@@ -0,0 +1,498 @@
+//      *********************************************************
+//      *                                                       *
+//      *           ESP32 Stepper Motor Macro Executor          *
+//      *                                                       *
+//      *            Copyright (c) Paul Kerspe, 2019            *
+//      *                                                       *
+//      **********************************************************
+
+// MIT License
+//
+// Copyright (c) 2019 Paul Kerspe
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished
+// to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#define ESPServerLogModule ESPServerLogModule_MacroExecutor
+
+#include <ESPStepperMotorServer_MacroExecutor.h>
+
+//
+// constructor for the macro executor module
+// the executor task and trigger queue are created in start()
+//
+ESPStepperMotorServer_MacroExecutor::ESPStepperMotorServer_MacroExecutor(ESPStepperMotorServer *serverRef)
+{
+  this->serverRef = serverRef;
+  ESPServerLogDebug("Macro Executor created");
+}
+
+void ESPStepperMotorServer_MacroExecutor::start()
+{
+  if (this->xHandle == NULL) //prevent multiple starts
+  {
+    if (this->triggerQueue == NULL)
+    {
+      this->triggerQueue = xQueueCreate(ESPServerMacroTriggerQueueLength, sizeof(ESPStepperMotorServer_MacroTrigger));
+    }
+    this->compileMacros();
+    xTaskCreate(
+        ESPStepperMotorServer_MacroExecutor::processMacroTriggers, /* Task function. */
+        "MacroExecutor",                                           /* String with name of task. */
+        4000,                                                      /* Stack size in bytes. */
+        this,                                                      /* Parameter passed as input of the task */
+        3,                                                         /* Priority of the task (above the motion controller, since it only runs shortly after a trigger). */
+        &this->xHandle);                                           /* Task handle. */
+    ESPServerLogInfo("Macro Executor task started");
+  }
+}
+
+void ESPStepperMotorServer_MacroExecutor::stop()
+{
+  if (this->xHandle != NULL)
+  {
+    vTaskDelete(this->xHandle);
+    this->xHandle = NULL;
+    ESPServerLogInfo("Macro Executor stopped");
+  }
+}
+
+/**
+ * queue the macro of the given switch for execution. Must only be called from an ISR.
+ * Returns false if the trigger could not be queued (executor not started or queue full)
+ */
+bool IRAM_ATTR ESPStepperMotorServer_MacroExecutor::triggerMacroFromISR(byte switchId)
+{
+  if (this->triggerQueue == NULL)
+  {
+    return false;
+  }
+  ESPStepperMotorServer_MacroTrigger trigger = {switchId, micros()};
+  BaseType_t higherPriorityTaskWoken = pdFALSE;
+  bool isQueued = (xQueueSendFromISR(this->triggerQueue, &trigger, &higherPriorityTaskWoken) == pdTRUE);
+  if (higherPriorityTaskWoken == pdTRUE)
+  {
+    portYIELD_FROM_ISR();
+  }
+  return isQueued;
+}
+
+/**
+ * queue the macro of the given switch for execution (to be used outside of an ISR context)
+ */
+bool ESPStepperMotorServer_MacroExecutor::triggerMacro(byte switchId)
+{
+  if (this->triggerQueue == NULL)
+  {
+    return false;
+  }
+  ESPStepperMotorServer_MacroTrigger trigger = {switchId, micros()};
+  return (xQueueSend(this->triggerQueue, &trigger, 0) == pdTRUE);
+}
+
+void ESPStepperMotorServer_MacroExecutor::processMacroTriggers(void *parameter)
+{
+  ESPStepperMotorServer_MacroExecutor *ref = static_cast<ESPStepperMotorServer_MacroExecutor *>(parameter);
+  ESPStepperMotorServer_MacroTrigger trigger;
+  while (true)
+  {
+    // block until the next trigger if no macro is running, otherwise only poll the queue once per tick
+    TickType_t ticksToWait = (ref->runningMacroCount > 0) ? 1 : portMAX_DELAY;
+    ref->isWaitingForTrigger = (ref->runningMacroCount == 0);
+    while (xQueueReceive(ref->triggerQueue, &trigger, ticksToWait) == pdTRUE)
+    {
+      ref->isWaitingForTrigger = false;
+      ticksToWait = 0;
+      if (trigger.switchId >= ESPServerMaxSwitches)
+      {
+        continue;
+      }
+      ref->checkConfigurationRevision();
+      // macros that are still running when the emergency stop got triggered are aborted before the new macro is started
+      ref->checkEmergencyStop();
+      if (ref->macroLength[trigger.switchId] > 0 && !ref->runStates[trigger.switchId].isRunning)
+      {
+        ref->dispatchLatency.addSample(micros() - trigger.triggerTimeMicros);
+        ref->startMacro(trigger.switchId, trigger.triggerTimeMicros);
+        ESPServerLogDebugf("Started macro of switch %i (dispatch latency %lu us)\n", trigger.switchId, ref->dispatchLatency.getLastMicros());
+      }
+    }
+
+    // running macros must not continue with instructions that reference removed steppers or switches
+    ref->checkConfigurationRevision();
+    ref->checkEmergencyStop();
+
+    for (byte switchId = 0; switchId < ESPServerMaxSwitches && ref->runningMacroCount > 0; switchId++)
+    {
+      if (ref->runStates[switchId].isRunning)
+      {
+        ref->runMacroSlice(switchId);
+      }
+    }
+  }
+}
+
+/**
+ * recompile the macros if switches or steppers have been added/removed since the last compilation.
+ * This aborts all running macros, since their instructions might reference removed configurations
+ */
+void ESPStepperMotorServer_MacroExecutor::checkConfigurationRevision()
+{
+  if (this->compiledConfigurationRevision != this->serverRef->getCurrentServerConfiguration()->getConfigurationRevision())
+  {
+    this->compileMacros();
+    // stepper configurations that have been removed with the previous revision are not used by this task anymore
+    this->serverRef->releaseRetiredConfigurationEntities();
+  }
+}
+
+/**
+ * an emergency stop ends all running macros, otherwise they would continue moving once their current instruction is done.
+ * Macros that are triggered while the emergency stop is active are run (e.g. to release the emergency stop)
+ */
+void ESPStepperMotorServer_MacroExecutor::checkEmergencyStop()
+{
+  const bool isEmergencyStopActive = this->serverRef->emergencySwitchIsActive;
+  if (isEmergencyStopActive && !this->wasEmergencyStopActive && this->runningMacroCount > 0)
+  {
+    ESPServerLogInfo("Aborting all running macros due to emergency stop");
+    this->abortAllMacros();
+  }
+  this->wasEmergencyStopActive = isEmergencyStopActive;
+}
+
+bool ESPStepperMotorServer_MacroExecutor::isStepperInstruction(byte opcode)
+{
+  switch (opcode)
+  {
+  case MacroActionType::moveTo:
+  case MacroActionType::moveBy:
+  case MacroActionType::setSpeed:
+  case MacroActionType::setAcceleration:
+  case MacroActionType::setDeceleration:
+  case MacroActionType::setHome:
+  case MacroActionType::setLimitA:
+  case MacroActionType::setLimitB:
+    return true;
+  default:
+    return false;
+  }
+}
+
+/**
+ * convert the macro actions of all configured switches into the flat instruction array
+ * and resolve the target steppers. Running macros are aborted, since their instruction indexes become invalid
+ */
+void ESPStepperMotorServer_MacroExecutor::compileMacros()
+{
+  ESPStepperMotorServer_Configuration *configuration = this->serverRef->getCurrentServerConfiguration();
+  this->abortAllMacros();
+  this->compiledConfigurationRevision = configuration->getConfigurationRevision();
+  this->instructionCount = 0;
+
+  for (byte switchId = 0; switchId < ESPServerMaxSwitches; switchId++)
+  {
+    this->macroStartIndex[switchId] = this->instructionCount;
+    this->macroLength[switchId] = 0;
+
+    ESPStepperMotorServer_PositionSwitch *switchConfig = configuration->getSwitch(switchId);
+    if (switchConfig == NULL || !switchConfig->hasMacroActions())
+    {
+      continue;
+    }
+
+    std::vector<ESPStepperMotorServer_MacroAction *> macroActions = switchConfig->getMacroActions();
+    for (ESPStepperMotorServer_MacroAction *macroAction : macroActions)
+    {
+      if (this->instructionCount >= ESPServerMaxMacroInstructions)
+      {
+        ESPStepperMotorServer_Logger::logWarningf("The maximum amount of macro instructions (%i) has been reached, remaining macro actions of switch %i will be ignored\n", ESPServerMaxMacroInstructions, switchId);
+        break;
+      }
+
+      ESPStepperMotorServer_MacroInstruction &instruction = this->instructions[this->instructionCount];
+      instruction.opcode = (byte)macroAction->getType();
+      instruction.val1 = macroAction->getVal1();
+      instruction.val2 = macroAction->getVal2();
+      instruction.flexyStepper = NULL;
+      instruction.stepperConfiguration = NULL;
+
+      // invalid actions are kept as no-op, so that jump targets still match the index of the macro action
+      if (this->isStepperInstruction(instruction.opcode) || (instruction.opcode == MacroActionType::waitUntilIdle && instruction.val1 > -1))
+      {
+        ESPStepperMotorServer_StepperConfiguration *stepper = configuration->getStepperConfiguration(instruction.val1);
+        if (stepper == NULL || stepper->getFlexyStepper() == NULL)
+        {
+          ESPStepperMotorServer_Logger::logWarningf("Macro action of switch %i references the invalid stepper id %i and will be ignored\n", switchId, instruction.val1);
+          instruction.opcode = ESPServerMacroOpcodeNoOperation;
+        }
+        else
+        {
+          instruction.flexyStepper = stepper->getFlexyStepper();
+          instruction.stepperConfiguration = stepper;
+        }
+      }
+      else if (instruction.opcode == MacroActionType::waitForSwitch && instruction.val1 < 0)
+      {
+        ESPStepperMotorServer_Logger::logWarningf("Wait for switch action of switch %i does not define a switch id and will be ignored\n", switchId);
+        instruction.opcode = ESPServerMacroOpcodeNoOperation;
+      }
+      else if (instruction.opcode == MacroActionType::waitMs && instruction.val2 < 0)
+      {
+        ESPStepperMotorServer_Logger::logWarningf("Macro action of switch %i contains the invalid wait time %li ms and will be ignored\n", switchId, instruction.val2);
+        instruction.opcode = ESPServerMacroOpcodeNoOperation;
+      }
+      else if ((instruction.opcode == MacroActionType::waitForSwitch || instruction.opcode == MacroActionType::jumpIf) && instruction.val1 > -1 && configuration->getSwitch(instruction.val1) == NULL)
+      {
+        ESPStepperMotorServer_Logger::logWarningf("Macro action of switch %i references the invalid switch id %i and will be ignored\n", switchId, instruction.val1);
+        instruction.opcode = ESPServerMacroOpcodeNoOperation;
+      }
+      else if (instruction.opcode == MacroActionType::jumpIf && (instruction.val2 < 0 || instruction.val2 >= (long)macroActions.size()))
+      {
+        ESPStepperMotorServer_Logger::logWarningf("Macro action of switch %i contains the invalid jump target %li and will be ignored\n", switchId, instruction.val2);
+        instruction.opcode = ESPServerMacroOpcodeNoOperation;
+      }
+      this->instructionCount++;
+      this->macroLength[switchId]++;
+    }
+  }
+  ESPServerLogDebugf("Compiled %i macro instructions\n", this->instructionCount);
+}
+
+void ESPStepperMotorServer_MacroExecutor::startMacro(byte switchId, unsigned long triggerTimeMicros)
+{
+  ESPStepperMotorServer_MacroRunState &state = this->runStates[switchId];
+  state.isRunning = true;
+  state.isWaiting = false;
+  state.programCounter = 0;
+  state.triggerTimeMicros = triggerTimeMicros;
+  state.isFirstMovePending = true;
+  this->runningMacroCount++;
+}
+
+/**
+ * abort all running macros, except for the macro of the given switch id (if any)
+ */
+void ESPStepperMotorServer_MacroExecutor::abortAllMacros(byte keepRunningSwitchId)
+{
+  for (byte switchId = 0; switchId < ESPServerMaxSwitches; switchId++)
+  {
+    if (this->runStates[switchId].isRunning && switchId != keepRunningSwitchId)
+    {
+      ESPServerLogInfof("Aborting running macro of switch %i\n", switchId);
+      this->runStates[switchId].isRunning = false;
+      this->runningMacroCount--;
+    }
+  }
+}
+
+/**
+ * run the macro of the given switch until it has to wait, performed a jump, or used up its instruction budget
+ */
+void ESPStepperMotorServer_MacroExecutor::runMacroSlice(byte switchId)
+{
+  ESPStepperMotorServer_MacroRunState &state = this->runStates[switchId];
+  const unsigned int startIndex = this->macroStartIndex[switchId];
+  for (byte executedInstructions = 0; executedInstructions < ESPServerMacroMaxInstructionsPerSlice; executedInstructions++)
+  {
+    if (state.programCounter >= this->macroLength[switchId])
+    {
+      state.isRunning = false;
+      this->runningMacroCount--;
+      return;
+    }
+
+    const ESPStepperMotorServer_MacroInstruction &instruction = this->instructions[startIndex + state.programCounter];
+    switch (instruction.opcode)
+    {
+    case MacroActionType::waitUntilIdle:
+      if (!this->isStepperIdle(instruction))
+      {
+        state.isWaiting = true;
+        return;
+      }
+      break;
+    case MacroActionType::waitMs:
+      if (!state.isWaiting)
+      {
+        state.isWaiting = true;
+        state.waitStartMillis = millis();
+      }
+      if (millis() - state.waitStartMillis < (unsigned long)instruction.val2)
+      {
+        return;
+      }
+      break;
+    case MacroActionType::waitForSwitch:
+      if (this->serverRef->getPositionSwitchStatus(instruction.val1) != ((instruction.val2) ? 1 : 0))
+      {
+        state.isWaiting = true;
+        return;
+      }
+      break;
+    case MacroActionType::jumpIf:
+      if (instruction.val1 < 0 || this->serverRef->getPositionSwitchStatus(instruction.val1) == 1)
+      {
+        // a jump always ends the slice, so loops in a macro cannot block the other macros
+        state.isWaiting = false;
+        state.programCounter = instruction.val2;
+        return;
+      }
+      break;
+    case MacroActionType::moveBy:
+    case MacroActionType::moveTo:
+    {
+      const long startPosition = instruction.flexyStepper->getCurrentPositionInSteps();
+      if (this->executeMoveInstruction(instruction) && state.isFirstMovePending)
+      {
+        state.isFirstMovePending = false;
+        this->serverRef->getMotionController()->startFirstStepMeasurement(instruction.val1, startPosition, state.triggerTimeMicros);
+      }
+      break;
+    }
+    case MacroActionType::triggerEmergencyStop:
+      // the macro that triggers the emergency stop keeps running (e.g. to release it again later), all other macros are aborted
+      this->executeInstruction(instruction);
+      this->abortAllMacros(switchId);
+      this->wasEmergencyStopActive = true;
+      break;
+    default:
+      this->executeInstruction(instruction);
+      break;
+    }
+    state.isWaiting = false;
+    state.programCounter++;
+  }
+}
+
+bool ESPStepperMotorServer_MacroExecutor::isStepperIdle(const ESPStepperMotorServer_MacroInstruction &instruction)
+{
+  if (instruction.flexyStepper)
+  {
+    return instruction.flexyStepper->motionComplete();
+  }
+  // no stepper given, so check all steppers
+  ESPStepperMotorServer_Configuration *configuration = this->serverRef->getCurrentServerConfiguration();
+  ESPStepperMotorServer_ActiveAxis activeAxes[ESPServerMaxSteppers];
+  const byte activeAxisCount = configuration->copyActiveAxes(activeAxes);
+  for (byte i = 0; i < activeAxisCount; i++)
+  {
+    if (!activeAxes[i].flexyStepper->motionComplete())
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool ESPStepperMotorServer_MacroExecutor::executeMoveInstruction(const ESPStepperMotorServer_MacroInstruction &instruction)
+{
+  const long currentPosition = instruction.flexyStepper->getCurrentPositionInSteps();
+  long targetPosition = (instruction.opcode == MacroActionType::moveBy) ? currentPosition + instruction.val2 : instruction.val2;
+  if (instruction.stepperConfiguration->applySoftLimits(targetPosition) == ESPServerSoftLimitResult_Rejected)
+  {
+    ESPStepperMotorServer_Logger::logWarningf("Macro move action for stepper %i to position %ld has been rejected, since it is outside of the soft limits\n", instruction.val1, targetPosition);
+    return false;
+  }
+  // only the target is set here, the steps are generated by the motion controller task.
+  // Macros that need to wait for the movement to be completed use a waitUntilIdle action
+  instruction.flexyStepper->setTargetPositionInSteps(targetPosition);
+  return true;
+}
+
+void ESPStepperMotorServer_MacroExecutor::executeInstruction(const ESPStepperMotorServer_MacroInstruction &instruction)
+{
+  switch (instruction.opcode)
+  {
+  case MacroActionType::setSpeed:
+    instruction.flexyStepper->setSpeedInStepsPerSecond(instruction.val2);
+    break;
+  case MacroActionType::setAcceleration:
+    instruction.flexyStepper->setAccelerationInStepsPerSecondPerSecond((float)instruction.val2);
+    break;
+  case MacroActionType::setDeceleration:
+    instruction.flexyStepper->setDecelerationInStepsPerSecondPerSecond((float)instruction.val2);
+    break;
+  case MacroActionType::setHome:
+    instruction.flexyStepper->setCurrentPositionAsHomeAndStop();
+    break;
+  case MacroActionType::setLimitA:
+    instruction.flexyStepper->setLimitSwitchActive(ESP_FlexyStepper::LIMIT_SWITCH_BEGIN);
+    break;
+  case MacroActionType::setLimitB:
+    instruction.flexyStepper->setLimitSwitchActive(ESP_FlexyStepper::LIMIT_SWITCH_END);
+    break;
+  case MacroActionType::setOutputHigh:
+    digitalWrite(instruction.val1, HIGH);
+    break;
+  case MacroActionType::setOutputLow:
+    digitalWrite(instruction.val1, LOW);
+    break;
+  case MacroActionType::triggerEmergencyStop:
+    this->serverRef->performEmergencyStop();
+    break;
+  case MacroActionType::releaseEmergencyStop:
+    this->serverRef->revokeEmergencyStop();
+    break;
+  default:
+    break;
+  }
+}
+
+unsigned int ESPStepperMotorServer_MacroExecutor::getCompiledInstructionCount()
+{
+  return this->instructionCount;
+}
+
+byte ESPStepperMotorServer_MacroExecutor::getRunningMacroCount()
+{
+  return this->runningMacroCount;
+}
+
+/**
+ * returns the oldest configuration revision the executor task might still use
+ */
+unsigned int ESPStepperMotorServer_MacroExecutor::getAppliedConfigurationRevision()
+{
+  // an idle executor recompiles the macros before running the next instruction, so it does not use any old configuration
+  if (this->isWaitingForTrigger)
+  {
+    return this->serverRef->getCurrentServerConfiguration()->getConfigurationRevision();
+  }
+  return this->compiledConfigurationRevision;
+}
+
+bool ESPStepperMotorServer_MacroExecutor::isRunning() const
+{
+  return (this->xHandle != NULL);
+}
+
+unsigned long ESPStepperMotorServer_MacroExecutor::getLastDispatchLatencyMicros()
+{
+  return this->dispatchLatency.getLastMicros();
+}
+
+/**
+ * get the min/avg/max time between the switch edge being detected and the first instruction of the macro being dispatched
+ */
+const ESPStepperMotorServer_LatencyStatistics &ESPStepperMotorServer_MacroExecutor::getDispatchLatency() const
+{
+  return this->dispatchLatency;
+}
+
+// -------------------------------------- End --------------------------------------
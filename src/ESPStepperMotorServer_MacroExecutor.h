@@ -0,0 +1,139 @@
+//      ******************************************************************
+//      *                                                                *
+//      *    Header file for ESPStepperMotorServer_MacroExecutor.cpp     *
+//      *                                                                *
+//      *               Copyright (c) Paul Kerspe, 2019                  *
+//      *                                                                *
+//      ******************************************************************
+
+// MIT License
+//
+// Copyright (c) 2019 Paul Kerspe
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished
+// to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef ESPStepperMotorServer_MacroExecutor_h
+#define ESPStepperMotorServer_MacroExecutor_h
+
+#include <Arduino.h>
+#include <ESPStepperMotorServer.h>
+#include <ESPStepperMotorServer_Logger.h>
+#include <ESPStepperMotorServer_LatencyStatistics.h>
+#include <ESPStepperMotorServer_MacroAction.h>
+#include <ESP_FlexyStepper.h>
+
+// the number of switch triggers that can be queued up for the executor task before new triggers get dropped
+#define ESPServerMacroTriggerQueueLength 10
+// the maximum number of instructions a single macro may run before the next macro gets its turn
+#define ESPServerMacroMaxInstructionsPerSlice 16
+// opcode used for macro actions that could not be compiled (e.g. invalid stepper id), so jump targets keep matching the action indexes
+#define ESPServerMacroOpcodeNoOperation 255
+
+class ESPStepperMotorServer;
+
+// one compiled macro action. The target stepper is resolved once during compilation,
+// so the executor does not need to look up the stepper configuration when running the instruction
+struct ESPStepperMotorServer_MacroInstruction
+{
+  byte opcode; // one of the MacroActionType values
+  ESP_FlexyStepper *flexyStepper;
+  // needed to check move targets against the soft limits, which can change without a new configuration revision
+  ESPStepperMotorServer_StepperConfiguration *stepperConfiguration;
+  int val1;
+  long val2;
+};
+
+// the execution state of the macro of one switch
+struct ESPStepperMotorServer_MacroRunState
+{
+  bool isRunning;
+  bool isWaiting;
+  // index of the next instruction, relative to the start of the macro
+  unsigned int programCounter;
+  unsigned long waitStartMillis;
+  // the time the switch edge that started the macro has been detected
+  unsigned long triggerTimeMicros;
+  // true until the first move action of the macro has been run, only this move is passed on to the first step latency measurement
+  bool isFirstMovePending;
+};
+
+// the entry that is passed from the switch ISR to the executor task
+struct ESPStepperMotorServer_MacroTrigger
+{
+  byte switchId;
+  unsigned long triggerTimeMicros;
+};
+
+//
+// the ESPStepperMotorServer_MacroExecutor class
+// compiles the macro actions of all configured switches into one flat instruction array
+// and runs them in a dedicated task when a switch gets triggered.
+// Multiple macros can run at the same time, they are scheduled cooperatively: a macro runs until it
+// reaches a wait action whose condition is not met yet, a jump, or ESPServerMacroMaxInstructionsPerSlice instructions
+class ESPStepperMotorServer_MacroExecutor
+{
+public:
+  ESPStepperMotorServer_MacroExecutor(ESPStepperMotorServer *serverRef);
+  static void processMacroTriggers(void *parameter);
+  void start();
+  void stop();
+  bool triggerMacroFromISR(byte switchId);
+  bool triggerMacro(byte switchId);
+  unsigned int getCompiledInstructionCount();
+  byte getRunningMacroCount();
+  unsigned long getLastDispatchLatencyMicros();
+  const ESPStepperMotorServer_LatencyStatistics &getDispatchLatency() const;
+  unsigned int getAppliedConfigurationRevision();
+  bool isRunning() const;
+
+private:
+  void compileMacros();
+  void startMacro(byte switchId, unsigned long triggerTimeMicros);
+  void abortAllMacros(byte keepRunningSwitchId = ESPServerMaxSwitches);
+  void checkConfigurationRevision();
+  void checkEmergencyStop();
+  void runMacroSlice(byte switchId);
+  void executeInstruction(const ESPStepperMotorServer_MacroInstruction &instruction);
+  bool executeMoveInstruction(const ESPStepperMotorServer_MacroInstruction &instruction);
+  bool isStepperInstruction(byte opcode);
+  bool isStepperIdle(const ESPStepperMotorServer_MacroInstruction &instruction);
+
+  ESPStepperMotorServer *serverRef;
+  TaskHandle_t xHandle = NULL;
+  QueueHandle_t triggerQueue = NULL;
+  // the configuration revision the current instructions have been compiled from
+  unsigned int compiledConfigurationRevision = 0;
+  // true while the task waits for a trigger without any running macro, so it does not use the compiled instructions
+  volatile bool isWaitingForTrigger = false;
+
+  ESPStepperMotorServer_MacroInstruction instructions[ESPServerMaxMacroInstructions];
+  unsigned int instructionCount = 0;
+  // start index in the instructions array and number of instructions per switch id
+  unsigned int macroStartIndex[ESPServerMaxSwitches] = {0};
+  unsigned int macroLength[ESPServerMaxSwitches] = {0};
+  ESPStepperMotorServer_MacroRunState runStates[ESPServerMaxSwitches] = {};
+  byte runningMacroCount = 0;
+  // the emergency stop state seen in the previous executor loop, all running macros are aborted when an emergency stop gets triggered
+  bool wasEmergencyStopActive = false;
+  // the time between the switch edge being detected and the first instruction being dispatched, the time until the
+  // first step of the macro is measured by the motion controller (see ESPStepperMotorServer_MotionController::getMacroFirstStepLatency)
+  ESPStepperMotorServer_LatencyStatistics dispatchLatency;
+};
+
+#endif
@@ -29,6 +29,8 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+#define ESPServerLogModule ESPServerLogModule_MotionController
+
 #include <ESPStepperMotorServer_MotionController.h>
 
 //
@@ -38,16 +40,21 @@
 ESPStepperMotorServer_MotionController::ESPStepperMotorServer_MotionController(ESPStepperMotorServer *serverRef)
 {
   this->serverRef = serverRef;
-#ifndef ESPStepperMotorServer_COMPILE_NO_DEBUG
-  ESPStepperMotorServer_Logger::logDebug("Motor Controller created");
-#endif
+  ESPServerLogDebug("Motor Controller created");
 }
 
 void ESPStepperMotorServer_MotionController::start()
 {
   if (this->xHandle == NULL) //prevent multiple starts
   {
+    if (this->homingRequestQueue == NULL)
+    {
+      this->homingRequestQueue = xQueueCreate(ESPServerHomingRequestQueueLength, sizeof(ESPStepperMotorServer_HomingRequest));
+    }
     disableCore0WDT();
+#ifdef ESPStepperMotorServer_USE_SHIFT_REGISTER_OUTPUT
+    this->shiftRegisterOutput.begin(ESPServerShiftRegisterDataPin, ESPServerShiftRegisterClockPin, ESPServerShiftRegisterLatchPin);
+#endif
     xTaskCreate(
         ESPStepperMotorServer_MotionController::processMotionUpdates, /* Task function. */
         "MotionControl",                                              /* String with name of task. */
@@ -56,7 +63,7 @@ void ESPStepperMotorServer_MotionController::start()
         2,                                                            /* Priority of the task. */
         &this->xHandle);                                              /* Task handle. */
     //esp_task_wdt_delete(this->xHandle);
-    ESPStepperMotorServer_Logger::logInfo("Motion Controller task started");
+    ESPServerLogInfo("Motion Controller task started");
   }
 }
 
@@ -64,89 +71,618 @@ void ESPStepperMotorServer_MotionController::processMotionUpdates(void *paramete
 {
   ESPStepperMotorServer_MotionController *ref = static_cast<ESPStepperMotorServer_MotionController *>(parameter);
   ESPStepperMotorServer_Configuration *configuration = ref->serverRef->getCurrentServerConfiguration();
-  ESP_FlexyStepper **configuredFlexySteppers = configuration->getConfiguredFlexySteppers();
+  // the motion controller works on its own copy of the active axis index, which is refreshed whenever the configuration revision changes
+  ESPStepperMotorServer_ActiveAxis activeAxes[ESPServerMaxSteppers];
+  unsigned int activeAxisRevision = 0;
+  byte activeAxisCount = configuration->copyActiveAxes(activeAxes, &activeAxisRevision);
+  unsigned long loopCounter = 0;
+  unsigned long loopRateWindowStart = millis();
+  unsigned long now = 0;
   bool emergencySwitchFlag = false;
   bool allMovementsCompleted = true;
+  bool wasMoving = false;
+  ESPStepperMotorServer_PowerManager &powerManager = ref->powerManager;
+  ESPStepperMotorServer_PositionJournal *positionJournal = ref->serverRef->positionJournal;
 #ifndef ESPStepperMotorServer_COMPILE_NO_WEB
-  int updateCounter = 0;
+  unsigned long lastPositionUpdateMillis = 0;
+  ESPStepperMotorServer_EventPublisher *eventPublisher = ref->serverRef->eventPublisherHandler;
+  ESPStepperMotorServer_Event event;
+#endif
+  powerManager.syncConfiguration(configuration);
+#ifdef ESPStepperMotorServer_USE_SHIFT_REGISTER_OUTPUT
+  ref->shiftRegisterOutput.syncConfiguration(configuration);
 #endif
+  ref->appliedConfigurationRevision = activeAxisRevision;
+  ref->serverRef->releaseRetiredConfigurationEntities();
   while (true)
   {
     allMovementsCompleted = true;
+    if (configuration->getConfigurationRevision() != activeAxisRevision)
+    {
+      activeAxisCount = refreshActiveAxes(configuration, activeAxes, activeAxisCount, &activeAxisRevision);
+      if (ref->activeHomingCount > 0)
+      {
+        ref->cancelStaleHoming(configuration);
+      }
+    }
+    if (configuration->getConfigurationRevision() != powerManager.getConfigurationRevision())
+    {
+      powerManager.syncConfiguration(configuration);
+    }
+#ifdef ESPStepperMotorServer_USE_SHIFT_REGISTER_OUTPUT
+    if (configuration->getConfigurationRevision() != ref->shiftRegisterOutput.getConfigurationRevision())
+    {
+      ref->shiftRegisterOutput.syncConfiguration(configuration);
+    }
+#endif
+    if (ref->appliedConfigurationRevision != activeAxisRevision)
+    {
+      ref->appliedConfigurationRevision = activeAxisRevision;
+      // stepper configurations that have been removed with the previous revision are not used by this task anymore
+      ref->serverRef->releaseRetiredConfigurationEntities();
+    }
     //update positions of all steppers / trigger stepping if needed
-    for (byte i = 0; i < ESPServerMaxSteppers; i++)
+    for (byte i = 0; i < activeAxisCount; i++)
     {
-      if (configuredFlexySteppers[i])
+      wasMoving = activeAxes[i].isMoving;
+      // enable the driver and release the brake before the first step of a new movement is sent
+      if (powerManager.isPowerUpRequired(activeAxes[i].stepperId) && !activeAxes[i].flexyStepper->motionComplete())
       {
-        if (!configuredFlexySteppers[i]->processMovement())
-        {
-          allMovementsCompleted = false;
-        }
+        powerManager.powerUp(activeAxes[i].stepperId);
       }
-      else
+      // no steps are sent until the driver is awake and the brake is released
+      if (!powerManager.isReadyToMove(activeAxes[i].stepperId))
       {
-        break;
+        allMovementsCompleted = false;
+        continue;
+      }
+      // the stored positions are not valid anymore once a stepper starts moving, so the clean shutdown marker is removed before the first step
+      if (positionJournal && positionJournal->isCleanShutdownMarkerSet() && !activeAxes[i].flexyStepper->motionComplete())
+      {
+        positionJournal->removeCleanShutdownMarker();
       }
+      activeAxes[i].isMoving = !activeAxes[i].flexyStepper->processMovement();
+      if (activeAxes[i].isMoving)
+      {
+        allMovementsCompleted = false;
+      }
+      else if (wasMoving)
+      {
+        powerManager.onMotionStopped(activeAxes[i].stepperId, millis());
+#ifndef ESPStepperMotorServer_COMPILE_NO_WEB
+        if (eventPublisher)
+        {
+          event = {ESPServerEventType_MotionComplete, activeAxes[i].stepperId, false, activeAxes[i].flexyStepper->getCurrentPositionInSteps(), millis()};
+          eventPublisher->publish(event);
+        }
+#endif
+      }
+    }
+#ifdef ESPStepperMotorServer_USE_SHIFT_REGISTER_OUTPUT
+    // queues the steps for the output task, only waits if the steps exceed the rate of the shift register chain
+    ref->shiftRegisterOutput.update(activeAxes, activeAxisCount);
+#endif
+    if (ref->hasPendingFirstStepMeasurement)
+    {
+      ref->processFirstStepMeasurement(activeAxes, activeAxisCount);
+    }
+    if (powerManager.hasPendingIdleTimers())
+    {
+      powerManager.processIdleTimers(millis());
+    }
+
+    if (ref->trajectoryRecorder.getState() == ESPServerTrajectoryState_Recording)
+    {
+      ref->trajectoryRecorder.recordSamples(activeAxes, activeAxisCount);
+    }
+    else if (ref->trajectoryRecorder.getState() == ESPServerTrajectoryState_Replaying)
+    {
+      ref->trajectoryRecorder.processReplay(configuration);
+    }
+
+    if (ref->hasPendingHomingRequests)
+    {
+      ref->processHomingRequests();
+    }
+    if (ref->activeHomingCount > 0)
+    {
+      ref->processHoming();
+    }
+
+    if (positionJournal)
+    {
+      positionJournal->update(configuration, allMovementsCompleted);
     }
 
     if (allMovementsCompleted && ref->serverRef->_isRebootScheduled)
     {
       //going for reboot since all motion is stopped and reboot has been requested
+      if (positionJournal)
+      {
+        positionJournal->writePositions(configuration);
+        positionJournal->flush();
+      }
       Serial.println("Rebooting server now");
       ESP.restart();
     }
 
+    //the loop rate is only calculated every 1024 iterations to keep the overhead of reading the clock low
+    loopCounter++;
+    if ((loopCounter & 0x3FF) == 0)
+    {
+      now = millis();
+      if (now - loopRateWindowStart >= 1000)
+      {
+        ref->loopRate = loopCounter * 1000 / (now - loopRateWindowStart);
+        loopCounter = 0;
+        loopRateWindowStart = now;
+      }
+    }
+
     //check for emergency switch
     if (ref->serverRef->emergencySwitchIsActive && !emergencySwitchFlag)
     {
       emergencySwitchFlag = true;
-      ESPStepperMotorServer_Logger::logInfo("Emergency Switch triggered");
+      ESPServerLogInfo("Emergency Switch triggered");
+      ref->abortAllHoming();
+      ref->trajectoryRecorder.stop();
+#ifndef ESPStepperMotorServer_COMPILE_NO_WEB
+      if (eventPublisher)
+      {
+        event = {ESPServerEventType_EmergencyStop, 0, true, 0, millis()};
+        eventPublisher->publish(event);
+      }
+#endif
     }
     else if (!ref->serverRef->emergencySwitchIsActive && emergencySwitchFlag)
     {
       emergencySwitchFlag = false;
+#ifndef ESPStepperMotorServer_COMPILE_NO_WEB
+      if (eventPublisher)
+      {
+        event = {ESPServerEventType_EmergencyStop, 0, false, 0, millis()};
+        eventPublisher->publish(event);
+      }
+#endif
     }
 
 #ifndef ESPStepperMotorServer_COMPILE_NO_WEB
     //check if we should send updated position information via websocket
     if (ref->serverRef->isWebserverEnabled)
     {
-      updateCounter++;
-      //we only send sproadically to reduce load and processing times
-      if (updateCounter % 200000 == 0 && ref->serverRef->webSockerServer->count() > 0)
+      //we only send sproadically to reduce load and processing times, the clock is only read every 1024 iterations (see loop rate above)
+      if ((loopCounter & 0x3FF) == 0 && now - lastPositionUpdateMillis >= ESPServerPositionUpdateIntervalMs && ref->serverRef->webSockerServer->count() > 0)
       {
+        lastPositionUpdateMillis = now;
         String positionsString = String("{");
         char segmentBuffer[500];
         bool isFirstSegment = true;
-        for (byte n = 0; n < ESPServerMaxSteppers; n++)
+        for (byte n = 0; n < activeAxisCount; n++)
         {
-          if (configuredFlexySteppers[n])
+          if (!isFirstSegment)
           {
-            if (!isFirstSegment)
-            {
-              positionsString += ",";
-            }
-            sprintf(segmentBuffer, "\"s%ipos\":%ld, \"s%ivel\":%.3f", n, configuredFlexySteppers[n]->getCurrentPositionInSteps(), n, configuredFlexySteppers[n]->getCurrentVelocityInStepsPerSecond());
-            //maybe register as friendly class and access property directly and save some processing time
-            positionsString += segmentBuffer;
-            isFirstSegment = false;
+            positionsString += ",";
           }
+          sprintf(segmentBuffer, "\"s%ipos\":%ld, \"s%ivel\":%.3f", activeAxes[n].stepperId, activeAxes[n].flexyStepper->getCurrentPositionInSteps(), activeAxes[n].stepperId, activeAxes[n].flexyStepper->getCurrentVelocityInStepsPerSecond());
+          //maybe register as friendly class and access property directly and save some processing time
+          positionsString += segmentBuffer;
+          isFirstSegment = false;
         }
         positionsString += "}";
 
         ref->serverRef->sendSocketMessageToAllClients(positionsString.c_str(), positionsString.length());
-        updateCounter = 0;
       }
     }
 #endif
   }
 }
 
+//
+// copy the current active axis index of the configuration into the given array.
+// The moving state of axes that are still configured with the same flexy stepper instance is kept,
+// so no motion complete event is lost or sent twice due to a configuration change
+//
+byte ESPStepperMotorServer_MotionController::refreshActiveAxes(ESPStepperMotorServer_Configuration *configuration, ESPStepperMotorServer_ActiveAxis *activeAxes, byte activeAxisCount, unsigned int *revision)
+{
+  ESPStepperMotorServer_ActiveAxis updatedActiveAxes[ESPServerMaxSteppers];
+  const byte updatedActiveAxisCount = configuration->copyActiveAxes(updatedActiveAxes, revision);
+  for (byte i = 0; i < updatedActiveAxisCount; i++)
+  {
+    for (byte n = 0; n < activeAxisCount; n++)
+    {
+      if (activeAxes[n].flexyStepper == updatedActiveAxes[i].flexyStepper && activeAxes[n].stepperId == updatedActiveAxes[i].stepperId)
+      {
+        updatedActiveAxes[i].isMoving = activeAxes[n].isMoving;
+        break;
+      }
+    }
+  }
+  memcpy(activeAxes, updatedActiveAxes, updatedActiveAxisCount * sizeof(ESPStepperMotorServer_ActiveAxis));
+  return updatedActiveAxisCount;
+}
+
+unsigned int ESPStepperMotorServer_MotionController::getAppliedConfigurationRevision() const
+{
+  return this->appliedConfigurationRevision;
+}
+
+bool ESPStepperMotorServer_MotionController::isRunning() const
+{
+  return (this->xHandle != NULL);
+}
+
+unsigned long ESPStepperMotorServer_MotionController::getLoopRate() const
+{
+  return this->loopRate;
+}
+
+/**
+ * measure the time from the given trigger time until the motion controller sends the first step of the given stepper.
+ * Called by the macro executor after it has set the target of a macro move, startPosition is the position before the target has been set
+ */
+void ESPStepperMotorServer_MotionController::startFirstStepMeasurement(byte stepperId, long startPosition, unsigned long triggerTimeMicros)
+{
+  portENTER_CRITICAL(&this->firstStepMux);
+  this->firstStepStepperId = stepperId;
+  this->firstStepStartPosition = startPosition;
+  this->firstStepTriggerTimeMicros = triggerTimeMicros;
+  this->hasPendingFirstStepMeasurement = true;
+  portEXIT_CRITICAL(&this->firstStepMux);
+}
+
+/**
+ * get the min/avg/max time between the switch edge that started a macro and the first step of its first move action.
+ * With the shift register output the step is written to the outputs ESPServerShiftRegisterLatencyMicros later
+ */
+const ESPStepperMotorServer_LatencyStatistics &ESPStepperMotorServer_MotionController::getMacroFirstStepLatency() const
+{
+  return this->macroFirstStepLatency;
+}
+
+void ESPStepperMotorServer_MotionController::processFirstStepMeasurement(const ESPStepperMotorServer_ActiveAxis *activeAxes, byte activeAxisCount)
+{
+  portENTER_CRITICAL(&this->firstStepMux);
+  const byte stepperId = this->firstStepStepperId;
+  const long startPosition = this->firstStepStartPosition;
+  const unsigned long triggerTimeMicros = this->firstStepTriggerTimeMicros;
+  portEXIT_CRITICAL(&this->firstStepMux);
+
+  for (byte i = 0; i < activeAxisCount; i++)
+  {
+    if (activeAxes[i].stepperId != stepperId)
+    {
+      continue;
+    }
+    if (activeAxes[i].flexyStepper->getCurrentPositionInSteps() != startPosition)
+    {
+      this->macroFirstStepLatency.addSample(micros() - triggerTimeMicros);
+    }
+    else if (!activeAxes[i].flexyStepper->motionComplete())
+    {
+      // still waiting for the first step (e.g. until the driver is enabled)
+      return;
+    }
+    // the measurement is also dropped if the move ended without a step (target was the current position or the move was stopped)
+    break;
+  }
+  // a newer measurement might have been started in the meantime, it must not be dropped
+  portENTER_CRITICAL(&this->firstStepMux);
+  if (this->firstStepStepperId == stepperId && this->firstStepTriggerTimeMicros == triggerTimeMicros)
+  {
+    this->hasPendingFirstStepMeasurement = false;
+  }
+  portEXIT_CRITICAL(&this->firstStepMux);
+}
+
 void ESPStepperMotorServer_MotionController::stop()
 {
   vTaskDelete(this->xHandle);
   this->xHandle = NULL;
-  ESPStepperMotorServer_Logger::logInfo("Motion Controller stopped");
+#ifdef ESPStepperMotorServer_USE_SHIFT_REGISTER_OUTPUT
+  this->shiftRegisterOutput.end();
+#endif
+  ESPServerLogInfo("Motion Controller stopped");
+}
+
+/**
+ * start the homing procedure for the given stepper using the given limit switch.
+ * The procedure runs in the motion controller task, multiple steppers can be homed in parallel.
+ * If a group number larger than 0 is given, the homing is started once all other homing procedures are finished
+ * and no request with a lower group number is waiting. If one stepper of a group fails, all waiting requests are dropped.
+ * Returns false if the request could not be queued (motion controller not started or too many pending requests)
+ */
+bool ESPStepperMotorServer_MotionController::startHoming(byte stepperId, byte switchId, const ESPStepperMotorServer_HomingParameters &parameters, byte group)
+{
+  if (stepperId >= ESPServerMaxSteppers)
+  {
+    ESPStepperMotorServer_Logger::logWarningf("Invalid stepper id %i for homing request\n", stepperId);
+    return false;
+  }
+  ESPStepperMotorServer_HomingRequest request = {stepperId, switchId, 0, group, parameters};
+  return this->queueHomingRequest(request);
+}
+
+/**
+ * abort the homing procedure of the given stepper, or of all steppers if ESPServerHomingAllSteppers is given.
+ * Homing requests that have been queued before and are not yet started are dropped as well.
+ * The abort does not use the request queue, so it cannot fail due to a full queue
+ */
+bool ESPStepperMotorServer_MotionController::abortHoming(byte stepperId)
+{
+  if (stepperId >= ESPServerMaxSteppers && stepperId != ESPServerHomingAllSteppers)
+  {
+    return false;
+  }
+  portENTER_CRITICAL(&this->homingAbortMux);
+  if (stepperId == ESPServerHomingAllSteppers)
+  {
+    this->allHomingAbortCount++;
+  }
+  else
+  {
+    this->homingAbortCounts[stepperId]++;
+  }
+  portEXIT_CRITICAL(&this->homingAbortMux);
+  this->hasPendingHomingRequests = true;
+  return true;
+}
+
+/**
+ * get the current phase of the homing procedure of the given stepper (one of the ESPServerHomingPhase_* values).
+ * The last phase is kept after the homing procedure has been finished, until the next homing is started
+ */
+byte ESPStepperMotorServer_MotionController::getHomingPhase(byte stepperId)
+{
+  if (stepperId >= ESPServerMaxSteppers)
+  {
+    return ESPServerHomingPhase_Idle;
+  }
+  return this->homingStateMachines[stepperId].getPhase();
+}
+
+/**
+ * get the number of homing procedures that have been started for the given stepper
+ */
+unsigned int ESPStepperMotorServer_MotionController::getHomingStartCount(byte stepperId)
+{
+  if (stepperId >= ESPServerMaxSteppers)
+  {
+    return 0;
+  }
+  return this->homingStartCounts[stepperId];
+}
+
+/**
+ * get the power manager that drives the brake and driver enable pins of all steppers
+ */
+const ESPStepperMotorServer_PowerManager &ESPStepperMotorServer_MotionController::getPowerManager() const
+{
+  return this->powerManager;
+}
+
+ESPStepperMotorServer_TrajectoryRecorder &ESPStepperMotorServer_MotionController::getTrajectoryRecorder()
+{
+  return this->trajectoryRecorder;
+}
+
+bool ESPStepperMotorServer_MotionController::queueHomingRequest(ESPStepperMotorServer_HomingRequest &request)
+{
+  request.abortCount = this->getHomingAbortCount(request.stepperId);
+  if (this->homingRequestQueue == NULL || xQueueSend(this->homingRequestQueue, &request, 0) != pdTRUE)
+  {
+    ESPStepperMotorServer_Logger::logWarningf("Homing request for stepper %i could not be queued\n", request.stepperId);
+    return false;
+  }
+  this->hasPendingHomingRequests = true;
+  return true;
+}
+
+unsigned int ESPStepperMotorServer_MotionController::getHomingAbortCount(byte stepperId)
+{
+  portENTER_CRITICAL(&this->homingAbortMux);
+  const unsigned int abortCount = this->allHomingAbortCount + this->homingAbortCounts[stepperId];
+  portEXIT_CRITICAL(&this->homingAbortMux);
+  return abortCount;
+}
+
+void ESPStepperMotorServer_MotionController::processHomingAborts()
+{
+  if (this->allHomingAbortCount != this->processedAllHomingAbortCount)
+  {
+    this->processedAllHomingAbortCount = this->allHomingAbortCount;
+    this->abortAllHoming();
+  }
+  for (byte stepperId = 0; stepperId < ESPServerMaxSteppers; stepperId++)
+  {
+    if (this->homingAbortCounts[stepperId] != this->processedHomingAbortCounts[stepperId])
+    {
+      this->processedHomingAbortCounts[stepperId] = this->homingAbortCounts[stepperId];
+      this->removeWaitingHomingRequest(stepperId);
+      if (this->homingStateMachines[stepperId].isActive())
+      {
+        this->homingStateMachines[stepperId].abort();
+        this->activeHomingCount--;
+        this->publishHomingPhase(stepperId);
+      }
+    }
+  }
+}
+
+void ESPStepperMotorServer_MotionController::processHomingRequests()
+{
+  this->hasPendingHomingRequests = false;
+  // aborts are processed first, start requests that have been queued before an abort are dropped below
+  this->processHomingAborts();
+  ESPStepperMotorServer_HomingRequest request;
+  while (xQueueReceive(this->homingRequestQueue, &request, 0) == pdTRUE)
+  {
+    if (request.abortCount != this->getHomingAbortCount(request.stepperId))
+    {
+      ESPServerLogDebugf("Dropping homing request for stepper %i, since the homing has been aborted after the request was queued\n", request.stepperId);
+    }
+    else if (request.group > 0)
+    {
+      // a newer request for the same stepper replaces the waiting one
+      this->removeWaitingHomingRequest(request.stepperId);
+      if (this->waitingHomingRequestCount < ESPServerMaxSteppers)
+      {
+        this->waitingHomingRequests[this->waitingHomingRequestCount++] = request;
+      }
+    }
+    else
+    {
+      this->startHomingStateMachine(request);
+    }
+  }
+  this->startNextHomingGroup();
+}
+
+void ESPStepperMotorServer_MotionController::startHomingStateMachine(const ESPStepperMotorServer_HomingRequest &request)
+{
+  ESPStepperMotorServer_Configuration *configuration = this->serverRef->getCurrentServerConfiguration();
+  ESPStepperMotorServer_StepperConfiguration *stepper = configuration->getStepperConfiguration(request.stepperId);
+  ESPStepperMotorServer_PositionSwitch *limitSwitch = configuration->getSwitch(request.switchId);
+  if (stepper == NULL || limitSwitch == NULL)
+  {
+    ESPStepperMotorServer_Logger::logWarningf("Ignoring homing request for stepper %i with switch %i, since one of them is not configured\n", request.stepperId, request.switchId);
+    return;
+  }
+  ESPStepperMotorServer_HomingStateMachine &stateMachine = this->homingStateMachines[request.stepperId];
+  if (!stateMachine.isActive())
+  {
+    this->activeHomingCount++;
+  }
+  this->homingSwitchPins[request.stepperId] = limitSwitch->getIoPinNumber();
+  this->homingSwitchActiveHigh[request.stepperId] = limitSwitch->isActiveHigh();
+  stateMachine.start(stepper->getFlexyStepper(), request.parameters);
+  this->homingStartCounts[request.stepperId]++;
+  ESPServerLogInfof("Homing of stepper %i started\n", request.stepperId);
+  this->publishHomingPhase(request.stepperId);
+}
+
+/**
+ * start all waiting homing requests with the lowest group number, if no homing is running anymore.
+ * If none of the requests of a group could be started (e.g. the stepper has been removed in the meantime), the next group is started
+ */
+void ESPStepperMotorServer_MotionController::startNextHomingGroup()
+{
+  while (this->activeHomingCount == 0 && this->waitingHomingRequestCount > 0)
+  {
+    byte nextGroup = 255;
+    for (byte i = 0; i < this->waitingHomingRequestCount; i++)
+    {
+      if (this->waitingHomingRequests[i].group < nextGroup)
+      {
+        nextGroup = this->waitingHomingRequests[i].group;
+      }
+    }
+    ESPServerLogDebugf("Starting homing group %i\n", nextGroup);
+    byte remainingCount = 0;
+    for (byte i = 0; i < this->waitingHomingRequestCount; i++)
+    {
+      if (this->waitingHomingRequests[i].group == nextGroup)
+      {
+        this->startHomingStateMachine(this->waitingHomingRequests[i]);
+      }
+      else
+      {
+        this->waitingHomingRequests[remainingCount++] = this->waitingHomingRequests[i];
+      }
+    }
+    this->waitingHomingRequestCount = remainingCount;
+  }
+}
+
+void ESPStepperMotorServer_MotionController::removeWaitingHomingRequest(byte stepperId)
+{
+  byte remainingCount = 0;
+  for (byte i = 0; i < this->waitingHomingRequestCount; i++)
+  {
+    if (this->waitingHomingRequests[i].stepperId != stepperId)
+    {
+      this->waitingHomingRequests[remainingCount++] = this->waitingHomingRequests[i];
+    }
+  }
+  this->waitingHomingRequestCount = remainingCount;
+}
+
+void ESPStepperMotorServer_MotionController::processHoming()
+{
+  for (byte stepperId = 0; stepperId < ESPServerMaxSteppers; stepperId++)
+  {
+    ESPStepperMotorServer_HomingStateMachine &stateMachine = this->homingStateMachines[stepperId];
+    if (stateMachine.isActive())
+    {
+      bool isSwitchActive = (digitalRead(this->homingSwitchPins[stepperId]) == this->homingSwitchActiveHigh[stepperId]);
+      if (stateMachine.process(isSwitchActive))
+      {
+        if (!stateMachine.isActive())
+        {
+          this->activeHomingCount--;
+          ESPServerLogInfof("Homing of stepper %i finished with result: %s\n", stepperId, ESPStepperMotorServer_HomingStateMachine::getPhaseName(stateMachine.getPhase()));
+          if (stateMachine.getPhase() != ESPServerHomingPhase_Completed && this->waitingHomingRequestCount > 0)
+          {
+            ESPStepperMotorServer_Logger::logWarningf("Homing of stepper %i failed, the remaining %i steppers of the homing sequence will not be homed\n", stepperId, this->waitingHomingRequestCount);
+            this->waitingHomingRequestCount = 0;
+          }
+        }
+        this->publishHomingPhase(stepperId);
+      }
+    }
+  }
+  this->startNextHomingGroup();
+}
+
+void ESPStepperMotorServer_MotionController::abortAllHoming()
+{
+  for (byte stepperId = 0; stepperId < ESPServerMaxSteppers; stepperId++)
+  {
+    if (this->homingStateMachines[stepperId].isActive())
+    {
+      this->homingStateMachines[stepperId].abort();
+      this->publishHomingPhase(stepperId);
+    }
+  }
+  this->activeHomingCount = 0;
+  this->waitingHomingRequestCount = 0;
+}
+
+//
+// cancel all homing procedures of steppers that have been removed or replaced with a new configuration.
+// Must be called before the retired stepper configurations are released, since the state machines still hold the flexy stepper of the old configuration
+//
+void ESPStepperMotorServer_MotionController::cancelStaleHoming(ESPStepperMotorServer_Configuration *configuration)
+{
+  for (byte stepperId = 0; stepperId < ESPServerMaxSteppers; stepperId++)
+  {
+    ESPStepperMotorServer_HomingStateMachine &stateMachine = this->homingStateMachines[stepperId];
+    if (!stateMachine.isActive())
+    {
+      continue;
+    }
+    ESPStepperMotorServer_StepperConfiguration *stepper = configuration->getStepperConfiguration(stepperId);
+    if (stepper == NULL || stepper->getFlexyStepper() != stateMachine.getFlexyStepper())
+    {
+      ESPStepperMotorServer_Logger::logWarningf("Homing of stepper %i canceled, since the stepper configuration has been changed\n", stepperId);
+      stateMachine.cancel();
+      this->activeHomingCount--;
+      this->removeWaitingHomingRequest(stepperId);
+      this->publishHomingPhase(stepperId);
+    }
+  }
+  this->startNextHomingGroup();
+}
+
+void ESPStepperMotorServer_MotionController::publishHomingPhase(byte stepperId)
+{
+#ifndef ESPStepperMotorServer_COMPILE_NO_WEB
+  if (this->serverRef->eventPublisherHandler)
+  {
+    const ESPStepperMotorServer_HomingStateMachine &stateMachine = this->homingStateMachines[stepperId];
+    ESPStepperMotorServer_Event event = {ESPServerEventType_Homing, stepperId, stateMachine.isActive(), stateMachine.getPhase(), millis()};
+    this->serverRef->eventPublisherHandler->publish(event);
+  }
+#endif
 }
 
 // -------------------------------------- End --------------------------------------
@@ -34,10 +34,37 @@
 #include <Arduino.h>
 #include <ESPStepperMotorServer.h>
 #include <ESPStepperMotorServer_Logger.h>
+#include <ESPStepperMotorServer_Homing.h>
+#include <ESPStepperMotorServer_LatencyStatistics.h>
+#include <ESPStepperMotorServer_PowerManager.h>
+#include <ESPStepperMotorServer_TrajectoryRecorder.h>
+#include <ESPStepperMotorServer_ShiftRegisterOutput.h>
 #include <ESP_FlexyStepper.h>
 
+// the number of homing start requests that can be queued up for the motion controller task
+#define ESPServerHomingRequestQueueLength (2 * ESPServerMaxSteppers)
+// stepper id used to abort the homing procedures of all steppers
+#define ESPServerHomingAllSteppers 255
+// the interval in ms the positions and velocities of all steppers are sent to the clients of the web socket
+#ifndef ESPServerPositionUpdateIntervalMs
+#define ESPServerPositionUpdateIntervalMs 500
+#endif
+
 class ESPStepperMotorServer;
 
+// the entry that is passed from the REST API (or user code) to the motion controller task to start a homing procedure
+struct ESPStepperMotorServer_HomingRequest
+{
+  byte stepperId;
+  byte switchId;
+  // sum of the abort counters of the stepper at the time the request was queued, the request is dropped if an abort has been requested since then
+  unsigned int abortCount;
+  // 0 to start the homing directly. Requests with a group number are started once no other homing is running,
+  // all requests with the lowest group number are started together
+  byte group;
+  ESPStepperMotorServer_HomingParameters parameters;
+};
+
 class ESPStepperMotorServer_MotionController
 {
 public:
@@ -45,10 +72,71 @@ public:
   static void processMotionUpdates(void *parameter);
   void start();
   void stop();
+  bool startHoming(byte stepperId, byte switchId, const ESPStepperMotorServer_HomingParameters &parameters, byte group = 0);
+  bool abortHoming(byte stepperId = ESPServerHomingAllSteppers);
+  byte getHomingPhase(byte stepperId);
+  unsigned int getHomingStartCount(byte stepperId);
+  const ESPStepperMotorServer_PowerManager &getPowerManager() const;
+  ESPStepperMotorServer_TrajectoryRecorder &getTrajectoryRecorder();
+  unsigned int getAppliedConfigurationRevision() const;
+  bool isRunning() const;
+  unsigned long getLoopRate() const;
+  void startFirstStepMeasurement(byte stepperId, long startPosition, unsigned long triggerTimeMicros);
+  const ESPStepperMotorServer_LatencyStatistics &getMacroFirstStepLatency() const;
 
 private:
+  static byte refreshActiveAxes(ESPStepperMotorServer_Configuration *configuration, ESPStepperMotorServer_ActiveAxis *activeAxes, byte activeAxisCount, unsigned int *revision);
+  bool queueHomingRequest(ESPStepperMotorServer_HomingRequest &request);
+  unsigned int getHomingAbortCount(byte stepperId);
+  void processHomingAborts();
+  void processHomingRequests();
+  void startHomingStateMachine(const ESPStepperMotorServer_HomingRequest &request);
+  void startNextHomingGroup();
+  void removeWaitingHomingRequest(byte stepperId);
+  void processHoming();
+  void abortAllHoming();
+  void cancelStaleHoming(ESPStepperMotorServer_Configuration *configuration);
+  void publishHomingPhase(byte stepperId);
+  void processFirstStepMeasurement(const ESPStepperMotorServer_ActiveAxis *activeAxes, byte activeAxisCount);
+
   TaskHandle_t xHandle = NULL;
   ESPStepperMotorServer *serverRef;
+  QueueHandle_t homingRequestQueue = NULL;
+  volatile bool hasPendingHomingRequests = false;
+  // aborts are not queued, so they also work while the request queue is full: the abort counters are incremented by abortHoming()
+  // and compared with the counters that have already been processed by the motion controller task
+  portMUX_TYPE homingAbortMux = portMUX_INITIALIZER_UNLOCKED;
+  volatile unsigned int homingAbortCounts[ESPServerMaxSteppers] = {0};
+  volatile unsigned int allHomingAbortCount = 0;
+  unsigned int processedHomingAbortCounts[ESPServerMaxSteppers] = {0};
+  unsigned int processedAllHomingAbortCount = 0;
+  // the homing procedures are run by the motion controller task, so all axes can be homed in parallel
+  ESPStepperMotorServer_HomingStateMachine homingStateMachines[ESPServerMaxSteppers];
+  byte homingSwitchPins[ESPServerMaxSteppers] = {0};
+  bool homingSwitchActiveHigh[ESPServerMaxSteppers] = {false};
+  // incremented whenever a homing procedure has been started, so callers can tell a new result from the result of a previous homing
+  volatile unsigned int homingStartCounts[ESPServerMaxSteppers] = {0};
+  byte activeHomingCount = 0;
+  // the configuration revision the motion controller task is currently working with
+  volatile unsigned int appliedConfigurationRevision = 0;
+  // number of motion loop iterations per second, measured over the last second
+  volatile unsigned long loopRate = 0;
+  // the first step after a macro move is detected by the position change of its stepper, the time since the switch edge is added to the statistics.
+  // Only one measurement is pending at a time, a newer macro move replaces it
+  portMUX_TYPE firstStepMux = portMUX_INITIALIZER_UNLOCKED;
+  volatile bool hasPendingFirstStepMeasurement = false;
+  byte firstStepStepperId = 0;
+  long firstStepStartPosition = 0;
+  unsigned long firstStepTriggerTimeMicros = 0;
+  ESPStepperMotorServer_LatencyStatistics macroFirstStepLatency;
+  ESPStepperMotorServer_PowerManager powerManager;
+  ESPStepperMotorServer_TrajectoryRecorder trajectoryRecorder;
+#ifdef ESPStepperMotorServer_USE_SHIFT_REGISTER_OUTPUT
+  ESPStepperMotorServer_ShiftRegisterOutput shiftRegisterOutput;
+#endif
+  // requests of a homing sequence that wait for the previous group to be completed
+  ESPStepperMotorServer_HomingRequest waitingHomingRequests[ESPServerMaxSteppers];
+  byte waitingHomingRequestCount = 0;
 };
 
 #endif
\ No newline at end of file
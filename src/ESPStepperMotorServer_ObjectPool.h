@@ -0,0 +1,209 @@
+//      ******************************************************************
+//      *                                                                *
+//      *      Header file for ESPStepperMotorServer_ObjectPool          *
+//      *                                                                *
+//      *               Copyright (c) Paul Kerspe, 2019                  *
+//      *                                                                *
+//      ******************************************************************
+
+// fixed capacity object pool used for the configuration entities that are created at runtime
+// (when loading the configuration or when changing it via the REST API / web UI).
+// Reusing the same slots prevents the heap from fragmenting on long running servers that get reconfigured often.
+
+// MIT License
+//
+// Copyright (c) 2019 Paul Kerspe
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished
+// to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef ESPStepperMotorServer_ObjectPool_h
+#define ESPStepperMotorServer_ObjectPool_h
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+//
+// the ESPStepperMotorServer_ObjectPool class
+// objects are constructed in place in a static slot array, free slots are kept in a singly linked free list.
+// If the pool is exhausted, create() falls back to a regular heap allocation (counted as overflow), so callers never get NULL.
+// Heap allocated overflow objects are kept in a linked list, so release() can tell them apart from objects created by the user
+template <typename T, unsigned int Capacity>
+class ESPStepperMotorServer_ObjectPool
+{
+  static_assert(Capacity > 0, "ESPStepperMotorServer_ObjectPool needs a capacity of at least 1");
+
+public:
+  ESPStepperMotorServer_ObjectPool()
+  {
+    for (unsigned int i = 0; i < Capacity; i++)
+    {
+      this->nextFreeSlot[i] = i + 1;
+    }
+    this->firstFreeSlot = 0;
+  }
+
+  template <typename... Args>
+  T *create(Args &&... args)
+  {
+    unsigned int slot;
+    portENTER_CRITICAL(&this->mux);
+    slot = this->firstFreeSlot;
+    if (slot < Capacity)
+    {
+      this->firstFreeSlot = this->nextFreeSlot[slot];
+      this->usedSlots++;
+      if (this->usedSlots > this->highWatermark)
+      {
+        this->highWatermark = this->usedSlots;
+      }
+    }
+    else
+    {
+      this->overflowCounter++;
+    }
+    portEXIT_CRITICAL(&this->mux);
+
+    if (slot >= Capacity)
+    {
+      OverflowNode *node = new OverflowNode();
+      T *object = new (&node->storage) T(std::forward<Args>(args)...);
+      portENTER_CRITICAL(&this->mux);
+      node->next = this->firstOverflowNode;
+      this->firstOverflowNode = node;
+      portEXIT_CRITICAL(&this->mux);
+      return object;
+    }
+    return new (&this->slots[slot]) T(std::forward<Args>(args)...);
+  }
+
+  /**
+   * returns true if the given object has been created in one of the slots of this pool
+   */
+  bool isPoolObject(const T *object) const
+  {
+    const unsigned char *address = reinterpret_cast<const unsigned char *>(object);
+    const unsigned char *begin = reinterpret_cast<const unsigned char *>(&this->slots[0]);
+    const unsigned char *end = reinterpret_cast<const unsigned char *>(&this->slots[Capacity]);
+    return (address >= begin && address < end);
+  }
+
+  /**
+   * destroy the given object and return its slot to the pool (or free its heap memory, if it has been created after the pool was exhausted).
+   * Objects that have not been created by the pool (e.g. created by the user with new or on the stack) are not touched,
+   * since the server does not own them. Returns true if the object has been released
+   */
+  bool release(T *object)
+  {
+    if (object == NULL)
+    {
+      return false;
+    }
+    if (!this->isPoolObject(object))
+    {
+      return this->releaseOverflowObject(object);
+    }
+    unsigned int slot = (unsigned int)(reinterpret_cast<SlotStorage *>(object) - &this->slots[0]);
+    object->~T();
+    portENTER_CRITICAL(&this->mux);
+    this->nextFreeSlot[slot] = this->firstFreeSlot;
+    this->firstFreeSlot = slot;
+    this->usedSlots--;
+    portEXIT_CRITICAL(&this->mux);
+    return true;
+  }
+
+  unsigned int getCapacity() const
+  {
+    return Capacity;
+  }
+
+  unsigned int getUsedCount() const
+  {
+    return this->usedSlots;
+  }
+
+  unsigned int getHighWatermark() const
+  {
+    return this->highWatermark;
+  }
+
+  /**
+   * number of objects that had to be allocated on the heap since the pool was exhausted
+   */
+  unsigned int getOverflowCount() const
+  {
+    return this->overflowCounter;
+  }
+
+  void addStatisticsToJsonObject(JsonObject statistics) const
+  {
+    statistics["capacity"] = Capacity;
+    statistics["used"] = this->usedSlots;
+    statistics["highWatermark"] = this->highWatermark;
+    statistics["overflows"] = this->overflowCounter;
+  }
+
+private:
+  typedef typename std::aligned_storage<sizeof(T), alignof(T)>::type SlotStorage;
+
+  // a heap allocated object that has been created while the pool was exhausted
+  struct OverflowNode
+  {
+    OverflowNode *next;
+    SlotStorage storage;
+  };
+
+  bool releaseOverflowObject(T *object)
+  {
+    OverflowNode *node = NULL;
+    portENTER_CRITICAL(&this->mux);
+    for (OverflowNode **link = &this->firstOverflowNode; *link != NULL; link = &(*link)->next)
+    {
+      if (reinterpret_cast<T *>(&(*link)->storage) == object)
+      {
+        node = *link;
+        *link = node->next;
+        break;
+      }
+    }
+    portEXIT_CRITICAL(&this->mux);
+    if (node == NULL)
+    {
+      return false;
+    }
+    object->~T();
+    delete node;
+    return true;
+  }
+
+  SlotStorage slots[Capacity];
+  // index of the next free slot for each free slot, Capacity marks the end of the list
+  unsigned int nextFreeSlot[Capacity];
+  unsigned int firstFreeSlot;
+  unsigned int usedSlots = 0;
+  unsigned int highWatermark = 0;
+  unsigned int overflowCounter = 0;
+  OverflowNode *firstOverflowNode = NULL;
+  portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+};
+
+#endif
@@ -0,0 +1,329 @@
+//      ******************************************************************
+//      *                                                                *
+//      *          ESPStepperMotorServer_PositionJournal                 *
+//      *                                                                *
+//      *               Copyright (c) Paul Kerspe, 2019                  *
+//      *                                                                *
+//      ******************************************************************
+
+// MIT License
+//
+// Copyright (c) 2019 Paul Kerspe
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished
+// to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#define ESPServerLogModule ESPServerLogModule_PositionJournal
+
+#include <ESPStepperMotorServer.h>
+#include <ESPStepperMotorServer_PositionJournal.h>
+#include <Preferences.h>
+
+// RTC memory that is not initialized on reset, so the record survives software resets
+static RTC_NOINIT_ATTR ESPStepperMotorServer_PositionJournalRecord rtcPositionJournalRecord;
+static RTC_NOINIT_ATTR ESPStepperMotorServer_PositionJournalDirtyMarker rtcPositionJournalDirtyMarker;
+
+ESPStepperMotorServer_PositionJournal::ESPStepperMotorServer_PositionJournal(byte storageType)
+{
+  if (storageType != ESPServerPositionJournalStorage_RTC && storageType != ESPServerPositionJournalStorage_NVS)
+  {
+    ESPStepperMotorServer_Logger::logWarningf("Invalid position journal storage type %i given, will use NVS\n", storageType);
+    storageType = ESPServerPositionJournalStorage_NVS;
+  }
+  this->storageType = storageType;
+  if (storageType == ESPServerPositionJournalStorage_NVS)
+  {
+    this->nvsWriteMutex = xSemaphoreCreateMutex();
+  }
+}
+
+/**
+ * start the writer task that writes the records to NVS. Until it is started, the records are written directly
+ */
+void ESPStepperMotorServer_PositionJournal::start()
+{
+  if (this->storageType == ESPServerPositionJournalStorage_NVS && this->writerTaskHandle == NULL)
+  {
+    xTaskCreate(
+        ESPStepperMotorServer_PositionJournal::processPendingRecords, /* Task function. */
+        "PositionJournal",                                            /* String with name of task. */
+        3000,                                                         /* Stack size in bytes. */
+        this,                                                         /* Parameter passed as input of the task */
+        1,                                                            /* Priority of the task. */
+        &this->writerTaskHandle);                                     /* Task handle. */
+    ESPServerLogInfo("Position journal writer task started");
+  }
+}
+
+/**
+ * stop the writer task and write the latest record, if it has not been written yet
+ */
+void ESPStepperMotorServer_PositionJournal::stop()
+{
+  if (this->writerTaskHandle != NULL)
+  {
+    // wait until a running write is completed
+    xSemaphoreTake(this->nvsWriteMutex, portMAX_DELAY);
+    vTaskDelete(this->writerTaskHandle);
+    this->writerTaskHandle = NULL;
+    xSemaphoreGive(this->nvsWriteMutex);
+  }
+  this->flush();
+}
+
+/**
+ * write the latest record to NVS in the calling task, if it has not been written by the writer task yet (e.g. before a reboot)
+ */
+void ESPStepperMotorServer_PositionJournal::flush()
+{
+  if (this->storageType == ESPServerPositionJournalStorage_NVS)
+  {
+    this->writePendingRecord();
+  }
+}
+
+void ESPStepperMotorServer_PositionJournal::processPendingRecords(void *parameter)
+{
+  ESPStepperMotorServer_PositionJournal *ref = static_cast<ESPStepperMotorServer_PositionJournal *>(parameter);
+  while (true)
+  {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    ref->writePendingRecord();
+  }
+}
+
+byte ESPStepperMotorServer_PositionJournal::getStorageType() const
+{
+  return this->storageType;
+}
+
+unsigned long ESPStepperMotorServer_PositionJournal::getWriteCount() const
+{
+  return this->writeCounter;
+}
+
+byte ESPStepperMotorServer_PositionJournal::getRestoredStepperCount() const
+{
+  return this->restoredStepperCount;
+}
+
+/**
+ * load the latest record and set the current (and target) position of all steppers that have not been changed since the record has been written.
+ * Positions are only restored if the record has the clean shutdown marker. Must be called before the motion controller is started.
+ * Returns the number of restored stepper positions
+ */
+byte ESPStepperMotorServer_PositionJournal::restorePositions(ESPStepperMotorServer_Configuration *configuration)
+{
+  this->restoredStepperCount = 0;
+  if (!this->loadRecord())
+  {
+    ESPServerLogInfo("No position journal record found, steppers need to be homed");
+    return 0;
+  }
+  if (this->storageType == ESPServerPositionJournalStorage_NVS && this->isDirtyMarkerSet(this->record.sequence))
+  {
+    // the movement started after this record, but the record without marker has not been written to NVS before the reset
+    this->record.isCleanShutdown = 0;
+  }
+  if (!this->record.isCleanShutdown)
+  {
+    ESPServerLogInfo("The last position journal record has been written before a movement that did not complete, steppers need to be homed");
+    return 0;
+  }
+  for (byte stepperId = 0; stepperId < ESPServerMaxSteppers; stepperId++)
+  {
+    ESPStepperMotorServer_StepperConfiguration *stepper = configuration->getStepperConfiguration(stepperId);
+    if (stepper && stepper->getStepIoPin() == this->record.stepIoPins[stepperId])
+    {
+      // the target is set as well, otherwise the stepper would move back to its previous target position
+      stepper->getFlexyStepper()->setCurrentPositionInSteps(this->record.positions[stepperId]);
+      stepper->getFlexyStepper()->setTargetPositionInSteps(this->record.positions[stepperId]);
+      this->restoredStepperCount++;
+    }
+  }
+  ESPServerLogInfof("Restored the positions of %i stepper%s from the position journal\n", this->restoredStepperCount, (this->restoredStepperCount == 1) ? "" : "s");
+  return this->restoredStepperCount;
+}
+
+/**
+ * remove the clean shutdown marker before the first movement after the positions have been written,
+ * since the stored positions are not valid anymore once a stepper starts moving
+ */
+void ESPStepperMotorServer_PositionJournal::removeCleanShutdownMarker()
+{
+  if (this->storageType == ESPServerPositionJournalStorage_NVS)
+  {
+    // flags the last clean record right away, the record without marker is written to NVS by the writer task
+    rtcPositionJournalDirtyMarker.magic = ESPServerPositionJournalDirtyMarkerMagic;
+    rtcPositionJournalDirtyMarker.sequence = this->record.sequence;
+    rtcPositionJournalDirtyMarker.inverseSequence = ~this->record.sequence;
+  }
+  this->record.isCleanShutdown = 0;
+  this->storeRecord();
+}
+
+/**
+ * write the current positions of all steppers with the clean shutdown marker.
+ * Nothing is written if the positions and stepper configurations did not change since the last record.
+ * Must only be called while no stepper is moving
+ */
+void ESPStepperMotorServer_PositionJournal::writePositions(ESPStepperMotorServer_Configuration *configuration)
+{
+  bool isChanged = !this->record.isCleanShutdown;
+  for (byte stepperId = 0; stepperId < ESPServerMaxSteppers; stepperId++)
+  {
+    ESPStepperMotorServer_StepperConfiguration *stepper = configuration->getStepperConfiguration(stepperId);
+    byte stepIoPin = (stepper) ? stepper->getStepIoPin() : ESPStepperMotorServer_StepperConfiguration::ESPServerStepperUnsetIoPinNumber;
+    long position = (stepper) ? stepper->getFlexyStepper()->getCurrentPositionInSteps() : 0;
+    if (stepIoPin != this->record.stepIoPins[stepperId] || position != this->record.positions[stepperId])
+    {
+      this->record.stepIoPins[stepperId] = stepIoPin;
+      this->record.positions[stepperId] = position;
+      isChanged = true;
+    }
+  }
+  if (isChanged)
+  {
+    this->record.isCleanShutdown = 1;
+    this->storeRecord();
+  }
+}
+
+bool ESPStepperMotorServer_PositionJournal::loadRecord()
+{
+  ESPStepperMotorServer_PositionJournalRecord candidate;
+  bool isRecordFound = false;
+  if (this->storageType == ESPServerPositionJournalStorage_RTC)
+  {
+    candidate = rtcPositionJournalRecord;
+    if (candidate.magic == ESPServerPositionJournalMagic && candidate.checksum == calculateChecksum(candidate))
+    {
+      this->record = candidate;
+      isRecordFound = true;
+    }
+  }
+  else
+  {
+    Preferences preferences;
+    // opening the namespace read only fails if no record has been written yet
+    if (!preferences.begin(ESPServerPositionJournalNvsNamespace, true))
+    {
+      return false;
+    }
+    char key[12];
+    for (byte slot = 0; slot < ESPServerPositionJournalSlotCount; slot++)
+    {
+      snprintf(key, sizeof(key), "slot%i", slot);
+      if (preferences.getBytes(key, &candidate, sizeof(candidate)) == sizeof(candidate) && candidate.magic == ESPServerPositionJournalMagic && candidate.checksum == calculateChecksum(candidate) && (!isRecordFound || candidate.sequence > this->record.sequence))
+      {
+        this->record = candidate;
+        this->nextNvsSlot = (slot + 1) % ESPServerPositionJournalSlotCount;
+        isRecordFound = true;
+      }
+    }
+    preferences.end();
+  }
+  return isRecordFound;
+}
+
+void ESPStepperMotorServer_PositionJournal::storeRecord()
+{
+  this->record.magic = ESPServerPositionJournalMagic;
+  this->record.sequence++;
+  this->record.checksum = calculateChecksum(this->record);
+  if (this->storageType == ESPServerPositionJournalStorage_RTC)
+  {
+    rtcPositionJournalRecord = this->record;
+    this->writeCounter++;
+    return;
+  }
+  // a record that has not been written yet is replaced, only the latest record is relevant
+  portENTER_CRITICAL(&this->pendingRecordMux);
+  this->pendingRecord = this->record;
+  this->hasPendingRecord = true;
+  portEXIT_CRITICAL(&this->pendingRecordMux);
+  if (this->writerTaskHandle != NULL)
+  {
+    xTaskNotifyGive(this->writerTaskHandle);
+  }
+  else
+  {
+    this->writePendingRecord();
+  }
+}
+
+void ESPStepperMotorServer_PositionJournal::writePendingRecord()
+{
+  ESPStepperMotorServer_PositionJournalRecord pendingRecord;
+  xSemaphoreTake(this->nvsWriteMutex, portMAX_DELAY);
+  portENTER_CRITICAL(&this->pendingRecordMux);
+  const bool hasPendingRecord = this->hasPendingRecord;
+  if (hasPendingRecord)
+  {
+    pendingRecord = this->pendingRecord;
+    this->hasPendingRecord = false;
+  }
+  portEXIT_CRITICAL(&this->pendingRecordMux);
+  if (hasPendingRecord)
+  {
+    this->writeNvsRecord(pendingRecord);
+  }
+  xSemaphoreGive(this->nvsWriteMutex);
+}
+
+void ESPStepperMotorServer_PositionJournal::writeNvsRecord(const ESPStepperMotorServer_PositionJournalRecord &record)
+{
+  // each record goes to the next slot, so the previous record is kept until the new one has been written completely
+  Preferences preferences;
+  if (!preferences.begin(ESPServerPositionJournalNvsNamespace, false))
+  {
+    ESPStepperMotorServer_Logger::logWarning("Failed to open the NVS namespace of the position journal");
+    return;
+  }
+  char key[12];
+  snprintf(key, sizeof(key), "slot%i", this->nextNvsSlot);
+  this->nextNvsSlot = (this->nextNvsSlot + 1) % ESPServerPositionJournalSlotCount;
+  if (preferences.putBytes(key, &record, sizeof(record)) != sizeof(record))
+  {
+    ESPStepperMotorServer_Logger::logWarning("Failed to write the position journal record to NVS");
+  }
+  else
+  {
+    this->writeCounter++;
+  }
+  preferences.end();
+}
+
+bool ESPStepperMotorServer_PositionJournal::isDirtyMarkerSet(uint32_t sequence) const
+{
+  return (rtcPositionJournalDirtyMarker.magic == ESPServerPositionJournalDirtyMarkerMagic &&
+          rtcPositionJournalDirtyMarker.sequence == sequence &&
+          rtcPositionJournalDirtyMarker.inverseSequence == (uint32_t)~sequence);
+}
+
+// FNV-1a hash over all members of the record except the checksum itself
+uint32_t ESPStepperMotorServer_PositionJournal::calculateChecksum(const ESPStepperMotorServer_PositionJournalRecord &record)
+{
+  const byte *data = reinterpret_cast<const byte *>(&record);
+  uint32_t hash = 2166136261UL;
+  for (size_t i = 0; i < offsetof(ESPStepperMotorServer_PositionJournalRecord, checksum); i++)
+  {
+    hash = (hash ^ data[i]) * 16777619UL;
+  }
+  return hash;
+}
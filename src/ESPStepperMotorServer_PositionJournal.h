@@ -0,0 +1,154 @@
+//      ******************************************************************
+//      *                                                                *
+//      *   Header file for ESPStepperMotorServer_PositionJournal.cpp    *
+//      *                                                                *
+//      *               Copyright (c) Paul Kerspe, 2019                  *
+//      *                                                                *
+//      ******************************************************************
+
+// MIT License
+//
+// Copyright (c) 2019 Paul Kerspe
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished
+// to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef ESPStepperMotorServer_PositionJournal_h
+#define ESPStepperMotorServer_PositionJournal_h
+
+#include <Arduino.h>
+
+// storage types of the position journal
+// RTC memory survives software resets (e.g. requestReboot, OTA updates, crashes) but not a power loss. Writing to it does not wear out anything
+#define ESPServerPositionJournalStorage_RTC 1
+// NVS flash survives a power loss, records are only written after the steppers have been idle for a while to reduce flash wear
+#define ESPServerPositionJournalStorage_NVS 2
+
+// the time all steppers need to be idle before their positions are written to the journal
+#ifndef ESPServerPositionJournalIdleDelayMs
+#define ESPServerPositionJournalIdleDelayMs 1000
+#endif
+// the number of NVS entries the records are rotated over. A record that is torn by a power loss during the write
+// fails the checksum test, so the previous record is still available
+#ifndef ESPServerPositionJournalSlotCount
+#define ESPServerPositionJournalSlotCount 4
+#endif
+#define ESPServerPositionJournalMagic 0x4A505345UL
+#define ESPServerPositionJournalDirtyMarkerMagic 0x59524944UL
+#define ESPServerPositionJournalNvsNamespace "espsms_journal"
+
+class ESPStepperMotorServer_Configuration;
+
+struct ESPStepperMotorServer_PositionJournalRecord
+{
+  uint32_t magic;
+  uint32_t sequence;
+  // the clean shutdown marker: set if the positions have been written while all steppers were idle
+  // and no movement has been started since, only then the positions can be restored
+  byte isCleanShutdown;
+  // the step pin of each stepper, used to detect changed stepper configurations. ESPServerStepperUnsetIoPinNumber if no stepper is configured
+  byte stepIoPins[ESPServerMaxSteppers];
+  long positions[ESPServerMaxSteppers];
+  uint32_t checksum;
+};
+
+// the dirty marker of the NVS storage, kept in RTC memory: set before the first step of a movement, it flags the NVS record with the given sequence
+// as not restorable, without waiting for the flash write of the record without clean shutdown marker
+struct ESPStepperMotorServer_PositionJournalDirtyMarker
+{
+  uint32_t magic;
+  uint32_t sequence;
+  uint32_t inverseSequence;
+};
+
+//
+// the ESPStepperMotorServer_PositionJournal class
+// stores the last known position of all steppers, so the positions can be restored after a reboot without homing the axes again.
+// Before the first movement after a record has been written, the clean shutdown marker is removed, so positions
+// of steppers that have been moving during a power loss or crash are never restored.
+// With NVS storage, the records are written to the flash by a separate writer task, so the motion controller never waits for a flash write:
+// the removal of the clean shutdown marker is stored in RTC memory right away (for software resets and crashes) and the record without marker
+// is written to the flash in the background. If the steppers stop again before it has been written, only the new record is written.
+// Except for restorePositions, start, stop and flush, all functions must be called from the motion controller task
+class ESPStepperMotorServer_PositionJournal
+{
+public:
+  ESPStepperMotorServer_PositionJournal(byte storageType);
+  byte getStorageType() const;
+  byte restorePositions(ESPStepperMotorServer_Configuration *configuration);
+  void start();
+  void stop();
+  void flush();
+  bool isCleanShutdownMarkerSet() const
+  {
+    return this->record.isCleanShutdown;
+  }
+  void removeCleanShutdownMarker();
+  /**
+   * called by the motion controller in every cycle, writes the positions once all steppers have been idle for ESPServerPositionJournalIdleDelayMs
+   */
+  void update(ESPStepperMotorServer_Configuration *configuration, bool isIdle)
+  {
+    if (!isIdle)
+    {
+      this->isIdle = false;
+      return;
+    }
+    const unsigned long now = millis();
+    if (!this->isIdle)
+    {
+      this->isIdle = true;
+      this->idleSinceMillis = now;
+    }
+    else if (now - this->idleSinceMillis >= ESPServerPositionJournalIdleDelayMs)
+    {
+      this->idleSinceMillis = now;
+      this->writePositions(configuration);
+    }
+  }
+  void writePositions(ESPStepperMotorServer_Configuration *configuration);
+  unsigned long getWriteCount() const;
+  byte getRestoredStepperCount() const;
+
+private:
+  static void processPendingRecords(void *parameter);
+  bool loadRecord();
+  void storeRecord();
+  void writePendingRecord();
+  void writeNvsRecord(const ESPStepperMotorServer_PositionJournalRecord &record);
+  bool isDirtyMarkerSet(uint32_t sequence) const;
+  static uint32_t calculateChecksum(const ESPStepperMotorServer_PositionJournalRecord &record);
+
+  byte storageType;
+  ESPStepperMotorServer_PositionJournalRecord record = {};
+  bool isIdle = false;
+  unsigned long idleSinceMillis = 0;
+  volatile unsigned long writeCounter = 0;
+  byte restoredStepperCount = 0;
+  // the latest record that has not been written to NVS yet, handed from the motion controller to the writer task
+  portMUX_TYPE pendingRecordMux = portMUX_INITIALIZER_UNLOCKED;
+  ESPStepperMotorServer_PositionJournalRecord pendingRecord = {};
+  bool hasPendingRecord = false;
+  // serializes the NVS writes of the writer task and flush(), so a record is never overwritten by an older one
+  SemaphoreHandle_t nvsWriteMutex = NULL;
+  TaskHandle_t writerTaskHandle = NULL;
+  // the slots are used in turn and not by sequence number, since records that have been replaced before they were written are skipped
+  byte nextNvsSlot = 0;
+};
+
+#endif
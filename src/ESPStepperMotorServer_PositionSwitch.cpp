@@ -28,13 +28,14 @@
 // SOFTWARE.
 //
 #include <ESPStepperMotorServer_PositionSwitch.h>
+#include <ESPStepperMotorServer.h>
 
 int _stepperIndex; // can be -1 for emergency stop switches only
 byte _ioPinNumber = 255;
 byte _switchType; //bit mask for active state and the general type of switch
 String _positionName = "";
 long _switchPosition = -1;
-ESPStepperMotorServer_Logger _logger = ESPStepperMotorServer_Logger((String)"ESPStepperMotorServer_PositionSwitch");
+ESPStepperMotorServer_Logger _logger = ESPStepperMotorServer_Logger((String)"switch");
 
 ESPStepperMotorServer_PositionSwitch::ESPStepperMotorServer_PositionSwitch()
 {
@@ -131,7 +132,9 @@ std::vector<ESPStepperMotorServer_MacroAction*> ESPStepperMotorServer_PositionSw
 
 void ESPStepperMotorServer_PositionSwitch::clearMacroActions() {
     for(ESPStepperMotorServer_MacroAction *macroAction : this->_macroActions) {
-        delete(macroAction);
+        if (!ESPStepperMotorServer_Configuration::getMacroActionPool().release(macroAction)) {
+            delete(macroAction);
+        }
     }
     this->_macroActions.clear();
 }
@@ -0,0 +1,277 @@
+//      *********************************************************
+//      *                                                       *
+//      *  ESP32 Stepper Motor Server Brake and Driver Control  *
+//      *                                                       *
+//      *            Copyright (c) Paul Kerspe, 2019            *
+//      *                                                       *
+//      **********************************************************
+
+// MIT License
+//
+// Copyright (c) 2019 Paul Kerspe
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished
+// to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#define ESPServerLogModule ESPServerLogModule_PowerManager
+
+#include <ESPStepperMotorServer.h>
+#include <ESPStepperMotorServer_PowerManager.h>
+
+/**
+ * read the brake and enable pin settings of all configured steppers.
+ * Only steppers that have been added, removed or whose power settings have changed are touched: the driver is enabled, the brake is released
+ * and the idle timers are started if the stepper is not moving. All other steppers keep their current power state and idle timers
+ */
+void ESPStepperMotorServer_PowerManager::syncConfiguration(ESPStepperMotorServer_Configuration *configuration)
+{
+  const unsigned long now = millis();
+  for (byte stepperId = 0; stepperId < ESPServerMaxSteppers; stepperId++)
+  {
+    ESPStepperMotorServer_AxisPowerState &axis = this->axes[stepperId];
+    ESPStepperMotorServer_StepperConfiguration *stepper = configuration->getStepperConfiguration(stepperId);
+    ESPStepperMotorServer_AxisPowerState updatedSettings = {};
+    if (stepper != NULL)
+    {
+      updatedSettings.isConfigured = true;
+      updatedSettings.brakeIoPin = stepper->getBrakeIoPin();
+      updatedSettings.isBrakeActiveHigh = (stepper->getBrakePinActiveState() == 1);
+      updatedSettings.brakeEngageDelayMs = stepper->getBrakeEngageDelayMs();
+      updatedSettings.brakeReleaseDelayMs = stepper->getBrakeReleaseDelayMs();
+      updatedSettings.enableIoPin = stepper->getEnableIoPin();
+      updatedSettings.isEnableActiveHigh = (stepper->getEnablePinActiveState() == 1);
+      updatedSettings.driverDisableDelayMs = stepper->getDriverDisableDelayMs();
+    }
+    if (hasSameSettings(axis, updatedSettings))
+    {
+      continue;
+    }
+    this->stopIdleTimers(axis);
+    axis.isWaking = false;
+    axis.isConfigured = updatedSettings.isConfigured;
+    if (stepper == NULL)
+    {
+      axis.brakeIoPin = ESPStepperMotorServer_StepperConfiguration::ESPServerStepperUnsetIoPinNumber;
+      axis.enableIoPin = ESPStepperMotorServer_StepperConfiguration::ESPServerStepperUnsetIoPinNumber;
+      axis.isPowerUpRequired = false;
+      continue;
+    }
+    ESPServerLogDebugf("Power settings of stepper %i changed\n", stepperId);
+    axis.brakeIoPin = updatedSettings.brakeIoPin;
+    axis.isBrakeActiveHigh = updatedSettings.isBrakeActiveHigh;
+    axis.brakeEngageDelayMs = updatedSettings.brakeEngageDelayMs;
+    axis.brakeReleaseDelayMs = updatedSettings.brakeReleaseDelayMs;
+    axis.enableIoPin = updatedSettings.enableIoPin;
+    axis.isEnableActiveHigh = updatedSettings.isEnableActiveHigh;
+    axis.driverDisableDelayMs = updatedSettings.driverDisableDelayMs;
+
+    if (axis.brakeIoPin != ESPStepperMotorServer_StepperConfiguration::ESPServerStepperUnsetIoPinNumber)
+    {
+      pinMode(axis.brakeIoPin, OUTPUT);
+    }
+    if (axis.enableIoPin != ESPStepperMotorServer_StepperConfiguration::ESPServerStepperUnsetIoPinNumber)
+    {
+      pinMode(axis.enableIoPin, OUTPUT);
+    }
+    // the output state of new pins is unknown, so both outputs are written and the wake delay is always applied
+    this->setBrakeEngaged(axis, false);
+    this->setDriverEnabled(axis, true);
+    this->startWaking(axis, true);
+    this->updatePowerUpRequired(axis);
+    if (stepper->getFlexyStepper()->motionComplete())
+    {
+      this->onMotionStopped(stepperId, now);
+    }
+  }
+  this->configurationRevision = configuration->getConfigurationRevision();
+  ESPServerLogDebug("Power manager configuration updated");
+}
+
+unsigned int ESPStepperMotorServer_PowerManager::getConfigurationRevision() const
+{
+  return this->configurationRevision;
+}
+
+/**
+ * enable the driver and release the brake of the given stepper and stop all idle timers. Must be called before the stepper starts moving
+ */
+void ESPStepperMotorServer_PowerManager::powerUp(byte stepperId)
+{
+  ESPStepperMotorServer_AxisPowerState &axis = this->axes[stepperId];
+  const bool wasPoweredDown = (!axis.isDriverEnabled || axis.isBrakeEngaged);
+  this->stopIdleTimers(axis);
+  this->setDriverEnabled(axis, true);
+  this->setBrakeEngaged(axis, false);
+  this->startWaking(axis, wasPoweredDown);
+  axis.isPowerUpRequired = false;
+}
+
+/**
+ * start the idle timers of the given stepper
+ */
+void ESPStepperMotorServer_PowerManager::onMotionStopped(byte stepperId, unsigned long now)
+{
+  ESPStepperMotorServer_AxisPowerState &axis = this->axes[stepperId];
+  const bool hadPendingIdleTimers = (axis.pendingIdleTimers != 0);
+  axis.pendingIdleTimers = 0;
+  if (axis.brakeIoPin != ESPStepperMotorServer_StepperConfiguration::ESPServerStepperUnsetIoPinNumber)
+  {
+    if (axis.brakeEngageDelayMs >= 0)
+    {
+      axis.pendingIdleTimers |= ESPServerIdleTimer_BrakeEngage;
+      if (axis.brakeReleaseDelayMs >= 0)
+      {
+        axis.pendingIdleTimers |= ESPServerIdleTimer_BrakeRelease;
+      }
+    }
+  }
+  if (axis.enableIoPin != ESPStepperMotorServer_StepperConfiguration::ESPServerStepperUnsetIoPinNumber && axis.driverDisableDelayMs >= 0)
+  {
+    axis.pendingIdleTimers |= ESPServerIdleTimer_DriverDisable;
+  }
+  axis.idleSinceMillis = now;
+
+  if (axis.pendingIdleTimers != 0 && !hadPendingIdleTimers)
+  {
+    this->pendingIdleTimerAxisCount++;
+  }
+  else if (axis.pendingIdleTimers == 0 && hadPendingIdleTimers)
+  {
+    this->pendingIdleTimerAxisCount--;
+  }
+  this->updatePowerUpRequired(axis);
+}
+
+/**
+ * engage / release the brakes and disable the drivers of all steppers whose idle timers have expired
+ */
+void ESPStepperMotorServer_PowerManager::processIdleTimers(unsigned long now)
+{
+  for (byte stepperId = 0; stepperId < ESPServerMaxSteppers; stepperId++)
+  {
+    ESPStepperMotorServer_AxisPowerState &axis = this->axes[stepperId];
+    if (axis.pendingIdleTimers == 0)
+    {
+      continue;
+    }
+    const unsigned long idleTime = now - axis.idleSinceMillis;
+    if ((axis.pendingIdleTimers & ESPServerIdleTimer_BrakeEngage) && idleTime >= (unsigned long)axis.brakeEngageDelayMs)
+    {
+      axis.pendingIdleTimers &= ~ESPServerIdleTimer_BrakeEngage;
+      this->setBrakeEngaged(axis, true);
+    }
+    // the brake is only released after it has been engaged
+    if (!(axis.pendingIdleTimers & ESPServerIdleTimer_BrakeEngage) && (axis.pendingIdleTimers & ESPServerIdleTimer_BrakeRelease) && idleTime >= (unsigned long)axis.brakeReleaseDelayMs)
+    {
+      axis.pendingIdleTimers &= ~ESPServerIdleTimer_BrakeRelease;
+      this->setBrakeEngaged(axis, false);
+    }
+    if ((axis.pendingIdleTimers & ESPServerIdleTimer_DriverDisable) && idleTime >= (unsigned long)axis.driverDisableDelayMs)
+    {
+      axis.pendingIdleTimers &= ~ESPServerIdleTimer_DriverDisable;
+      this->setDriverEnabled(axis, false);
+    }
+    if (axis.pendingIdleTimers == 0)
+    {
+      this->pendingIdleTimerAxisCount--;
+      this->updatePowerUpRequired(axis);
+    }
+  }
+}
+
+bool ESPStepperMotorServer_PowerManager::isBrakeEngaged(byte stepperId) const
+{
+  return (stepperId < ESPServerMaxSteppers && this->axes[stepperId].isBrakeEngaged);
+}
+
+bool ESPStepperMotorServer_PowerManager::isDriverEnabled(byte stepperId) const
+{
+  return (stepperId < ESPServerMaxSteppers && this->axes[stepperId].isDriverEnabled);
+}
+
+bool ESPStepperMotorServer_PowerManager::hasSameSettings(const ESPStepperMotorServer_AxisPowerState &axis, const ESPStepperMotorServer_AxisPowerState &other)
+{
+  if (!axis.isConfigured || !other.isConfigured)
+  {
+    return (axis.isConfigured == other.isConfigured);
+  }
+  return (axis.brakeIoPin == other.brakeIoPin &&
+          axis.isBrakeActiveHigh == other.isBrakeActiveHigh &&
+          axis.brakeEngageDelayMs == other.brakeEngageDelayMs &&
+          axis.brakeReleaseDelayMs == other.brakeReleaseDelayMs &&
+          axis.enableIoPin == other.enableIoPin &&
+          axis.isEnableActiveHigh == other.isEnableActiveHigh &&
+          axis.driverDisableDelayMs == other.driverDisableDelayMs);
+}
+
+void ESPStepperMotorServer_PowerManager::stopIdleTimers(ESPStepperMotorServer_AxisPowerState &axis)
+{
+  if (axis.pendingIdleTimers != 0)
+  {
+    axis.pendingIdleTimers = 0;
+    this->pendingIdleTimerAxisCount--;
+  }
+}
+
+void ESPStepperMotorServer_PowerManager::startWaking(ESPStepperMotorServer_AxisPowerState &axis, bool wasPoweredDown)
+{
+  if (wasPoweredDown && ESPServerPowerManagerWakeDelayMs > 0)
+  {
+    axis.isWaking = true;
+    axis.wakingSinceMicros = micros();
+  }
+}
+
+bool ESPStepperMotorServer_PowerManager::hasWakeDelayExpired(ESPStepperMotorServer_AxisPowerState &axis)
+{
+  if (micros() - axis.wakingSinceMicros < (unsigned long)ESPServerPowerManagerWakeDelayMs * 1000UL)
+  {
+    return false;
+  }
+  axis.isWaking = false;
+  return true;
+}
+
+void ESPStepperMotorServer_PowerManager::setBrakeEngaged(ESPStepperMotorServer_AxisPowerState &axis, bool isEngaged)
+{
+  if (axis.brakeIoPin == ESPStepperMotorServer_StepperConfiguration::ESPServerStepperUnsetIoPinNumber)
+  {
+    axis.isBrakeEngaged = false;
+    return;
+  }
+  digitalWrite(axis.brakeIoPin, (isEngaged == axis.isBrakeActiveHigh) ? HIGH : LOW);
+  axis.isBrakeEngaged = isEngaged;
+}
+
+void ESPStepperMotorServer_PowerManager::setDriverEnabled(ESPStepperMotorServer_AxisPowerState &axis, bool isEnabled)
+{
+  if (axis.enableIoPin == ESPStepperMotorServer_StepperConfiguration::ESPServerStepperUnsetIoPinNumber)
+  {
+    axis.isDriverEnabled = true;
+    return;
+  }
+  digitalWrite(axis.enableIoPin, (isEnabled == axis.isEnableActiveHigh) ? HIGH : LOW);
+  axis.isDriverEnabled = isEnabled;
+}
+
+void ESPStepperMotorServer_PowerManager::updatePowerUpRequired(ESPStepperMotorServer_AxisPowerState &axis)
+{
+  axis.isPowerUpRequired = (axis.pendingIdleTimers != 0 || axis.isBrakeEngaged || !axis.isDriverEnabled);
+}
+
+// -------------------------------------- End --------------------------------------
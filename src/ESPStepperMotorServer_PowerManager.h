@@ -0,0 +1,118 @@
+//      ******************************************************************
+//      *                                                                *
+//      *    Header file for ESPStepperMotorServer_PowerManager.cpp      *
+//      *                                                                *
+//      *               Copyright (c) Paul Kerspe, 2019                  *
+//      *                                                                *
+//      ******************************************************************
+
+// MIT License
+//
+// Copyright (c) 2019 Paul Kerspe
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished
+// to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef ESPStepperMotorServer_PowerManager_h
+#define ESPStepperMotorServer_PowerManager_h
+
+#include <Arduino.h>
+#include <ESPStepperMotorServer_StepperConfiguration.h>
+
+// time in ms the motion controller waits after enabling a driver or releasing a brake, before the first step is sent to the stepper
+// (drivers need some time to wake up from the disabled state and brakes need some time to release mechanically)
+#ifndef ESPServerPowerManagerWakeDelayMs
+#define ESPServerPowerManagerWakeDelayMs 5
+#endif
+
+// bits for the idle timers of an axis that have not expired yet
+#define ESPServerIdleTimer_BrakeEngage 1
+#define ESPServerIdleTimer_BrakeRelease 2
+#define ESPServerIdleTimer_DriverDisable 4
+
+class ESPStepperMotorServer_Configuration;
+
+// the power state and the cached brake / enable pin settings of one stepper
+struct ESPStepperMotorServer_AxisPowerState
+{
+  bool isConfigured;
+  byte brakeIoPin;
+  bool isBrakeActiveHigh;
+  long brakeEngageDelayMs;
+  long brakeReleaseDelayMs;
+  byte enableIoPin;
+  bool isEnableActiveHigh;
+  long driverDisableDelayMs;
+
+  bool isBrakeEngaged;
+  bool isDriverEnabled;
+  // set if the brake is engaged, the driver is disabled or an idle timer is running,
+  // so the motion loop needs to call powerUp() before the next movement
+  bool isPowerUpRequired;
+  byte pendingIdleTimers;
+  unsigned long idleSinceMillis;
+  // set after the driver has been enabled or the brake has been released, until the wake delay has expired
+  bool isWaking;
+  unsigned long wakingSinceMicros;
+};
+
+//
+// the ESPStepperMotorServer_PowerManager class
+// drives the brake and driver enable pins of all steppers, based on the idle detection of the motion controller:
+// once a stepper stops, the brake is engaged after the brake engage delay (and released again after the brake release delay if configured)
+// and the driver is disabled after the driver disable delay. Before the next movement starts, the driver is enabled and the brake is released.
+// All functions must be called from the motion controller task
+class ESPStepperMotorServer_PowerManager
+{
+public:
+  void syncConfiguration(ESPStepperMotorServer_Configuration *configuration);
+  unsigned int getConfigurationRevision() const;
+  bool isPowerUpRequired(byte stepperId) const
+  {
+    return this->axes[stepperId].isPowerUpRequired;
+  }
+  void powerUp(byte stepperId);
+  // returns false while the driver / brake of the given stepper is still waking up, no steps must be sent in the meantime
+  bool isReadyToMove(byte stepperId)
+  {
+    return !this->axes[stepperId].isWaking || this->hasWakeDelayExpired(this->axes[stepperId]);
+  }
+  void onMotionStopped(byte stepperId, unsigned long now);
+  bool hasPendingIdleTimers() const
+  {
+    return this->pendingIdleTimerAxisCount > 0;
+  }
+  void processIdleTimers(unsigned long now);
+  bool isBrakeEngaged(byte stepperId) const;
+  bool isDriverEnabled(byte stepperId) const;
+
+private:
+  static bool hasSameSettings(const ESPStepperMotorServer_AxisPowerState &axis, const ESPStepperMotorServer_AxisPowerState &other);
+  void stopIdleTimers(ESPStepperMotorServer_AxisPowerState &axis);
+  void startWaking(ESPStepperMotorServer_AxisPowerState &axis, bool wasPoweredDown);
+  bool hasWakeDelayExpired(ESPStepperMotorServer_AxisPowerState &axis);
+  void setBrakeEngaged(ESPStepperMotorServer_AxisPowerState &axis, bool isEngaged);
+  void setDriverEnabled(ESPStepperMotorServer_AxisPowerState &axis, bool isEnabled);
+  void updatePowerUpRequired(ESPStepperMotorServer_AxisPowerState &axis);
+
+  ESPStepperMotorServer_AxisPowerState axes[ESPServerMaxSteppers] = {};
+  byte pendingIdleTimerAxisCount = 0;
+  unsigned int configurationRevision = 0;
+};
+
+#endif
@@ -0,0 +1,117 @@
+//      ******************************************************************
+//      *                                                                *
+//      *       Header file for ESPStepperMotorServer_Registry           *
+//      *                                                                *
+//      *               Copyright (c) Paul Kerspe, 2019                  *
+//      *                                                                *
+//      ******************************************************************
+
+// fixed capacity registries for the configuration entities (steppers, switches, encoders).
+// The capacity of each registry is a template parameter, so the required RAM is decided at compile time
+// and can be tuned with the ESPServerMaxSteppers, ESPServerMaxSwitches and ESPServerMaxRotaryEncoders build flags.
+
+// MIT License
+//
+// Copyright (c) 2019 Paul Kerspe
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished
+// to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef ESPStepperMotorServer_Registry_h
+#define ESPStepperMotorServer_Registry_h
+
+#include <Arduino.h>
+
+/**
+ * returns the number of 8 bit registers that are needed to store one status bit for each of the given amount of entries
+ * (basically ceil(bitCount / 8), but evaluated by the compiler)
+ */
+constexpr byte ESPStepperMotorServer_getRequiredRegisterCount(unsigned int bitCount)
+{
+  return (byte)((bitCount + 7) / 8);
+}
+
+//
+// the ESPStepperMotorServer_Registry class
+// a fixed size slot array of pointers to configuration entities, where the slot index equals the ID of the entity.
+// empty slots are NULL. 255 is reserved as "invalid id" return value, so at most 254 slots are allowed
+template <typename T, unsigned int Capacity>
+class ESPStepperMotorServer_Registry
+{
+  static_assert(Capacity > 0, "ESPStepperMotorServer_Registry needs a capacity of at least 1");
+  static_assert(Capacity < 255, "ESPStepperMotorServer_Registry capacity must be smaller than 255 since byte sized IDs are used and 255 marks an invalid ID");
+
+public:
+  /**
+   * the maximum amount of entities that can be stored in this registry
+   */
+  static constexpr byte capacity()
+  {
+    return (byte)Capacity;
+  }
+
+  T *&operator[](byte index)
+  {
+    return this->_slots[index];
+  }
+
+  T *operator[](byte index) const
+  {
+    return this->_slots[index];
+  }
+
+  /**
+   * direct access to the underlying slot array, e.g. for time critical loops
+   */
+  T **data()
+  {
+    return this->_slots;
+  }
+
+  /**
+   * returns the number of slots that are currently not NULL
+   */
+  byte count() const
+  {
+    byte counter = 0;
+    for (byte i = 0; i < Capacity; i++)
+    {
+      if (this->_slots[i] != NULL)
+      {
+        counter++;
+      }
+    }
+    return counter;
+  }
+
+  /**
+   * set all slots to NULL (the referenced entities will NOT be deleted)
+   */
+  void clear()
+  {
+    for (byte i = 0; i < Capacity; i++)
+    {
+      this->_slots[i] = NULL;
+    }
+  }
+
+private:
+  T *_slots[Capacity] = {NULL};
+};
+
+#endif
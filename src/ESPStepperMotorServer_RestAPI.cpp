@@ -29,10 +29,20 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+#define ESPServerLogModule ESPServerLogModule_RestAPI
+
 #include "ESPStepperMotorServer_RestAPI.h"
 
 ESPStepperMotorServer_Logger *logger;
 ESPStepperMotorServer *_stepperMotorServer;
+
+// constant responses that are shared by multiple endpoints, they are sent directly from flash without building a String first
+static const char ESPServerRestResponse_MissingId[] PROGMEM = "{\"error\": \"Missing id paramter\"}";
+static const char ESPServerRestResponse_StepperNotFound[] PROGMEM = "{\"error\": \"No stepper configuration found for given id\"}";
+static const char ESPServerRestResponse_MissingValueOrUnit[] PROGMEM = "{\"error\": \"Missing value or unit parameter\"}";
+static const char ESPServerRestResponse_InvalidUnit[] PROGMEM = "{\"error\": \"Unit must be one of: revs, steps, mm\"}";
+static const char ESPServerRestResponse_InvalidNumber[] PROGMEM = "{\"error\": \"Invalid number given in request parameter\"}";
+static const char ESPServerRestResponse_InvalidJson[] PROGMEM = "{\"error\": \"Invalid JSON request, deserialization failed\"}";
 // ---------------------------------------------------------------------------------
 //                                  Setup functions
 // ---------------------------------------------------------------------------------
@@ -43,9 +53,7 @@ ESPStepperMotorServer *_stepperMotorServer;
 ESPStepperMotorServer_RestAPI::ESPStepperMotorServer_RestAPI(ESPStepperMotorServer *stepperMotorServer)
 {
     this->_stepperMotorServer = stepperMotorServer;
-#ifndef ESPStepperMotorServer_COMPILE_NO_DEBUG
-    ESPStepperMotorServer_Logger::logDebug("ESPStepperMotorServer_RestAPI instance created");
-#endif
+    ESPServerLogDebug("ESPStepperMotorServer_RestAPI instance created");
 }
 
 /**
@@ -70,39 +78,15 @@ void ESPStepperMotorServer_RestAPI::registerRestEndpoints(AsyncWebServer *httpSe
                    {
                        this->logDebugRequestUrl(request);
 
-                       if (request->hasParam("id"))
+                       ESPStepperMotorServer_StepperConfiguration *stepper = this->getStepperFromRequest(request);
+                       if (stepper == NULL)
                        {
-                           const byte stepperIndex = request->getParam("id")->value().toInt();
-                           ESPStepperMotorServer_StepperConfiguration *stepper = this->_stepperMotorServer->getCurrentServerConfiguration()->getStepperConfiguration(stepperIndex);
-                           if (stepperIndex < 0 || stepperIndex >= ESPServerMaxSteppers || stepper == NULL)
-                           {
-                               request->send(404, "application/json", "{\"error\": \"Invalid stepper id\"}");
-                               return;
-                           }
-                           String output;
-                           const int docSize = 60;
-
-                           StaticJsonDocument<docSize> doc;
-                           JsonObject root = doc.to<JsonObject>();
-
-                           root["mm"] = stepper->getFlexyStepper()->getCurrentPositionInMillimeters();
-                           root["revs"] = stepper->getFlexyStepper()->getCurrentPositionInRevolutions();
-                           root["steps"] = stepper->getFlexyStepper()->getCurrentPositionInSteps();
-                           serializeJson(root, output);
-                           AsyncWebServerResponse *response = request->beginResponse(200, "application/json", output);
-                           request->send(response);
-#ifndef ESPStepperMotorServer_COMPILE_NO_DEBUG
-                           if (ESPStepperMotorServer_Logger::isDebugEnabled())
-                           {
-                               ESPStepperMotorServer_Logger::logDebugf("ArduinoJSON document size uses %i bytes from alocated %i bytes", doc.memoryUsage(), docSize);
-                           }
-#endif
-                       }
-                       else
-                       {
-                           request->send(400, "application/json", "{\"error\": \"Missing id paramter\"}");
                            return;
                        }
+                       ESP_FlexyStepper *flexyStepper = stepper->getFlexyStepper();
+                       char output[96];
+                       snprintf(output, sizeof(output), "{\"mm\":%.3f,\"revs\":%.3f,\"steps\":%ld}", flexyStepper->getCurrentPositionInMillimeters(), flexyStepper->getCurrentPositionInRevolutions(), flexyStepper->getCurrentPositionInSteps());
+                       request->send(200, "application/json", output);
                    });
 
     // POST /api/steppers/returnhome
@@ -114,150 +98,37 @@ void ESPStepperMotorServer_RestAPI::registerRestEndpoints(AsyncWebServer *httpSe
                        this->handleHomingRequest(request);
                    });
 
+    // POST /api/steppers/homeall
+    // endpoint to home multiple steppers at once, either all steppers with a configured limit switch in parallel, or in the order given in the "order" parameter
+    // see documentation of handler function for details
+    httpServer->on("/api/steppers/homeall", HTTP_POST, [this](AsyncWebServerRequest *request)
+                   {
+                       this->logDebugRequestUrl(request);
+                       this->handleHomeAllRequest(request);
+                   });
+
     // POST /api/steppers/moveby
     // endpoint to set a new RELATIVE target position for the stepper motor in either mm, revs or steps
     // post parameters: id, unit, value
     // optional parameters: speed, accel, decel
+    // see documentation of handler function for details on the soft limit handling
     httpServer->on("/api/steppers/moveby", HTTP_POST, [this](AsyncWebServerRequest *request)
                    {
                        this->logDebugRequestUrl(request);
 
-                       if (request->hasParam("id"))
-                       {
-                           int stepperIndex = request->getParam("id")->value().toInt();
-                           ESPStepperMotorServer_StepperConfiguration *stepper = this->_stepperMotorServer->getCurrentServerConfiguration()->getStepperConfiguration(stepperIndex);
-                           if (stepper == NULL)
-                           {
-                               request->send(404, "application/json", "{\"error\": \"No stepper configuration found for given id\"}");
-                               return;
-                           }
-                           if (request->hasParam("speed"))
-                           {
-                               float speed = request->getParam("speed")->value().toFloat();
-                               if (speed > 0)
-                               {
-                                   stepper->getFlexyStepper()->setSpeedInStepsPerSecond(speed);
-                               }
-                           }
-                           if (request->hasParam("accel"))
-                           {
-                               float accel = request->getParam("accel")->value().toFloat();
-                               if (accel > 0)
-                               {
-                                   stepper->getFlexyStepper()->setAccelerationInStepsPerSecondPerSecond(accel);
-                                   //in case deceleration is not explicitly given, we just use the same value
-                                   stepper->getFlexyStepper()->setDecelerationInStepsPerSecondPerSecond(accel);
-                               }
-                           }
-                           if (request->hasParam("decel"))
-                           {
-                               float decel = request->getParam("decel")->value().toFloat();
-                               if (decel > 0)
-                               {
-                                   stepper->getFlexyStepper()->setDecelerationInStepsPerSecondPerSecond(decel);
-                               }
-                           }
-
-                           if (request->hasParam("value") && request->hasParam("unit"))
-                           {
-                               String unit = request->getParam("unit")->value();
-                               float distance = request->getParam("value")->value().toFloat();
-                               if (unit == "mm")
-                               {
-                                   stepper->getFlexyStepper()->setTargetPositionRelativeInMillimeters(distance);
-                               }
-                               else if (unit == "revs")
-                               {
-                                   stepper->getFlexyStepper()->setTargetPositionRelativeInRevolutions(distance);
-                               }
-                               else if (unit == "steps")
-                               {
-                                   stepper->getFlexyStepper()->setTargetPositionRelativeInSteps(distance);
-                               }
-                               else
-                               {
-                                   request->send(400, "application/json", "{\"error\": \"Unit must be one of: revs, steps, mm\"}");
-                                   return;
-                               }
-                               request->send(204);
-                               return;
-                           }
-                       }
-                       request->send(400, "application/json", "{\"error\": \"Missing id paramter\"}");
+                       this->handleMovementRequest(request, true);
                    });
 
     // POST /api/steppers/position
     // endpoint to set a new absolute target position for the stepper motor in either mm, revs or steps
     // post parameters: id, unit, value
     // optional parameters: speed, accel, decel
+    // see documentation of handler function for details on the soft limit handling
     httpServer->on("/api/steppers/position", HTTP_POST, [this](AsyncWebServerRequest *request)
                    {
                        this->logDebugRequestUrl(request);
 
-                       if (request->hasParam("id", true))
-                       {
-                           int stepperIndex = request->getParam("id", true)->value().toInt();
-                           ESPStepperMotorServer_StepperConfiguration *stepper = this->_stepperMotorServer->getCurrentServerConfiguration()->getStepperConfiguration(stepperIndex);
-                           if (stepper == NULL)
-                           {
-                               request->send(404, "application/json", "{\"error\": \"No stepper configuration found for given id\"}");
-                               return;
-                           }
-
-                           if (request->hasParam("speed"))
-                           {
-                               float speed = request->getParam("speed")->value().toFloat();
-                               if (speed > 0)
-                               {
-                                   stepper->getFlexyStepper()->setSpeedInStepsPerSecond(speed);
-                               }
-                           }
-                           if (request->hasParam("accel"))
-                           {
-                               float accel = request->getParam("accel")->value().toFloat();
-                               if (accel > 0)
-                               {
-                                   stepper->getFlexyStepper()->setAccelerationInStepsPerSecondPerSecond(accel);
-                                   //in case deceleration is not explicitly given, we just use the same value
-                                   stepper->getFlexyStepper()->setDecelerationInStepsPerSecondPerSecond(accel);
-                               }
-                           }
-                           if (request->hasParam("decel"))
-                           {
-                               float decel = request->getParam("decel")->value().toFloat();
-                               if (decel > 0)
-                               {
-                                   stepper->getFlexyStepper()->setDecelerationInStepsPerSecondPerSecond(decel);
-                               }
-                           }
-
-                           if (request->hasParam("value", true) && request->hasParam("unit", true))
-                           {
-                               String unit = request->getParam("unit", true)->value();
-                               float position = request->getParam("value", true)->value().toFloat();
-                               if (unit == "mm")
-                               {
-                                   stepper->getFlexyStepper()->setTargetPositionInMillimeters(position);
-                               }
-                               else if (unit == "revs")
-                               {
-                                   stepper->getFlexyStepper()->setTargetPositionInRevolutions(position);
-                               }
-                               else if (unit == "steps")
-                               {
-                                   stepper->getFlexyStepper()->setTargetPositionInSteps(position);
-                               }
-                               else
-                               {
-                                   request->send(400);
-                                   return;
-                               }
-
-                               request->send(204);
-                               return;
-                           }
-                       }
-                       request->send(400);
+                       this->handleMovementRequest(request, false);
                    });
 
     // GET /api/steppers/stop?id=<id>
@@ -266,26 +137,11 @@ void ESPStepperMotorServer_RestAPI::registerRestEndpoints(AsyncWebServer *httpSe
                    {
                        this->logDebugRequestUrl(request);
 
-                       if (request->hasParam("id", false))
+                       ESPStepperMotorServer_StepperConfiguration *stepper = this->getStepperFromRequest(request);
+                       if (stepper != NULL)
                        {
-                           int stepperIndex = request->getParam("id", false)->value().toInt();
-                           ESPStepperMotorServer_StepperConfiguration *stepper = this->_stepperMotorServer->getCurrentServerConfiguration()->getStepperConfiguration(stepperIndex);
-                           if (stepper == NULL)
-                           {
-                               request->send(404);
-                               return;
-                           }
-                           else
-                           {
-                               stepper->getFlexyStepper()->setTargetPositionToStop();
-                               request->send(204);
-                               return;
-                           }
-                       }
-                       else
-                       {
-                           request->send(400, "application/json", "{\"error\": \"Missing id paramter\"}");
-                           return;
+                           stepper->getFlexyStepper()->setTargetPositionToStop();
+                           request->send(204);
                        }
                    });
 
@@ -309,6 +165,176 @@ void ESPStepperMotorServer_RestAPI::registerRestEndpoints(AsyncWebServer *httpSe
                        return;
                    });
 
+    // POST /api/trajectories/record
+    // endpoint to start recording the target position changes of all steppers (e.g. while jogging with rotary encoders or via the REST API)
+    httpServer->on("/api/trajectories/record", HTTP_POST, [this](AsyncWebServerRequest *request)
+                   {
+                       this->logDebugRequestUrl(request);
+                       if (this->_stepperMotorServer->getMotionController()->getTrajectoryRecorder().startRecording())
+                       {
+                           request->send(204);
+                       }
+                       else
+                       {
+                           request->send(409, "application/json", "{\"error\": \"A trajectory is already being recorded or replayed\"}");
+                       }
+                   });
+
+    // POST /api/trajectories/stop
+    // endpoint to stop the current recording or replay
+    // see documentation of handler function for details
+    httpServer->on("/api/trajectories/stop", HTTP_POST, [this](AsyncWebServerRequest *request)
+                   {
+                       this->logDebugRequestUrl(request);
+                       this->handleTrajectoryStopRequest(request);
+                   });
+
+    // POST /api/trajectories/play
+    // endpoint to replay the last recording or a stored recording
+    // see documentation of handler function for details
+    httpServer->on("/api/trajectories/play", HTTP_POST, [this](AsyncWebServerRequest *request)
+                   {
+                       this->logDebugRequestUrl(request);
+                       this->handleTrajectoryPlayRequest(request);
+                   });
+
+    // GET /api/trajectories
+    // endpoint to list all recordings that are stored on the SPIFFS, along with the state of the recorder
+    httpServer->on("/api/trajectories", HTTP_GET, [this](AsyncWebServerRequest *request)
+                   {
+                       this->logDebugRequestUrl(request);
+
+                       ESPStepperMotorServer_TrajectoryRecorder &recorder = this->_stepperMotorServer->getMotionController()->getTrajectoryRecorder();
+                       StaticJsonDocument<1024> doc;
+                       JsonObject root = doc.to<JsonObject>();
+                       root["state"] = ESPStepperMotorServer_TrajectoryRecorder::getStateName(recorder.getState());
+                       root["samples"] = recorder.getSampleCount();
+                       root["overflow"] = recorder.isSampleBufferOverflown();
+                       ESPStepperMotorServer_TrajectoryRecorder::addRecordingsToJsonArray(root.createNestedArray("recordings"));
+                       String output;
+                       serializeJson(root, output);
+                       request->send(200, "application/json", output);
+                   });
+
+    // POST /api/sync/segment
+    // endpoint to start moves of steppers connected to the sync master and its followers at the same time
+    // see documentation of handler function for details
+    httpServer->on(
+        "/api/sync/segment", HTTP_POST, [](AsyncWebServerRequest *request) {}, NULL, [this](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total)
+        {
+            this->logDebugRequestUrl(request);
+            this->handleSyncSegmentRequest(request, data, len, index, total);
+        });
+
+#ifndef ESPStepperMotorServer_COMPILE_NO_GCODE
+    // POST /api/gcode/run?file=<path>
+    // endpoint to run a G-code file from the SPIFFS
+    httpServer->on("/api/gcode/run", HTTP_POST, [this](AsyncWebServerRequest *request)
+                   {
+                       this->logDebugRequestUrl(request);
+                       AsyncWebParameter *fileParameter = this->getRequestParameter(request, "file");
+                       if (fileParameter == NULL)
+                       {
+                           request->send(400, "application/json", "{\"error\": \"Missing file parameter\"}");
+                       }
+                       else if (this->_stepperMotorServer->getGCodeInterpreter()->isFileRunning())
+                       {
+                           request->send(409, "application/json", "{\"error\": \"Another G-code file is already running\"}");
+                       }
+                       else if (!this->_stepperMotorServer->getGCodeInterpreter()->runFile(fileParameter->value().c_str()))
+                       {
+                           request->send(404, "application/json", "{\"error\": \"G-code file not found\"}");
+                       }
+                       else
+                       {
+                           request->send(204);
+                       }
+                   });
+
+    // POST /api/gcode/pause
+    // endpoint to pause the running G-code file job after the current line
+    httpServer->on("/api/gcode/pause", HTTP_POST, [this](AsyncWebServerRequest *request)
+                   {
+                       this->logDebugRequestUrl(request);
+                       if (this->_stepperMotorServer->getGCodeInterpreter()->pauseJob())
+                       {
+                           request->send(204);
+                       }
+                       else
+                       {
+                           request->send(409, "application/json", "{\"error\": \"No G-code file is running\"}");
+                       }
+                   });
+
+    // POST /api/gcode/resume
+    // endpoint to continue a paused G-code file job
+    httpServer->on("/api/gcode/resume", HTTP_POST, [this](AsyncWebServerRequest *request)
+                   {
+                       this->logDebugRequestUrl(request);
+                       if (this->_stepperMotorServer->getGCodeInterpreter()->resumeJob())
+                       {
+                           request->send(204);
+                       }
+                       else
+                       {
+                           request->send(409, "application/json", "{\"error\": \"No G-code file is paused\"}");
+                       }
+                   });
+
+    // POST /api/gcode/abort
+    // endpoint to abort the running or paused G-code file job, a running move is stopped
+    httpServer->on("/api/gcode/abort", HTTP_POST, [this](AsyncWebServerRequest *request)
+                   {
+                       this->logDebugRequestUrl(request);
+                       if (this->_stepperMotorServer->getGCodeInterpreter()->abortJob())
+                       {
+                           request->send(204);
+                       }
+                       else
+                       {
+                           request->send(409, "application/json", "{\"error\": \"No G-code file is running\"}");
+                       }
+                   });
+
+    // GET /api/gcode
+    // endpoint to get the state of the G-code interpreter, the progress of the current (or last) file job and the axis mapping
+    httpServer->on("/api/gcode", HTTP_GET, [this](AsyncWebServerRequest *request)
+                   {
+                       this->logDebugRequestUrl(request);
+                       ESPStepperMotorServer_GCodeInterpreter *interpreter = this->_stepperMotorServer->getGCodeInterpreter();
+                       StaticJsonDocument<512> doc;
+                       JsonObject root = doc.to<JsonObject>();
+                       root["fileRunning"] = interpreter->isFileRunning();
+                       root["executedLines"] = interpreter->getExecutedLineCount();
+                       ESPStepperMotorServer_GCodeJobProgress progress;
+                       interpreter->getJobProgress(progress);
+                       JsonObject job = root.createNestedObject("job");
+                       job["state"] = ESPStepperMotorServer_GCodeInterpreter::getJobStateName(progress.state);
+                       job["file"] = interpreter->getJobPath();
+                       job["processedBytes"] = progress.processedBytes;
+                       job["fileSize"] = progress.fileSize;
+                       job["line"] = progress.lineNumber;
+                       job["executedLines"] = progress.executedLines;
+                       job["elapsedMs"] = progress.elapsedMs;
+                       job["remainingMs"] = progress.remainingMs;
+                       job["linesPerSecond"] = progress.linesPerSecond;
+                       job["bufferUnderruns"] = progress.bufferUnderruns;
+                       JsonObject axes = root.createNestedObject("axes");
+                       const char *axisNames[] = {"X", "Y", "Z", "A", "B", "C"};
+                       for (byte axisIndex = 0; axisIndex < ESPServerGCodeAxisCount; axisIndex++)
+                       {
+                           byte stepperId = interpreter->getAxisStepperId(axisNames[axisIndex][0]);
+                           if (stepperId != ESPServerGCodeUnmappedAxis)
+                           {
+                               axes[axisNames[axisIndex]] = stepperId;
+                           }
+                       }
+                       String output;
+                       serializeJson(root, output);
+                       request->send(200, "application/json", output);
+                   });
+
+#endif
     // GET /api/steppers
     // GET /api/steppers?id=<id>
     // endpoint to list all configured steppers or a specific one if "id" query parameter is given
@@ -327,7 +353,7 @@ void ESPStepperMotorServer_RestAPI::registerRestEndpoints(AsyncWebServer *httpSe
                                return;
                            }
 
-                           StaticJsonDocument<400> doc;
+                           StaticJsonDocument<530> doc;
                            JsonObject root = doc.to<JsonObject>();
                            JsonObject stepperDetails = root.createNestedObject("stepper");
                            this->populateStepperDetailsToJsonObject(stepperDetails, this->_stepperMotorServer->getCurrentServerConfiguration()->getStepperConfiguration(stepperIndex), stepperIndex);
@@ -335,7 +361,7 @@ void ESPStepperMotorServer_RestAPI::registerRestEndpoints(AsyncWebServer *httpSe
                        }
                        else
                        {
-                           const int docSize = 420 * ESPServerMaxSteppers;
+                           const int docSize = 550 * ESPServerMaxSteppers;
                            StaticJsonDocument<docSize> doc;
                            JsonObject root = doc.to<JsonObject>();
                            JsonArray steppers = root.createNestedArray("steppers");
@@ -345,7 +371,7 @@ void ESPStepperMotorServer_RestAPI::registerRestEndpoints(AsyncWebServer *httpSe
                                this->populateStepperDetailsToJsonObject(stepperDetails, this->_stepperMotorServer->getCurrentServerConfiguration()->getStepperConfiguration(i), i);
                            }
                            serializeJson(root, output);
-                           ESPStepperMotorServer_Logger::logDebugf("ArduinoJSON document size uses %i bytes from alocated %i bytes\n", doc.memoryUsage(), docSize);
+                           ESPServerLogDebugf("ArduinoJSON document size uses %i bytes from alocated %i bytes\n", doc.memoryUsage(), docSize);
                        }
 
                        AsyncWebServerResponse *response = request->beginResponse(200, "application/json", output);
@@ -428,12 +454,7 @@ void ESPStepperMotorServer_RestAPI::registerRestEndpoints(AsyncWebServer *httpSe
                            JsonObject root = doc.to<JsonObject>();
                            this->populateSwitchDetailsToJsonObject(root, this->_stepperMotorServer->getCurrentServerConfiguration()->getSwitch(switchIndex), switchIndex);
                            serializeJson(root, output);
-#ifndef ESPStepperMotorServer_COMPILE_NO_DEBUG
-                           if (ESPStepperMotorServer_Logger::isDebugEnabled())
-                           {
-                               ESPStepperMotorServer_Logger::logDebugf("ArduinoJSON document size uses %i bytes from alocated %i bytes\n", doc.memoryUsage(), switchObjectSize);
-                           }
-#endif
+                           ESPServerLogDebugf("ArduinoJSON document size uses %i bytes from alocated %i bytes\n", doc.memoryUsage(), switchObjectSize);
                        }
                        else
                        {
@@ -452,12 +473,7 @@ void ESPStepperMotorServer_RestAPI::registerRestEndpoints(AsyncWebServer *httpSe
                                }
                            }
                            serializeJson(root, output);
-#ifndef ESPStepperMotorServer_COMPILE_NO_DEBUG
-                           if (ESPStepperMotorServer_Logger::isDebugEnabled())
-                           {
-                               ESPStepperMotorServer_Logger::logDebugf("ArduinoJSON document size uses %i bytes from alocated %i bytes\n", doc.memoryUsage(), docSize);
-                           }
-#endif
+                           ESPServerLogDebugf("ArduinoJSON document size uses %i bytes from alocated %i bytes\n", doc.memoryUsage(), docSize);
                        }
 
                        AsyncWebServerResponse *response = request->beginResponse(200, "application/json", output);
@@ -513,12 +529,7 @@ void ESPStepperMotorServer_RestAPI::registerRestEndpoints(AsyncWebServer *httpSe
                            JsonObject root = doc.to<JsonObject>();
                            this->populateRotaryEncoderDetailsToJsonObject(root, this->_stepperMotorServer->getCurrentServerConfiguration()->getRotaryEncoder(rotaryEncoderIndex), rotaryEncoderIndex);
                            serializeJson(root, output);
-#ifndef ESPStepperMotorServer_COMPILE_NO_DEBUG
-                           if (ESPStepperMotorServer_Logger::isDebugEnabled())
-                           {
-                               ESPStepperMotorServer_Logger::logDebugf("ArduinoJSON document size uses %i bytes from alocated %i bytes\n", doc.memoryUsage(), rotaryEncoderObjectSize);
-                           }
-#endif
+                           ESPServerLogDebugf("ArduinoJSON document size uses %i bytes from alocated %i bytes\n", doc.memoryUsage(), rotaryEncoderObjectSize);
                        }
                        else
                        {
@@ -535,12 +546,7 @@ void ESPStepperMotorServer_RestAPI::registerRestEndpoints(AsyncWebServer *httpSe
                                }
                            }
                            serializeJson(root, output);
-#ifndef ESPStepperMotorServer_COMPILE_NO_DEBUG
-                           if (ESPStepperMotorServer_Logger::isDebugEnabled())
-                           {
-                               ESPStepperMotorServer_Logger::logDebugf("ArduinoJSON document size uses %i bytes from alocated %i bytes\n", doc.memoryUsage(), docSize);
-                           }
-#endif
+                           ESPServerLogDebugf("ArduinoJSON document size uses %i bytes from alocated %i bytes\n", doc.memoryUsage(), docSize);
                        }
 
                        AsyncWebServerResponse *response = request->beginResponse(200, "application/json", output);
@@ -619,7 +625,8 @@ void ESPStepperMotorServer_RestAPI::registerRestEndpoints(AsyncWebServer *httpSe
 
 /**
  * handler for the REST endpoint to perform a homing run.
- * This will call the goToLimitAndSetAsHome() function in the flexyStepper instance.
+ * The homing is performed by the motion controller in multiple phases: a fast seek toward the limit switch, a back off until the switch is released
+ * and a slow re-approach at which the switch position is latched as home position.
  * It will require that a home/limit switch is configured for this stepper, otherwise stepper will "never" (an absolute limit of 2000000000 steps is configured by default to somewhat limit the movement) come to a halt 
  * Required POST parameters: 
  *      id (id of the stepper motor to pefrom the homing command for)
@@ -628,63 +635,27 @@ void ESPStepperMotorServer_RestAPI::registerRestEndpoints(AsyncWebServer *httpSe
  *      switchId:  the id of the configured switch to use as limit switch, if parameter is omited the position switch from the configurtration of the stepper motor will be used, if none is configured, operation will fail)
  *      accel: the acceleration for the homing procdeure in steps/sec^2, if ommitted the previously defined acceleration in the flexy stepper instance will be used
  *      maxSteps: this parameter defines the maximum number of steps to perform before cancelling the homing procedure. This is kind of a safeguard to prevent endless spinning of the stepper motor. Defaults to 2000000000 steps
+ *      slowSpeed: the speed in steps per second for the final approach of the switch, defaults to speed / ESPServerHomingDefaultSlowSpeedDivider
+ *      backOff: the distance in steps to move away from the switch after it has been released, before the slow approach starts. Defaults to ESPServerHomingDefaultBackOffSteps
+ *      latchOffset: the distance in steps between the latched switch position and the home position, defaults to 0
  */
 void ESPStepperMotorServer_RestAPI::handleHomingRequest(AsyncWebServerRequest *request)
 {
     this->logDebugRequestUrl(request);
 
-    if (!request->hasParam("id"))
-    {
-        request->send(400, "application/json", "{\"error\": \"Missing stepper id parameter\"}");
-        return;
-    }
-
-    int stepperIndex = request->getParam("id")->value().toInt();
-    ESPStepperMotorServer_StepperConfiguration *stepperConfiguration = this->_stepperMotorServer->getCurrentServerConfiguration()->getStepperConfiguration(stepperIndex);
+    ESPStepperMotorServer_StepperConfiguration *stepperConfiguration = this->getStepperFromRequest(request);
     if (stepperConfiguration == NULL)
     {
-        request->send(404, "application/json", "{\"error\": \"No stepper configuration found for given stepper id\"}");
         return;
     }
+    const byte stepperIndex = stepperConfiguration->getId();
 
-    float speedInStepsPerSecond = 0;
-    if (request->hasParam("speed"))
+    ESPStepperMotorServer_HomingParameters homingParameters;
+    if (!this->extractHomingParameters(request, homingParameters))
     {
-        speedInStepsPerSecond = request->getParam("speed")->value().toFloat();
-        if (speedInStepsPerSecond <= 0)
-        {
-            request->send(400, "application/json", "{\"error\": \"Value for homing speed (in steps/second) must be larger than 0\"}");
-            return;
-        }
-    }
-    else
-    {
-        request->send(400, "application/json", "{\"error\": \"Missing parameter for speed (in steps/second)\"}");
         return;
     }
 
-    float accelInStepPerSecondSquare = 0;
-    if (request->hasParam("accel"))
-    {
-        accelInStepPerSecondSquare = request->getParam("accel")->value().toFloat();
-        if (accelInStepPerSecondSquare <= 0)
-        {
-            request->send(400, "application/json", "{\"error\": \"Acceleration value must be larger than 0\"}");
-            return;
-        }
-    }
-
-    unsigned int maxSteps = 2000000000;
-    if (request->hasParam("maxSteps"))
-    {
-        maxSteps = request->getParam("maxSteps")->value().toInt();
-        if (maxSteps < 1)
-        {
-            request->send(400, "application/json", "{\"error\": \"Max number of steps during homing must be larger than 0\"}");
-            return;
-        }
-    }
-
     ESPStepperMotorServer_PositionSwitch *switchConfig;
     signed char directionTowardHome = 1;
 
@@ -734,29 +705,290 @@ void ESPStepperMotorServer_RestAPI::handleHomingRequest(AsyncWebServerRequest *r
         }
     }
 
-    ESPStepperMotorServer_Logger::logDebugf("Received homing request for stepper with id %i and limit switch on GPIO %i. Homing speed to be set to %.2f steps per second. Max step limit set to %i\n", stepperIndex, gpioPinForSwitch, speedInStepsPerSecond, maxSteps);
+    ESPServerLogDebugf("Received homing request for stepper with id %i and limit switch on GPIO %i. Homing speed to be set to %.2f (fast) / %.2f (slow) steps per second. Max step limit set to %li\n", stepperIndex, gpioPinForSwitch, homingParameters.fastSpeed, homingParameters.slowSpeed, homingParameters.maxSteps);
+
+    homingParameters.directionTowardHome = (forcedDirectionTowardHome != 0) ? forcedDirectionTowardHome : directionTowardHome;
+    stepperConfiguration->getFlexyStepper()->setDirectionToHome(homingParameters.directionTowardHome);
 
-    ESP_FlexyStepper *stepper = stepperConfiguration->getFlexyStepper();
-    if (speedInStepsPerSecond > 0)
+    if (!this->_stepperMotorServer->getMotionController()->startHoming(stepperIndex, switchConfig->getId(), homingParameters))
     {
-        stepper->setSpeedInStepsPerSecond(speedInStepsPerSecond);
+        request->send(503, "application/json", "{\"error\": \"The homing procedure could not be started, too many pending homing requests\"}");
+        return;
     }
-    if (accelInStepPerSecondSquare > 0)
+    request->send(200, "application/json", "{\"status\": \"homing procedure started\"}");
+    return;
+}
+
+/**
+ * handler for the REST endpoint to home multiple steppers at once.
+ * Each stepper is homed with the first limit switch that is configured for it, the direction is derived from the switch type.
+ * Required POST parameters:
+ *      speed: the speed in steps per second to seek the limit switches with
+ * Optional POST parameters:
+ *      order: the stepper ids to home. Ids separated by "," are homed in parallel, groups separated by ";" are homed one after the other
+ *             (e.g. "2;0,1" homes stepper 2 first, then steppers 0 and 1 together). If omitted, all steppers with a configured limit switch are homed in parallel
+ *      accel, maxSteps, slowSpeed, backOff, latchOffset: see handleHomingRequest, the values are used for all steppers
+ */
+void ESPStepperMotorServer_RestAPI::handleHomeAllRequest(AsyncWebServerRequest *request)
+{
+    ESPStepperMotorServer_HomingParameters homingParameters;
+    if (!this->extractHomingParameters(request, homingParameters))
     {
-        stepper->setAccelerationInStepsPerSecondPerSecond(accelInStepPerSecondSquare);
+        return;
     }
 
-    if (forcedDirectionTowardHome != 0)
+    ESPStepperMotorServer_Configuration *configuration = this->_stepperMotorServer->getCurrentServerConfiguration();
+    // the group number each stepper is homed in, 0 = stepper is not homed
+    byte homingGroups[ESPServerMaxSteppers] = {0};
+    AsyncWebParameter *orderParameter = this->getRequestParameter(request, "order");
+    if (orderParameter)
     {
-        stepper->setDirectionToHome(forcedDirectionTowardHome);
+        const char *order = orderParameter->value().c_str();
+        byte group = 1;
+        while (*order != '\0')
+        {
+            char *end;
+            long stepperIndex = strtol(order, &end, 10);
+            if (end == order || (*end != ',' && *end != ';' && *end != '\0') || stepperIndex < 0 || stepperIndex >= ESPServerMaxSteppers || homingGroups[stepperIndex] != 0 || configuration->getStepperConfiguration(stepperIndex) == NULL || configuration->getFirstConfiguredLimitSwitchForStepper(stepperIndex) == NULL)
+            {
+                request->send(400, "application/json", "{\"error\": \"Invalid order parameter. Expected a list of stepper ids with configured limit switches, separated by ',' (parallel) or ';' (sequential)\"}");
+                return;
+            }
+            homingGroups[stepperIndex] = group;
+            if (*end == ';')
+            {
+                group++;
+            }
+            order = (*end == '\0') ? end : end + 1;
+        }
     }
     else
     {
-        stepper->setDirectionToHome(directionTowardHome);
+        for (byte stepperIndex = 0; stepperIndex < ESPServerMaxSteppers; stepperIndex++)
+        {
+            if (configuration->getStepperConfiguration(stepperIndex) != NULL && configuration->getFirstConfiguredLimitSwitchForStepper(stepperIndex) != NULL)
+            {
+                homingGroups[stepperIndex] = 1;
+            }
+        }
+    }
+
+    byte homedStepperCount = 0;
+    for (byte stepperIndex = 0; stepperIndex < ESPServerMaxSteppers; stepperIndex++)
+    {
+        if (homingGroups[stepperIndex] == 0)
+        {
+            continue;
+        }
+        ESPStepperMotorServer_PositionSwitch *switchConfig = configuration->getFirstConfiguredLimitSwitchForStepper(stepperIndex);
+        homingParameters.directionTowardHome = (switchConfig->isTypeBitSet(SWITCHTYPE_LIMITSWITCH_POS_BEGIN_BIT)) ? -1 : 1;
+        configuration->getStepperConfiguration(stepperIndex)->getFlexyStepper()->setDirectionToHome(homingParameters.directionTowardHome);
+        if (!this->_stepperMotorServer->getMotionController()->startHoming(stepperIndex, switchConfig->getId(), homingParameters, homingGroups[stepperIndex]))
+        {
+            // drops the requests of this sequence that have already been queued (the abort itself does not need a free queue slot)
+            this->_stepperMotorServer->getMotionController()->abortHoming();
+            request->send(503, "application/json", "{\"error\": \"The homing procedure could not be started, too many pending homing requests\"}");
+            return;
+        }
+        homedStepperCount++;
+    }
+
+    if (homedStepperCount == 0)
+    {
+        request->send(400, "application/json", "{\"error\": \"No stepper with a configured limit switch found\"}");
+        return;
     }
-    stepper->goToLimitAndSetAsHome(NULL, maxSteps);
+    ESPServerLogInfof("Homing of %i steppers requested\n", homedStepperCount);
     request->send(200, "application/json", "{\"status\": \"homing procedure started\"}");
-    return;
+}
+
+/**
+ * handler for the trajectory stop endpoint.
+ * Stops the current recording or replay. If a recording has been stopped, it can be stored on the SPIFFS with the given name.
+ * Optional POST parameters:
+ *      name: the name to store the recording with (letters, digits, '-' and '_', up to 16 characters). An existing recording with the same name is replaced
+ */
+void ESPStepperMotorServer_RestAPI::handleTrajectoryStopRequest(AsyncWebServerRequest *request)
+{
+    ESPStepperMotorServer_TrajectoryRecorder &recorder = this->_stepperMotorServer->getMotionController()->getTrajectoryRecorder();
+    AsyncWebParameter *nameParameter = this->getRequestParameter(request, "name");
+    if (nameParameter && !ESPStepperMotorServer_TrajectoryRecorder::isValidRecordingName(nameParameter->value().c_str()))
+    {
+        request->send(400, "application/json", "{\"error\": \"Invalid name parameter. Only letters, digits, '-' and '_' are allowed (up to 16 characters)\"}");
+        return;
+    }
+    recorder.stop();
+    if (nameParameter && !recorder.saveRecording(nameParameter->value().c_str()))
+    {
+        request->send(500, "application/json", "{\"error\": \"Failed to store the recording on the SPIFFS\"}");
+        return;
+    }
+    char output[64];
+    snprintf(output, sizeof(output), "{\"samples\": %u, \"overflow\": %s}", recorder.getSampleCount(), (recorder.isSampleBufferOverflown()) ? "true" : "false");
+    request->send(200, "application/json", output);
+}
+
+/**
+ * handler for the trajectory play endpoint.
+ * Optional POST parameters:
+ *      name: the name of a stored recording to replay. If omitted, the last recording is replayed
+ *      timeScale: 2 replays the recording twice as fast, 0.5 with half of the speed (default 1). 0 sends each target as soon as all steppers reached the previous one
+ */
+void ESPStepperMotorServer_RestAPI::handleTrajectoryPlayRequest(AsyncWebServerRequest *request)
+{
+    ESPStepperMotorServer_TrajectoryRecorder &recorder = this->_stepperMotorServer->getMotionController()->getTrajectoryRecorder();
+    float timeScale = 1;
+    if (!this->parseFloatParameter(request, "timeScale", timeScale))
+    {
+        return;
+    }
+    if (timeScale < 0)
+    {
+        request->send(400, "application/json", "{\"error\": \"The timeScale parameter must not be negative\"}");
+        return;
+    }
+    if (recorder.getState() != ESPServerTrajectoryState_Idle)
+    {
+        request->send(409, "application/json", "{\"error\": \"A trajectory is already being recorded or replayed\"}");
+        return;
+    }
+    AsyncWebParameter *nameParameter = this->getRequestParameter(request, "name");
+    if (nameParameter && !recorder.loadRecording(nameParameter->value().c_str()))
+    {
+        request->send(404, "application/json", "{\"error\": \"No valid recording found for the given name\"}");
+        return;
+    }
+    if (this->_stepperMotorServer->emergencySwitchIsActive || !recorder.startReplay(timeScale))
+    {
+        request->send(409, "application/json", "{\"error\": \"The replay could not be started, no samples recorded or emergency stop active\"}");
+        return;
+    }
+    request->send(204);
+}
+
+/**
+ * handler for the sync segment endpoint, only available on the sync master.
+ * Expects a JSON body with the moves of the segment and an optional lead time in ms, e.g.
+ * {"leadTimeMs": 20, "moves": [{"node": 0, "id": 0, "position": 2000, "speed": 800, "accel": 400}, {"node": 1, "id": 0, "position": -500, "speed": 200, "accel": 100}]}
+ * node is the id of the controller the stepper is connected to (0 = master), position is the absolute target in steps.
+ * Responds with the id of the segment and its start time in master us
+ */
+void ESPStepperMotorServer_RestAPI::handleSyncSegmentRequest(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total)
+{
+    ESPStepperMotorServer_SyncController *syncController = this->_stepperMotorServer->getSyncController();
+    if (syncController == NULL || syncController->getRole() != ESPServerSyncRole_Master)
+    {
+        request->send(409, "application/json", "{\"error\": \"This server is not running as sync master\"}");
+        return;
+    }
+    StaticJsonDocument<768> doc;
+    DeserializationError error = deserializeJson(doc, (const char *)data, len);
+    if (error)
+    {
+        request->send_P(400, "application/json", ESPServerRestResponse_InvalidJson);
+        ESPStepperMotorServer_Logger::logWarningf("Error while trying to deserialize JSON request: %s", error.c_str());
+        return;
+    }
+    JsonArray moves = doc["moves"];
+    if (moves.isNull() || moves.size() == 0 || moves.size() > ESPServerSyncMaxSegmentMoves)
+    {
+        request->send(400, "application/json", "{\"error\": \"Invalid number of moves in the moves array\"}");
+        return;
+    }
+
+    ESPStepperMotorServer_SyncSegment segment;
+    segment.moveCount = 0;
+    for (JsonObject move : moves)
+    {
+        if (!move.containsKey("id") || !move.containsKey("position") || (move["speed"] | 0.0f) <= 0 || (move["accel"] | 0.0f) <= 0)
+        {
+            request->send(400, "application/json", "{\"error\": \"Each move needs an id, a position and a speed and accel greater than 0\"}");
+            return;
+        }
+        ESPStepperMotorServer_SyncMove &syncMove = segment.moves[segment.moveCount++];
+        syncMove.nodeId = move["node"] | 0;
+        syncMove.stepperId = move["id"];
+        syncMove.targetPositionInSteps = move["position"];
+        syncMove.speedInStepsPerSecond = move["speed"];
+        syncMove.accelerationInStepsPerSecondPerSecond = move["accel"];
+    }
+
+    if (this->_stepperMotorServer->emergencySwitchIsActive)
+    {
+        request->send(409, "application/json", "{\"error\": \"Emergency stop is active\"}");
+        return;
+    }
+    unsigned long leadTimeMs = doc["leadTimeMs"] | ESPServerSyncLeadTimeMs;
+    if (!syncController->sendSegment(segment, leadTimeMs))
+    {
+        request->send(409, "application/json", "{\"error\": \"The segment queue is full\"}");
+        return;
+    }
+    char output[80];
+    snprintf(output, sizeof(output), "{\"segmentId\": %u, \"startMasterMicros\": %lu}", segment.segmentId, (unsigned long)segment.startMasterMicros);
+    request->send(200, "application/json", output);
+}
+
+/**
+ * extract and validate the homing parameters that are shared by the returnhome and the homeall endpoints.
+ * The direction toward home is not set by this function, since it depends on the limit switch of each stepper.
+ * Returns false if the request is invalid, in this case the error response has already been sent
+ */
+bool ESPStepperMotorServer_RestAPI::extractHomingParameters(AsyncWebServerRequest *request, ESPStepperMotorServer_HomingParameters &parameters)
+{
+    memset(&parameters, 0, sizeof(parameters));
+    if (this->getRequestParameter(request, "speed") == NULL)
+    {
+        request->send(400, "application/json", "{\"error\": \"Missing parameter for speed (in steps/second)\"}");
+        return false;
+    }
+    if (!this->parseFloatParameter(request, "speed", parameters.fastSpeed))
+    {
+        return false;
+    }
+    if (parameters.fastSpeed <= 0)
+    {
+        request->send(400, "application/json", "{\"error\": \"Value for homing speed (in steps/second) must be larger than 0\"}");
+        return false;
+    }
+
+    if (!this->parseFloatParameter(request, "accel", parameters.acceleration))
+    {
+        return false;
+    }
+    if (this->getRequestParameter(request, "accel") && parameters.acceleration <= 0)
+    {
+        request->send(400, "application/json", "{\"error\": \"Acceleration value must be larger than 0\"}");
+        return false;
+    }
+
+    float maxSteps = 2000000000;
+    if (!this->parseFloatParameter(request, "maxSteps", maxSteps))
+    {
+        return false;
+    }
+    if (maxSteps < 1)
+    {
+        request->send(400, "application/json", "{\"error\": \"Max number of steps during homing must be larger than 0\"}");
+        return false;
+    }
+    parameters.maxSteps = (long)maxSteps;
+
+    parameters.slowSpeed = parameters.fastSpeed / ESPServerHomingDefaultSlowSpeedDivider;
+    float backOffSteps = ESPServerHomingDefaultBackOffSteps;
+    float latchOffsetSteps = 0;
+    if (!this->parseFloatParameter(request, "slowSpeed", parameters.slowSpeed) || !this->parseFloatParameter(request, "backOff", backOffSteps) || !this->parseFloatParameter(request, "latchOffset", latchOffsetSteps))
+    {
+        return false;
+    }
+    if (parameters.slowSpeed <= 0 || backOffSteps < 1 || latchOffsetSteps < 0)
+    {
+        request->send(400, "application/json", "{\"error\": \"Slow speed and back off distance must be larger than 0, latch offset must not be negative\"}");
+        return false;
+    }
+    parameters.backOffSteps = (long)backOffSteps;
+    parameters.latchOffsetSteps = (long)latchOffsetSteps;
+    return true;
 }
 
 void ESPStepperMotorServer_RestAPI::populateSwitchDetailsToJsonObject(JsonObject &switchDetails, ESPStepperMotorServer_PositionSwitch *positionSwitch, int index)
@@ -800,6 +1032,14 @@ void ESPStepperMotorServer_RestAPI::populateStepperDetailsToJsonObject(JsonObjec
         stepperDetails["brakePinActiveState"] = stepper->getBrakePinActiveState();
         stepperDetails["brakeEngageDelayMs"] = stepper->getBrakeEngageDelayMs();
         stepperDetails["brakeReleaseDelayMs"] = stepper->getBrakeReleaseDelayMs();
+        stepperDetails["enablePin"] = stepper->getEnableIoPin();
+        stepperDetails["enablePinActiveState"] = stepper->getEnablePinActiveState();
+        stepperDetails["driverDisableDelayMs"] = stepper->getDriverDisableDelayMs();
+
+        JsonObject softLimits = stepperDetails.createNestedObject("softLimits");
+        softLimits["mode"] = stepper->getSoftLimitMode();
+        softLimits["min"] = stepper->getSoftLimitMinPositionInSteps();
+        softLimits["max"] = stepper->getSoftLimitMaxPositionInSteps();
 
         stepperDetails["stepsPerMM"] = stepper->getStepsPerMM();
         stepperDetails["stepsPerRev"] = stepper->getStepsPerRev();
@@ -816,6 +1056,7 @@ void ESPStepperMotorServer_RestAPI::populateStepperDetailsToJsonObject(JsonObjec
         stepperStatus["steps_s"] = stepper->getFlexyStepper()->getCurrentVelocityInStepsPerSecond();
 
         stepperDetails["stopped"] = stepper->getFlexyStepper()->motionComplete();
+        stepperDetails["homing"] = ESPStepperMotorServer_HomingStateMachine::getPhaseName(this->_stepperMotorServer->getMotionController()->getHomingPhase(index));
     }
 }
 
@@ -825,27 +1066,218 @@ void ESPStepperMotorServer_RestAPI::logDebugRequestUrl(AsyncWebServerRequest *re
     if (ESPStepperMotorServer_Logger::isDebugEnabled())
     {
         int params = request->params();
-        ESPStepperMotorServer_Logger::logDebug((String)request->methodToString() + " called" + request->url() + ((params > 0) ? " with parameters: " : ""), (params == 0));
+        ESPServerLogDebug((String)request->methodToString() + " called" + request->url() + ((params > 0) ? " with parameters: " : ""), (params == 0));
         for (int i = 0; i < params; i++)
         {
             AsyncWebParameter *p = request->getParam(i);
             if (!p->isFile() && !p->isPost())
             {
-                ESPStepperMotorServer_Logger::logDebug(p->name() + "=" + p->value() + ((i < params - 1) ? ", " : ""), (i == params - 1), true);
+                ESPServerLogDebug(p->name() + "=" + p->value() + ((i < params - 1) ? ", " : ""), (i == params - 1), true);
             }
         }
     }
 #endif
 }
 
+/**
+ * get the request parameter with the given name, no matter if it has been sent as query or as POST parameter.
+ * Returns NULL if the parameter is not present in the request
+ */
+AsyncWebParameter *ESPStepperMotorServer_RestAPI::getRequestParameter(AsyncWebServerRequest *request, const char *name)
+{
+    const size_t params = request->params();
+    for (size_t i = 0; i < params; i++)
+    {
+        AsyncWebParameter *parameter = request->getParam(i);
+        if (!parameter->isFile() && strcmp(parameter->name().c_str(), name) == 0)
+        {
+            return parameter;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * parse the request parameter with the given name into the given float value.
+ * If the parameter is not present, the value is not changed.
+ * Returns false if the parameter is present but not a valid, finite number (e.g. "nan", "inf" or a value that overflows a float),
+ * in this case the error response has already been sent
+ */
+bool ESPStepperMotorServer_RestAPI::parseFloatParameter(AsyncWebServerRequest *request, const char *name, float &value)
+{
+    AsyncWebParameter *parameter = this->getRequestParameter(request, name);
+    if (parameter == NULL)
+    {
+        return true;
+    }
+    const char *text = parameter->value().c_str();
+    char *end;
+    float parsedValue = strtof(text, &end);
+    if (end == text || *end != '\0' || !isfinite(parsedValue))
+    {
+        request->send_P(400, "application/json", ESPServerRestResponse_InvalidNumber);
+        return false;
+    }
+    value = parsedValue;
+    return true;
+}
+
+/**
+ * get the stepper configuration for the "id" parameter of the given request.
+ * Returns NULL if the parameter is missing or no stepper is configured for the given id, in this case the error response has already been sent
+ */
+ESPStepperMotorServer_StepperConfiguration *ESPStepperMotorServer_RestAPI::getStepperFromRequest(AsyncWebServerRequest *request)
+{
+    AsyncWebParameter *idParameter = this->getRequestParameter(request, "id");
+    if (idParameter == NULL)
+    {
+        request->send_P(400, "application/json", ESPServerRestResponse_MissingId);
+        return NULL;
+    }
+    const char *text = idParameter->value().c_str();
+    char *end;
+    long stepperIndex = strtol(text, &end, 10);
+    ESPStepperMotorServer_StepperConfiguration *stepper = NULL;
+    if (end != text && *end == '\0' && stepperIndex >= 0 && stepperIndex < ESPServerMaxSteppers)
+    {
+        stepper = this->_stepperMotorServer->getCurrentServerConfiguration()->getStepperConfiguration(stepperIndex);
+    }
+    if (stepper == NULL)
+    {
+        request->send_P(404, "application/json", ESPServerRestResponse_StepperNotFound);
+    }
+    return stepper;
+}
+
+/**
+ * extract and validate all parameters of a movement request (stepper id, value, unit and the optional speed, accel and decel parameters).
+ * Returns false if the request is invalid, in this case the error response has already been sent
+ */
+bool ESPStepperMotorServer_RestAPI::extractMovementParameters(AsyncWebServerRequest *request, ESPStepperMotorServer_MovementParameters &parameters)
+{
+    memset(&parameters, 0, sizeof(parameters));
+    parameters.stepper = this->getStepperFromRequest(request);
+    if (parameters.stepper == NULL)
+    {
+        return false;
+    }
+    if (!this->parseFloatParameter(request, "speed", parameters.speed) || !this->parseFloatParameter(request, "accel", parameters.accel) || !this->parseFloatParameter(request, "decel", parameters.decel))
+    {
+        return false;
+    }
+
+    AsyncWebParameter *unitParameter = this->getRequestParameter(request, "unit");
+    if (unitParameter == NULL || this->getRequestParameter(request, "value") == NULL)
+    {
+        request->send_P(400, "application/json", ESPServerRestResponse_MissingValueOrUnit);
+        return false;
+    }
+    const char *unit = unitParameter->value().c_str();
+    if (strcmp(unit, "steps") == 0)
+    {
+        parameters.unit = ESPServerPositionUnit_Steps;
+    }
+    else if (strcmp(unit, "mm") == 0)
+    {
+        parameters.unit = ESPServerPositionUnit_Millimeters;
+    }
+    else if (strcmp(unit, "revs") == 0)
+    {
+        parameters.unit = ESPServerPositionUnit_Revolutions;
+    }
+    else
+    {
+        request->send_P(400, "application/json", ESPServerRestResponse_InvalidUnit);
+        return false;
+    }
+    return this->parseFloatParameter(request, "value", parameters.value);
+}
+
+/**
+ * set the optional speed, acceleration and deceleration values of a movement request in the flexy stepper instance.
+ * Values that are not larger than 0 (or have not been given) are ignored
+ */
+void ESPStepperMotorServer_RestAPI::applySpeedAndAcceleration(const ESPStepperMotorServer_MovementParameters &parameters)
+{
+    ESP_FlexyStepper *flexyStepper = parameters.stepper->getFlexyStepper();
+    if (parameters.speed > 0)
+    {
+        flexyStepper->setSpeedInStepsPerSecond(parameters.speed);
+    }
+    if (parameters.accel > 0)
+    {
+        flexyStepper->setAccelerationInStepsPerSecondPerSecond(parameters.accel);
+        //in case deceleration is not explicitly given, we just use the same value
+        flexyStepper->setDecelerationInStepsPerSecondPerSecond(parameters.accel);
+    }
+    if (parameters.decel > 0)
+    {
+        flexyStepper->setDecelerationInStepsPerSecondPerSecond(parameters.decel);
+    }
+}
+
+/**
+ * handler for the moveby and position endpoints.
+ * The requested target is converted to an absolute position in steps and checked against the soft limits of the stepper before it is set,
+ * so the motion loop itself does not need to check the limits.
+ * Responses:
+ *      204: target position has been set as requested
+ *      200: target position was outside of the soft limits and has been clamped, the response contains the clamped target in steps
+ *      400: invalid request or target position outside of the soft limits (if the soft limit mode of the stepper is "reject")
+ */
+void ESPStepperMotorServer_RestAPI::handleMovementRequest(AsyncWebServerRequest *request, bool isRelativeMovement)
+{
+    ESPStepperMotorServer_MovementParameters parameters;
+    if (!this->extractMovementParameters(request, parameters))
+    {
+        return;
+    }
+    ESPStepperMotorServer_StepperConfiguration *stepper = parameters.stepper;
+    long targetPositionInSteps;
+    switch (parameters.unit)
+    {
+    case ESPServerPositionUnit_Millimeters:
+        targetPositionInSteps = stepper->getStepsForMillimeters(parameters.value);
+        break;
+    case ESPServerPositionUnit_Revolutions:
+        targetPositionInSteps = stepper->getStepsForRevolutions(parameters.value);
+        break;
+    default:
+        targetPositionInSteps = (long)parameters.value;
+        break;
+    }
+    if (isRelativeMovement)
+    {
+        targetPositionInSteps += stepper->getFlexyStepper()->getCurrentPositionInSteps();
+    }
+
+    char output[160];
+    byte softLimitResult = stepper->applySoftLimits(targetPositionInSteps);
+    if (softLimitResult == ESPServerSoftLimitResult_Rejected)
+    {
+        snprintf(output, sizeof(output), "{\"error\": \"Target position %ld is outside of the soft limits\", \"min\": %ld, \"max\": %ld}", targetPositionInSteps, stepper->getSoftLimitMinPositionInSteps(), stepper->getSoftLimitMaxPositionInSteps());
+        request->send(400, "application/json", output);
+        return;
+    }
+    this->applySpeedAndAcceleration(parameters);
+    stepper->getFlexyStepper()->setTargetPositionInSteps(targetPositionInSteps);
+    if (softLimitResult == ESPServerSoftLimitResult_Clamped)
+    {
+        snprintf(output, sizeof(output), "{\"warning\": \"Target position has been clamped to the soft limits\", \"steps\": %ld}", targetPositionInSteps);
+        request->send(200, "application/json", output);
+        return;
+    }
+    request->send(204);
+}
+
 // request handlers
 void ESPStepperMotorServer_RestAPI::handlePostStepperRequest(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total, int stepperIndex)
 {
-    StaticJsonDocument<500> doc;
+    StaticJsonDocument<600> doc;
     DeserializationError error = deserializeJson(doc, (const char *)data);
     if (error)
     {
-        request->send(400, "application/json", "{\"error\": \"Invalid JSON request, deserialization failed\"}");
+        request->send_P(400, "application/json", ESPServerRestResponse_InvalidJson);
         ESPStepperMotorServer_Logger::logWarningf("Error while trying to deserialize JSON request: %s", error.c_str());
     }
     else
@@ -864,7 +1296,18 @@ void ESPStepperMotorServer_RestAPI::handlePostStepperRequest(AsyncWebServerReque
             int brakeEngageDelayMs = doc["brakeEngageDelayMs"];
             int brakeReleaseDelayMs = doc["brakeReleaseDelayMs"];
 
-            if (stepPin >= 0 && stepPin <= ESPStepperHighestAllowedIoPin && dirPin >= 0 && dirPin <= ESPStepperHighestAllowedIoPin && dirPin != stepPin)
+            int enablePin = doc["enablePin"] | ESPStepperMotorServer_StepperConfiguration::ESPServerStepperUnsetIoPinNumber;
+            int enablePinActiveState = doc["enablePinActiveState"] | 2;
+            long driverDisableDelayMs = doc["driverDisableDelayMs"] | -1;
+
+            long softLimitMin = doc["softLimitMin"] | 0L;
+            long softLimitMax = doc["softLimitMax"] | 0L;
+            int softLimitMode = doc["softLimitMode"] | ESPServerSoftLimitMode_Disabled;
+
+            // step and dir pin are either both IO pins or both outputs of the shift register chain (if enabled)
+            bool isValidIoPinPair = stepPin >= 0 && stepPin <= ESPStepperHighestAllowedIoPin && dirPin >= 0 && dirPin <= ESPStepperHighestAllowedIoPin;
+            bool isValidShiftRegisterPinPair = ESPServerIsShiftRegisterPin(stepPin) && ESPServerIsShiftRegisterPin(dirPin);
+            if ((isValidIoPinPair || isValidShiftRegisterPinPair) && dirPin != stepPin)
             {
                 ESPStepperMotorServer_StepperConfiguration *stepper = this->_stepperMotorServer->getCurrentServerConfiguration()->getStepperConfiguration(stepperIndex);
                 //check if pins are already in use by a stepper or switch configuration (that is not the current stepper to be updated)
@@ -880,10 +1323,18 @@ void ESPStepperMotorServer_RestAPI::handlePostStepperRequest(AsyncWebServerReque
                 {
                     request->send(400, "application/json", "{\"error\": \"The given BRAKE IO pin is already used by another stepper or a switch configuration\"}");
                 }
+                else if (enablePin != ESPStepperMotorServer_StepperConfiguration::ESPServerStepperUnsetIoPinNumber && (enablePin < 0 || enablePin > ESPStepperHighestAllowedIoPin || enablePin == stepPin || enablePin == dirPin || enablePin == brakePin || (this->_stepperMotorServer->isIoPinUsed(enablePin) && (stepper == NULL || stepper->getEnableIoPin() != enablePin))))
+                {
+                    request->send(400, "application/json", "{\"error\": \"The given ENABLE IO pin is invalid or already used by another stepper or a switch configuration\"}");
+                }
+                else if (softLimitMode < ESPServerSoftLimitMode_Disabled || softLimitMode > ESPServerSoftLimitMode_Clamp || (softLimitMode != ESPServerSoftLimitMode_Disabled && softLimitMin > softLimitMax))
+                {
+                    request->send(400, "application/json", "{\"error\": \"Invalid soft limits given. softLimitMode must be 0 (disabled), 1 (reject) or 2 (clamp) and softLimitMin must not be larger than softLimitMax\"}");
+                }
                 else
                 {
                     int newId = -1;
-                    ESPStepperMotorServer_StepperConfiguration *stepperToAdd = new ESPStepperMotorServer_StepperConfiguration(stepPin, dirPin);
+                    ESPStepperMotorServer_StepperConfiguration *stepperToAdd = ESPStepperMotorServer_Configuration::getStepperConfigurationPool().create(stepPin, dirPin);
                     stepperToAdd->setDisplayName(name);
                     stepperToAdd->setStepsPerMM(stepsPerMM);
                     stepperToAdd->setStepsPerRev(stepsPerRev);
@@ -894,6 +1345,9 @@ void ESPStepperMotorServer_RestAPI::handlePostStepperRequest(AsyncWebServerReque
                     }
                     stepperToAdd->setBrakeEngageDelayMs(brakeEngageDelayMs);
                     stepperToAdd->setBrakeReleaseDelayMs(brakeReleaseDelayMs);
+                    stepperToAdd->setEnableIoPin(enablePin, enablePinActiveState);
+                    stepperToAdd->setDriverDisableDelayMs(driverDisableDelayMs);
+                    stepperToAdd->setSoftLimits(softLimitMin, softLimitMax, softLimitMode);
 
                     if (stepperIndex == -1)
                     {
@@ -913,7 +1367,7 @@ void ESPStepperMotorServer_RestAPI::handlePostStepperRequest(AsyncWebServerReque
             }
             else
             {
-                request->send(400, "application/json", "{\"error\": \"Invalid IO pin number given or step and dir pin are the same\"}");
+                request->send(400, "application/json", "{\"error\": \"Invalid IO pin number given, step and dir pin are the same or only one of them is a shift register output\"}");
             }
         }
         else
@@ -940,7 +1394,7 @@ int ESPStepperMotorServer_RestAPI::handleDeleteStepperRequest(AsyncWebServerRequ
     }
     if (sendReponse)
     {
-        request->send(404, "application/json", "{\"error\": \"Invalid stepper id\"}");
+        request->send_P(404, "application/json", ESPServerRestResponse_StepperNotFound);
     }
     return 404;
 }
@@ -951,7 +1405,7 @@ void ESPStepperMotorServer_RestAPI::handlePostRotaryEncoderRequest(AsyncWebServe
     DeserializationError error = deserializeJson(doc, (const char *)data);
     if (error)
     {
-        request->send(400, "application/json", "{\"error\": \"Invalid JSON request, deserialization failed\"}");
+        request->send_P(400, "application/json", ESPServerRestResponse_InvalidJson);
         ESPStepperMotorServer_Logger::logWarningf("Error while trying to deserialize JSON request: %s", error.c_str());
     }
     else
@@ -994,7 +1448,7 @@ void ESPStepperMotorServer_RestAPI::handlePostRotaryEncoderRequest(AsyncWebServe
                     }
                 }
 
-                ESPStepperMotorServer_RotaryEncoder *encoderToAdd = new ESPStepperMotorServer_RotaryEncoder(pinA, pinB, displayName, stepMultiplier, stepperIndex);
+                ESPStepperMotorServer_RotaryEncoder *encoderToAdd = ESPStepperMotorServer_Configuration::getRotaryEncoderPool().create(pinA, pinB, displayName, stepMultiplier, stepperIndex);
                 if (encoderIndex == -1)
                 {
                     encoderIndex = this->_stepperMotorServer->addOrUpdateRotaryEncoder(encoderToAdd);
@@ -1074,7 +1528,7 @@ void ESPStepperMotorServer_RestAPI::handlePostSwitchRequest(AsyncWebServerReques
     DeserializationError error = deserializeJson(doc, (const char *)data);
     if (error)
     {
-        request->send(400, "application/json", "{\"error\": \"Invalid JSON request, deserialization failed\"}");
+        request->send_P(400, "application/json", ESPServerRestResponse_InvalidJson);
         ESPStepperMotorServer_Logger::logWarningf("Error while trying to deserialize JSON request: %s", error.c_str());
     }
     else
@@ -1114,7 +1568,7 @@ void ESPStepperMotorServer_RestAPI::handlePostSwitchRequest(AsyncWebServerReques
                     return;
                 }
 
-                ESPStepperMotorServer_PositionSwitch *posSwitchToAdd = new ESPStepperMotorServer_PositionSwitch(ioPinNumber, stepperConfigIndex, switchType, name, switchPosition);
+                ESPStepperMotorServer_PositionSwitch *posSwitchToAdd = ESPStepperMotorServer_Configuration::getSwitchPool().create(ioPinNumber, stepperConfigIndex, switchType, name, switchPosition);
 
                 if (doc[this->_stepperMotorServer->getCurrentServerConfiguration()->JSON_SECTION_NAME_SWITCH_CONFIGURATION_MACROACTIONS])
                 {
@@ -37,12 +37,29 @@
 #include <ArduinoJson.h>
 #include <ESPStepperMotorServer_PositionSwitch.h>
 #include <ESPStepperMotorServer_Logger.h>
+#include <ESPStepperMotorServer_Homing.h>
 #include <ESPStepperMotorServer.h>
 #include <ESP_FlexyStepper.h>
 
+#define ESPServerPositionUnit_Steps 1
+#define ESPServerPositionUnit_Millimeters 2
+#define ESPServerPositionUnit_Revolutions 3
+
 //just declare class here for compiler, since we have a circular dependency
 class ESPStepperMotorServer;
 
+// the validated parameters of a movement request (moveby / position endpoints).
+// Optional values that have not been given in the request are set to 0
+struct ESPStepperMotorServer_MovementParameters
+{
+  ESPStepperMotorServer_StepperConfiguration *stepper;
+  float speed;
+  float accel;
+  float decel;
+  float value;
+  byte unit; // one of the ESPServerPositionUnit_* values
+};
+
 class ESPStepperMotorServer_RestAPI
 {
 public:
@@ -61,9 +78,20 @@ private:
   void populateRotaryEncoderDetailsToJsonObject(JsonObject &detailsObjecToPopulate, ESPStepperMotorServer_RotaryEncoder *rotaryEncoder, int index);
   
   void logDebugRequestUrl(AsyncWebServerRequest *request);
+  AsyncWebParameter *getRequestParameter(AsyncWebServerRequest *request, const char *name);
+  bool parseFloatParameter(AsyncWebServerRequest *request, const char *name, float &value);
+  ESPStepperMotorServer_StepperConfiguration *getStepperFromRequest(AsyncWebServerRequest *request);
+  bool extractMovementParameters(AsyncWebServerRequest *request, ESPStepperMotorServer_MovementParameters &parameters);
+  void applySpeedAndAcceleration(const ESPStepperMotorServer_MovementParameters &parameters);
 
   //movement related endpoints
   void handleHomingRequest(AsyncWebServerRequest *request);
+  void handleHomeAllRequest(AsyncWebServerRequest *request);
+  void handleMovementRequest(AsyncWebServerRequest *request, bool isRelativeMovement);
+  void handleTrajectoryStopRequest(AsyncWebServerRequest *request);
+  void handleTrajectoryPlayRequest(AsyncWebServerRequest *request);
+  void handleSyncSegmentRequest(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total);
+  bool extractHomingParameters(AsyncWebServerRequest *request, ESPStepperMotorServer_HomingParameters &parameters);
   //for other endpoints see ESPStepperMotorServer_RestAPI.cpp in function registerRestEndpoints
 
   // SWITCH CONFIGURATION ENDPOINT HANDLER
@@ -0,0 +1,257 @@
+//      ******************************************************************
+//      *                                                                *
+//      *          ESPStepperMotorServer_ShiftRegisterOutput             *
+//      *                                                                *
+//      *               Copyright (c) Paul Kerspe, 2019                  *
+//      *                                                                *
+//      ******************************************************************
+// MIT License
+//
+// Copyright (c) 2019 Paul Kerspe
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished
+// to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#define ESPServerLogModule ESPServerLogModule_ShiftRegisterOutput
+
+#include <ESPStepperMotorServer.h>
+#include <ESPStepperMotorServer_ShiftRegisterOutput.h>
+#include <driver/i2s.h>
+
+#define ESPServerShiftRegisterI2SPort I2S_NUM_0
+// the output task stays this many buffers ahead of the DMA
+#define ESPServerShiftRegisterBufferCount 4
+// the output task applies 1/n of the difference between the time of its blocks and the motion controller time
+#define ESPServerShiftRegisterClockFilter 8
+
+/**
+ * start the I2S peripheral and the output task. The latch pin is driven by the word select signal, so each output word is latched once it has been shifted out
+ */
+bool ESPStepperMotorServer_ShiftRegisterOutput::begin(byte dataPin, byte clockPin, byte latchPin)
+{
+  if (this->isI2SStarted)
+  {
+    return true;
+  }
+  i2s_config_t i2sConfig;
+  memset(&i2sConfig, 0, sizeof(i2sConfig));
+  i2sConfig.mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_TX);
+  i2sConfig.sample_rate = ESPServerShiftRegisterWordRate;
+  i2sConfig.bits_per_sample = I2S_BITS_PER_SAMPLE_32BIT;
+  i2sConfig.channel_format = I2S_CHANNEL_FMT_ONLY_LEFT;
+  // MSB first without the one bit delay of the I2S standard, so the word is complete in the registers when the latch edge arrives
+  i2sConfig.communication_format = I2S_COMM_FORMAT_I2S_MSB;
+  i2sConfig.dma_buf_count = ESPServerShiftRegisterBufferCount;
+  i2sConfig.dma_buf_len = ESPServerShiftRegisterWordsPerCycle;
+  // the DMA repeats the buffers if the output task does not write new ones. The output task only stops writing once all buffers
+  // contain nothing but the direction outputs, clearing the buffers instead would reset the direction outputs
+  i2sConfig.tx_desc_auto_clear = false;
+
+  i2s_pin_config_t pinConfig;
+  memset(&pinConfig, 0, sizeof(pinConfig));
+  pinConfig.bck_io_num = clockPin;
+  pinConfig.ws_io_num = latchPin;
+  pinConfig.data_out_num = dataPin;
+  pinConfig.data_in_num = I2S_PIN_NO_CHANGE;
+
+  if (i2s_driver_install(ESPServerShiftRegisterI2SPort, &i2sConfig, 0, NULL) != ESP_OK)
+  {
+    ESPStepperMotorServer_Logger::logWarning("Failed to install the I2S driver for the shift register output");
+    return false;
+  }
+  if (i2s_set_pin(ESPServerShiftRegisterI2SPort, &pinConfig) != ESP_OK)
+  {
+    ESPStepperMotorServer_Logger::logWarning("Failed to assign the IO pins of the shift register output");
+    i2s_driver_uninstall(ESPServerShiftRegisterI2SPort);
+    return false;
+  }
+  this->outputState = 0;
+  if (this->stepQueue == NULL)
+  {
+    this->stepQueue = xQueueCreate(ESPServerShiftRegisterStepQueueLength, sizeof(ESPStepperMotorServer_ShiftRegisterStep));
+  }
+  xQueueReset(this->stepQueue);
+  this->isI2SStarted = true;
+  xTaskCreate(
+      ESPStepperMotorServer_ShiftRegisterOutput::processOutput, /* Task function. */
+      "ShiftRegister",                                          /* String with name of task. */
+      2000,                                                     /* Stack size in bytes. */
+      this,                                                     /* Parameter passed as input of the task */
+      3,                                                        /* Priority of the task, higher than the motion controller. */
+      &this->xHandle);                                          /* Task handle. */
+  ESPServerLogInfof("Shift register output started (data: %i, clock: %i, latch: %i)\n", dataPin, clockPin, latchPin);
+  return true;
+}
+
+void ESPStepperMotorServer_ShiftRegisterOutput::end()
+{
+  if (this->isI2SStarted)
+  {
+    vTaskDelete(this->xHandle);
+    this->xHandle = NULL;
+    i2s_driver_uninstall(ESPServerShiftRegisterI2SPort);
+    this->isI2SStarted = false;
+  }
+}
+
+bool ESPStepperMotorServer_ShiftRegisterOutput::isStarted() const
+{
+  return this->isI2SStarted;
+}
+
+/**
+ * update the output bits of all steppers from the current configuration.
+ * Only steppers with both, the step and direction pin on the shift registers are driven by this class
+ */
+void ESPStepperMotorServer_ShiftRegisterOutput::syncConfiguration(ESPStepperMotorServer_Configuration *configuration)
+{
+  uint32_t usedDirectionMask = 0;
+  for (byte stepperId = 0; stepperId < ESPServerMaxSteppers; stepperId++)
+  {
+    ESPStepperMotorServer_StepperConfiguration *stepper = configuration->getStepperConfiguration(stepperId);
+    this->stepMasks[stepperId] = 0;
+    this->directionMasks[stepperId] = 0;
+    if (stepper && ESPServerIsShiftRegisterPin(stepper->getStepIoPin()) && ESPServerIsShiftRegisterPin(stepper->getDirectionIoPin()))
+    {
+      this->stepMasks[stepperId] = 1UL << (stepper->getStepIoPin() - ESPServerShiftRegisterPinBase);
+      this->directionMasks[stepperId] = 1UL << (stepper->getDirectionIoPin() - ESPServerShiftRegisterPinBase);
+      this->lastPositions[stepperId] = stepper->getFlexyStepper()->getCurrentPositionInSteps();
+      usedDirectionMask |= this->directionMasks[stepperId];
+    }
+  }
+  // reset the direction outputs of removed steppers
+  if ((this->outputState & usedDirectionMask) != this->outputState)
+  {
+    this->outputState &= usedDirectionMask;
+    this->queueStep(0);
+  }
+  this->configurationRevision = configuration->getConfigurationRevision();
+}
+
+unsigned int ESPStepperMotorServer_ShiftRegisterOutput::getConfigurationRevision() const
+{
+  return this->configurationRevision;
+}
+
+/**
+ * queue the position changes of all shift register steppers since the last cycle as one step for the output task.
+ * Only waits if the step queue is full, which happens if the steps exceed the rate the shift register chain can send
+ */
+void ESPStepperMotorServer_ShiftRegisterOutput::update(ESPStepperMotorServer_ActiveAxis *activeAxes, byte activeAxisCount)
+{
+  if (!this->isI2SStarted)
+  {
+    return;
+  }
+  uint32_t stepMask = 0;
+  for (byte i = 0; i < activeAxisCount; i++)
+  {
+    const byte stepperId = activeAxes[i].stepperId;
+    if (this->stepMasks[stepperId] == 0)
+    {
+      continue;
+    }
+    const long position = activeAxes[i].flexyStepper->getCurrentPositionInSteps();
+    const long distance = position - this->lastPositions[stepperId];
+    this->lastPositions[stepperId] = position;
+    // ESP_FlexyStepper sends at most one step per call of processMovement, larger changes are caused by setting the position (e.g. homing)
+    if (distance != 1 && distance != -1)
+    {
+      continue;
+    }
+    stepMask |= this->stepMasks[stepperId];
+    if ((distance > 0) == (ESPServerShiftRegisterPositiveDirectionLevel == HIGH))
+    {
+      this->outputState |= this->directionMasks[stepperId];
+    }
+    else
+    {
+      this->outputState &= ~this->directionMasks[stepperId];
+    }
+  }
+
+  if (stepMask != 0)
+  {
+    this->queueStep(stepMask);
+  }
+}
+
+void ESPStepperMotorServer_ShiftRegisterOutput::queueStep(uint32_t stepMask)
+{
+  if (this->isI2SStarted)
+  {
+    ESPStepperMotorServer_ShiftRegisterStep step = {micros(), stepMask, this->outputState};
+    xQueueSend(this->stepQueue, &step, portMAX_DELAY);
+  }
+}
+
+/**
+ * the output task: writes one block of output words after the other, each one covering ESPServerShiftRegisterCycleMicros of the motion controller time.
+ * Writing a block waits for a free DMA buffer, so the task runs at the pace of the I2S clock.
+ * If there are no steps for all DMA buffers, the task waits for the next step and the DMA repeats the buffers with the direction outputs
+ */
+void ESPStepperMotorServer_ShiftRegisterOutput::processOutput(void *parameter)
+{
+  ESPStepperMotorServer_ShiftRegisterOutput *ref = static_cast<ESPStepperMotorServer_ShiftRegisterOutput *>(parameter);
+  // at most one pulse per PulseWords + 1 words can be started, so this is more than one block can take
+  ESPStepperMotorServer_ShiftRegisterStep steps[ESPServerShiftRegisterWordsPerCycle];
+  size_t stepCount = 0;
+  byte idleBlockCount = 0;
+  size_t bytesWritten = 0;
+  ref->stream.reset(micros() - ESPServerShiftRegisterLatencyMicros, 0);
+  while (true)
+  {
+    if (idleBlockCount >= ESPServerShiftRegisterBufferCount)
+    {
+      xQueuePeek(ref->stepQueue, &steps[0], portMAX_DELAY);
+      ref->stream.setBlockStartMicros(micros() - ESPServerShiftRegisterLatencyMicros);
+      idleBlockCount = 0;
+    }
+    while (stepCount < ESPServerShiftRegisterWordsPerCycle && xQueueReceive(ref->stepQueue, &steps[stepCount], 0) == pdTRUE)
+    {
+      stepCount++;
+    }
+    const bool isIdleBlock = (stepCount == 0 && !ref->stream.isPulseActive());
+    const size_t startedStepCount = ref->stream.buildCycleWords(steps, stepCount, ref->words);
+    stepCount -= startedStepCount;
+    memmove(steps, &steps[startedStepCount], stepCount * sizeof(ESPStepperMotorServer_ShiftRegisterStep));
+    idleBlockCount = isIdleBlock ? idleBlockCount + 1 : 0;
+
+    const uint32_t writeStartMicros = micros();
+    i2s_write(ESPServerShiftRegisterI2SPort, ref->words, sizeof(ref->words), &bytesWritten, portMAX_DELAY);
+    ref->cycleCounter++;
+    // keep the time of the blocks aligned with the motion controller time, since the I2S clock is not derived from the same divider as micros().
+    // Only done if the write had to wait for a free buffer, then all DMA buffers are filled and the time of the next block is well defined
+    const uint32_t now = micros();
+    if (now - writeStartMicros > ESPServerShiftRegisterCycleMicros / 2)
+    {
+      const long clockErrorMicros = (long)(now - ESPServerShiftRegisterLatencyMicros - ref->stream.getBlockStartMicros());
+      ref->stream.setBlockStartMicros(ref->stream.getBlockStartMicros() + clockErrorMicros / ESPServerShiftRegisterClockFilter);
+    }
+  }
+}
+
+uint32_t ESPStepperMotorServer_ShiftRegisterOutput::getOutputState() const
+{
+  return this->outputState;
+}
+
+unsigned long ESPStepperMotorServer_ShiftRegisterOutput::getCycleCount() const
+{
+  return this->cycleCounter;
+}
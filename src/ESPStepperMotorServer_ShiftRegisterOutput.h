@@ -0,0 +1,119 @@
+//      ******************************************************************
+//      *                                                                *
+//      *  Header file for ESPStepperMotorServer_ShiftRegisterOutput.cpp *
+//      *                                                                *
+//      *               Copyright (c) Paul Kerspe, 2019                  *
+//      *                                                                *
+//      ******************************************************************
+// MIT License
+//
+// Copyright (c) 2019 Paul Kerspe
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished
+// to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef ESPStepperMotorServer_ShiftRegisterOutput_h
+#define ESPStepperMotorServer_ShiftRegisterOutput_h
+
+#include <Arduino.h>
+#include <ESPStepperMotorServer.h>
+#include <ESPStepperMotorServer_ShiftRegisterStream.h>
+
+// step and direction pins of steppers can be outputs of a chain of up to four 74HC595 shift registers instead of IO pins,
+// if the library is compiled with ESPStepperMotorServer_USE_SHIFT_REGISTER_OUTPUT.
+// The outputs are addressed with the pin numbers ESPServerShiftRegisterPinBase (QA of the first register) and above
+#define ESPServerShiftRegisterPinBase 100
+#define ESPServerShiftRegisterMaxOutputs 32
+
+#ifdef ESPStepperMotorServer_USE_SHIFT_REGISTER_OUTPUT
+#define ESPServerIsShiftRegisterPin(pin) ((pin) >= ESPServerShiftRegisterPinBase && (pin) < ESPServerShiftRegisterPinBase + ESPServerShiftRegisterMaxOutputs)
+#ifndef ESPServerShiftRegisterPlaceholderPin
+#error "ESPStepperMotorServer_USE_SHIFT_REGISTER_OUTPUT is set, but no ESPServerShiftRegisterPlaceholderPin has been defined. Set it to an unconnected output capable IO pin"
+#endif
+#else
+#define ESPServerIsShiftRegisterPin(pin) false
+#endif
+
+// IO pins of the I2S peripheral that clocks the output words into the shift registers
+#ifndef ESPServerShiftRegisterDataPin
+#define ESPServerShiftRegisterDataPin 21 // to SER of the first 74HC595
+#endif
+#ifndef ESPServerShiftRegisterClockPin
+#define ESPServerShiftRegisterClockPin 22 // to SRCLK of all 74HC595
+#endif
+#ifndef ESPServerShiftRegisterLatchPin
+#define ESPServerShiftRegisterLatchPin 17 // to RCLK of all 74HC595
+#endif
+// time in us between the calculation of a step in the motion controller and its output block. Steps that reach the output task later are sent as soon as possible
+#ifndef ESPServerShiftRegisterLatencyMicros
+#define ESPServerShiftRegisterLatencyMicros 250
+#endif
+// number of motion controller cycles with steps that can wait for the output task
+#ifndef ESPServerShiftRegisterStepQueueLength
+#define ESPServerShiftRegisterStepQueueLength 64
+#endif
+// the level of the direction output while moving in positive direction
+#ifndef ESPServerShiftRegisterPositiveDirectionLevel
+#define ESPServerShiftRegisterPositiveDirectionLevel LOW
+#endif
+
+class ESPStepperMotorServer_Configuration;
+struct ESPStepperMotorServer_ActiveAxis;
+
+//
+// the ESPStepperMotorServer_ShiftRegisterOutput class
+// generates the step and direction signals of all steppers that are connected to the shift register chain.
+// ESP_FlexyStepper calculates the motion of these steppers as usual (its own pin outputs go to the placeholder pin),
+// in each motion controller cycle the position changes are queued with the current time as one step.
+// A separate output task converts the queued steps into blocks of output words (see ESPStepperMotorServer_ShiftRegisterStream)
+// and writes them to the I2S DMA buffers, so the motion controller never waits for the I2S clock and the step pulses keep their timing
+// with the resolution of one word. The output task always fills the DMA buffers with the direction outputs, so repeated buffers never contain step pulses.
+// Except for begin and end, all functions must be called from the motion controller task
+class ESPStepperMotorServer_ShiftRegisterOutput
+{
+public:
+  bool begin(byte dataPin, byte clockPin, byte latchPin);
+  void end();
+  bool isStarted() const;
+  void syncConfiguration(ESPStepperMotorServer_Configuration *configuration);
+  unsigned int getConfigurationRevision() const;
+  void update(ESPStepperMotorServer_ActiveAxis *activeAxes, byte activeAxisCount);
+  uint32_t getOutputState() const;
+  unsigned long getCycleCount() const;
+  static void processOutput(void *parameter);
+
+private:
+  void queueStep(uint32_t stepMask);
+
+  bool isI2SStarted = false;
+  TaskHandle_t xHandle = NULL;
+  QueueHandle_t stepQueue = NULL;
+  // the output bits of the step and direction pins of each stepper, 0 if the stepper is not connected to the shift registers
+  uint32_t stepMasks[ESPServerMaxSteppers] = {0};
+  uint32_t directionMasks[ESPServerMaxSteppers] = {0};
+  long lastPositions[ESPServerMaxSteppers] = {0};
+  // the current level of all direction outputs, the step outputs are only high during a pulse
+  uint32_t outputState = 0;
+  // only used by the output task
+  ESPStepperMotorServer_ShiftRegisterStream stream;
+  uint32_t words[ESPServerShiftRegisterWordsPerCycle];
+  volatile unsigned long cycleCounter = 0;
+  unsigned int configurationRevision = 0;
+};
+
+#endif
@@ -0,0 +1,111 @@
+//      ******************************************************************
+//      *                                                                *
+//      *          ESPStepperMotorServer_ShiftRegisterStream             *
+//      *                                                                *
+//      *               Copyright (c) Paul Kerspe, 2019                  *
+//      *                                                                *
+//      ******************************************************************
+// MIT License
+//
+// Copyright (c) 2019 Paul Kerspe
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished
+// to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <ESPStepperMotorServer_ShiftRegisterStream.h>
+
+void ESPStepperMotorServer_ShiftRegisterStream::reset(uint32_t blockStartMicros, uint32_t outputState)
+{
+  this->blockStartMicros = blockStartMicros;
+  this->outputState = outputState;
+  this->pulseMask = 0;
+  this->remainingPulseWords = 0;
+  this->nextPulseWord = 0;
+}
+
+/**
+ * fill the given buffer with the next ESPServerShiftRegisterWordsPerCycle output words.
+ * The steps must be ordered by their time, each one gets a pulse of ESPServerShiftRegisterPulseWords words that starts at the word matching its time.
+ * If the direction outputs change with a step, they are set one word before the step edge.
+ * Bit n of each word is shifted into output n of the chain (QA of the first register is output 0).
+ * Returns the number of steps that have been started in this block, the remaining ones must be passed again with the next block
+ */
+size_t ESPStepperMotorServer_ShiftRegisterStream::buildCycleWords(const ESPStepperMotorServer_ShiftRegisterStep *steps, size_t stepCount, uint32_t *words)
+{
+  size_t stepIndex = 0;
+  for (int word = 0; word < ESPServerShiftRegisterWordsPerCycle; word++)
+  {
+    if (this->remainingPulseWords == 0 && stepIndex < stepCount && word >= this->nextPulseWord && this->getWordIndex(steps[stepIndex].stepMicros) <= word)
+    {
+      const ESPStepperMotorServer_ShiftRegisterStep &step = steps[stepIndex];
+      if (step.outputState != this->outputState)
+      {
+        this->outputState = step.outputState;
+        this->nextPulseWord = word + 1;
+        if (step.stepMask == 0)
+        {
+          stepIndex++;
+        }
+      }
+      else
+      {
+        this->pulseMask = step.stepMask;
+        this->remainingPulseWords = (step.stepMask != 0) ? ESPServerShiftRegisterPulseWords : 0;
+        stepIndex++;
+      }
+    }
+    words[word] = (this->remainingPulseWords > 0) ? (this->outputState | this->pulseMask) : this->outputState;
+    if (this->remainingPulseWords > 0 && --this->remainingPulseWords == 0)
+    {
+      // one word with the step outputs low before the next pulse
+      this->nextPulseWord = word + 2;
+    }
+  }
+  this->nextPulseWord = (this->nextPulseWord > ESPServerShiftRegisterWordsPerCycle) ? this->nextPulseWord - ESPServerShiftRegisterWordsPerCycle : 0;
+  this->blockStartMicros += ESPServerShiftRegisterCycleMicros;
+  return stepIndex;
+}
+
+/**
+ * get the index of the word in the next block that matches the given time. Negative for steps that are already late
+ */
+int ESPStepperMotorServer_ShiftRegisterStream::getWordIndex(uint32_t stepMicros) const
+{
+  const int32_t offsetMicros = (int32_t)(stepMicros - this->blockStartMicros);
+  return (int)((int64_t)offsetMicros * ESPServerShiftRegisterWordRate / 1000000);
+}
+
+bool ESPStepperMotorServer_ShiftRegisterStream::isPulseActive() const
+{
+  return (this->remainingPulseWords > 0);
+}
+
+uint32_t ESPStepperMotorServer_ShiftRegisterStream::getOutputState() const
+{
+  return this->outputState;
+}
+
+uint32_t ESPStepperMotorServer_ShiftRegisterStream::getBlockStartMicros() const
+{
+  return this->blockStartMicros;
+}
+
+void ESPStepperMotorServer_ShiftRegisterStream::setBlockStartMicros(uint32_t blockStartMicros)
+{
+  this->blockStartMicros = blockStartMicros;
+}
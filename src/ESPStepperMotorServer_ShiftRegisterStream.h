@@ -0,0 +1,90 @@
+//      ******************************************************************
+//      *                                                                *
+//      *  Header file for ESPStepperMotorServer_ShiftRegisterStream.cpp *
+//      *                                                                *
+//      *               Copyright (c) Paul Kerspe, 2019                  *
+//      *                                                                *
+//      ******************************************************************
+// MIT License
+//
+// Copyright (c) 2019 Paul Kerspe
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished
+// to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef ESPStepperMotorServer_ShiftRegisterStream_h
+#define ESPStepperMotorServer_ShiftRegisterStream_h
+
+#include <Arduino.h>
+
+// number of output words latched per second. The shift clock is 64 times this rate, so it must stay within the limits of the shift registers
+#ifndef ESPServerShiftRegisterWordRate
+#define ESPServerShiftRegisterWordRate 125000
+#endif
+// number of output words in each DMA buffer
+#ifndef ESPServerShiftRegisterWordsPerCycle
+#define ESPServerShiftRegisterWordsPerCycle 8
+#endif
+// number of words the step outputs are kept high for each step. Each pulse is followed by at least one word with the step outputs low
+#ifndef ESPServerShiftRegisterPulseWords
+#define ESPServerShiftRegisterPulseWords 2
+#endif
+
+static_assert(ESPServerShiftRegisterPulseWords > 0 && ESPServerShiftRegisterPulseWords < ESPServerShiftRegisterWordsPerCycle, "ESPServerShiftRegisterPulseWords must be in the range of 1 to ESPServerShiftRegisterWordsPerCycle - 1");
+
+// the time covered by the words of one DMA buffer
+#define ESPServerShiftRegisterCycleMicros (ESPServerShiftRegisterWordsPerCycle * 1000000UL / ESPServerShiftRegisterWordRate)
+
+// the steps of the shift register steppers in one motion controller cycle
+struct ESPStepperMotorServer_ShiftRegisterStep
+{
+  uint32_t stepMicros;  // the time the motion controller has sent the steps
+  uint32_t stepMask;    // the step outputs to pulse, 0 if only the direction outputs change
+  uint32_t outputState; // the direction outputs to set before the step edge
+};
+
+//
+// the ESPStepperMotorServer_ShiftRegisterStream class
+// converts the steps of the motion controller into the output words of the shift register chain.
+// Each block covers ESPServerShiftRegisterCycleMicros of the motion controller time, the pulse of each step is placed
+// at the word that matches its time (or at the next free word, if the previous pulse is still active).
+// Does not depend on the ESP32 hardware, so it can also be tested on the host (see test/test_shift_register)
+class ESPStepperMotorServer_ShiftRegisterStream
+{
+public:
+  void reset(uint32_t blockStartMicros, uint32_t outputState);
+  size_t buildCycleWords(const ESPStepperMotorServer_ShiftRegisterStep *steps, size_t stepCount, uint32_t *words);
+  int getWordIndex(uint32_t stepMicros) const;
+  bool isPulseActive() const;
+  uint32_t getOutputState() const;
+  uint32_t getBlockStartMicros() const;
+  void setBlockStartMicros(uint32_t blockStartMicros);
+
+private:
+  // the motion controller time of the first word of the next block
+  uint32_t blockStartMicros = 0;
+  // the current level of all direction outputs
+  uint32_t outputState = 0;
+  // the step outputs of a pulse that continues in the next block
+  uint32_t pulseMask = 0;
+  byte remainingPulseWords = 0;
+  // the first word of the next block a new pulse may start at
+  int nextPulseWord = 0;
+};
+
+#endif
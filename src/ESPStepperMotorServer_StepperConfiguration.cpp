@@ -30,6 +30,7 @@
 //
 
 #include "ESPStepperMotorServer_StepperConfiguration.h"
+#include <ESPStepperMotorServer.h>
 
 ESPStepperMotorServer_StepperConfiguration::ESPStepperMotorServer_StepperConfiguration(const ESPStepperMotorServer_StepperConfiguration &espStepperConfiguration)
 {
@@ -43,8 +44,18 @@ ESPStepperMotorServer_StepperConfiguration::ESPStepperMotorServer_StepperConfigu
     this->_microsteppingDivisor = espStepperConfiguration._microsteppingDivisor;
     this->_displayName = espStepperConfiguration._displayName;
     this->_rpmLimit = espStepperConfiguration._rpmLimit;
-
-    this->_flexyStepper->connectToPins(this->_stepIoPin, this->_directionIoPin);
+    this->_brakeIoPin = espStepperConfiguration._brakeIoPin;
+    this->_brakePinActiveState = espStepperConfiguration._brakePinActiveState;
+    this->_brakeEngageDelayMs = espStepperConfiguration._brakeEngageDelayMs;
+    this->_brakeReleaseDelayMs = espStepperConfiguration._brakeReleaseDelayMs;
+    this->_enableIoPin = espStepperConfiguration._enableIoPin;
+    this->_enablePinActiveState = espStepperConfiguration._enablePinActiveState;
+    this->_driverDisableDelayMs = espStepperConfiguration._driverDisableDelayMs;
+    this->_softLimitMinPositionInSteps = espStepperConfiguration._softLimitMinPositionInSteps;
+    this->_softLimitMaxPositionInSteps = espStepperConfiguration._softLimitMaxPositionInSteps;
+    this->_softLimitMode = espStepperConfiguration._softLimitMode;
+
+    this->connectFlexyStepperToPins();
 }
 
 ESPStepperMotorServer_StepperConfiguration::~ESPStepperMotorServer_StepperConfiguration()
@@ -60,7 +71,7 @@ ESPStepperMotorServer_StepperConfiguration::ESPStepperMotorServer_StepperConfigu
     this->_stepIoPin = stepIoPin;
     this->_directionIoPin = directionIoPin;
     this->_flexyStepper = new ESP_FlexyStepper();
-    this->_flexyStepper->connectToPins(this->_stepIoPin, this->_directionIoPin);
+    this->connectFlexyStepperToPins();
 }
 
 ESPStepperMotorServer_StepperConfiguration::ESPStepperMotorServer_StepperConfiguration(byte stepIoPin, byte directionIoPin, String displayName, unsigned int stepsPerRev, unsigned int stepsPerMM, unsigned int microsteppingDivisor, unsigned int rpmLimit)
@@ -72,7 +83,7 @@ ESPStepperMotorServer_StepperConfiguration::ESPStepperMotorServer_StepperConfigu
     this->_rpmLimit = rpmLimit;
 
     this->_flexyStepper = new ESP_FlexyStepper();
-    this->_flexyStepper->connectToPins(this->_stepIoPin, this->_directionIoPin);
+    this->connectFlexyStepperToPins();
 
     //we store the value in flexistepper and locally, since flexystepper does not provider getters
     this->_flexyStepper->setStepsPerMillimeter(stepsPerMM * this->_microsteppingDivisor);
@@ -83,6 +94,22 @@ ESPStepperMotorServer_StepperConfiguration::ESPStepperMotorServer_StepperConfigu
     this->_stepsPerRev = stepsPerRev;
 }
 
+/**
+ * connect the flexy stepper to the step and direction IO pins.
+ * ESP_FlexyStepper always writes to IO pins, so steppers on the shift register outputs are connected to the placeholder pin,
+ * their step signals are generated by the shift register output of the motion controller
+ */
+void ESPStepperMotorServer_StepperConfiguration::connectFlexyStepperToPins()
+{
+#ifdef ESPStepperMotorServer_USE_SHIFT_REGISTER_OUTPUT
+    byte stepIoPin = ESPServerIsShiftRegisterPin(this->_stepIoPin) ? ESPServerShiftRegisterPlaceholderPin : this->_stepIoPin;
+    byte directionIoPin = ESPServerIsShiftRegisterPin(this->_directionIoPin) ? ESPServerShiftRegisterPlaceholderPin : this->_directionIoPin;
+    this->_flexyStepper->connectToPins(stepIoPin, directionIoPin);
+#else
+    this->_flexyStepper->connectToPins(this->_stepIoPin, this->_directionIoPin);
+#endif
+}
+
 // ---------------------------------------------------------------------------------
 //                                  Getters / Setters
 // ---------------------------------------------------------------------------------
@@ -152,29 +179,119 @@ byte ESPStepperMotorServer_StepperConfiguration::getBrakePinActiveState()
     return this->_brakePinActiveState;
 }
 
+// the brake and enable pins are driven by the power manager of the motion controller (see ESPStepperMotorServer_PowerManager),
+// so the settings are not passed on to the flexy stepper instance
 void ESPStepperMotorServer_StepperConfiguration::setBrakeIoPin(byte brakeIoPin, byte brakePinActiveState)
 {
     this->_brakeIoPin = brakeIoPin;
     this->_brakePinActiveState = brakePinActiveState;
-    this->_flexyStepper->setBrakePin(brakeIoPin, brakePinActiveState);
 }
 
 void ESPStepperMotorServer_StepperConfiguration::setBrakeEngageDelayMs(long delay)
 {
     this->_brakeEngageDelayMs = delay;
-    this->_flexyStepper->setBrakeEngageDelayMs(delay);
 }
 
 void ESPStepperMotorServer_StepperConfiguration::setBrakeReleaseDelayMs(long delay)
 {
     this->_brakeReleaseDelayMs = delay;
-    this->_flexyStepper->setBrakeReleaseDelayMs(delay);
 }
 
 void ESPStepperMotorServer_StepperConfiguration::setBrakePinActiveState(byte activeState)
 {
     this->_brakePinActiveState = activeState;
-    this->_flexyStepper->setBrakePin(this->_brakeIoPin, this->_brakePinActiveState);
+}
+
+// driver enable settings
+
+byte ESPStepperMotorServer_StepperConfiguration::getEnableIoPin()
+{
+    return this->_enableIoPin;
+}
+
+byte ESPStepperMotorServer_StepperConfiguration::getEnablePinActiveState()
+{
+    return this->_enablePinActiveState;
+}
+
+long ESPStepperMotorServer_StepperConfiguration::getDriverDisableDelayMs()
+{
+    return this->_driverDisableDelayMs;
+}
+
+void ESPStepperMotorServer_StepperConfiguration::setEnableIoPin(byte enableIoPin, byte enablePinActiveState)
+{
+    this->_enableIoPin = enableIoPin;
+    this->_enablePinActiveState = enablePinActiveState;
+}
+
+void ESPStepperMotorServer_StepperConfiguration::setDriverDisableDelayMs(long delay)
+{
+    this->_driverDisableDelayMs = delay;
+}
+
+// software travel limit settings
+void ESPStepperMotorServer_StepperConfiguration::setSoftLimits(long minPositionInSteps, long maxPositionInSteps, byte mode)
+{
+    if (mode > ESPServerSoftLimitMode_Clamp || (mode != ESPServerSoftLimitMode_Disabled && minPositionInSteps > maxPositionInSteps))
+    {
+        ESPStepperMotorServer_Logger::logWarningf("Invalid soft limits given for stepper with id %i (min: %ld, max: %ld, mode: %i). Soft limits will be disabled", this->getId(), minPositionInSteps, maxPositionInSteps, mode);
+        mode = ESPServerSoftLimitMode_Disabled;
+    }
+    this->_softLimitMinPositionInSteps = minPositionInSteps;
+    this->_softLimitMaxPositionInSteps = maxPositionInSteps;
+    this->_softLimitMode = mode;
+}
+
+long ESPStepperMotorServer_StepperConfiguration::getSoftLimitMinPositionInSteps()
+{
+    return this->_softLimitMinPositionInSteps;
+}
+
+long ESPStepperMotorServer_StepperConfiguration::getSoftLimitMaxPositionInSteps()
+{
+    return this->_softLimitMaxPositionInSteps;
+}
+
+byte ESPStepperMotorServer_StepperConfiguration::getSoftLimitMode()
+{
+    return this->_softLimitMode;
+}
+
+byte ESPStepperMotorServer_StepperConfiguration::applySoftLimits(long &targetPositionInSteps)
+{
+    if (this->_softLimitMode == ESPServerSoftLimitMode_Disabled ||
+        (targetPositionInSteps >= this->_softLimitMinPositionInSteps && targetPositionInSteps <= this->_softLimitMaxPositionInSteps))
+    {
+        return ESPServerSoftLimitResult_WithinLimits;
+    }
+    if (this->_softLimitMode == ESPServerSoftLimitMode_Reject)
+    {
+        return ESPServerSoftLimitResult_Rejected;
+    }
+    targetPositionInSteps = (targetPositionInSteps < this->_softLimitMinPositionInSteps) ? this->_softLimitMinPositionInSteps : this->_softLimitMaxPositionInSteps;
+    return ESPServerSoftLimitResult_Clamped;
+}
+
+byte ESPStepperMotorServer_StepperConfiguration::setTargetPositionWithinSoftLimits(long &targetPositionInSteps)
+{
+    byte result = this->applySoftLimits(targetPositionInSteps);
+    if (result != ESPServerSoftLimitResult_Rejected)
+    {
+        this->_flexyStepper->setTargetPositionInSteps(targetPositionInSteps);
+    }
+    return result;
+}
+
+// uses the same rounding as ESP_FlexyStepper, so the resulting target matches the one of setTargetPositionInMillimeters / setTargetPositionInRevolutions
+long ESPStepperMotorServer_StepperConfiguration::getStepsForMillimeters(float millimeters)
+{
+    return (long)round(millimeters * (float)(this->_stepsPerMM * this->_microsteppingDivisor));
+}
+
+long ESPStepperMotorServer_StepperConfiguration::getStepsForRevolutions(float revolutions)
+{
+    return (long)round(revolutions * (float)(this->_stepsPerRev * this->_microsteppingDivisor));
 }
 
 // motion configurateion settings
@@ -47,8 +47,18 @@
 
 #define ESPSMS_Stepper_DisplayName_MaxLength 20
 
+// modes for the software travel limits (soft endstops) of a stepper
+#define ESPServerSoftLimitMode_Disabled 0
+#define ESPServerSoftLimitMode_Reject 1
+#define ESPServerSoftLimitMode_Clamp 2
+
+// results of checking a target position against the soft limits
+#define ESPServerSoftLimitResult_WithinLimits 0
+#define ESPServerSoftLimitResult_Clamped 1
+#define ESPServerSoftLimitResult_Rejected 2
+
 //size calculated using https://arduinojson.org/v6/assistant/
-#define RESERVED_JSON_SIZE_ESPStepperMotorServer_StepperConfiguration 210
+#define RESERVED_JSON_SIZE_ESPStepperMotorServer_StepperConfiguration 306
 
 class ESPStepperMotorServer_StepperConfiguration
 {
@@ -119,6 +129,58 @@ public:
   void setBrakeEngageDelayMs(long);
   void setBrakeReleaseDelayMs(long);
 
+  /**
+   * Get the currently configured IO pin that is connected to the enable input of the stepper driver.
+   * Returns ESPServerStepperUnsetIoPinNumber (255) if none is defined
+   */
+  byte getEnableIoPin();
+
+  /**
+   * Get the currently configured active state of the IO pin used to enable the stepper driver.
+   * Returns 1 for active high (pin goes high to enable the driver), 2 for active low (pin goes low to enable the driver, most common for stepper drivers)
+   */
+  byte getEnablePinActiveState();
+
+  /**
+   * Get the currently configured timeout of inactivity of the motor, before the stepper driver is disabled to reduce heat and power consumption.
+   * Default is -1, meaning that the driver is never disabled.
+   */
+  long getDriverDisableDelayMs();
+
+  void setEnableIoPin(byte, byte);
+  void setDriverDisableDelayMs(long);
+
+  /**
+   * Set the software travel limits (soft endstops) of this stepper as absolute positions in steps.
+   * The limits are checked whenever a new target position is set via the REST API, CLI, macros, rotary encoders or the binary protocol,
+   * the movement itself is not affected. Since positions are relative to the home position, the limits are only meaningful once the axis has been homed.
+   * Allowed modes: ESPServerSoftLimitMode_Disabled (default), ESPServerSoftLimitMode_Reject (targets outside of the limits are ignored),
+   * ESPServerSoftLimitMode_Clamp (targets outside of the limits are replaced by the nearest limit)
+   */
+  void setSoftLimits(long minPositionInSteps, long maxPositionInSteps, byte mode);
+  long getSoftLimitMinPositionInSteps();
+  long getSoftLimitMaxPositionInSteps();
+  byte getSoftLimitMode();
+
+  /**
+   * Check the given absolute target position against the soft limits.
+   * If the mode is ESPServerSoftLimitMode_Clamp, the given position is changed to the nearest limit.
+   * Returns one of ESPServerSoftLimitResult_WithinLimits, ESPServerSoftLimitResult_Clamped or ESPServerSoftLimitResult_Rejected
+   */
+  byte applySoftLimits(long &targetPositionInSteps);
+
+  /**
+   * Set a new absolute target position in steps for the stepper, after checking it against the soft limits (see applySoftLimits).
+   * The target position is not changed if the result is ESPServerSoftLimitResult_Rejected
+   */
+  byte setTargetPositionWithinSoftLimits(long &targetPositionInSteps);
+
+  /**
+   * Convert the given distance in millimeters or revolutions to steps, including the configured microstepping
+   */
+  long getStepsForMillimeters(float millimeters);
+  long getStepsForRevolutions(float revolutions);
+
   /**
    * Set the number of full steps the stepper motor itself needs to perform for a full revolution.
    * Most stepper motors perform 1.8 degree turn per step, thus resulting in 200 full steps per revolution.
@@ -179,6 +241,8 @@ public:
   const static byte ESPServerStepperUnsetIoPinNumber = 255;
 
 private:
+  void connectFlexyStepperToPins();
+
   //
   // private member variables
   //
@@ -191,6 +255,12 @@ private:
   byte _brakePinActiveState = 1; // 1 = active high, 2 = active low
   long _brakeEngageDelayMs = 0;
   long _brakeReleaseDelayMs = -1;
+  byte _enableIoPin = ESPServerStepperUnsetIoPinNumber;
+  byte _enablePinActiveState = 2; // 1 = active high, 2 = active low
+  long _driverDisableDelayMs = -1;
+  long _softLimitMinPositionInSteps = 0;
+  long _softLimitMaxPositionInSteps = 0;
+  byte _softLimitMode = ESPServerSoftLimitMode_Disabled;
   unsigned int _stepsPerRev = 200;
   unsigned int _stepsPerMM = 100;
   unsigned int _microsteppingDivisor = ESPSMS_MICROSTEPS_OFF;
@@ -0,0 +1,182 @@
+//      *********************************************************
+//      *                                                       *
+//      *     ESP32 Stepper Motor Server -  Sync Clock        *
+//      *                                                       *
+//      *            Copyright (c) Paul Kerspe, 2019            *
+//      *                                                       *
+//      **********************************************************
+
+// MIT License
+//
+// Copyright (c) 2019 Paul Kerspe
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished
+// to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <ESPStepperMotorServer_SyncClock.h>
+
+/**
+ * forget the master clock, the drift and the network delay estimate. On the master, the clock is always valid
+ */
+void ESPStepperMotorServer_SyncClock::reset(bool isMaster)
+{
+  this->isMaster = isMaster;
+  this->isClockValid = isMaster;
+  this->masterMicrosAtSync = 0;
+  this->localMicrosAtSync = 0;
+  this->clockDrift = 0;
+  this->lastClockErrorMicros = 0;
+  this->isDelayMeasured = false;
+  this->networkDelayMicros = 0;
+}
+
+/**
+ * mark the clock as invalid (e.g. if no clock packet has been received for a while), the next clock packet sets the clock again
+ */
+void ESPStepperMotorServer_SyncClock::invalidate()
+{
+  this->isClockValid = this->isMaster;
+}
+
+/**
+ * update the follower clock with the master time of a received clock packet. The master time has been taken when the packet was sent,
+ * so the estimated network delay is added. The difference to the predicted master time is partially applied to the clock offset and the drift estimate,
+ * large differences (e.g. after the master rebooted) set the clock directly.
+ * Returns one of the ESPServerSyncClockUpdate_* values
+ */
+byte ESPStepperMotorServer_SyncClock::update(uint32_t masterSendMicros, uint32_t localReceiveMicros)
+{
+  const uint32_t masterMicros = masterSendMicros + this->networkDelayMicros;
+  if (!this->isClockValid)
+  {
+    this->masterMicrosAtSync = masterMicros;
+    this->localMicrosAtSync = localReceiveMicros;
+    this->clockDrift = 0;
+    this->lastClockErrorMicros = 0;
+    this->isClockValid = true;
+    return ESPServerSyncClockUpdate_Synchronized;
+  }
+
+  const uint32_t elapsedMicros = localReceiveMicros - this->localMicrosAtSync;
+  const uint32_t predictedMasterMicros = this->getMasterMicros(localReceiveMicros);
+  const long clockError = (int32_t)(masterMicros - predictedMasterMicros);
+  this->lastClockErrorMicros = clockError;
+  this->localMicrosAtSync = localReceiveMicros;
+  if (clockError > ESPServerSyncMaxClockErrorMicros || clockError < -ESPServerSyncMaxClockErrorMicros)
+  {
+    this->masterMicrosAtSync = masterMicros;
+    this->resyncCounter++;
+    return ESPServerSyncClockUpdate_Resynchronized;
+  }
+  this->masterMicrosAtSync = predictedMasterMicros + clockError / ESPServerSyncClockOffsetFilter;
+  if (elapsedMicros > 0)
+  {
+    this->clockDrift += ((float)clockError / (float)elapsedMicros) / ESPServerSyncClockDriftFilter;
+    if (this->clockDrift > ESPServerSyncMaxClockDrift)
+    {
+      this->clockDrift = ESPServerSyncMaxClockDrift;
+    }
+    else if (this->clockDrift < -ESPServerSyncMaxClockDrift)
+    {
+      this->clockDrift = -ESPServerSyncMaxClockDrift;
+    }
+  }
+  return ESPServerSyncClockUpdate_Filtered;
+}
+
+/**
+ * update the network delay estimate with the answer of the master to a clock request.
+ * Returns false if the exchange took too long to be used
+ */
+bool ESPStepperMotorServer_SyncClock::updateNetworkDelay(const ESPStepperMotorServer_SyncClockExchange &exchange, uint32_t localReceiveMicros)
+{
+  const long delayMicros = ESPStepperMotorServer_SyncPacket::calculateOneWayDelayMicros(exchange, localReceiveMicros);
+  if (localReceiveMicros - exchange.followerSendMicros > ESPServerSyncMaxRoundTripMicros || delayMicros < 0)
+  {
+    return false;
+  }
+  if (!this->isDelayMeasured)
+  {
+    this->networkDelayMicros = delayMicros;
+    this->isDelayMeasured = true;
+  }
+  else
+  {
+    this->networkDelayMicros += (delayMicros - this->networkDelayMicros) / ESPServerSyncNetworkDelayFilter;
+  }
+  return true;
+}
+
+bool ESPStepperMotorServer_SyncClock::isValid() const
+{
+  return this->isClockValid;
+}
+
+/**
+ * get the master time at the given local time. On followers this is only valid while isValid() returns true
+ */
+uint32_t ESPStepperMotorServer_SyncClock::getMasterMicros(uint32_t localMicros) const
+{
+  if (this->isMaster)
+  {
+    return localMicros;
+  }
+  const uint32_t elapsedMicros = localMicros - this->localMicrosAtSync;
+  return this->masterMicrosAtSync + elapsedMicros + (long)(this->clockDrift * (float)elapsedMicros);
+}
+
+/**
+ * true if the master time reached the start time of a segment at the given local time. startDelayMicros is set to the time since the start time
+ * (negative while the segment is not due yet). The times may wrap around, segments must be started within 35 minutes
+ */
+bool ESPStepperMotorServer_SyncClock::isSegmentDue(uint32_t startMasterMicros, uint32_t localMicros, long &startDelayMicros) const
+{
+  startDelayMicros = (int32_t)(this->getMasterMicros(localMicros) - startMasterMicros);
+  return (this->isClockValid && startDelayMicros >= 0);
+}
+
+/**
+ * the difference between the master time of the last clock packet and the time the follower clock predicted for it
+ */
+long ESPStepperMotorServer_SyncClock::getLastClockErrorMicros() const
+{
+  return this->lastClockErrorMicros;
+}
+
+/**
+ * the estimated one way network delay between the master and this follower. Always 0 on the master
+ */
+long ESPStepperMotorServer_SyncClock::getNetworkDelayMicros() const
+{
+  return this->networkDelayMicros;
+}
+
+bool ESPStepperMotorServer_SyncClock::isNetworkDelayMeasured() const
+{
+  return this->isDelayMeasured;
+}
+
+float ESPStepperMotorServer_SyncClock::getClockDriftPpm() const
+{
+  return this->clockDrift * 1000000.0f;
+}
+
+unsigned long ESPStepperMotorServer_SyncClock::getResyncCount() const
+{
+  return this->resyncCounter;
+}
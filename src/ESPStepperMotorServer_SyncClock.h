@@ -0,0 +1,91 @@
+//      ******************************************************************
+//      *                                                                *
+//      *     Header file for ESPStepperMotorServer_SyncClock.cpp        *
+//      *                                                                *
+//      *               Copyright (c) Paul Kerspe, 2019                  *
+//      *                                                                *
+//      ******************************************************************
+
+// MIT License
+//
+// Copyright (c) 2019 Paul Kerspe
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished
+// to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef ESPStepperMotorServer_SyncClock_h
+#define ESPStepperMotorServer_SyncClock_h
+
+#include <Arduino.h>
+#include <ESPStepperMotorServer_SyncPacket.h>
+
+// clock errors above this value are not filtered, the follower clock is set to the master clock instead
+#define ESPServerSyncMaxClockErrorMicros 5000
+// the follower applies 1/n of each measured clock error to its clock offset and 1/n of the resulting rate error to its drift estimate,
+// which filters the jitter of the packet delivery. The drift filter is about as strong as the square of the offset filter (critical damping),
+// a weaker drift filter lets the drift estimate follow the jitter (see test/test_sync_clock)
+#define ESPServerSyncClockOffsetFilter 8
+#define ESPServerSyncClockDriftFilter 256
+// limit of the drift estimate (500 ppm), far above the tolerance of the ESP32 crystal
+#define ESPServerSyncMaxClockDrift 0.0005f
+// clock exchanges with a longer round trip time (e.g. delayed by WiFi retransmissions) are not used for the network delay estimate
+#define ESPServerSyncMaxRoundTripMicros 20000
+// the follower applies 1/n of the difference between a measured network delay and its current estimate
+#define ESPServerSyncNetworkDelayFilter 8
+
+// the results of ESPStepperMotorServer_SyncClock::update
+#define ESPServerSyncClockUpdate_Synchronized 0   // the first clock packet after a reset or a timeout, the clock has been set
+#define ESPServerSyncClockUpdate_Filtered 1       // the clock error has been applied to the offset and drift estimate
+#define ESPServerSyncClockUpdate_Resynchronized 2 // the clock error was too large (e.g. after the master rebooted), the clock has been set
+
+//
+// the ESPStepperMotorServer_SyncClock class
+// tracks the master clock on a follower of the sync controller: master time = master time at the last clock packet + elapsed local time * (1 + drift).
+// The offset and the drift are filtered over the received clock packets, the network delay is estimated from the round trip time of clock requests.
+// Also decides when a segment is due. On the master, the master time is the local time.
+// All times are passed in by the caller, so the class does not depend on the ESP32 hardware and can also be tested on the host (see test/test_sync_clock)
+class ESPStepperMotorServer_SyncClock
+{
+public:
+  void reset(bool isMaster);
+  void invalidate();
+  byte update(uint32_t masterSendMicros, uint32_t localReceiveMicros);
+  bool updateNetworkDelay(const ESPStepperMotorServer_SyncClockExchange &exchange, uint32_t localReceiveMicros);
+  bool isValid() const;
+  uint32_t getMasterMicros(uint32_t localMicros) const;
+  bool isSegmentDue(uint32_t startMasterMicros, uint32_t localMicros, long &startDelayMicros) const;
+
+  long getLastClockErrorMicros() const;
+  long getNetworkDelayMicros() const;
+  bool isNetworkDelayMeasured() const;
+  float getClockDriftPpm() const;
+  unsigned long getResyncCount() const;
+
+private:
+  bool isMaster = false;
+  volatile bool isClockValid = false;
+  uint32_t masterMicrosAtSync = 0;
+  uint32_t localMicrosAtSync = 0;
+  float clockDrift = 0;
+  long lastClockErrorMicros = 0;
+  unsigned long resyncCounter = 0;
+  bool isDelayMeasured = false;
+  long networkDelayMicros = 0;
+};
+
+#endif
@@ -0,0 +1,541 @@
+//      ******************************************************************
+//      *                                                                *
+//      *          ESPStepperMotorServer_SyncController                  *
+//      *                                                                *
+//      *               Copyright (c) Paul Kerspe, 2019                  *
+//      *                                                                *
+//      ******************************************************************
+// MIT License
+//
+// Copyright (c) 2019 Paul Kerspe
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished
+// to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#define ESPServerLogModule ESPServerLogModule_SyncController
+
+#include <ESPStepperMotorServer_SyncController.h>
+#include <ESPStepperMotorServer.h>
+
+//
+// constructor for the sync controller module
+// the UDP socket, the segment queue and the sync task are created in start()
+//
+ESPStepperMotorServer_SyncController::ESPStepperMotorServer_SyncController(ESPStepperMotorServer *serverRef, byte role, byte nodeId, uint16_t port)
+{
+  this->serverRef = serverRef;
+  this->role = role;
+  this->nodeId = (role == ESPServerSyncRole_Master) ? 0 : nodeId;
+  this->port = port;
+  this->syncClock.reset(role == ESPServerSyncRole_Master);
+  ESPServerLogDebug("Sync Controller created");
+}
+
+ESPStepperMotorServer_SyncController::~ESPStepperMotorServer_SyncController()
+{
+  this->stop();
+}
+
+void ESPStepperMotorServer_SyncController::start()
+{
+  if (this->xHandle == NULL) //prevent multiple starts
+  {
+    if (this->segmentQueue == NULL)
+    {
+      this->segmentQueue = xQueueCreate(ESPServerSyncSegmentQueueLength, sizeof(ESPStepperMotorServer_SyncSegment));
+      this->udpMutex = xSemaphoreCreateMutex();
+    }
+    if (!this->isBroadcastAddressSet)
+    {
+      this->broadcastAddress = (this->serverRef->getCurrentServerConfiguration()->wifiMode == ESPServerWifiModeAccessPoint) ? WiFi.softAPBroadcastIP() : WiFi.broadcastIP();
+    }
+    // the master receives the clock requests of the followers on the same port
+    this->udp.begin(this->port);
+    xTaskCreate(
+        ESPStepperMotorServer_SyncController::processSync, /* Task function. */
+        "SyncController",                                  /* String with name of task. */
+        3000,                                              /* Stack size in bytes. */
+        this,                                              /* Parameter passed as input of the task */
+        2,                                                 /* Priority of the task. */
+        &this->xHandle);                                   /* Task handle. */
+    if (this->role == ESPServerSyncRole_Master)
+    {
+      ESPServerLogInfof("Sync Controller started as master, broadcasting to %s:%u\n", this->broadcastAddress.toString().c_str(), this->port);
+    }
+    else
+    {
+      ESPServerLogInfof("Sync Controller started as follower with node id %i on port %u\n", this->nodeId, this->port);
+    }
+  }
+}
+
+void ESPStepperMotorServer_SyncController::stop()
+{
+  if (this->xHandle != NULL)
+  {
+    vTaskDelete(this->xHandle);
+    this->xHandle = NULL;
+    this->udp.stop();
+    this->discardSegments();
+    this->syncClock.reset(this->role == ESPServerSyncRole_Master);
+    this->isClockRequestPending = false;
+    ESPServerLogInfo("Sync Controller stopped");
+  }
+}
+
+/**
+ * set the address the master sends its packets to. Defaults to the broadcast address of the WiFi network,
+ * a unicast address can be used if there is only one follower. Must be called before the server is started
+ */
+void ESPStepperMotorServer_SyncController::setBroadcastAddress(IPAddress broadcastAddress)
+{
+  this->broadcastAddress = broadcastAddress;
+  this->isBroadcastAddressSet = true;
+}
+
+void ESPStepperMotorServer_SyncController::processSync(void *parameter)
+{
+  ESPStepperMotorServer_SyncController *ref = static_cast<ESPStepperMotorServer_SyncController *>(parameter);
+  while (true)
+  {
+    ref->receivePackets();
+    if (ref->role == ESPServerSyncRole_Master)
+    {
+      // the emergency stop state is part of the clock packet, so a change is sent right away
+      if (millis() - ref->lastClockSentMillis >= ESPServerSyncClockIntervalMs || ref->serverRef->emergencySwitchIsActive != ref->lastSentEmergencyStopState)
+      {
+        ref->sendClock();
+      }
+    }
+    else
+    {
+      if (ref->isMasterAddressKnown && millis() - ref->lastClockRequestMillis >= ESPServerSyncRoundTripIntervalMs)
+      {
+        ref->sendClockRequest();
+      }
+      if (ref->syncClock.isValid() && millis() - ref->lastClockReceivedMillis > ESPServerSyncClockTimeoutMs)
+      {
+        ref->syncClock.invalidate();
+        ref->discardSegments();
+        ESPStepperMotorServer_Logger::logWarning("Lost the clock of the sync master, discarded all waiting segments");
+      }
+    }
+    ref->executeDueSegments();
+    vTaskDelay(1);
+  }
+}
+
+/**
+ * broadcast the given segment to all followers and queue it for the steppers of this controller.
+ * All moves of the segment are started leadTimeMs after this call, the segment id and start time are set by this function.
+ * Segments are started in the order they have been sent, so all segments should use the same lead time.
+ * Returns false if this controller is not a running master, the segment is invalid or the segment queue is full
+ */
+bool ESPStepperMotorServer_SyncController::sendSegment(ESPStepperMotorServer_SyncSegment &segment, unsigned long leadTimeMs)
+{
+  if (this->role != ESPServerSyncRole_Master || this->xHandle == NULL || segment.moveCount == 0 || segment.moveCount > ESPServerSyncMaxSegmentMoves)
+  {
+    return false;
+  }
+  segment.segmentId = this->nextSegmentId++;
+  segment.startMasterMicros = micros() + leadTimeMs * 1000;
+  if (xQueueSend(this->segmentQueue, &segment, 0) != pdTRUE)
+  {
+    ESPStepperMotorServer_Logger::logWarning("Sync segment queue is full, segment has not been sent");
+    return false;
+  }
+  byte packet[ESPServerSyncPacketMaxLength];
+  size_t length = ESPStepperMotorServer_SyncPacket::encodeSegment(segment, packet);
+  for (byte i = 0; i < ESPServerSyncSegmentSendCount; i++)
+  {
+    this->sendPacket(packet, length, this->broadcastAddress);
+  }
+  return true;
+}
+
+void ESPStepperMotorServer_SyncController::sendClock()
+{
+  byte packet[ESPServerSyncPacketClockLength];
+  const bool isEmergencyStopActive = this->serverRef->emergencySwitchIsActive;
+  size_t length = ESPStepperMotorServer_SyncPacket::encodeClock(micros(), isEmergencyStopActive, packet);
+  this->sendPacket(packet, length, this->broadcastAddress);
+  this->lastClockSentMillis = millis();
+  this->lastSentEmergencyStopState = isEmergencyStopActive;
+}
+
+/**
+ * send a clock request to the master to measure the network delay. Only one request is pending at a time, a lost one is replaced by the next one
+ */
+void ESPStepperMotorServer_SyncController::sendClockRequest()
+{
+  byte packet[ESPServerSyncPacketClockRequestLength];
+  this->lastClockRequestMicros = micros();
+  size_t length = ESPStepperMotorServer_SyncPacket::encodeClockRequest(this->nodeId, this->lastClockRequestMicros, packet);
+  this->isClockRequestPending = this->sendPacket(packet, length, this->masterAddress);
+  this->lastClockRequestMillis = millis();
+}
+
+bool ESPStepperMotorServer_SyncController::sendPacket(const byte *packet, size_t length, IPAddress address)
+{
+  xSemaphoreTake(this->udpMutex, portMAX_DELAY);
+  bool isSent = (this->udp.beginPacket(address, this->port) != 0);
+  if (isSent)
+  {
+    this->udp.write(packet, length);
+    isSent = (this->udp.endPacket() != 0);
+  }
+  xSemaphoreGive(this->udpMutex);
+  if (!isSent)
+  {
+    this->packetErrorCounter++;
+  }
+  return isSent;
+}
+
+void ESPStepperMotorServer_SyncController::receivePackets()
+{
+  byte packet[ESPServerSyncPacketMaxLength];
+  int packetSize;
+  while ((packetSize = this->udp.parsePacket()) > 0)
+  {
+    // taken before reading the packet, so the time of the clock packets is as close to the reception as possible
+    uint32_t receiveMicros = micros();
+    int length = this->udp.read(packet, sizeof(packet));
+    if (packetSize > (int)sizeof(packet) || length <= 0)
+    {
+      this->packetErrorCounter++;
+      continue;
+    }
+    this->handlePacket(packet, length, receiveMicros, this->udp.remoteIP());
+  }
+}
+
+void ESPStepperMotorServer_SyncController::handlePacket(const byte *packet, size_t length, uint32_t receiveMicros, IPAddress remoteAddress)
+{
+  if (!ESPStepperMotorServer_SyncPacket::isValid(packet, length))
+  {
+    this->packetErrorCounter++;
+    return;
+  }
+
+  const byte packetType = ESPStepperMotorServer_SyncPacket::getType(packet);
+  if (this->role == ESPServerSyncRole_Master)
+  {
+    // the master may also receive its own broadcasts, it only answers the clock requests of the followers
+    if (packetType == ESPServerSyncPacket_ClockRequest)
+    {
+      this->handleClockRequest(packet, length, receiveMicros, remoteAddress);
+    }
+  }
+  else if (packetType == ESPServerSyncPacket_Clock)
+  {
+    this->handleClockPacket(packet, length, receiveMicros, remoteAddress);
+  }
+  else if (packetType == ESPServerSyncPacket_ClockResponse)
+  {
+    this->handleClockResponse(packet, length, receiveMicros);
+  }
+  else if (packetType == ESPServerSyncPacket_Segment)
+  {
+    this->handleSegmentPacket(packet, length);
+  }
+  else if (packetType != ESPServerSyncPacket_ClockRequest) // requests of other followers are ignored
+  {
+    this->packetErrorCounter++;
+  }
+}
+
+void ESPStepperMotorServer_SyncController::handleClockPacket(const byte *packet, size_t length, uint32_t receiveMicros, IPAddress remoteAddress)
+{
+  uint32_t masterMicros;
+  bool isEmergencyStopActive;
+  if (!ESPStepperMotorServer_SyncPacket::decodeClock(packet, length, masterMicros, isEmergencyStopActive))
+  {
+    this->packetErrorCounter++;
+    return;
+  }
+  // the clock requests are sent to the address the clock packets come from
+  this->masterAddress = remoteAddress;
+  this->isMasterAddressKnown = true;
+  this->updateClock(masterMicros, receiveMicros);
+  this->updateMasterEmergencyStop(isEmergencyStopActive);
+}
+
+/**
+ * answer the clock request of a follower with the time the request has been received and the time the answer is sent
+ */
+void ESPStepperMotorServer_SyncController::handleClockRequest(const byte *packet, size_t length, uint32_t receiveMicros, IPAddress remoteAddress)
+{
+  ESPStepperMotorServer_SyncClockExchange exchange;
+  if (!ESPStepperMotorServer_SyncPacket::decodeClockRequest(packet, length, exchange.nodeId, exchange.followerSendMicros))
+  {
+    this->packetErrorCounter++;
+    return;
+  }
+  byte response[ESPServerSyncPacketClockResponseLength];
+  exchange.masterReceiveMicros = receiveMicros;
+  exchange.masterSendMicros = micros();
+  size_t responseLength = ESPStepperMotorServer_SyncPacket::encodeClockResponse(exchange, response);
+  this->sendPacket(response, responseLength, remoteAddress);
+}
+
+/**
+ * update the network delay estimate with the answer of the master to the last clock request
+ */
+void ESPStepperMotorServer_SyncController::handleClockResponse(const byte *packet, size_t length, uint32_t receiveMicros)
+{
+  ESPStepperMotorServer_SyncClockExchange exchange;
+  if (!ESPStepperMotorServer_SyncPacket::decodeClockResponse(packet, length, exchange))
+  {
+    this->packetErrorCounter++;
+    return;
+  }
+  // answers to other followers or to an older request are ignored
+  if (exchange.nodeId != this->nodeId || !this->isClockRequestPending || exchange.followerSendMicros != this->lastClockRequestMicros)
+  {
+    return;
+  }
+  this->isClockRequestPending = false;
+  const bool isFirstMeasurement = !this->syncClock.isNetworkDelayMeasured();
+  if (this->syncClock.updateNetworkDelay(exchange, receiveMicros) && isFirstMeasurement)
+  {
+    ESPServerLogDebugf("Network delay to the sync master is %ld us\n", this->syncClock.getNetworkDelayMicros());
+  }
+}
+
+void ESPStepperMotorServer_SyncController::handleSegmentPacket(const byte *packet, size_t length)
+{
+  ESPStepperMotorServer_SyncSegment segment;
+  if (!ESPStepperMotorServer_SyncPacket::decodeSegment(packet, length, segment))
+  {
+    this->packetErrorCounter++;
+    return;
+  }
+  // ignore the repeated copies of the last segment
+  if (this->isSegmentReceived && (int16_t)(segment.segmentId - this->lastReceivedSegmentId) <= 0)
+  {
+    return;
+  }
+  if (this->isSegmentReceived && segment.segmentId != (uint16_t)(this->lastReceivedSegmentId + 1))
+  {
+    ESPStepperMotorServer_Logger::logWarningf("Lost %u sync segments\n", (uint16_t)(segment.segmentId - this->lastReceivedSegmentId - 1));
+    this->droppedSegmentCounter += (uint16_t)(segment.segmentId - this->lastReceivedSegmentId - 1);
+  }
+  this->lastReceivedSegmentId = segment.segmentId;
+  this->isSegmentReceived = true;
+
+  bool hasLocalMoves = false;
+  for (byte moveIndex = 0; moveIndex < segment.moveCount; moveIndex++)
+  {
+    hasLocalMoves |= (segment.moves[moveIndex].nodeId == this->nodeId);
+  }
+  if (!hasLocalMoves)
+  {
+    return;
+  }
+  if (!this->syncClock.isValid() || xQueueSend(this->segmentQueue, &segment, 0) != pdTRUE)
+  {
+    this->droppedSegmentCounter++;
+    ESPStepperMotorServer_Logger::logWarningf("Dropped sync segment %u, no master clock or segment queue full\n", segment.segmentId);
+  }
+}
+
+/**
+ * mirror the emergency stop of the master. An emergency stop that has been triggered on this controller
+ * (e.g. by a local emergency switch) is not revoked when the master revokes its emergency stop
+ */
+void ESPStepperMotorServer_SyncController::updateMasterEmergencyStop(bool isEmergencyStopActive)
+{
+  if (isEmergencyStopActive && !this->isMasterEmergencyStopActive)
+  {
+    const unsigned int emergencyStopCounter = this->serverRef->emergencyStopCounter;
+    this->isEmergencyStopTriggeredByMaster = !this->serverRef->emergencySwitchIsActive;
+    this->discardSegments();
+    this->serverRef->performEmergencyStop();
+    this->masterEmergencyStopCounter = emergencyStopCounter + 1;
+    ESPStepperMotorServer_Logger::logWarning("Emergency stop triggered by the sync master");
+  }
+  else if (!isEmergencyStopActive && this->isMasterEmergencyStopActive)
+  {
+    // any other emergency stop since the one of the master changes the counter
+    if (this->isEmergencyStopTriggeredByMaster && this->serverRef->emergencyStopCounter == this->masterEmergencyStopCounter)
+    {
+      this->serverRef->revokeEmergencyStop();
+      ESPServerLogInfo("Emergency stop revoked by the sync master");
+    }
+    else if (this->serverRef->emergencySwitchIsActive)
+    {
+      ESPStepperMotorServer_Logger::logWarning("Emergency stop revoked by the sync master, the local emergency stop stays active");
+    }
+    this->isEmergencyStopTriggeredByMaster = false;
+  }
+  this->isMasterEmergencyStopActive = isEmergencyStopActive;
+}
+
+/**
+ * update the follower clock with the master time (send time) of a received clock packet
+ */
+void ESPStepperMotorServer_SyncController::updateClock(uint32_t masterMicros, uint32_t localMicros)
+{
+  this->lastClockReceivedMillis = millis();
+  const byte result = this->syncClock.update(masterMicros, localMicros);
+  if (result == ESPServerSyncClockUpdate_Synchronized)
+  {
+    ESPServerLogInfo("Synchronized to the clock of the sync master");
+  }
+  else if (result == ESPServerSyncClockUpdate_Resynchronized)
+  {
+    ESPServerLogDebugf("Sync clock error of %ld us, clock has been set to the master clock\n", this->syncClock.getLastClockErrorMicros());
+  }
+}
+
+/**
+ * start all queued segments whose start time has been reached
+ */
+void ESPStepperMotorServer_SyncController::executeDueSegments()
+{
+  ESPStepperMotorServer_SyncSegment segment;
+  long startDelayMicros;
+  while (xQueuePeek(this->segmentQueue, &segment, 0) == pdTRUE)
+  {
+    if (!this->syncClock.isSegmentDue(segment.startMasterMicros, micros(), startDelayMicros))
+    {
+      return;
+    }
+    xQueueReceive(this->segmentQueue, &segment, 0);
+    if ((unsigned long)startDelayMicros > this->maxStartDelayMicros)
+    {
+      this->maxStartDelayMicros = startDelayMicros;
+    }
+    this->executeSegment(segment);
+  }
+}
+
+void ESPStepperMotorServer_SyncController::executeSegment(const ESPStepperMotorServer_SyncSegment &segment)
+{
+  if (this->serverRef->emergencySwitchIsActive)
+  {
+    this->droppedSegmentCounter++;
+    return;
+  }
+  ESPStepperMotorServer_Configuration *configuration = this->serverRef->getCurrentServerConfiguration();
+  for (byte moveIndex = 0; moveIndex < segment.moveCount; moveIndex++)
+  {
+    const ESPStepperMotorServer_SyncMove &move = segment.moves[moveIndex];
+    if (move.nodeId != this->nodeId)
+    {
+      continue;
+    }
+    ESPStepperMotorServer_StepperConfiguration *stepper = configuration->getStepperConfiguration(move.stepperId);
+    if (stepper == NULL)
+    {
+      ESPStepperMotorServer_Logger::logWarningf("Sync segment %u references the invalid stepper id %i\n", segment.segmentId, move.stepperId);
+      continue;
+    }
+    ESP_FlexyStepper *flexyStepper = stepper->getFlexyStepper();
+    flexyStepper->setSpeedInStepsPerSecond(move.speedInStepsPerSecond);
+    flexyStepper->setAccelerationInStepsPerSecondPerSecond(move.accelerationInStepsPerSecondPerSecond);
+    flexyStepper->setDecelerationInStepsPerSecondPerSecond(move.accelerationInStepsPerSecondPerSecond);
+    long targetPosition = move.targetPositionInSteps;
+    if (stepper->setTargetPositionWithinSoftLimits(targetPosition) == ESPServerSoftLimitResult_Rejected)
+    {
+      ESPStepperMotorServer_Logger::logWarningf("Target of stepper %i in sync segment %u is outside of the soft limits\n", move.stepperId, segment.segmentId);
+    }
+  }
+  this->executedSegmentCounter++;
+}
+
+void ESPStepperMotorServer_SyncController::discardSegments()
+{
+  if (this->segmentQueue != NULL)
+  {
+    xQueueReset(this->segmentQueue);
+  }
+}
+
+/**
+ * get the current time of the master in us. On followers this is only valid while isClockSynchronized() returns true
+ */
+uint32_t ESPStepperMotorServer_SyncController::getMasterMicros()
+{
+  return this->syncClock.getMasterMicros(micros());
+}
+
+byte ESPStepperMotorServer_SyncController::getRole() const
+{
+  return this->role;
+}
+
+byte ESPStepperMotorServer_SyncController::getNodeId() const
+{
+  return this->nodeId;
+}
+
+bool ESPStepperMotorServer_SyncController::isClockSynchronized() const
+{
+  return this->syncClock.isValid();
+}
+
+/**
+ * the difference between the master time of the last clock packet and the time the follower clock predicted for it
+ */
+long ESPStepperMotorServer_SyncController::getLastClockErrorMicros() const
+{
+  return this->syncClock.getLastClockErrorMicros();
+}
+
+/**
+ * the one way network delay between the master and this follower, measured with the clock requests. Always 0 on the master
+ */
+long ESPStepperMotorServer_SyncController::getNetworkDelayMicros() const
+{
+  return this->syncClock.getNetworkDelayMicros();
+}
+
+float ESPStepperMotorServer_SyncController::getClockDriftPpm() const
+{
+  return this->syncClock.getClockDriftPpm();
+}
+
+unsigned long ESPStepperMotorServer_SyncController::getClockResyncCount() const
+{
+  return this->syncClock.getResyncCount();
+}
+
+unsigned long ESPStepperMotorServer_SyncController::getExecutedSegmentCount() const
+{
+  return this->executedSegmentCounter;
+}
+
+unsigned long ESPStepperMotorServer_SyncController::getDroppedSegmentCount() const
+{
+  return this->droppedSegmentCounter;
+}
+
+/**
+ * the longest time between the start time of a segment and the time it has actually been started on this controller
+ */
+unsigned long ESPStepperMotorServer_SyncController::getMaxStartDelayMicros() const
+{
+  return this->maxStartDelayMicros;
+}
+
+unsigned long ESPStepperMotorServer_SyncController::getPacketErrorCount() const
+{
+  return this->packetErrorCounter;
+}
@@ -0,0 +1,154 @@
+//      ******************************************************************
+//      *                                                                *
+//      *   Header file for ESPStepperMotorServer_SyncController.cpp     *
+//      *                                                                *
+//      *               Copyright (c) Paul Kerspe, 2019                  *
+//      *                                                                *
+//      ******************************************************************
+// MIT License
+//
+// Copyright (c) 2019 Paul Kerspe
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished
+// to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef ESPStepperMotorServer_SyncController_h
+#define ESPStepperMotorServer_SyncController_h
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <WiFiUdp.h>
+#include <ESPStepperMotorServer_Logger.h>
+#include <ESPStepperMotorServer_SyncPacket.h>
+#include <ESPStepperMotorServer_SyncClock.h>
+
+#define ESPServerSyncRole_Master 1
+#define ESPServerSyncRole_Follower 2
+
+// the UDP port the master broadcasts to and the followers listen on
+#define ESPServerSyncDefaultPort 4211
+// the interval in ms the master broadcasts its clock
+#ifndef ESPServerSyncClockIntervalMs
+#define ESPServerSyncClockIntervalMs 100
+#endif
+// the default time in ms between broadcasting a segment and executing it. Must be larger than the network latency
+#ifndef ESPServerSyncLeadTimeMs
+#define ESPServerSyncLeadTimeMs 20
+#endif
+// the number of segments that can be waiting for their start time on each controller
+#ifndef ESPServerSyncSegmentQueueLength
+#define ESPServerSyncSegmentQueueLength 8
+#endif
+// a follower that did not receive a clock packet for this time discards its waiting segments and rejects new ones
+#ifndef ESPServerSyncClockTimeoutMs
+#define ESPServerSyncClockTimeoutMs 1000
+#endif
+// the interval in ms a follower measures the network delay to the master with a clock request
+#ifndef ESPServerSyncRoundTripIntervalMs
+#define ESPServerSyncRoundTripIntervalMs 1000
+#endif
+// each segment is sent this many times, followers ignore the copies. Reduces the impact of lost UDP packets
+#define ESPServerSyncSegmentSendCount 2
+class ESPStepperMotorServer;
+
+//
+// the ESPStepperMotorServer_SyncController class
+// synchronizes the moves of several servers (e.g. for machines with more axes than one ESP32 can drive).
+// The master broadcasts its clock and the move segments via UDP, each segment is started by all controllers
+// at the same master time. Followers track the master clock with a filtered offset and a drift estimate,
+// so the start times stay aligned between the clock packets. The network delay is measured with round trip
+// clock requests of the followers (like NTP does) and added to the master time of the clock packets.
+// The clock filter and the start time decisions are done by ESPStepperMotorServer_SyncClock
+class ESPStepperMotorServer_SyncController
+{
+public:
+  ESPStepperMotorServer_SyncController(ESPStepperMotorServer *serverRef, byte role, byte nodeId, uint16_t port = ESPServerSyncDefaultPort);
+  ~ESPStepperMotorServer_SyncController();
+  static void processSync(void *parameter);
+  void start();
+  void stop();
+  void setBroadcastAddress(IPAddress broadcastAddress);
+  bool sendSegment(ESPStepperMotorServer_SyncSegment &segment, unsigned long leadTimeMs = ESPServerSyncLeadTimeMs);
+
+  byte getRole() const;
+  byte getNodeId() const;
+  bool isClockSynchronized() const;
+  uint32_t getMasterMicros();
+  long getLastClockErrorMicros() const;
+  long getNetworkDelayMicros() const;
+  float getClockDriftPpm() const;
+  unsigned long getClockResyncCount() const;
+  unsigned long getExecutedSegmentCount() const;
+  unsigned long getDroppedSegmentCount() const;
+  unsigned long getMaxStartDelayMicros() const;
+  unsigned long getPacketErrorCount() const;
+
+private:
+  void sendClock();
+  void sendClockRequest();
+  bool sendPacket(const byte *packet, size_t length, IPAddress address);
+  void receivePackets();
+  void handlePacket(const byte *packet, size_t length, uint32_t receiveMicros, IPAddress remoteAddress);
+  void handleClockPacket(const byte *packet, size_t length, uint32_t receiveMicros, IPAddress remoteAddress);
+  void handleClockRequest(const byte *packet, size_t length, uint32_t receiveMicros, IPAddress remoteAddress);
+  void handleClockResponse(const byte *packet, size_t length, uint32_t receiveMicros);
+  void handleSegmentPacket(const byte *packet, size_t length);
+  void updateMasterEmergencyStop(bool isEmergencyStopActive);
+  void updateClock(uint32_t masterMicros, uint32_t localMicros);
+  void executeDueSegments();
+  void executeSegment(const ESPStepperMotorServer_SyncSegment &segment);
+  void discardSegments();
+
+  ESPStepperMotorServer *serverRef;
+  byte role;
+  byte nodeId;
+  uint16_t port;
+  IPAddress broadcastAddress;
+  bool isBroadcastAddressSet = false;
+  WiFiUDP udp;
+  // the UDP socket is used by the sync task and by the tasks calling sendSegment
+  SemaphoreHandle_t udpMutex = NULL;
+  TaskHandle_t xHandle = NULL;
+  QueueHandle_t segmentQueue = NULL;
+  uint16_t nextSegmentId = 1;
+  uint16_t lastReceivedSegmentId = 0;
+  bool isSegmentReceived = false;
+  unsigned long lastClockSentMillis = 0;
+  bool lastSentEmergencyStopState = false;
+
+  ESPStepperMotorServer_SyncClock syncClock;
+  unsigned long lastClockReceivedMillis = 0;
+  bool isMasterEmergencyStopActive = false;
+  // set if the emergency stop of the master stopped this follower, only then it is revoked with the master
+  bool isEmergencyStopTriggeredByMaster = false;
+  unsigned int masterEmergencyStopCounter = 0;
+
+  // network delay measurement of the follower
+  IPAddress masterAddress;
+  bool isMasterAddressKnown = false;
+  unsigned long lastClockRequestMillis = 0;
+  uint32_t lastClockRequestMicros = 0;
+  bool isClockRequestPending = false;
+
+  unsigned long executedSegmentCounter = 0;
+  unsigned long droppedSegmentCounter = 0;
+  unsigned long maxStartDelayMicros = 0;
+  unsigned long packetErrorCounter = 0;
+};
+
+#endif
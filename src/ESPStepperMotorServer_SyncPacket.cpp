@@ -0,0 +1,196 @@
+//      *********************************************************
+//      *                                                       *
+//      *     ESP32 Stepper Motor Server -  Sync Packet       *
+//      *                                                       *
+//      *            Copyright (c) Paul Kerspe, 2019            *
+//      *                                                       *
+//      **********************************************************
+
+// MIT License
+//
+// Copyright (c) 2019 Paul Kerspe
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished
+// to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <ESPStepperMotorServer_SyncPacket.h>
+#include <ESPStepperMotorServer_FrameCodec.h>
+
+/**
+ * check the magic number, the protocol version and the checksum of the given packet
+ */
+bool ESPStepperMotorServer_SyncPacket::isValid(const byte *packet, size_t length)
+{
+  if (length < ESPServerSyncPacketHeaderLength + ESPServerSyncPacketCrcLength || packet[0] != ESPServerSyncPacketMagic || packet[1] != ESPServerSyncPacketVersion)
+  {
+    return false;
+  }
+  uint16_t crc;
+  memcpy(&crc, &packet[length - ESPServerSyncPacketCrcLength], sizeof(crc));
+  return (crc == ESPStepperMotorServer_FrameCodec::calculateCrc16(packet, length - ESPServerSyncPacketCrcLength));
+}
+
+/**
+ * get the type of a valid packet (one of the ESPServerSyncPacket_* values)
+ */
+byte ESPStepperMotorServer_SyncPacket::getType(const byte *packet)
+{
+  return packet[2];
+}
+
+size_t ESPStepperMotorServer_SyncPacket::encodeClock(uint32_t masterMicros, bool isEmergencyStopActive, byte *packet)
+{
+  byte *payload = &packet[ESPServerSyncPacketHeaderLength];
+  memcpy(&payload[0], &masterMicros, 4);
+  payload[4] = isEmergencyStopActive ? 1 : 0;
+  return writeHeaderAndCrc(packet, ESPServerSyncPacket_Clock, 5);
+}
+
+bool ESPStepperMotorServer_SyncPacket::decodeClock(const byte *packet, size_t length, uint32_t &masterMicros, bool &isEmergencyStopActive)
+{
+  if (length != ESPServerSyncPacketClockLength || getType(packet) != ESPServerSyncPacket_Clock)
+  {
+    return false;
+  }
+  const byte *payload = &packet[ESPServerSyncPacketHeaderLength];
+  memcpy(&masterMicros, &payload[0], 4);
+  isEmergencyStopActive = (payload[4] != 0);
+  return true;
+}
+
+size_t ESPStepperMotorServer_SyncPacket::encodeClockRequest(byte nodeId, uint32_t followerSendMicros, byte *packet)
+{
+  byte *payload = &packet[ESPServerSyncPacketHeaderLength];
+  payload[0] = nodeId;
+  memcpy(&payload[1], &followerSendMicros, 4);
+  return writeHeaderAndCrc(packet, ESPServerSyncPacket_ClockRequest, 5);
+}
+
+bool ESPStepperMotorServer_SyncPacket::decodeClockRequest(const byte *packet, size_t length, byte &nodeId, uint32_t &followerSendMicros)
+{
+  if (length != ESPServerSyncPacketClockRequestLength || getType(packet) != ESPServerSyncPacket_ClockRequest)
+  {
+    return false;
+  }
+  const byte *payload = &packet[ESPServerSyncPacketHeaderLength];
+  nodeId = payload[0];
+  memcpy(&followerSendMicros, &payload[1], 4);
+  return true;
+}
+
+size_t ESPStepperMotorServer_SyncPacket::encodeClockResponse(const ESPStepperMotorServer_SyncClockExchange &exchange, byte *packet)
+{
+  byte *payload = &packet[ESPServerSyncPacketHeaderLength];
+  payload[0] = exchange.nodeId;
+  memcpy(&payload[1], &exchange.followerSendMicros, 4);
+  memcpy(&payload[5], &exchange.masterReceiveMicros, 4);
+  memcpy(&payload[9], &exchange.masterSendMicros, 4);
+  return writeHeaderAndCrc(packet, ESPServerSyncPacket_ClockResponse, 13);
+}
+
+bool ESPStepperMotorServer_SyncPacket::decodeClockResponse(const byte *packet, size_t length, ESPStepperMotorServer_SyncClockExchange &exchange)
+{
+  if (length != ESPServerSyncPacketClockResponseLength || getType(packet) != ESPServerSyncPacket_ClockResponse)
+  {
+    return false;
+  }
+  const byte *payload = &packet[ESPServerSyncPacketHeaderLength];
+  exchange.nodeId = payload[0];
+  memcpy(&exchange.followerSendMicros, &payload[1], 4);
+  memcpy(&exchange.masterReceiveMicros, &payload[5], 4);
+  memcpy(&exchange.masterSendMicros, &payload[9], 4);
+  return true;
+}
+
+size_t ESPStepperMotorServer_SyncPacket::encodeSegment(const ESPStepperMotorServer_SyncSegment &segment, byte *packet)
+{
+  // the ESP32 is little endian, so all values can be copied as they are
+  byte *payload = &packet[ESPServerSyncPacketHeaderLength];
+  memcpy(&payload[0], &segment.segmentId, 2);
+  memcpy(&payload[2], &segment.startMasterMicros, 4);
+  payload[6] = segment.moveCount;
+  size_t payloadLength = 7;
+  for (byte moveIndex = 0; moveIndex < segment.moveCount; moveIndex++)
+  {
+    const ESPStepperMotorServer_SyncMove &move = segment.moves[moveIndex];
+    int32_t targetPosition = move.targetPositionInSteps;
+    payload[payloadLength] = move.nodeId;
+    payload[payloadLength + 1] = move.stepperId;
+    memcpy(&payload[payloadLength + 2], &targetPosition, 4);
+    memcpy(&payload[payloadLength + 6], &move.speedInStepsPerSecond, 4);
+    memcpy(&payload[payloadLength + 10], &move.accelerationInStepsPerSecondPerSecond, 4);
+    payloadLength += ESPServerSyncPacketMoveLength;
+  }
+  return writeHeaderAndCrc(packet, ESPServerSyncPacket_Segment, payloadLength);
+}
+
+/**
+ * decode a segment packet. Returns false if the length does not match the move count
+ */
+bool ESPStepperMotorServer_SyncPacket::decodeSegment(const byte *packet, size_t length, ESPStepperMotorServer_SyncSegment &segment)
+{
+  const byte *payload = &packet[ESPServerSyncPacketHeaderLength];
+  if (length < ESPServerSyncPacketHeaderLength + 7 + ESPServerSyncPacketCrcLength || getType(packet) != ESPServerSyncPacket_Segment)
+  {
+    return false;
+  }
+  segment.moveCount = payload[6];
+  if (segment.moveCount == 0 || segment.moveCount > ESPServerSyncMaxSegmentMoves || length != (size_t)(ESPServerSyncPacketHeaderLength + 7 + segment.moveCount * ESPServerSyncPacketMoveLength + ESPServerSyncPacketCrcLength))
+  {
+    return false;
+  }
+  memcpy(&segment.segmentId, &payload[0], 2);
+  memcpy(&segment.startMasterMicros, &payload[2], 4);
+  const byte *movePayload = &payload[7];
+  for (byte moveIndex = 0; moveIndex < segment.moveCount; moveIndex++)
+  {
+    ESPStepperMotorServer_SyncMove &move = segment.moves[moveIndex];
+    int32_t targetPosition;
+    move.nodeId = movePayload[0];
+    move.stepperId = movePayload[1];
+    memcpy(&targetPosition, &movePayload[2], 4);
+    move.targetPositionInSteps = targetPosition;
+    memcpy(&move.speedInStepsPerSecond, &movePayload[6], 4);
+    memcpy(&move.accelerationInStepsPerSecondPerSecond, &movePayload[10], 4);
+    movePayload += ESPServerSyncPacketMoveLength;
+  }
+  return true;
+}
+
+/**
+ * calculate the one way network delay of a clock exchange like NTP does: half of the round trip time without the time the master needed to answer.
+ * All time stamps may wrap around
+ */
+long ESPStepperMotorServer_SyncPacket::calculateOneWayDelayMicros(const ESPStepperMotorServer_SyncClockExchange &exchange, uint32_t followerReceiveMicros)
+{
+  const uint32_t roundTripMicros = followerReceiveMicros - exchange.followerSendMicros;
+  const uint32_t masterProcessingMicros = exchange.masterSendMicros - exchange.masterReceiveMicros;
+  return (long)(int32_t)(roundTripMicros - masterProcessingMicros) / 2;
+}
+
+// writes the header and the checksum around the payload, returns the length of the packet
+size_t ESPStepperMotorServer_SyncPacket::writeHeaderAndCrc(byte *packet, byte type, size_t payloadLength)
+{
+  packet[0] = ESPServerSyncPacketMagic;
+  packet[1] = ESPServerSyncPacketVersion;
+  packet[2] = type;
+  const size_t crcOffset = ESPServerSyncPacketHeaderLength + payloadLength;
+  const uint16_t crc = ESPStepperMotorServer_FrameCodec::calculateCrc16(packet, crcOffset);
+  memcpy(&packet[crcOffset], &crc, sizeof(crc));
+  return crcOffset + ESPServerSyncPacketCrcLength;
+}
@@ -0,0 +1,112 @@
+//      ******************************************************************
+//      *                                                                *
+//      *     Header file for ESPStepperMotorServer_SyncPacket.cpp       *
+//      *                                                                *
+//      *               Copyright (c) Paul Kerspe, 2019                  *
+//      *                                                                *
+//      ******************************************************************
+
+// MIT License
+//
+// Copyright (c) 2019 Paul Kerspe
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished
+// to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef ESPStepperMotorServer_SyncPacket_h
+#define ESPStepperMotorServer_SyncPacket_h
+
+#include <Arduino.h>
+
+// the maximum number of stepper moves (summed up over all controllers) in one segment
+#define ESPServerSyncMaxSegmentMoves 6
+
+// packet layout (all values little endian):
+// [magic (uint8)] [version (uint8)] [type (uint8)] [payload] [CRC-16/CCITT-FALSE over all previous bytes (uint16)]
+#define ESPServerSyncPacketMagic 0xE5
+#define ESPServerSyncPacketVersion 1
+// broadcast by the master. Payload: master time in us (uint32), emergency stop active (uint8)
+#define ESPServerSyncPacket_Clock 1
+// broadcast by the master. Payload: segment id (uint16), start time in master us (uint32), move count (uint8),
+// per move: node id (uint8), stepper id (uint8), target position in steps (int32), speed in steps/s (float), acceleration in steps/s^2 (float)
+#define ESPServerSyncPacket_Segment 2
+// sent by a follower to the master to measure the network delay. Payload: node id (uint8), follower send time in us (uint32)
+#define ESPServerSyncPacket_ClockRequest 3
+// the answer of the master to a clock request. Payload: node id (uint8), follower send time in us (uint32),
+// master receive time in us (uint32), master send time in us (uint32)
+#define ESPServerSyncPacket_ClockResponse 4
+#define ESPServerSyncPacketHeaderLength 3
+#define ESPServerSyncPacketCrcLength 2
+#define ESPServerSyncPacketClockLength (ESPServerSyncPacketHeaderLength + 5 + ESPServerSyncPacketCrcLength)
+#define ESPServerSyncPacketClockRequestLength (ESPServerSyncPacketHeaderLength + 5 + ESPServerSyncPacketCrcLength)
+#define ESPServerSyncPacketClockResponseLength (ESPServerSyncPacketHeaderLength + 13 + ESPServerSyncPacketCrcLength)
+#define ESPServerSyncPacketMoveLength 14
+#define ESPServerSyncPacketMaxLength (ESPServerSyncPacketHeaderLength + 7 + ESPServerSyncMaxSegmentMoves * ESPServerSyncPacketMoveLength + ESPServerSyncPacketCrcLength)
+
+// one target position change that is part of a segment. The master has the node id 0, followers 1-254
+struct ESPStepperMotorServer_SyncMove
+{
+  byte nodeId;
+  byte stepperId;
+  long targetPositionInSteps;
+  float speedInStepsPerSecond;
+  float accelerationInStepsPerSecondPerSecond; // also used as deceleration
+};
+
+// a set of moves that are started at the same time on all controllers
+struct ESPStepperMotorServer_SyncSegment
+{
+  uint16_t segmentId;
+  uint32_t startMasterMicros; // the start time in the time base of the master
+  byte moveCount;
+  ESPStepperMotorServer_SyncMove moves[ESPServerSyncMaxSegmentMoves];
+};
+
+// the time stamps of a clock request of a follower and the response of the master
+struct ESPStepperMotorServer_SyncClockExchange
+{
+  byte nodeId;
+  uint32_t followerSendMicros;
+  uint32_t masterReceiveMicros;
+  uint32_t masterSendMicros;
+};
+
+//
+// the ESPStepperMotorServer_SyncPacket class
+// encodes and decodes the UDP packets of the sync controller.
+// The functions do not depend on the server, so they can also be tested on the host (see test/test_sync_packet)
+class ESPStepperMotorServer_SyncPacket
+{
+public:
+  static bool isValid(const byte *packet, size_t length);
+  static byte getType(const byte *packet);
+  static size_t encodeClock(uint32_t masterMicros, bool isEmergencyStopActive, byte *packet);
+  static bool decodeClock(const byte *packet, size_t length, uint32_t &masterMicros, bool &isEmergencyStopActive);
+  static size_t encodeClockRequest(byte nodeId, uint32_t followerSendMicros, byte *packet);
+  static bool decodeClockRequest(const byte *packet, size_t length, byte &nodeId, uint32_t &followerSendMicros);
+  static size_t encodeClockResponse(const ESPStepperMotorServer_SyncClockExchange &exchange, byte *packet);
+  static bool decodeClockResponse(const byte *packet, size_t length, ESPStepperMotorServer_SyncClockExchange &exchange);
+  static size_t encodeSegment(const ESPStepperMotorServer_SyncSegment &segment, byte *packet);
+  static bool decodeSegment(const byte *packet, size_t length, ESPStepperMotorServer_SyncSegment &segment);
+  static long calculateOneWayDelayMicros(const ESPStepperMotorServer_SyncClockExchange &exchange, uint32_t followerReceiveMicros);
+
+private:
+  static size_t writeHeaderAndCrc(byte *packet, byte type, size_t payloadLength);
+};
+
+#endif
@@ -0,0 +1,325 @@
+//      ******************************************************************
+//      *                                                                *
+//      *        ESPStepperMotorServer_TrajectoryRecorder                *
+//      *                                                                *
+//      *               Copyright (c) Paul Kerspe, 2019                  *
+//      *                                                                *
+//      ******************************************************************
+
+// MIT License
+//
+// Copyright (c) 2019 Paul Kerspe
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished
+// to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#define ESPServerLogModule ESPServerLogModule_TrajectoryRecorder
+
+#include <ESPStepperMotorServer.h>
+#include <ESPStepperMotorServer_TrajectoryRecorder.h>
+
+// the header of a recording file on the SPIFFS, followed by the samples
+struct ESPStepperMotorServer_TrajectoryFileHeader
+{
+  uint32_t magic;
+  uint32_t sampleCount;
+};
+
+/**
+ * start a new recording. The samples of the previous recording are discarded.
+ * Returns false if a recording or replay is already running
+ */
+bool ESPStepperMotorServer_TrajectoryRecorder::startRecording()
+{
+  bool isStarted = false;
+  portENTER_CRITICAL(&this->mux);
+  if (this->state == ESPServerTrajectoryState_Idle)
+  {
+    this->isStartPending = true;
+    this->state = ESPServerTrajectoryState_Recording;
+    isStarted = true;
+  }
+  portEXIT_CRITICAL(&this->mux);
+  return isStarted;
+}
+
+/**
+ * replay the current samples. A time scale of 2 replays the recording twice as fast, 0.5 with half of the speed.
+ * A time scale of 0 sends each target position as soon as all steppers reached their previous targets, so the recording is replayed as fast as the speed settings of the steppers allow.
+ * Returns false if a recording or replay is already running or no samples are available
+ */
+bool ESPStepperMotorServer_TrajectoryRecorder::startReplay(float timeScale)
+{
+  bool isStarted = false;
+  portENTER_CRITICAL(&this->mux);
+  if (this->state == ESPServerTrajectoryState_Idle && this->timeline.getSampleCount() > 0 && timeScale >= 0)
+  {
+    this->timeline.startReplay(timeScale);
+    this->isStartPending = true;
+    this->state = ESPServerTrajectoryState_Replaying;
+    isStarted = true;
+  }
+  portEXIT_CRITICAL(&this->mux);
+  return isStarted;
+}
+
+/**
+ * stop the current recording or replay. Steppers that are moving during a replay continue to move to their current target
+ */
+void ESPStepperMotorServer_TrajectoryRecorder::stop()
+{
+  portENTER_CRITICAL(&this->mux);
+  this->state = ESPServerTrajectoryState_Idle;
+  this->isStartPending = false;
+  portEXIT_CRITICAL(&this->mux);
+}
+
+unsigned int ESPStepperMotorServer_TrajectoryRecorder::getSampleCount() const
+{
+  return this->timeline.getSampleCount();
+}
+
+bool ESPStepperMotorServer_TrajectoryRecorder::isSampleBufferOverflown() const
+{
+  return this->timeline.isSampleBufferOverflown();
+}
+
+/**
+ * add a sample for each stepper whose target position changed since the last call.
+ * On the first call after startRecording, a sample with the current position is added for each stepper
+ */
+void ESPStepperMotorServer_TrajectoryRecorder::recordSamples(ESPStepperMotorServer_ActiveAxis *activeAxes, byte activeAxisCount)
+{
+  const unsigned long now = millis();
+  bool isOverflowDetected = false;
+  portENTER_CRITICAL(&this->mux);
+  if (this->state == ESPServerTrajectoryState_Recording)
+  {
+    const bool isFirstCycle = this->isStartPending;
+    if (isFirstCycle)
+    {
+      this->timeline.startRecording(now);
+      this->isStartPending = false;
+    }
+    for (byte i = 0; i < activeAxisCount; i++)
+    {
+      const long targetPosition = (isFirstCycle) ? activeAxes[i].flexyStepper->getCurrentPositionInSteps() : activeAxes[i].flexyStepper->getTargetPositionInSteps();
+      if (!this->timeline.recordTargetPosition(now, activeAxes[i].stepperId, targetPosition, isFirstCycle))
+      {
+        // the recording is stopped instead of overwriting the oldest samples, since a replay without its beginning would start from the wrong positions
+        this->state = ESPServerTrajectoryState_Idle;
+        isOverflowDetected = true;
+        break;
+      }
+    }
+  }
+  portEXIT_CRITICAL(&this->mux);
+  if (isOverflowDetected)
+  {
+    ESPStepperMotorServer_Logger::logWarningf("The trajectory recording has been stopped, since the maximum number of %i samples has been reached\n", ESPServerTrajectoryMaxSamples);
+  }
+}
+
+/**
+ * set the target positions of all samples that are due. The first samples (the start positions) are sent immediately,
+ * the timeline of the recording starts once all steppers reached their start positions
+ */
+void ESPStepperMotorServer_TrajectoryRecorder::processReplay(ESPStepperMotorServer_Configuration *configuration)
+{
+  const unsigned long now = millis();
+  unsigned int count = 0;
+  const ESPStepperMotorServer_TrajectorySample *samples;
+  if (this->isStartPending)
+  {
+    this->isStartPending = false;
+    samples = this->timeline.getStartSamples(count);
+    for (unsigned int i = 0; i < count; i++)
+    {
+      this->replaySample(configuration, samples[i]);
+    }
+  }
+  const bool isIdle = this->areAllSteppersIdle(configuration);
+  samples = this->timeline.getDueSamples(now, isIdle, count);
+  for (unsigned int i = 0; i < count; i++)
+  {
+    this->replaySample(configuration, samples[i]);
+  }
+  // the idle state has been checked before the last samples were sent, so the replay completes in one of the next cycles
+  if (isIdle && count == 0 && this->timeline.isReplayCompleted())
+  {
+    this->stop();
+    ESPServerLogInfo("Trajectory replay completed");
+  }
+}
+
+void ESPStepperMotorServer_TrajectoryRecorder::replaySample(ESPStepperMotorServer_Configuration *configuration, const ESPStepperMotorServer_TrajectorySample &sample)
+{
+  ESPStepperMotorServer_StepperConfiguration *stepper = configuration->getStepperConfiguration(sample.stepperId);
+  if (stepper == NULL)
+  {
+    return;
+  }
+  long targetPosition = sample.targetPositionInSteps;
+  if (stepper->setTargetPositionWithinSoftLimits(targetPosition) == ESPServerSoftLimitResult_Rejected)
+  {
+    ESPStepperMotorServer_Logger::logWarningf("Replayed target position %ld of stepper %i is outside of the soft limits and has been skipped\n", targetPosition, sample.stepperId);
+  }
+}
+
+bool ESPStepperMotorServer_TrajectoryRecorder::areAllSteppersIdle(ESPStepperMotorServer_Configuration *configuration)
+{
+  ESPStepperMotorServer_ActiveAxis activeAxes[ESPServerMaxSteppers];
+  const byte activeAxisCount = configuration->copyActiveAxes(activeAxes);
+  for (byte i = 0; i < activeAxisCount; i++)
+  {
+    if (!activeAxes[i].flexyStepper->motionComplete())
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * write the current samples to the SPIFFS, an existing recording with the same name is replaced
+ */
+bool ESPStepperMotorServer_TrajectoryRecorder::saveRecording(const char *name)
+{
+  const unsigned int sampleCount = this->timeline.getSampleCount();
+  if (!isValidRecordingName(name) || this->state != ESPServerTrajectoryState_Idle || sampleCount == 0)
+  {
+    return false;
+  }
+  char path[32];
+  getRecordingPath(name, path, sizeof(path));
+  File file = SPIFFS.open(path, FILE_WRITE);
+  if (!file)
+  {
+    ESPStepperMotorServer_Logger::logWarningf("Failed to open %s for writing the trajectory recording\n", path);
+    return false;
+  }
+  ESPStepperMotorServer_TrajectoryFileHeader header = {ESPServerTrajectoryFileMagic, sampleCount};
+  const size_t samplesSize = sampleCount * sizeof(ESPStepperMotorServer_TrajectorySample);
+  bool isWritten = (file.write((const uint8_t *)&header, sizeof(header)) == sizeof(header)) && (file.write((const uint8_t *)this->timeline.getSamples(), samplesSize) == samplesSize);
+  file.close();
+  if (!isWritten)
+  {
+    ESPStepperMotorServer_Logger::logWarningf("Failed to write the trajectory recording to %s\n", path);
+    SPIFFS.remove(path);
+  }
+  return isWritten;
+}
+
+/**
+ * load a recording from the SPIFFS into the sample buffer
+ */
+bool ESPStepperMotorServer_TrajectoryRecorder::loadRecording(const char *name)
+{
+  if (!isValidRecordingName(name) || this->state != ESPServerTrajectoryState_Idle)
+  {
+    return false;
+  }
+  char path[32];
+  getRecordingPath(name, path, sizeof(path));
+  File file = SPIFFS.open(path, FILE_READ);
+  if (!file)
+  {
+    return false;
+  }
+  ESPStepperMotorServer_TrajectoryFileHeader header;
+  bool isLoaded = (file.read((uint8_t *)&header, sizeof(header)) == sizeof(header)) && header.magic == ESPServerTrajectoryFileMagic && header.sampleCount <= ESPServerTrajectoryMaxSamples;
+  if (isLoaded)
+  {
+    const size_t samplesSize = header.sampleCount * sizeof(ESPStepperMotorServer_TrajectorySample);
+    isLoaded = (file.read((uint8_t *)this->timeline.getSamples(), samplesSize) == samplesSize);
+  }
+  file.close();
+  this->timeline.setLoadedSampleCount((isLoaded) ? header.sampleCount : 0);
+  if (!isLoaded)
+  {
+    ESPStepperMotorServer_Logger::logWarningf("The trajectory recording %s is invalid or has been recorded with a larger sample limit\n", path);
+  }
+  return isLoaded;
+}
+
+/**
+ * names may only contain letters, digits, '-' and '_', so they can be used as file name without escaping
+ */
+bool ESPStepperMotorServer_TrajectoryRecorder::isValidRecordingName(const char *name)
+{
+  size_t length = (name) ? strlen(name) : 0;
+  if (length == 0 || length > ESPServerTrajectoryMaxNameLength)
+  {
+    return false;
+  }
+  for (size_t i = 0; i < length; i++)
+  {
+    if (!isalnum(name[i]) && name[i] != '-' && name[i] != '_')
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+void ESPStepperMotorServer_TrajectoryRecorder::addRecordingsToJsonArray(JsonArray recordings)
+{
+  File root = SPIFFS.open("/");
+  if (!root || !root.isDirectory())
+  {
+    return;
+  }
+  const size_t prefixLength = strlen(ESPServerTrajectoryFilePrefix);
+  File file = root.openNextFile();
+  while (file)
+  {
+    // depending on the version of the ESP32 core, the name starts with a slash or not
+    const char *fileName = file.name();
+    if (fileName[0] == '/')
+    {
+      fileName++;
+    }
+    const size_t fileNameLength = strlen(fileName);
+    if (strncmp(fileName, ESPServerTrajectoryFilePrefix, prefixLength) == 0 && fileNameLength > prefixLength + 4 && strcmp(&fileName[fileNameLength - 4], ".bin") == 0)
+    {
+      JsonObject recording = recordings.createNestedObject();
+      recording["name"] = String(fileName).substring(prefixLength, fileNameLength - 4);
+      recording["samples"] = (file.size() > sizeof(ESPStepperMotorServer_TrajectoryFileHeader)) ? (file.size() - sizeof(ESPStepperMotorServer_TrajectoryFileHeader)) / sizeof(ESPStepperMotorServer_TrajectorySample) : 0;
+    }
+    file = root.openNextFile();
+  }
+  root.close();
+}
+
+const char *ESPStepperMotorServer_TrajectoryRecorder::getStateName(byte state)
+{
+  switch (state)
+  {
+  case ESPServerTrajectoryState_Recording:
+    return "recording";
+  case ESPServerTrajectoryState_Replaying:
+    return "replaying";
+  default:
+    return "idle";
+  }
+}
+
+void ESPStepperMotorServer_TrajectoryRecorder::getRecordingPath(const char *name, char *path, size_t pathSize)
+{
+  snprintf(path, pathSize, "/%s%s.bin", ESPServerTrajectoryFilePrefix, name);
+}
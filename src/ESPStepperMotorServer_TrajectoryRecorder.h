@@ -0,0 +1,90 @@
+//      ******************************************************************
+//      *                                                                *
+//      *  Header file for ESPStepperMotorServer_TrajectoryRecorder.cpp  *
+//      *                                                                *
+//      *               Copyright (c) Paul Kerspe, 2019                  *
+//      *                                                                *
+//      ******************************************************************
+
+// MIT License
+//
+// Copyright (c) 2019 Paul Kerspe
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished
+// to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef ESPStepperMotorServer_TrajectoryRecorder_h
+#define ESPStepperMotorServer_TrajectoryRecorder_h
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <ESPStepperMotorServer_TrajectoryTimeline.h>
+
+// recordings are stored in the root folder of the SPIFFS as /<prefix><name>.bin
+#define ESPServerTrajectoryFilePrefix "trj_"
+#define ESPServerTrajectoryMaxNameLength 16
+#define ESPServerTrajectoryFileMagic 0x4A525445UL
+
+#define ESPServerTrajectoryState_Idle 0
+#define ESPServerTrajectoryState_Recording 1
+#define ESPServerTrajectoryState_Replaying 2
+
+class ESPStepperMotorServer_Configuration;
+struct ESPStepperMotorServer_ActiveAxis;
+
+//
+// the ESPStepperMotorServer_TrajectoryRecorder class
+// records the target position changes of all steppers (e.g. from jogging with rotary encoders or REST API calls) with their time
+// and replays them later through the same path as all other movement commands (including the soft limits), optionally faster or slower.
+// The first samples of each recording contain the positions of all steppers at the start of the recording, so the replay starts from the same positions.
+// The samples and the timing of the replay are handled by ESPStepperMotorServer_TrajectoryTimeline.
+// recordSamples and processReplay are called by the motion controller task, all other functions can be called from any task
+class ESPStepperMotorServer_TrajectoryRecorder
+{
+public:
+  bool startRecording();
+  bool startReplay(float timeScale);
+  void stop();
+  byte getState() const
+  {
+    return this->state;
+  }
+  unsigned int getSampleCount() const;
+  bool isSampleBufferOverflown() const;
+  void recordSamples(ESPStepperMotorServer_ActiveAxis *activeAxes, byte activeAxisCount);
+  void processReplay(ESPStepperMotorServer_Configuration *configuration);
+
+  bool saveRecording(const char *name);
+  bool loadRecording(const char *name);
+  static bool isValidRecordingName(const char *name);
+  static void addRecordingsToJsonArray(JsonArray recordings);
+  static const char *getStateName(byte state);
+
+private:
+  void replaySample(ESPStepperMotorServer_Configuration *configuration, const ESPStepperMotorServer_TrajectorySample &sample);
+  bool areAllSteppersIdle(ESPStepperMotorServer_Configuration *configuration);
+  static void getRecordingPath(const char *name, char *path, size_t pathSize);
+
+  volatile byte state = ESPServerTrajectoryState_Idle;
+  // set when a recording or replay has been requested, the motion controller task captures the start time (and start positions)
+  volatile bool isStartPending = false;
+  ESPStepperMotorServer_TrajectoryTimeline timeline;
+  portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+};
+
+#endif
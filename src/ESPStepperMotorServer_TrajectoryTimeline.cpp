@@ -0,0 +1,157 @@
+//      ******************************************************************
+//      *                                                                *
+//      *            ESPStepperMotorServer_TrajectoryTimeline            *
+//      *                                                                *
+//      *               Copyright (c) Paul Kerspe, 2019                  *
+//      *                                                                *
+//      ******************************************************************
+// MIT License
+//
+// Copyright (c) 2019 Paul Kerspe
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished
+// to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <ESPStepperMotorServer_TrajectoryTimeline.h>
+
+/**
+ * discard the current samples and start the timeline of a new recording
+ */
+void ESPStepperMotorServer_TrajectoryTimeline::startRecording(unsigned long nowMillis)
+{
+  this->sampleCount = 0;
+  this->isOverflown = false;
+  this->startMillis = nowMillis;
+}
+
+/**
+ * add a sample if the target position of the stepper changed since its last sample. The start positions are always added.
+ * Returns false if the sample buffer is full, the recording should be stopped then, since a replay without its beginning would start from the wrong positions
+ */
+bool ESPStepperMotorServer_TrajectoryTimeline::recordTargetPosition(unsigned long nowMillis, byte stepperId, long targetPosition, bool isStartPosition)
+{
+  if (stepperId >= ESPServerMaxSteppers || (!isStartPosition && targetPosition == this->lastTargetPositions[stepperId]))
+  {
+    return true;
+  }
+  if (this->sampleCount >= ESPServerTrajectoryMaxSamples)
+  {
+    this->isOverflown = true;
+    return false;
+  }
+  this->samples[this->sampleCount] = {(uint32_t)(nowMillis - this->startMillis), (int32_t)targetPosition, stepperId};
+  this->sampleCount++;
+  this->lastTargetPositions[stepperId] = targetPosition;
+  return true;
+}
+
+/**
+ * rewind the replay to the first sample. A time scale of 2 replays the recording twice as fast, 0.5 with half of the speed, 0 as fast as the steppers can follow
+ */
+void ESPStepperMotorServer_TrajectoryTimeline::startReplay(float timeScale)
+{
+  this->timeScale = timeScale;
+  this->replayIndex = 0;
+  this->isApproachingStartPositions = true;
+}
+
+/**
+ * returns the samples with the start positions of the recording, they are sent right away when the replay starts
+ */
+const ESPStepperMotorServer_TrajectorySample *ESPStepperMotorServer_TrajectoryTimeline::getStartSamples(unsigned int &count)
+{
+  const unsigned int firstIndex = this->replayIndex;
+  while (this->replayIndex < this->sampleCount && this->samples[this->replayIndex].timeMs == 0)
+  {
+    this->replayIndex++;
+  }
+  count = this->replayIndex - firstIndex;
+  return &this->samples[firstIndex];
+}
+
+/**
+ * returns the samples that are due at the given time, the timeline starts once all steppers reached their start positions.
+ * With a time scale of 0, at most one sample is returned and only if all steppers reached the targets of the previous samples
+ */
+const ESPStepperMotorServer_TrajectorySample *ESPStepperMotorServer_TrajectoryTimeline::getDueSamples(unsigned long nowMillis, bool areAllSteppersIdle, unsigned int &count)
+{
+  const unsigned int firstIndex = this->replayIndex;
+  count = 0;
+  if (this->isApproachingStartPositions)
+  {
+    if (!areAllSteppersIdle)
+    {
+      return &this->samples[firstIndex];
+    }
+    this->isApproachingStartPositions = false;
+    this->startMillis = nowMillis;
+  }
+
+  if (this->timeScale == 0)
+  {
+    if (areAllSteppersIdle && this->replayIndex < this->sampleCount)
+    {
+      this->replayIndex++;
+    }
+  }
+  else
+  {
+    const float elapsedMs = (float)(nowMillis - this->startMillis) * this->timeScale;
+    while (this->replayIndex < this->sampleCount && (float)this->samples[this->replayIndex].timeMs <= elapsedMs)
+    {
+      this->replayIndex++;
+    }
+  }
+  count = this->replayIndex - firstIndex;
+  return &this->samples[firstIndex];
+}
+
+/**
+ * true once all samples have been returned, the replay is completed when the steppers reached the last targets
+ */
+bool ESPStepperMotorServer_TrajectoryTimeline::isReplayCompleted() const
+{
+  return (!this->isApproachingStartPositions && this->replayIndex >= this->sampleCount);
+}
+
+unsigned int ESPStepperMotorServer_TrajectoryTimeline::getSampleCount() const
+{
+  return this->sampleCount;
+}
+
+bool ESPStepperMotorServer_TrajectoryTimeline::isSampleBufferOverflown() const
+{
+  return this->isOverflown;
+}
+
+/**
+ * the sample buffer with room for ESPServerTrajectoryMaxSamples samples, used to save and load recordings
+ */
+ESPStepperMotorServer_TrajectorySample *ESPStepperMotorServer_TrajectoryTimeline::getSamples()
+{
+  return this->samples;
+}
+
+/**
+ * set the number of samples that have been loaded into the sample buffer
+ */
+void ESPStepperMotorServer_TrajectoryTimeline::setLoadedSampleCount(unsigned int sampleCount)
+{
+  this->sampleCount = (sampleCount <= ESPServerTrajectoryMaxSamples) ? sampleCount : 0;
+  this->isOverflown = false;
+}
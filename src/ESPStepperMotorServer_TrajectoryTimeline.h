@@ -0,0 +1,84 @@
+//      ******************************************************************
+//      *                                                                *
+//      *  Header file for ESPStepperMotorServer_TrajectoryTimeline.cpp  *
+//      *                                                                *
+//      *               Copyright (c) Paul Kerspe, 2019                  *
+//      *                                                                *
+//      ******************************************************************
+// MIT License
+//
+// Copyright (c) 2019 Paul Kerspe
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished
+// to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef ESPStepperMotorServer_TrajectoryTimeline_h
+#define ESPStepperMotorServer_TrajectoryTimeline_h
+
+#include <Arduino.h>
+
+// the maximum number of samples of one recording. Each sample takes 12 bytes of RAM
+#ifndef ESPServerTrajectoryMaxSamples
+#define ESPServerTrajectoryMaxSamples 500
+#endif
+// same default as in ESPStepperMotorServer.h, so the module can be compiled on its own
+#ifndef ESPServerMaxSteppers
+#define ESPServerMaxSteppers 10
+#endif
+
+// one recorded target position change of a stepper
+struct ESPStepperMotorServer_TrajectorySample
+{
+  uint32_t timeMs; // relative to the start of the recording
+  int32_t targetPositionInSteps;
+  byte stepperId;
+};
+
+//
+// the ESPStepperMotorServer_TrajectoryTimeline class
+// keeps the samples of a trajectory recording and decides which of them are due during a replay.
+// The time is passed in by the caller and the steppers are driven by the caller, so the class does not depend on the ESP32 hardware
+// and can also be tested on the host (see test/test_trajectory_recorder)
+class ESPStepperMotorServer_TrajectoryTimeline
+{
+public:
+  void startRecording(unsigned long nowMillis);
+  bool recordTargetPosition(unsigned long nowMillis, byte stepperId, long targetPosition, bool isStartPosition);
+  void startReplay(float timeScale);
+  const ESPStepperMotorServer_TrajectorySample *getStartSamples(unsigned int &count);
+  const ESPStepperMotorServer_TrajectorySample *getDueSamples(unsigned long nowMillis, bool areAllSteppersIdle, unsigned int &count);
+  bool isReplayCompleted() const;
+
+  unsigned int getSampleCount() const;
+  bool isSampleBufferOverflown() const;
+  ESPStepperMotorServer_TrajectorySample *getSamples();
+  void setLoadedSampleCount(unsigned int sampleCount);
+
+private:
+  ESPStepperMotorServer_TrajectorySample samples[ESPServerTrajectoryMaxSamples];
+  unsigned int sampleCount = 0;
+  bool isOverflown = false;
+  long lastTargetPositions[ESPServerMaxSteppers] = {0};
+  unsigned long startMillis = 0;
+  float timeScale = 1.0;
+  unsigned int replayIndex = 0;
+  // during a replay, the timeline starts once all steppers reached the positions they had at the start of the recording
+  bool isApproachingStartPositions = false;
+};
+
+#endif
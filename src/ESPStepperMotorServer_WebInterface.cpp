@@ -29,6 +29,8 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+#define ESPServerLogModule ESPServerLogModule_WebInterface
+
 #include <ESPStepperMotorServer_WebInterface.h>
 
 HTTPClient http;
@@ -45,20 +47,40 @@ ESPStepperMotorServer_WebInterface::ESPStepperMotorServer_WebInterface(ESPSteppe
     this->_httpServer = NULL;
 }
 
+ESPStepperMotorServer_WebInterface::~ESPStepperMotorServer_WebInterface()
+{
+    this->releaseWebAssets();
+}
+
 /**
  * check if the UI files exist in the SPIFFS and then register all endpoints for the web UI in the http server
  */
 void ESPStepperMotorServer_WebInterface::registerWebInterfaceUrls(AsyncWebServer *httpServer)
 {
     this->_httpServer = httpServer;
+    this->releaseWebAssets();
+#ifdef ESPStepperMotorServer_USE_EMBEDDED_WEB_UI
+    // the web UI is part of the firmware, files in the SPIFFS are only used to override single embedded files
+    const bool isWebUiInstalled = true;
+#else
+    const bool isWebUiInstalled = this->_serverRef->isSPIFFSMounted() && checkIfGuiExistsInSpiffs();
+#endif
+    snprintf(this->_maxAgeCacheControl, sizeof(this->_maxAgeCacheControl), "public, max-age=%lu", (unsigned long)ESPServerWebAssetMaxAge);
+    const char *maxAgeCacheControl = this->_maxAgeCacheControl;
+    const char *revalidateCacheControl = "no-cache";
 
     //OTA update form
-    this->_httpServer->on("/update", HTTP_GET, [this](AsyncWebServerRequest *request) {
-        if (SPIFFS.exists(this->webUiFirmwareUpdate))
+    ESPStepperMotorServer_WebAsset *firmwareUpdatePage = NULL;
+#ifndef ESPStepperMotorServer_USE_EMBEDDED_WEB_UI
+    if (this->_serverRef->isSPIFFSMounted() && this->webUiFileExists(this->webUiFirmwareUpdate))
+#endif
+    {
+        firmwareUpdatePage = this->loadWebAsset(this->webUiFirmwareUpdate, "text/html", revalidateCacheControl);
+    }
+    this->_httpServer->on("/update", HTTP_GET, [this, firmwareUpdatePage](AsyncWebServerRequest *request) {
+        if (firmwareUpdatePage)
         {
-            AsyncWebServerResponse *response = request->beginResponse(SPIFFS, this->webUiFirmwareUpdate, "text/html");
-            response->addHeader("Content-Encoding", "gzip");
-            request->send(response);
+            this->sendWebAsset(request, firmwareUpdatePage);
         }
         else
         {
@@ -123,20 +145,13 @@ void ESPStepperMotorServer_WebInterface::registerWebInterfaceUrls(AsyncWebServer
             }
         });
 
-    if (this->_serverRef->isSPIFFSMounted() && checkIfGuiExistsInSpiffs())
+    if (isWebUiInstalled)
     {
-        this->_httpServer->on("/", HTTP_GET, [this](AsyncWebServerRequest *request) {
-            request->send(SPIFFS, this->webUiIndexFile);
-        });
-        this->_httpServer->on(this->webUiIndexFile, HTTP_GET, [this](AsyncWebServerRequest *request) {
-            request->send(SPIFFS, this->webUiIndexFile);
-        });
-
-        this->_httpServer->on(this->webUiFaviconFile, HTTP_GET, [this](AsyncWebServerRequest *request) {
-            AsyncWebServerResponse *response = request->beginResponse(SPIFFS, this->webUiFaviconFile, "image/x-icon");
-            //response->addHeader("Content-Encoding", "gzip");
-            request->send(response);
-        });
+        // the index page is always revalidated (which is answered with a 304 as long as it did not change), all other assets can be cached by the browser
+        ESPStepperMotorServer_WebAsset *indexPage = this->loadWebAsset(this->webUiIndexFile, "text/html", revalidateCacheControl);
+        this->registerWebAsset("/", indexPage);
+        this->registerWebAsset(this->webUiIndexFile, indexPage);
+        this->registerWebAsset(this->webUiFaviconFile, this->loadWebAsset(this->webUiFaviconFile, "image/x-icon", maxAgeCacheControl));
         /* REMOVED FOR NOW DUE TO SECURITY ISSUES. CAN STILL USE /api/config endpoint to download config (in memory config though!)
         this->_httpServer->on(this->_serverRef->defaultConfigurationFilename, HTTP_GET, [this](AsyncWebServerRequest *request) {
           //FIME: currently this streams the json config including the WiFi Credentials, which might be a security risk.
@@ -146,14 +161,10 @@ void ESPStepperMotorServer_WebInterface::registerWebInterfaceUrls(AsyncWebServer
         });
         */
 
-        this->_httpServer->on("/js/app.js", HTTP_GET, [this](AsyncWebServerRequest *request) {
-            request->redirect(this->webUiJsFile);
-        });
-        this->_httpServer->on(this->webUiJsFile, HTTP_GET, [this](AsyncWebServerRequest *request) {
-            AsyncWebServerResponse *response = request->beginResponse(SPIFFS, this->webUiJsFile, "text/javascript");
-            response->addHeader("Content-Encoding", "gzip");
-            request->send(response);
-        });
+        // the app is served on both urls, to save the redirect from the uncompressed to the compressed file
+        ESPStepperMotorServer_WebAsset *appScript = this->loadWebAsset(this->webUiJsFile, "text/javascript", maxAgeCacheControl);
+        this->registerWebAsset("/js/app.js", appScript);
+        this->registerWebAsset(this->webUiJsFile, appScript);
 
         //little test page to show contents of SPIFFS and check if it is initialized at all for trouble shooting
         this->_httpServer->on("/selftest", HTTP_GET, [this](AsyncWebServerRequest *request) {
@@ -168,7 +179,11 @@ void ESPStepperMotorServer_WebInterface::registerWebInterfaceUrls(AsyncWebServer
             }
             else
             {
+#ifdef ESPStepperMotorServer_USE_EMBEDDED_WEB_UI
+                response->print("<li>WEB UI embedded in firmware: <span class=\"badge badge-success\">true</span></li>");
+#else
                 response->printf("<li>WEB UI installed completely: %s</li>", (this->checkIfGuiExistsInSpiffs()) ? "<span class=\"badge badge-success\">true</span>" : "<span class=\"badge badge-danger\">false</span>");
+#endif
 
                 File root = SPIFFS.open("/");
                 if (!root)
@@ -198,38 +213,23 @@ void ESPStepperMotorServer_WebInterface::registerWebInterfaceUrls(AsyncWebServer
         });
 
         // register image paths with caching header present
-        this->_httpServer->on(this->webUiLogoFile, HTTP_GET, [this](AsyncWebServerRequest *request) {
-            AsyncWebServerResponse *response = request->beginResponse(SPIFFS, this->webUiLogoFile, "image/svg+xml");
-            response->addHeader("Cache-Control", "max-age=36000, public");
-            request->send(response);
-        });
-        this->_httpServer->on(this->webUiStepperGraphic, HTTP_GET, [this](AsyncWebServerRequest *request) {
-            AsyncWebServerResponse *response = request->beginResponse(SPIFFS, this->webUiStepperGraphic, "image/svg+xml");
-            response->addHeader("Cache-Control", "max-age=36000, public");
-            request->send(response);
-        });
-        this->_httpServer->on(this->webUiEncoderGraphic, HTTP_GET, [this](AsyncWebServerRequest *request) {
-            AsyncWebServerResponse *response = request->beginResponse(SPIFFS, this->webUiEncoderGraphic, "image/svg+xml");
-            response->addHeader("Cache-Control", "max-age=36000, public");
-            request->send(response);
-        });
-        this->_httpServer->on(this->webUiEmergencySwitchGraphic, HTTP_GET, [this](AsyncWebServerRequest *request) {
-            AsyncWebServerResponse *response = request->beginResponse(SPIFFS, this->webUiEmergencySwitchGraphic, "image/svg+xml");
-            response->addHeader("Cache-Control", "max-age=36000, public");
-            request->send(response);
-        });
-        this->_httpServer->on(this->webUiSwitchGraphic, HTTP_GET, [this](AsyncWebServerRequest *request) {
-            AsyncWebServerResponse *response = request->beginResponse(SPIFFS, this->webUiSwitchGraphic, "image/svg+xml");
-            response->addHeader("Cache-Control", "max-age=36000, public");
-            request->send(response);
-        });
+        const char *images[] = {
+            this->webUiLogoFile,
+            this->webUiStepperGraphic,
+            this->webUiEncoderGraphic,
+            this->webUiEmergencySwitchGraphic,
+            this->webUiSwitchGraphic};
+        for (const char *image : images)
+        {
+            this->registerWebAsset(image, this->loadWebAsset(image, "image/svg+xml", maxAgeCacheControl));
+        }
         this->_httpServer->onNotFound([this](AsyncWebServerRequest *request) {
             request->send(404, "text/html", "<html><body><h1>ESP-StepperMotor-Server</h1><p>The requested file could not be found</body></html>");
         });
     }
     else
     {
-        ESPStepperMotorServer_Logger::logInfo("No web UI could be registered");
+        ESPServerLogInfo("No web UI could be registered");
     }
 }
 
@@ -239,9 +239,7 @@ void ESPStepperMotorServer_WebInterface::registerWebInterfaceUrls(AsyncWebServer
  */
 bool ESPStepperMotorServer_WebInterface::checkIfGuiExistsInSpiffs()
 {
-#ifndef ESPStepperMotorServer_COMPILE_NO_DEBUG
-    ESPStepperMotorServer_Logger::logDebug("Checking if web UI is installed in SPIFFS");
-#endif
+    ESPServerLogDebug("Checking if web UI is installed in SPIFFS");
 
     if (!this->_serverRef->isSPIFFSMounted())
     {
@@ -263,11 +261,11 @@ bool ESPStepperMotorServer_WebInterface::checkIfGuiExistsInSpiffs()
             this->webUiSwitchGraphic,
             this->webUiFirmwareUpdate};
 
-        for (int i = 0; i < 9; i++) //ALWAYS UPDATE THIS COUNTER IF NEW FILES ARE ADDED TO UI
+        for (int i = 0; i < ESPServerWebAssetCount; i++) //ALWAYS UPDATE ESPServerWebAssetCount IF NEW FILES ARE ADDED TO UI
         {
-            if (!SPIFFS.exists(files[i]))
+            if (!this->webUiFileExists(files[i]))
             {
-                ESPStepperMotorServer_Logger::logInfof(notPresent, files[i]);
+                ESPServerLogInfof(notPresent, files[i]);
                 if (this->_serverRef->getCurrentServerConfiguration()->wifiMode == ESPServerWifiModeClient && WiFi.isConnected())
                 {
                     char downloadUrl[200];
@@ -295,11 +293,11 @@ bool ESPStepperMotorServer_WebInterface::checkIfGuiExistsInSpiffs()
         {
             if (uiComplete == true)
             {
-                ESPStepperMotorServer_Logger::logDebug("Check completed successfully");
+                ESPServerLogDebug("Check completed successfully");
             }
             else
             {
-                ESPStepperMotorServer_Logger::logDebug("Check failed, one or more UI files are missing and could not be downloaded automatically");
+                ESPServerLogDebug("Check failed, one or more UI files are missing and could not be downloaded automatically");
             }
         }
 #endif
@@ -307,6 +305,200 @@ bool ESPStepperMotorServer_WebInterface::checkIfGuiExistsInSpiffs()
     }
 }
 
+/**
+ * returns true if the given file or a pre-gzipped version of it (with .gz extension) exists in the SPIFFS
+ */
+bool ESPStepperMotorServer_WebInterface::webUiFileExists(const char *filePath)
+{
+    return SPIFFS.exists(filePath) || SPIFFS.exists(String(filePath) + ".gz");
+}
+
+/**
+ * prepare the given web UI file for serving. Files in the SPIFFS take precedence over the web UI that is embedded in the firmware
+ * (if compiled with ESPStepperMotorServer_USE_EMBEDDED_WEB_UI), so single files can be replaced without rebuilding the firmware.
+ * Returns NULL if the file does not exist
+ */
+ESPStepperMotorServer_WebAsset *ESPStepperMotorServer_WebInterface::loadWebAsset(const char *filePath, const char *contentType, const char *cacheControl)
+{
+    if (this->_webAssetCount >= ESPServerWebAssetCount)
+    {
+        ESPStepperMotorServer_Logger::logWarningf("Cannot register web UI file %s, increase ESPServerWebAssetCount\n", filePath);
+        return NULL;
+    }
+    ESPStepperMotorServer_WebAsset *asset = &this->_webAssets[this->_webAssetCount];
+    asset->contentType = contentType;
+    asset->cacheControl = cacheControl;
+    asset->ramContent = NULL;
+    asset->flashContent = NULL;
+
+    bool isLoaded = false;
+    if (this->_serverRef->isSPIFFSMounted() && this->webUiFileExists(filePath))
+    {
+        isLoaded = this->loadWebAssetFromSpiffs(asset, filePath);
+    }
+#ifdef ESPStepperMotorServer_USE_EMBEDDED_WEB_UI
+    else
+    {
+        isLoaded = this->loadEmbeddedWebAsset(asset, filePath);
+    }
+#endif
+    if (!isLoaded)
+    {
+        return NULL;
+    }
+    this->_webAssetCount++;
+    return asset;
+}
+
+/**
+ * prepare a web UI file from the SPIFFS: the pre-gzipped version of the file is preferred if it exists,
+ * the ETag is calculated from the file contents and small files are copied to RAM if ESPServerWebAssetRamCacheSize allows
+ */
+bool ESPStepperMotorServer_WebInterface::loadWebAssetFromSpiffs(ESPStepperMotorServer_WebAsset *asset, const char *filePath)
+{
+    const size_t pathLength = strlen(filePath);
+    asset->isGzipped = (pathLength > 3 && strcmp(&filePath[pathLength - 3], ".gz") == 0);
+    snprintf(asset->filePath, sizeof(asset->filePath), "%s.gz", filePath);
+    if (asset->isGzipped || !SPIFFS.exists(asset->filePath))
+    {
+        strncpy(asset->filePath, filePath, sizeof(asset->filePath) - 1);
+        asset->filePath[sizeof(asset->filePath) - 1] = '\0';
+    }
+    else
+    {
+        asset->isGzipped = true;
+    }
+
+    File file = SPIFFS.open(asset->filePath, FILE_READ);
+    if (!file)
+    {
+        ESPStepperMotorServer_Logger::logWarningf("Failed to open web UI file %s\n", asset->filePath);
+        return false;
+    }
+    asset->contentLength = file.size();
+    if (asset->contentLength <= ESPServerWebAssetRamCacheMaxFileSize && this->_ramCacheUsage + asset->contentLength <= ESPServerWebAssetRamCacheSize)
+    {
+        asset->ramContent = (uint8_t *)malloc(asset->contentLength);
+        if (asset->ramContent)
+        {
+            this->_ramCacheUsage += asset->contentLength;
+        }
+    }
+
+    // FNV-1a hash of the file contents as strong ETag (tools/embed_webui.py uses the same calculation for the embedded files)
+    uint32_t hash = 2166136261UL;
+    uint8_t buffer[128];
+    size_t offset = 0;
+    size_t bytesRead;
+    while ((bytesRead = file.read(buffer, sizeof(buffer))) > 0)
+    {
+        for (size_t i = 0; i < bytesRead; i++)
+        {
+            hash = (hash ^ buffer[i]) * 16777619UL;
+        }
+        if (asset->ramContent && offset + bytesRead <= asset->contentLength)
+        {
+            memcpy(&asset->ramContent[offset], buffer, bytesRead);
+        }
+        offset += bytesRead;
+    }
+    file.close();
+    if (asset->ramContent && offset != asset->contentLength)
+    {
+        // file could not be read completely, serve it from SPIFFS instead
+        this->_ramCacheUsage -= asset->contentLength;
+        free(asset->ramContent);
+        asset->ramContent = NULL;
+    }
+    snprintf(asset->etag, sizeof(asset->etag), "\"%08x-%x\"", (unsigned int)hash, (unsigned int)offset);
+    ESPServerLogDebugf("Loaded web UI file %s (%i bytes, ETag %s, %s)\n", asset->filePath, (int)offset, asset->etag, (asset->ramContent) ? "cached in RAM" : "served from SPIFFS");
+    return true;
+}
+
+#ifdef ESPStepperMotorServer_USE_EMBEDDED_WEB_UI
+/**
+ * prepare a web UI file from the generated ESPStepperMotorServer_EmbeddedWebUI.h. The file content is served directly from flash
+ */
+bool ESPStepperMotorServer_WebInterface::loadEmbeddedWebAsset(ESPStepperMotorServer_WebAsset *asset, const char *filePath)
+{
+    const size_t pathLength = strlen(filePath);
+    for (const ESPStepperMotorServer_EmbeddedWebFile &embeddedFile : ESPStepperMotorServer_embeddedWebFiles)
+    {
+        // the file might have been pre-gzipped in the data folder already, then it is embedded with the .gz extension
+        if (strncmp(embeddedFile.path, filePath, pathLength) == 0 && (embeddedFile.path[pathLength] == '\0' || strcmp(&embeddedFile.path[pathLength], ".gz") == 0))
+        {
+            strncpy(asset->filePath, embeddedFile.path, sizeof(asset->filePath) - 1);
+            asset->filePath[sizeof(asset->filePath) - 1] = '\0';
+            asset->isGzipped = embeddedFile.isGzipped;
+            asset->contentLength = embeddedFile.length;
+            asset->flashContent = embeddedFile.content;
+            strncpy(asset->etag, embeddedFile.etag, sizeof(asset->etag) - 1);
+            asset->etag[sizeof(asset->etag) - 1] = '\0';
+            ESPServerLogDebugf("Using embedded web UI file %s (%i bytes)\n", asset->filePath, (int)asset->contentLength);
+            return true;
+        }
+    }
+    ESPStepperMotorServer_Logger::logWarningf("The web UI file %s is neither embedded in the firmware nor present in the SPIFFS\n", filePath);
+    return false;
+}
+#endif
+
+void ESPStepperMotorServer_WebInterface::registerWebAsset(const char *url, ESPStepperMotorServer_WebAsset *asset)
+{
+    if (asset == NULL)
+    {
+        return;
+    }
+    this->_httpServer->on(url, HTTP_GET, [this, asset](AsyncWebServerRequest *request) {
+        this->sendWebAsset(request, asset);
+    });
+}
+
+/**
+ * send the given asset, or only a 304 response if the browser already has the current version of the asset
+ */
+void ESPStepperMotorServer_WebInterface::sendWebAsset(AsyncWebServerRequest *request, const ESPStepperMotorServer_WebAsset *asset)
+{
+    AsyncWebServerResponse *response;
+    if (request->hasHeader("If-None-Match") && request->header("If-None-Match") == asset->etag)
+    {
+        response = request->beginResponse(304);
+    }
+    else
+    {
+        if (asset->ramContent)
+        {
+            response = request->beginResponse_P(200, asset->contentType, asset->ramContent, asset->contentLength);
+        }
+        else if (asset->flashContent)
+        {
+            response = request->beginResponse_P(200, asset->contentType, asset->flashContent, asset->contentLength);
+        }
+        else
+        {
+            response = request->beginResponse(SPIFFS, asset->filePath, asset->contentType);
+        }
+        if (asset->isGzipped)
+        {
+            response->addHeader("Content-Encoding", "gzip");
+        }
+    }
+    response->addHeader("ETag", asset->etag);
+    response->addHeader("Cache-Control", asset->cacheControl);
+    request->send(response);
+}
+
+void ESPStepperMotorServer_WebInterface::releaseWebAssets()
+{
+    for (byte i = 0; i < this->_webAssetCount; i++)
+    {
+        free(this->_webAssets[i].ramContent);
+        this->_webAssets[i].ramContent = NULL;
+    }
+    this->_webAssetCount = 0;
+    this->_ramCacheUsage = 0;
+}
+
 // Perform an HTTP GET request to a remote page to download a file to SPIFFS
 bool ESPStepperMotorServer_WebInterface::downloadFileToSpiffs(const char *url, const char *targetPath)
 {
@@ -317,29 +509,23 @@ bool ESPStepperMotorServer_WebInterface::downloadFileToSpiffs(const char *url, c
     }
     else
     {
-#ifndef ESPStepperMotorServer_COMPILE_NO_DEBUG
-        ESPStepperMotorServer_Logger::logDebugf("downloading %s from %s\n", targetPath, url);
-#endif
+        ESPServerLogDebugf("downloading %s from %s\n", targetPath, url);
 
         if (http.begin(url))
         {
 #ifndef ESPStepperMotorServer_COMPILE_NO_DEBUG
             int httpCode = http.GET();
-            ESPStepperMotorServer_Logger::logDebugf("server responded with %i\n", httpCode);
+            ESPServerLogDebugf("server responded with %i\n", httpCode);
 #endif
 
             //////////////////
             // get length of document (is -1 when Server sends no Content-Length header)
             int len = http.getSize();
             uint8_t buff[128] = {0};
-#ifndef ESPStepperMotorServer_COMPILE_NO_DEBUG
-            ESPStepperMotorServer_Logger::logDebugf("starting download stream for file size %i\n", len);
-#endif
+            ESPServerLogDebugf("starting download stream for file size %i\n", len);
 
             WiFiClient *stream = &http.getStream();
-#ifndef ESPStepperMotorServer_COMPILE_NO_DEBUG
-            ESPStepperMotorServer_Logger::logDebug("opening file for writing");
-#endif
+            ESPServerLogDebug("opening file for writing");
             File f = SPIFFS.open(targetPath, "w+");
 
             // read all data from server
@@ -347,9 +533,7 @@ bool ESPStepperMotorServer_WebInterface::downloadFileToSpiffs(const char *url, c
             {
                 // get available data size
                 size_t size = stream->available();
-#ifndef ESPStepperMotorServer_COMPILE_NO_DEBUG
-                ESPStepperMotorServer_Logger::logDebugf("%i bytes available to read from stream\n", size);
-#endif
+                ESPServerLogDebugf("%i bytes available to read from stream\n", size);
 
                 if (size)
                 {
@@ -368,7 +552,7 @@ bool ESPStepperMotorServer_WebInterface::downloadFileToSpiffs(const char *url, c
                 delay(1);
             }
             f.close();
-            ESPStepperMotorServer_Logger::logInfof("Download of %s completed\n", targetPath);
+            ESPServerLogInfof("Download of %s completed\n", targetPath);
             http.end(); //Close connection
         }
 
@@ -38,18 +38,80 @@
 #include <ESPStepperMotorServer.h>
 #include <Update.h>
 
+// one file of the web UI that is embedded in the firmware. The array of all files (ESPStepperMotorServer_embeddedWebFiles)
+// is generated by tools/embed_webui.py into ESPStepperMotorServer_EmbeddedWebUI.h
+struct ESPStepperMotorServer_EmbeddedWebFile
+{
+  const char *path; // path of the file as it would be stored in the SPIFFS
+  const uint8_t *content;
+  size_t length;
+  bool isGzipped;
+  const char *etag;
+};
+
+#ifdef ESPStepperMotorServer_USE_EMBEDDED_WEB_UI
+#if defined(__has_include)
+#if !__has_include(<ESPStepperMotorServer_EmbeddedWebUI.h>)
+#error "ESPStepperMotorServer_USE_EMBEDDED_WEB_UI is set, but ESPStepperMotorServer_EmbeddedWebUI.h has not been generated. Run tools/embed_webui.py first"
+#endif
+#endif
+#include <ESPStepperMotorServer_EmbeddedWebUI.h>
+#endif
+
 //need this forward declaration here due to circular dependency (use in constructor)
+// maximum time in seconds browsers may cache the static web UI assets without asking again.
+// index.html is always revalidated, so a changed UI is picked up on the next page load
+#ifndef ESPServerWebAssetMaxAge
+#define ESPServerWebAssetMaxAge 604800
+#endif
+// amount of RAM in bytes that may be used to keep web UI assets in memory (0 = disabled).
+// Cached assets are served without reading the SPIFFS, which is slow while the steppers are moving
+#ifndef ESPServerWebAssetRamCacheSize
+#define ESPServerWebAssetRamCacheSize 0
+#endif
+// assets larger than this size (in bytes) are never cached in RAM
+#ifndef ESPServerWebAssetRamCacheMaxFileSize
+#define ESPServerWebAssetRamCacheMaxFileSize 4096
+#endif
+// the number of files the web UI consists of
+#define ESPServerWebAssetCount 9
+#define ESPServerWebAssetMaxPathLength 32
+
+// a static file of the web UI. The ETag is calculated once from the file contents when the web UI is registered,
+// so requests with a matching If-None-Match header can be answered without accessing the SPIFFS
+struct ESPStepperMotorServer_WebAsset
+{
+  char filePath[ESPServerWebAssetMaxPathLength]; // path of the file in SPIFFS, either the plain or the pre-gzipped (.gz) version
+  const char *contentType;
+  const char *cacheControl;
+  bool isGzipped;
+  char etag[24];
+  size_t contentLength;
+  uint8_t *ramContent;         // NULL if the asset is not cached in RAM
+  const uint8_t *flashContent; // NULL if the asset is not embedded in the firmware
+};
+
 class ESPStepperMotorServer;
 
 class ESPStepperMotorServer_WebInterface
 {
 public:
   ESPStepperMotorServer_WebInterface(ESPStepperMotorServer *serverRef);
+  ~ESPStepperMotorServer_WebInterface();
   void registerWebInterfaceUrls(AsyncWebServer *httpServer);
 
 private:
   bool downloadFileToSpiffs(const char *url, const char *targetPath);
   bool checkIfGuiExistsInSpiffs();
+  bool webUiFileExists(const char *filePath);
+  ESPStepperMotorServer_WebAsset *loadWebAsset(const char *filePath, const char *contentType, const char *cacheControl);
+  bool loadWebAssetFromSpiffs(ESPStepperMotorServer_WebAsset *asset, const char *filePath);
+#ifdef ESPStepperMotorServer_USE_EMBEDDED_WEB_UI
+  bool loadEmbeddedWebAsset(ESPStepperMotorServer_WebAsset *asset, const char *filePath);
+#endif
+  void registerWebAsset(const char *url, ESPStepperMotorServer_WebAsset *asset);
+  void sendWebAsset(AsyncWebServerRequest *request, const ESPStepperMotorServer_WebAsset *asset);
+  void releaseWebAssets();
 
   const char *webUiFirmwareUpdate = "/upload.html.gz";
   const char *webUiIndexFile = "/index.html";
@@ -63,6 +125,10 @@ private:
   const char *webUiRepositoryBasePath = "https://raw.githubusercontent.com/pkerspe/ESP-StepperMotor-Server-UI/master/data";
   ESPStepperMotorServer *_serverRef;
   AsyncWebServer *_httpServer;
+  ESPStepperMotorServer_WebAsset _webAssets[ESPServerWebAssetCount];
+  byte _webAssetCount = 0;
+  size_t _ramCacheUsage = 0;
+  char _maxAgeCacheControl[32];
 };
 
 #endif
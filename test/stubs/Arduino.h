@@ -0,0 +1,15 @@
+// minimal replacement of the Arduino core header for the native (host) unit tests.
+// Only the modules that do not depend on the ESP32 hardware are compiled for the native environment (see platformio.ini)
+#ifndef ESPStepperMotorServer_Test_Arduino_h
+#define ESPStepperMotorServer_Test_Arduino_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <ctype.h>
+
+typedef uint8_t byte;
+
+#endif
@@ -0,0 +1,99 @@
+// simulated replacement of the ESP-FlexyStepper library for the native (host) unit tests.
+// The stepper moves one step toward the target position per call of processMovement(), speeds and accelerations are only stored.
+// A stop request moves the target stopDistanceInSteps further in the current direction, to simulate the deceleration ramp
+#ifndef ESPStepperMotorServer_Test_ESP_FlexyStepper_h
+#define ESPStepperMotorServer_Test_ESP_FlexyStepper_h
+
+#include <Arduino.h>
+
+class ESP_FlexyStepper
+{
+public:
+  long stopDistanceInSteps = 0;
+  float speedInStepsPerSecond = 0;
+  float accelerationInStepsPerSecondPerSecond = 0;
+  float decelerationInStepsPerSecondPerSecond = 0;
+
+  // returns true if the target position has been reached
+  bool processMovement()
+  {
+    if (this->currentPosition < this->targetPosition)
+    {
+      this->currentPosition++;
+    }
+    else if (this->currentPosition > this->targetPosition)
+    {
+      this->currentPosition--;
+    }
+    return this->motionComplete();
+  }
+
+  bool motionComplete()
+  {
+    return (this->currentPosition == this->targetPosition);
+  }
+
+  long getCurrentPositionInSteps()
+  {
+    return this->currentPosition;
+  }
+
+  void setCurrentPositionInSteps(long currentPositionInSteps)
+  {
+    this->currentPosition = currentPositionInSteps;
+  }
+
+  void setCurrentPositionAsHomeAndStop()
+  {
+    this->currentPosition = 0;
+    this->targetPosition = 0;
+  }
+
+  long getTargetPositionInSteps()
+  {
+    return this->targetPosition;
+  }
+
+  void setTargetPositionInSteps(long absolutePositionToMoveToInSteps)
+  {
+    this->targetPosition = absolutePositionToMoveToInSteps;
+  }
+
+  void setTargetPositionRelativeInSteps(long distanceToMoveInSteps)
+  {
+    this->targetPosition = this->currentPosition + distanceToMoveInSteps;
+  }
+
+  void setTargetPositionToStop()
+  {
+    if (this->targetPosition > this->currentPosition)
+    {
+      this->targetPosition = this->currentPosition + this->stopDistanceInSteps;
+    }
+    else if (this->targetPosition < this->currentPosition)
+    {
+      this->targetPosition = this->currentPosition - this->stopDistanceInSteps;
+    }
+  }
+
+  void setSpeedInStepsPerSecond(float speedInStepsPerSecond)
+  {
+    this->speedInStepsPerSecond = speedInStepsPerSecond;
+  }
+
+  void setAccelerationInStepsPerSecondPerSecond(float accelerationInStepsPerSecondPerSecond)
+  {
+    this->accelerationInStepsPerSecondPerSecond = accelerationInStepsPerSecondPerSecond;
+  }
+
+  void setDecelerationInStepsPerSecondPerSecond(float decelerationInStepsPerSecondPerSecond)
+  {
+    this->decelerationInStepsPerSecondPerSecond = decelerationInStepsPerSecondPerSecond;
+  }
+
+private:
+  long currentPosition = 0;
+  long targetPosition = 0;
+};
+
+#endif
@@ -0,0 +1,328 @@
+// host tests for the command line parsing and the command lookup of the CLI.
+// Run with: pio test -e native -f test_command_parser
+#include <unity.h>
+#include <stdio.h>
+#include <time.h>
+#include <ESPStepperMotorServer_CommandParser.h>
+
+#define MAX_COMMANDS (MAX_CLI_CMD_COUNTER + MAX_CLI_USER_CMD_COUNTER)
+#define BENCHMARK_COMMANDS 1000000
+
+// a command table with the names kept in plain arrays, like the CLI keeps them in its command details
+class TestCommandTable : public ESPStepperMotorServer_CommandTable
+{
+public:
+  void addCommand(byte commandIndex, const char *command, const char *shortCut)
+  {
+    this->commands[commandIndex] = command;
+    this->shortCuts[commandIndex] = shortCut;
+    this->addCommandName(command, commandIndex);
+    this->addCommandName(shortCut, commandIndex);
+  }
+
+  static unsigned int getSlot(const char *name)
+  {
+    return hashCommandName(name, strlen(name)) & (CLI_COMMAND_HASH_TABLE_SIZE - 1);
+  }
+
+protected:
+  bool commandMatchesName(byte commandIndex, const char *name, unsigned int length) const override
+  {
+    return isSameName(this->commands[commandIndex], strlen(this->commands[commandIndex]), name, length) ||
+           isSameName(this->shortCuts[commandIndex], strlen(this->shortCuts[commandIndex]), name, length);
+  }
+
+private:
+  const char *commands[MAX_COMMANDS];
+  const char *shortCuts[MAX_COMMANDS];
+};
+
+// the built in commands of the CLI
+const char *builtInCommands[][2] = {
+    {"help", "h"}, {"moveby", "mb"}, {"moveto", "mt"}, {"config", "c"}, {"emergencystop", "es"}, {"revokeemergencystop", "res"},
+    {"position", "p"}, {"velocity", "v"}, {"removeswitch", "rsw"}, {"removestepper", "rs"}, {"removeencoder", "re"}, {"reboot", "r"},
+    {"save", "s"}, {"stop", "st"}, {"loglevel", "ll"}, {"serverstatus", "ss"}, {"switchstatus", "pss"}, {"setapname", "san"},
+    {"setappwd", "sap"}, {"sethttpport", "shp"}, {"setwifissid", "sws"}, {"setwifipwd", "swp"}, {"stream", "sm"}, {"softlimits", "sl"},
+    {"gcodefile", "gf"}, {"gcodejob", "gj"}};
+const byte builtInCommandCount = sizeof(builtInCommands) / sizeof(builtInCommands[0]);
+
+TestCommandTable *table;
+char names[3][16];
+
+void setUp(void)
+{
+  table = new TestCommandTable();
+}
+
+void tearDown(void)
+{
+  delete table;
+}
+
+static void addBuiltInCommands()
+{
+  for (byte i = 0; i < builtInCommandCount; i++)
+  {
+    table->addCommand(i, builtInCommands[i][0], builtInCommands[i][1]);
+  }
+}
+
+static int find(const char *name)
+{
+  return table->findCommandIndex(name, strlen(name));
+}
+
+// finds two generated names that start with the given prefix and use the same hash table slot
+static void findCollidingNames(const char *prefix, char *name1, char *name2)
+{
+  int firstNameForSlot[CLI_COMMAND_HASH_TABLE_SIZE];
+  for (int i = 0; i < CLI_COMMAND_HASH_TABLE_SIZE; i++)
+  {
+    firstNameForSlot[i] = -1;
+  }
+  for (int i = 0; i <= CLI_COMMAND_HASH_TABLE_SIZE; i++)
+  {
+    sprintf(name2, "%s%d", prefix, i);
+    const unsigned int slot = TestCommandTable::getSlot(name2);
+    if (firstNameForSlot[slot] >= 0)
+    {
+      sprintf(name1, "%s%d", prefix, firstNameForSlot[slot]);
+      return;
+    }
+    firstNameForSlot[slot] = i;
+  }
+  TEST_FAIL_MESSAGE("no colliding names found");
+}
+
+void test_all_built_in_commands_and_shortcuts_are_found(void)
+{
+  addBuiltInCommands();
+  for (byte i = 0; i < builtInCommandCount; i++)
+  {
+    TEST_ASSERT_EQUAL(i, find(builtInCommands[i][0]));
+    TEST_ASSERT_EQUAL(i, find(builtInCommands[i][1]));
+  }
+  TEST_ASSERT_EQUAL(-1, find("unknown"));
+  TEST_ASSERT_EQUAL(-1, find(""));
+}
+
+void test_prefixes_and_extensions_of_names_are_not_found(void)
+{
+  addBuiltInCommands();
+  // "s", "st" and "stop" are all names of commands, but their prefixes and extensions are not
+  TEST_ASSERT_EQUAL(12, find("s"));
+  TEST_ASSERT_EQUAL(13, find("st"));
+  TEST_ASSERT_EQUAL(13, find("stop"));
+  TEST_ASSERT_EQUAL(-1, find("sto"));
+  TEST_ASSERT_EQUAL(-1, find("stops"));
+  TEST_ASSERT_EQUAL(-1, find("movet"));
+  TEST_ASSERT_EQUAL(-1, find("movetoo"));
+  TEST_ASSERT_EQUAL(-1, find("revokeemergencysto"));
+  // the name does not need to be null terminated, e.g. when looking up a command in the middle of a line
+  TEST_ASSERT_EQUAL(2, table->findCommandIndex("movetoo", 6));
+  TEST_ASSERT_EQUAL(12, table->findCommandIndex("stop", 1));
+}
+
+void test_names_in_the_same_slot(void)
+{
+  findCollidingNames("cmd", names[0], names[1]);
+  TEST_ASSERT_EQUAL(TestCommandTable::getSlot(names[0]), TestCommandTable::getSlot(names[1]));
+  table->addCommand(0, names[0], "");
+  table->addCommand(1, names[1], "");
+  TEST_ASSERT_EQUAL(0, find(names[0]));
+  TEST_ASSERT_EQUAL(1, find(names[1]));
+
+  // an unknown name in the same slot is not found, even though the slot and the following one are used
+  int i = 0;
+  do
+  {
+    sprintf(names[2], "x%d", i++);
+  } while (TestCommandTable::getSlot(names[2]) != TestCommandTable::getSlot(names[0]) && i < 100000);
+  TEST_ASSERT_EQUAL(TestCommandTable::getSlot(names[0]), TestCommandTable::getSlot(names[2]));
+  TEST_ASSERT_EQUAL(-1, find(names[2]));
+  TEST_ASSERT_FALSE(table->isCommandNameRegistered(names[2]));
+  TEST_ASSERT_TRUE(table->isCommandNameRegistered(names[1]));
+}
+
+void test_command_and_shortcut_in_the_same_slot(void)
+{
+  // the shortcut must not be skipped because its slot already contains the same command index
+  findCollidingNames("name", names[0], names[1]);
+  table->addCommand(3, names[0], names[1]);
+  TEST_ASSERT_EQUAL(3, find(names[0]));
+  TEST_ASSERT_EQUAL(3, find(names[1]));
+  // the same name as command and shortcut only uses one slot
+  table->addCommand(4, "same", "same");
+  TEST_ASSERT_EQUAL(4, find("same"));
+}
+
+void test_built_in_commands_take_precedence(void)
+{
+  // the CLI rejects duplicate names when registering, but the lookup still prefers the lower (built in) index
+  table->addCommand(MAX_CLI_CMD_COUNTER, "status", "ust");
+  table->addCommand(7, "status", "st");
+  TEST_ASSERT_EQUAL(7, find("status"));
+  TEST_ASSERT_EQUAL(MAX_CLI_CMD_COUNTER, find("ust"));
+}
+
+void test_full_table(void)
+{
+  // all command indexes with a name and a shortcut each
+  static char commandNames[MAX_COMMANDS][2][8];
+  for (byte i = 0; i < MAX_COMMANDS; i++)
+  {
+    sprintf(commandNames[i][0], "cmd%d", i);
+    sprintf(commandNames[i][1], "c%d", i);
+    table->addCommand(i, commandNames[i][0], commandNames[i][1]);
+  }
+  for (byte i = 0; i < MAX_COMMANDS; i++)
+  {
+    TEST_ASSERT_EQUAL(i, find(commandNames[i][0]));
+    TEST_ASSERT_EQUAL(i, find(commandNames[i][1]));
+  }
+  TEST_ASSERT_EQUAL(-1, find("cmd"));
+  TEST_ASSERT_EQUAL(-1, find("c"));
+}
+
+void test_split_command_line(void)
+{
+  char *arguments;
+  char line1[] = "mt=0&v:100&u:mm";
+  TEST_ASSERT_EQUAL_STRING("mt", ESPStepperMotorServer_CommandParser::splitCommandLine(line1, &arguments));
+  TEST_ASSERT_EQUAL_STRING("0&v:100&u:mm", arguments);
+
+  char line2[] = "ss";
+  TEST_ASSERT_EQUAL_STRING("ss", ESPStepperMotorServer_CommandParser::splitCommandLine(line2, &arguments));
+  TEST_ASSERT_NULL(arguments);
+
+  char line3[] = "pos=";
+  TEST_ASSERT_EQUAL_STRING("pos", ESPStepperMotorServer_CommandParser::splitCommandLine(line3, &arguments));
+  TEST_ASSERT_NULL(arguments);
+
+  // everything after a second '=' is ignored
+  char line4[] = "san=name=ignored";
+  TEST_ASSERT_EQUAL_STRING("san", ESPStepperMotorServer_CommandParser::splitCommandLine(line4, &arguments));
+  TEST_ASSERT_EQUAL_STRING("name", arguments);
+
+  char line5[] = "=0";
+  TEST_ASSERT_EQUAL_STRING("", ESPStepperMotorServer_CommandParser::splitCommandLine(line5, &arguments));
+  TEST_ASSERT_EQUAL_STRING("0", arguments);
+}
+
+static void assertParameter(const char *args, const char *parameterName, const char *expectedValue)
+{
+  cliTokenSlice value;
+  if (expectedValue == NULL)
+  {
+    TEST_ASSERT_FALSE(ESPStepperMotorServer_CommandParser::getParameterSlice(args, parameterName, value));
+    TEST_ASSERT_NULL(value.data);
+    TEST_ASSERT_EQUAL(0, value.length);
+    return;
+  }
+  TEST_ASSERT_TRUE(ESPStepperMotorServer_CommandParser::getParameterSlice(args, parameterName, value));
+  TEST_ASSERT_EQUAL(strlen(expectedValue), value.length);
+  TEST_ASSERT_EQUAL_INT(0, strncmp(expectedValue, value.data, value.length));
+}
+
+void test_parameter_values(void)
+{
+  const char *args = "0&v:100&u:mm&s:800";
+  assertParameter(args, "v", "100");
+  assertParameter(args, "u", "mm");
+  assertParameter(args, "s", "800");
+  assertParameter(args, "a", NULL);
+  assertParameter(NULL, "v", NULL);
+  assertParameter("", "v", NULL);
+}
+
+void test_parameter_names_are_compared_completely(void)
+{
+  const char *args = "0&min:-100&max:100&m:1";
+  assertParameter(args, "m", "1");
+  assertParameter(args, "mi", NULL);
+  assertParameter(args, "min", "-100");
+  assertParameter(args, "max", "100");
+  assertParameter("0&mode:2", "m", NULL);
+}
+
+void test_parameter_value_edge_cases(void)
+{
+  // a second ':' terminates the value, empty values are missing values
+  assertParameter("0&v:100:200", "v", "100");
+  assertParameter("0&v:&u:mm", "v", NULL);
+  assertParameter("0&v&u:mm", "v", NULL);
+  assertParameter("0&&u:mm&", "u", "mm");
+  // the first parameter with a value is used
+  assertParameter("v:&v:1&v:2", "v", "1");
+}
+
+void test_dispatch_rate_of_a_plc_command_mix(void)
+{
+  addBuiltInCommands();
+  // the commands a PLC typically sends in a loop: moves, position and status polling and emergency stops
+  const char *commandMix[] = {
+      "mt=0&v:1500&u:steps",
+      "p=0",
+      "mb=1&v:-250&u:mm",
+      "pss",
+      "p=1&u:mm",
+      "v=0",
+      "ss",
+      "moveto=2&v:20.5&u:revs",
+      "position=2",
+      "sl=0&min:-1000&max:1000&m:1",
+      "es",
+      "res",
+      "gj",
+      "unknowncommand=1",
+  };
+  const unsigned int mixLength = sizeof(commandMix) / sizeof(commandMix[0]);
+  const char *parameterNames[] = {"v", "u", "min", "max", "m"};
+  const unsigned int parameterNameCount = sizeof(parameterNames) / sizeof(parameterNames[0]);
+  char line[96];
+  unsigned long foundCommands = 0;
+  unsigned long foundParameters = 0;
+  const clock_t startClock = clock();
+  for (unsigned long i = 0; i < BENCHMARK_COMMANDS; i++)
+  {
+    // the CLI tokenizes the line in place, so each command starts from a fresh copy of the line
+    strcpy(line, commandMix[i % mixLength]);
+    char *arguments;
+    const char *command = ESPStepperMotorServer_CommandParser::splitCommandLine(line, &arguments);
+    if (table->findCommandIndex(command, strlen(command)) >= 0)
+    {
+      foundCommands++;
+    }
+    cliTokenSlice value;
+    for (unsigned int p = 0; p < parameterNameCount && arguments != NULL; p++)
+    {
+      if (ESPStepperMotorServer_CommandParser::getParameterSlice(arguments, parameterNames[p], value))
+      {
+        foundParameters++;
+      }
+    }
+  }
+  const double elapsedSeconds = (double)(clock() - startClock) / CLOCKS_PER_SEC;
+
+  // all commands except the unknown one at the end of the mix are found, each full mix contains 10 parameters
+  TEST_ASSERT_EQUAL((unsigned long)BENCHMARK_COMMANDS - BENCHMARK_COMMANDS / mixLength, foundCommands);
+  TEST_ASSERT_TRUE(foundParameters >= (BENCHMARK_COMMANDS / mixLength) * 10);
+  printf("dispatched %lu commands of a PLC command mix in %.3f s: %.0f commands/s\n", (unsigned long)BENCHMARK_COMMANDS, elapsedSeconds, (elapsedSeconds > 0) ? BENCHMARK_COMMANDS / elapsedSeconds : 0);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_all_built_in_commands_and_shortcuts_are_found);
+  RUN_TEST(test_prefixes_and_extensions_of_names_are_not_found);
+  RUN_TEST(test_names_in_the_same_slot);
+  RUN_TEST(test_command_and_shortcut_in_the_same_slot);
+  RUN_TEST(test_built_in_commands_take_precedence);
+  RUN_TEST(test_full_table);
+  RUN_TEST(test_split_command_line);
+  RUN_TEST(test_parameter_values);
+  RUN_TEST(test_parameter_names_are_compared_completely);
+  RUN_TEST(test_parameter_value_edge_cases);
+  RUN_TEST(test_dispatch_rate_of_a_plc_command_mix);
+  return UNITY_END();
+}
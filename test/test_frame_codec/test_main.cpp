@@ -0,0 +1,127 @@
+// host tests for the COBS framing and CRC-16 checksum of the binary serial protocol and the sync packets.
+// Run with: pio test -e native -f test_frame_codec
+#include <unity.h>
+#include <ESPStepperMotorServer_FrameCodec.h>
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+// encode the given data, check the encoded bytes (if given) and that decoding restores the original data
+static void assertCobsRoundTrip(const byte *data, size_t length, const byte *expectedEncoded, size_t expectedEncodedLength)
+{
+  byte encoded[600];
+  byte decoded[600];
+  size_t encodedLength = ESPStepperMotorServer_FrameCodec::encodeCobs(data, length, encoded);
+  if (expectedEncoded != NULL)
+  {
+    TEST_ASSERT_EQUAL(expectedEncodedLength, encodedLength);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expectedEncoded, encoded, encodedLength);
+  }
+  for (size_t i = 0; i < encodedLength; i++)
+  {
+    TEST_ASSERT_TRUE(encoded[i] != 0);
+  }
+  size_t decodedLength = ESPStepperMotorServer_FrameCodec::decodeCobs(encoded, encodedLength, decoded);
+  TEST_ASSERT_EQUAL(length, decodedLength);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(data, decoded, length);
+}
+
+void test_cobs_single_zero(void)
+{
+  const byte data[] = {0x00};
+  const byte expected[] = {0x01, 0x01};
+  assertCobsRoundTrip(data, sizeof(data), expected, sizeof(expected));
+}
+
+void test_cobs_zeros_between_data(void)
+{
+  const byte data[] = {0x11, 0x22, 0x00, 0x33};
+  const byte expected[] = {0x03, 0x11, 0x22, 0x02, 0x33};
+  assertCobsRoundTrip(data, sizeof(data), expected, sizeof(expected));
+}
+
+void test_cobs_trailing_zero(void)
+{
+  const byte data[] = {0x11, 0x00, 0x00};
+  const byte expected[] = {0x02, 0x11, 0x01, 0x01};
+  assertCobsRoundTrip(data, sizeof(data), expected, sizeof(expected));
+}
+
+void test_cobs_254_non_zero_bytes(void)
+{
+  byte data[254];
+  for (size_t i = 0; i < sizeof(data); i++)
+  {
+    data[i] = (byte)(i + 1);
+  }
+  byte encoded[300];
+  size_t encodedLength = ESPStepperMotorServer_FrameCodec::encodeCobs(data, sizeof(data), encoded);
+  TEST_ASSERT_EQUAL_HEX8(0xFF, encoded[0]);
+  assertCobsRoundTrip(data, sizeof(data), NULL, 0);
+  TEST_ASSERT_LESS_OR_EQUAL(sizeof(data) + sizeof(data) / 254 + 1, encodedLength);
+}
+
+void test_cobs_long_mixed_data(void)
+{
+  byte data[520];
+  for (size_t i = 0; i < sizeof(data); i++)
+  {
+    data[i] = (i % 97 == 0) ? 0 : (byte)(i * 7);
+  }
+  assertCobsRoundTrip(data, sizeof(data), NULL, 0);
+}
+
+void test_cobs_decode_rejects_zero_code(void)
+{
+  const byte encoded[] = {0x02, 0x11, 0x00, 0x22};
+  byte decoded[8];
+  TEST_ASSERT_EQUAL(0, ESPStepperMotorServer_FrameCodec::decodeCobs(encoded, sizeof(encoded), decoded));
+}
+
+void test_cobs_decode_rejects_truncated_block(void)
+{
+  const byte encoded[] = {0x05, 0x11, 0x22};
+  byte decoded[8];
+  TEST_ASSERT_EQUAL(0, ESPStepperMotorServer_FrameCodec::decodeCobs(encoded, sizeof(encoded), decoded));
+}
+
+void test_crc16_check_value(void)
+{
+  // the check value of CRC-16/CCITT-FALSE for the ASCII string "123456789"
+  const byte data[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+  TEST_ASSERT_EQUAL_HEX16(0x29B1, ESPStepperMotorServer_FrameCodec::calculateCrc16(data, sizeof(data)));
+}
+
+void test_crc16_empty_input(void)
+{
+  TEST_ASSERT_EQUAL_HEX16(0xFFFF, ESPStepperMotorServer_FrameCodec::calculateCrc16(NULL, 0));
+}
+
+void test_crc16_detects_single_bit_error(void)
+{
+  byte data[] = {0x01, 0x07, 0x00, 0x10, 0x27, 0x00, 0x00};
+  const uint16_t crc = ESPStepperMotorServer_FrameCodec::calculateCrc16(data, sizeof(data));
+  data[3] ^= 0x04;
+  TEST_ASSERT_TRUE(crc != ESPStepperMotorServer_FrameCodec::calculateCrc16(data, sizeof(data)));
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_cobs_single_zero);
+  RUN_TEST(test_cobs_zeros_between_data);
+  RUN_TEST(test_cobs_trailing_zero);
+  RUN_TEST(test_cobs_254_non_zero_bytes);
+  RUN_TEST(test_cobs_long_mixed_data);
+  RUN_TEST(test_cobs_decode_rejects_zero_code);
+  RUN_TEST(test_cobs_decode_rejects_truncated_block);
+  RUN_TEST(test_crc16_check_value);
+  RUN_TEST(test_crc16_empty_input);
+  RUN_TEST(test_crc16_detects_single_bit_error);
+  return UNITY_END();
+}
@@ -0,0 +1,273 @@
+// host tests for the double buffered G-code file reader, including a throughput measurement of the reader and the G-code parser.
+// Run with: pio test -e native -f test_gcode_file_reader
+#include <unity.h>
+#include <stdio.h>
+#include <time.h>
+#include <ESPStepperMotorServer_GCodeFileReader.h>
+#include <ESPStepperMotorServer_GCodeParser.h>
+
+// same as ESPServerGCodeMaxLineLength of the G-code interpreter
+#define MAX_LINE_LENGTH 96
+#define BUFFER_SIZE ESPServerGCodeFileBufferSize
+#define LARGE_PROGRAM_LINES 200000
+
+// reads a file through the C library, like the SPIFFS input of the G-code interpreter
+class FileStreamInput : public ESPStepperMotorServer_GCodeInput
+{
+public:
+  FILE *file = NULL;
+  bool isClosed = false;
+
+  size_t read(uint8_t *buffer, size_t size)
+  {
+    return fread(buffer, 1, size, this->file);
+  }
+
+  unsigned long getSize()
+  {
+    long position = ftell(this->file);
+    fseek(this->file, 0, SEEK_END);
+    long size = ftell(this->file);
+    fseek(this->file, position, SEEK_SET);
+    return size;
+  }
+
+  void close()
+  {
+    this->isClosed = true;
+  }
+};
+
+ESPStepperMotorServer_GCodeFileReader reader;
+char program[8 * BUFFER_SIZE];
+size_t programLength;
+char line[MAX_LINE_LENGTH + 1];
+
+void setUp(void)
+{
+  programLength = 0;
+}
+
+void tearDown(void)
+{
+  reader.close();
+}
+
+static void append(const char *text)
+{
+  size_t length = strlen(text);
+  TEST_ASSERT_TRUE(programLength + length <= sizeof(program));
+  memcpy(&program[programLength], text, length);
+  programLength += length;
+}
+
+// append empty lines (with a length of 1 or 2 bytes), until the program has the given length
+static void appendEmptyLinesUntil(size_t length, bool isCrLf)
+{
+  while (programLength < length)
+  {
+    append((isCrLf && programLength + 2 <= length) ? "\r\n" : "\n");
+  }
+}
+
+static void assertNextLine(const char *expectedLine, unsigned long expectedLineNumber)
+{
+  TEST_ASSERT_TRUE_MESSAGE(reader.readLine(line, MAX_LINE_LENGTH), expectedLine);
+  TEST_ASSERT_EQUAL_STRING(expectedLine, line);
+  TEST_ASSERT_EQUAL(expectedLineNumber, reader.getLineNumber());
+}
+
+static void assertEndOfProgram()
+{
+  TEST_ASSERT_FALSE(reader.readLine(line, MAX_LINE_LENGTH));
+  TEST_ASSERT_EQUAL_STRING("", line);
+  TEST_ASSERT_EQUAL(programLength, reader.getProcessedBytes());
+}
+
+void test_lines_of_a_small_program(void)
+{
+  append("G21\nG90\r\n\r\nG1 X10 F1200\nM400");
+  ESPStepperMotorServer_GCodeMemoryInput input(program, programLength);
+  TEST_ASSERT_TRUE(reader.open(&input));
+  TEST_ASSERT_EQUAL(programLength, reader.getFileSize());
+  assertNextLine("G21", 1);
+  assertNextLine("G90", 2);
+  assertNextLine("G1 X10 F1200", 4);
+  // the last line does not need a line break
+  assertNextLine("M400", 5);
+  assertEndOfProgram();
+}
+
+void test_crlf_split_at_the_buffer_boundary(void)
+{
+  // the CR is the last byte of the first buffer, the LF the first byte of the second one
+  appendEmptyLinesUntil(BUFFER_SIZE - 6, false);
+  append("G1 X1\r\nG1 X2\r\n");
+  TEST_ASSERT_EQUAL('\r', program[BUFFER_SIZE - 1]);
+  TEST_ASSERT_EQUAL('\n', program[BUFFER_SIZE]);
+  ESPStepperMotorServer_GCodeMemoryInput input(program, programLength);
+  reader.open(&input);
+  assertNextLine("G1 X1", BUFFER_SIZE - 6 + 1);
+  assertNextLine("G1 X2", BUFFER_SIZE - 6 + 2);
+  assertEndOfProgram();
+}
+
+void test_line_split_at_the_buffer_boundary(void)
+{
+  appendEmptyLinesUntil(BUFFER_SIZE - 4, true);
+  append("G1 X123\nG1 Y4");
+  ESPStepperMotorServer_GCodeMemoryInput input(program, programLength);
+  reader.open(&input);
+  assertNextLine("G1 X123", (BUFFER_SIZE - 4) / 2 + 1);
+  assertNextLine("G1 Y4", (BUFFER_SIZE - 4) / 2 + 2);
+  assertEndOfProgram();
+}
+
+void test_empty_lines_across_the_buffer_boundaries(void)
+{
+  append("G90\n");
+  appendEmptyLinesUntil(3 * BUFFER_SIZE + 1, true);
+  append("G91\n");
+  ESPStepperMotorServer_GCodeMemoryInput input(program, programLength);
+  reader.open(&input);
+  assertNextLine("G90", 1);
+  // one byte line break at the end, since the length of the empty lines is odd
+  assertNextLine("G91", 2 + (3 * BUFFER_SIZE + 1 - 4) / 2 + 1);
+  assertEndOfProgram();
+}
+
+void test_long_line_is_truncated_across_the_buffer_boundary(void)
+{
+  char longLine[3 * MAX_LINE_LENGTH + 2];
+  for (int i = 0; i < 3 * MAX_LINE_LENGTH; i++)
+  {
+    longLine[i] = 'A' + (i % 26);
+  }
+  strcpy(&longLine[3 * MAX_LINE_LENGTH], "\n");
+  appendEmptyLinesUntil(BUFFER_SIZE - MAX_LINE_LENGTH - 10, false);
+  append(longLine);
+  append("G1 Z1\n");
+  ESPStepperMotorServer_GCodeMemoryInput input(program, programLength);
+  reader.open(&input);
+  longLine[MAX_LINE_LENGTH] = '\0';
+  assertNextLine(longLine, BUFFER_SIZE - MAX_LINE_LENGTH - 10 + 1);
+  // the rest of the truncated line is skipped, not returned as a new line
+  assertNextLine("G1 Z1", BUFFER_SIZE - MAX_LINE_LENGTH - 10 + 2);
+  assertEndOfProgram();
+}
+
+void test_every_buffer_position_of_a_line(void)
+{
+  // move a CRLF terminated line over the first buffer boundary one byte at a time
+  for (size_t startPosition = BUFFER_SIZE - 16; startPosition <= BUFFER_SIZE + 2; startPosition++)
+  {
+    programLength = 0;
+    appendEmptyLinesUntil(startPosition, false);
+    append("G1 X1 Y2 Z3 ; move\r\n\r\nM400\r\n");
+    ESPStepperMotorServer_GCodeMemoryInput input(program, programLength);
+    reader.open(&input);
+    assertNextLine("G1 X1 Y2 Z3 ; move", startPosition + 1);
+    assertNextLine("M400", startPosition + 3);
+    assertEndOfProgram();
+  }
+}
+
+void test_prefetch_avoids_buffer_underruns(void)
+{
+  appendEmptyLinesUntil(4 * BUFFER_SIZE, false);
+  append("G28\n");
+  ESPStepperMotorServer_GCodeMemoryInput input(program, programLength);
+  reader.open(&input);
+  // without a prefetch between the reads, the reader has to refill each following buffer itself
+  assertNextLine("G28", 4 * BUFFER_SIZE + 1);
+  TEST_ASSERT_EQUAL(4, reader.getBufferUnderrunCount());
+
+  programLength = 0;
+  for (int i = 0; i < 200; i++)
+  {
+    append("G1 X1.25 Y-3.5\n");
+  }
+  ESPStepperMotorServer_GCodeMemoryInput secondInput(program, programLength);
+  reader.open(&secondInput);
+  while (reader.readLine(line, MAX_LINE_LENGTH))
+  {
+    reader.prefetch();
+  }
+  TEST_ASSERT_EQUAL(0, reader.getBufferUnderrunCount());
+  TEST_ASSERT_EQUAL(programLength, reader.getProcessedBytes());
+}
+
+void test_large_program_through_the_reader_and_the_parser(void)
+{
+  FileStreamInput input;
+  input.file = tmpfile();
+  TEST_ASSERT_NOT_NULL(input.file);
+  unsigned long expectedLines = 0;
+  for (long i = 0; i < LARGE_PROGRAM_LINES; i++)
+  {
+    // mixed line endings, comments and empty lines, with line lengths that are not aligned to the buffers
+    switch (i % 5)
+    {
+    case 0:
+      fprintf(input.file, "G1 X%ld.%03ld Y-%ld.5 F%ld\n", i % 400, i % 1000, i % 250, 600 + i % 1200);
+      break;
+    case 1:
+      fprintf(input.file, "G0 Z%ld.25 ; lift %ld\r\n", i % 7, i);
+      break;
+    case 2:
+      fprintf(input.file, "\r\n\n(pause)\n");
+      break;
+    case 3:
+      fprintf(input.file, "G91\r\nG1 A%ld B-%ld\r\n", i % 90, i % 45);
+      expectedLines++;
+      break;
+    default:
+      fprintf(input.file, "M400\n");
+    }
+    expectedLines++;
+  }
+  rewind(input.file);
+  const unsigned long fileSize = input.getSize();
+
+  ESPStepperMotorServer_GCodeBlock block = {};
+  block.feedRate = 600;
+  const char *errorMessage = NULL;
+  unsigned long lineCount = 0;
+  unsigned long moveCount = 0;
+  const clock_t startClock = clock();
+  TEST_ASSERT_TRUE(reader.open(&input));
+  while (reader.readLine(line, MAX_LINE_LENGTH))
+  {
+    lineCount++;
+    TEST_ASSERT_TRUE_MESSAGE(ESPStepperMotorServer_GCodeParser::parseLine(line, block, errorMessage), line);
+    if (block.hasAxisWords)
+    {
+      moveCount++;
+    }
+    reader.prefetch();
+  }
+  const double elapsedSeconds = (double)(clock() - startClock) / CLOCKS_PER_SEC;
+  reader.close();
+  TEST_ASSERT_TRUE(input.isClosed);
+  fclose(input.file);
+
+  TEST_ASSERT_EQUAL(expectedLines, lineCount);
+  TEST_ASSERT_EQUAL(3 * LARGE_PROGRAM_LINES / 5, moveCount);
+  TEST_ASSERT_EQUAL(fileSize, reader.getProcessedBytes());
+  TEST_ASSERT_EQUAL(0, reader.getBufferUnderrunCount());
+  printf("read and parsed %lu lines (%lu bytes) in %.3f s: %.0f lines/s\n", lineCount, fileSize, elapsedSeconds, (elapsedSeconds > 0) ? lineCount / elapsedSeconds : 0);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_lines_of_a_small_program);
+  RUN_TEST(test_crlf_split_at_the_buffer_boundary);
+  RUN_TEST(test_line_split_at_the_buffer_boundary);
+  RUN_TEST(test_empty_lines_across_the_buffer_boundaries);
+  RUN_TEST(test_long_line_is_truncated_across_the_buffer_boundary);
+  RUN_TEST(test_every_buffer_position_of_a_line);
+  RUN_TEST(test_prefetch_avoids_buffer_underruns);
+  RUN_TEST(test_large_program_through_the_reader_and_the_parser);
+  return UNITY_END();
+}
@@ -0,0 +1,177 @@
+// host tests for the G-code parser used by the G-code interpreter.
+// Run with: pio test -e native -f test_gcode_parser
+#include <unity.h>
+#include <ESPStepperMotorServer_GCodeParser.h>
+
+ESPStepperMotorServer_GCodeBlock block;
+const char *errorMessage;
+
+void setUp(void)
+{
+  // the modal state the interpreter starts with
+  block.motionMode = 0;
+  block.isRelativeMode = false;
+  block.feedRate = 600;
+  errorMessage = NULL;
+}
+
+void tearDown(void)
+{
+}
+
+static void assertParseError(const char *line, const char *expectedErrorMessage)
+{
+  TEST_ASSERT_FALSE_MESSAGE(ESPStepperMotorServer_GCodeParser::parseLine(line, block, errorMessage), line);
+  TEST_ASSERT_EQUAL_STRING_MESSAGE(expectedErrorMessage, errorMessage, line);
+}
+
+void test_parse_linear_move(void)
+{
+  TEST_ASSERT_TRUE(ESPStepperMotorServer_GCodeParser::parseLine("G1 X10.5 Y-2 F1200", block, errorMessage));
+  TEST_ASSERT_EQUAL(1, block.motionMode);
+  TEST_ASSERT_EQUAL_FLOAT(1200, block.feedRate);
+  TEST_ASSERT_TRUE(block.hasAxisWords);
+  TEST_ASSERT_TRUE(block.isAxisGiven[0]);
+  TEST_ASSERT_TRUE(block.isAxisGiven[1]);
+  TEST_ASSERT_FALSE(block.isAxisGiven[2]);
+  TEST_ASSERT_EQUAL_FLOAT(10.5, block.axisValues[0]);
+  TEST_ASSERT_EQUAL_FLOAT(-2, block.axisValues[1]);
+  TEST_ASSERT_FALSE(block.isHomingRequested);
+  TEST_ASSERT_FALSE(block.isWaitRequested);
+}
+
+void test_parse_words_without_spaces_and_lower_case(void)
+{
+  // no hex or exponent notation, so the axis letters are not read as part of the number
+  TEST_ASSERT_TRUE(ESPStepperMotorServer_GCodeParser::parseLine("g0x10b2c-3", block, errorMessage));
+  TEST_ASSERT_EQUAL(0, block.motionMode);
+  TEST_ASSERT_EQUAL_FLOAT(10, block.axisValues[0]);
+  TEST_ASSERT_EQUAL_FLOAT(2, block.axisValues[4]);
+  TEST_ASSERT_EQUAL_FLOAT(-3, block.axisValues[5]);
+}
+
+void test_modal_state_is_kept(void)
+{
+  block.motionMode = 1;
+  block.isRelativeMode = true;
+  block.feedRate = 300;
+  TEST_ASSERT_TRUE(ESPStepperMotorServer_GCodeParser::parseLine("Z5", block, errorMessage));
+  TEST_ASSERT_EQUAL(1, block.motionMode);
+  TEST_ASSERT_TRUE(block.isRelativeMode);
+  TEST_ASSERT_EQUAL_FLOAT(300, block.feedRate);
+  TEST_ASSERT_TRUE(block.isAxisGiven[2]);
+
+  TEST_ASSERT_TRUE(ESPStepperMotorServer_GCodeParser::parseLine("G90", block, errorMessage));
+  TEST_ASSERT_FALSE(block.isRelativeMode);
+  TEST_ASSERT_FALSE(block.hasAxisWords);
+  TEST_ASSERT_TRUE(ESPStepperMotorServer_GCodeParser::parseLine("G91 G21", block, errorMessage));
+  TEST_ASSERT_TRUE(block.isRelativeMode);
+}
+
+void test_axis_words_are_reset_for_each_line(void)
+{
+  TEST_ASSERT_TRUE(ESPStepperMotorServer_GCodeParser::parseLine("G0 X1 Y2", block, errorMessage));
+  TEST_ASSERT_TRUE(ESPStepperMotorServer_GCodeParser::parseLine("G0 Y3", block, errorMessage));
+  TEST_ASSERT_FALSE(block.isAxisGiven[0]);
+  TEST_ASSERT_EQUAL_FLOAT(0, block.axisValues[0]);
+  TEST_ASSERT_EQUAL_FLOAT(3, block.axisValues[1]);
+}
+
+void test_parse_homing_and_wait(void)
+{
+  TEST_ASSERT_TRUE(ESPStepperMotorServer_GCodeParser::parseLine("G28 X0 Z0", block, errorMessage));
+  TEST_ASSERT_TRUE(block.isHomingRequested);
+  TEST_ASSERT_TRUE(block.isAxisGiven[0]);
+  TEST_ASSERT_FALSE(block.isAxisGiven[1]);
+  TEST_ASSERT_TRUE(block.isAxisGiven[2]);
+
+  TEST_ASSERT_TRUE(ESPStepperMotorServer_GCodeParser::parseLine("M400", block, errorMessage));
+  TEST_ASSERT_TRUE(block.isWaitRequested);
+  TEST_ASSERT_FALSE(block.isHomingRequested);
+}
+
+void test_comments_checksums_and_line_numbers_are_ignored(void)
+{
+  TEST_ASSERT_TRUE(ESPStepperMotorServer_GCodeParser::parseLine("N10 G1 X1 ; move T1 to X1", block, errorMessage));
+  TEST_ASSERT_EQUAL_FLOAT(1, block.axisValues[0]);
+  TEST_ASSERT_TRUE(ESPStepperMotorServer_GCodeParser::parseLine("(start) G0 X2 (inline comment) Y4", block, errorMessage));
+  TEST_ASSERT_EQUAL_FLOAT(2, block.axisValues[0]);
+  TEST_ASSERT_EQUAL_FLOAT(4, block.axisValues[1]);
+  TEST_ASSERT_TRUE(ESPStepperMotorServer_GCodeParser::parseLine("N3 G0 X5*57", block, errorMessage));
+  TEST_ASSERT_EQUAL_FLOAT(5, block.axisValues[0]);
+  TEST_ASSERT_TRUE(ESPStepperMotorServer_GCodeParser::parseLine("G0 X6 (comment without end", block, errorMessage));
+  TEST_ASSERT_EQUAL_FLOAT(6, block.axisValues[0]);
+  TEST_ASSERT_TRUE(ESPStepperMotorServer_GCodeParser::parseLine("", block, errorMessage));
+  TEST_ASSERT_FALSE(block.hasAxisWords);
+}
+
+void test_invalid_lines(void)
+{
+  assertParseError("G1 F0", "feed rate must be larger than 0");
+  assertParseError("G1 F-100", "feed rate must be larger than 0");
+  assertParseError("G2 X1", "unsupported command");
+  assertParseError("G1.5 X1", "unsupported command");
+  assertParseError("M3", "unsupported command");
+  assertParseError("T1", "unsupported word");
+  assertParseError("G0 X", "invalid word, expected a letter followed by a number");
+  assertParseError("G0 X1 #2", "invalid word, expected a letter followed by a number");
+  assertParseError("G0 X.", "invalid word, expected a letter followed by a number");
+}
+
+void test_parse_number(void)
+{
+  float value = 0;
+  TEST_ASSERT_EQUAL(4, ESPStepperMotorServer_GCodeParser::parseNumber("12.5abc", value));
+  TEST_ASSERT_EQUAL_FLOAT(12.5, value);
+  TEST_ASSERT_EQUAL(3, ESPStepperMotorServer_GCodeParser::parseNumber("-.5", value));
+  TEST_ASSERT_EQUAL_FLOAT(-0.5, value);
+  TEST_ASSERT_EQUAL(2, ESPStepperMotorServer_GCodeParser::parseNumber("+3", value));
+  TEST_ASSERT_EQUAL_FLOAT(3, value);
+  TEST_ASSERT_EQUAL(3, ESPStepperMotorServer_GCodeParser::parseNumber("1.2.3", value));
+  TEST_ASSERT_EQUAL_FLOAT(1.2, value);
+  TEST_ASSERT_EQUAL(2, ESPStepperMotorServer_GCodeParser::parseNumber("10e5", value));
+  TEST_ASSERT_EQUAL_FLOAT(10, value);
+  value = 7;
+  TEST_ASSERT_EQUAL(0, ESPStepperMotorServer_GCodeParser::parseNumber(".", value));
+  TEST_ASSERT_EQUAL(0, ESPStepperMotorServer_GCodeParser::parseNumber("-", value));
+  TEST_ASSERT_EQUAL(0, ESPStepperMotorServer_GCodeParser::parseNumber("", value));
+  TEST_ASSERT_EQUAL_FLOAT(7, value);
+}
+
+void test_is_gcode_line(void)
+{
+  TEST_ASSERT_TRUE(ESPStepperMotorServer_GCodeParser::isGCodeLine("G1 X1"));
+  TEST_ASSERT_TRUE(ESPStepperMotorServer_GCodeParser::isGCodeLine("  m400"));
+  TEST_ASSERT_TRUE(ESPStepperMotorServer_GCodeParser::isGCodeLine("N10 G0 X1"));
+  TEST_ASSERT_TRUE(ESPStepperMotorServer_GCodeParser::isGCodeLine("; comment"));
+  TEST_ASSERT_TRUE(ESPStepperMotorServer_GCodeParser::isGCodeLine("\t(comment)"));
+  TEST_ASSERT_FALSE(ESPStepperMotorServer_GCodeParser::isGCodeLine("help"));
+  TEST_ASSERT_FALSE(ESPStepperMotorServer_GCodeParser::isGCodeLine("moveby id=0&v=100"));
+  TEST_ASSERT_FALSE(ESPStepperMotorServer_GCodeParser::isGCodeLine("G"));
+  TEST_ASSERT_FALSE(ESPStepperMotorServer_GCodeParser::isGCodeLine(""));
+}
+
+void test_axis_index(void)
+{
+  TEST_ASSERT_EQUAL(0, ESPStepperMotorServer_GCodeParser::getAxisIndex('x'));
+  TEST_ASSERT_EQUAL(2, ESPStepperMotorServer_GCodeParser::getAxisIndex('Z'));
+  TEST_ASSERT_EQUAL(5, ESPStepperMotorServer_GCodeParser::getAxisIndex('C'));
+  TEST_ASSERT_EQUAL(-1, ESPStepperMotorServer_GCodeParser::getAxisIndex('E'));
+  TEST_ASSERT_EQUAL(-1, ESPStepperMotorServer_GCodeParser::getAxisIndex('F'));
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_parse_linear_move);
+  RUN_TEST(test_parse_words_without_spaces_and_lower_case);
+  RUN_TEST(test_modal_state_is_kept);
+  RUN_TEST(test_axis_words_are_reset_for_each_line);
+  RUN_TEST(test_parse_homing_and_wait);
+  RUN_TEST(test_comments_checksums_and_line_numbers_are_ignored);
+  RUN_TEST(test_invalid_lines);
+  RUN_TEST(test_parse_number);
+  RUN_TEST(test_is_gcode_line);
+  RUN_TEST(test_axis_index);
+  return UNITY_END();
+}
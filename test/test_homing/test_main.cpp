@@ -0,0 +1,187 @@
+// host simulation of the homing state machine with a simulated stepper (see test/stubs/ESP_FlexyStepper.h) and a virtual limit switch.
+// Run with: pio test -e native -f test_homing
+#include <unity.h>
+#include <ESPStepperMotorServer_Homing.h>
+
+// the limit switch is active while the carriage is at or beyond this physical position (homing toward negative positions)
+#define SWITCH_POSITION -500
+#define STOP_DISTANCE 10
+#define MAX_ITERATIONS 100000
+
+ESP_FlexyStepper stepper;
+ESPStepperMotorServer_HomingStateMachine stateMachine;
+// difference between the physical position of the carriage and the position of the stepper, changes when the stepper position gets reset
+long physicalOffset;
+long switchPosition;
+bool isSwitchStuck;
+byte phaseHistory[16];
+byte phaseHistoryCount;
+
+void setUp(void)
+{
+  stepper = ESP_FlexyStepper();
+  stepper.stopDistanceInSteps = STOP_DISTANCE;
+  stateMachine = ESPStepperMotorServer_HomingStateMachine();
+  physicalOffset = 0;
+  switchPosition = SWITCH_POSITION;
+  isSwitchStuck = false;
+  phaseHistoryCount = 0;
+}
+
+void tearDown(void)
+{
+}
+
+static long getPhysicalPosition()
+{
+  return stepper.getCurrentPositionInSteps() + physicalOffset;
+}
+
+static bool isSwitchActive()
+{
+  return isSwitchStuck || getPhysicalPosition() <= switchPosition;
+}
+
+static ESPStepperMotorServer_HomingParameters createParameters()
+{
+  ESPStepperMotorServer_HomingParameters parameters = {};
+  parameters.fastSpeed = 1000;
+  parameters.slowSpeed = 100;
+  parameters.acceleration = 0;
+  parameters.backOffSteps = 20;
+  parameters.latchOffsetSteps = 0;
+  parameters.maxSteps = 2000;
+  parameters.directionTowardHome = -1;
+  return parameters;
+}
+
+// run the state machine and the simulated stepper like the motion controller task does, until the homing is finished
+static void simulate(long maxIterations)
+{
+  phaseHistory[phaseHistoryCount++] = stateMachine.getPhase();
+  for (long i = 0; i < maxIterations && stateMachine.isActive(); i++)
+  {
+    stepper.processMovement();
+    long positionBefore = stepper.getCurrentPositionInSteps();
+    if (stateMachine.process(isSwitchActive()) && phaseHistoryCount < sizeof(phaseHistory))
+    {
+      phaseHistory[phaseHistoryCount++] = stateMachine.getPhase();
+    }
+    // the state machine may redefine the current position (home), the carriage itself does not move
+    physicalOffset += positionBefore - stepper.getCurrentPositionInSteps();
+  }
+}
+
+void test_homing_latches_switch_position(void)
+{
+  stateMachine.start(&stepper, createParameters());
+  simulate(MAX_ITERATIONS);
+
+  const byte expectedPhases[] = {ESPServerHomingPhase_FastSeek, ESPServerHomingPhase_BackOff, ESPServerHomingPhase_SlowApproach, ESPServerHomingPhase_Completed};
+  TEST_ASSERT_EQUAL(sizeof(expectedPhases), phaseHistoryCount);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(expectedPhases, phaseHistory, phaseHistoryCount);
+  TEST_ASSERT_FALSE(stateMachine.isActive());
+  TEST_ASSERT_EQUAL(0, stepper.getCurrentPositionInSteps());
+  TEST_ASSERT_EQUAL(SWITCH_POSITION, getPhysicalPosition());
+  TEST_ASSERT_TRUE(stepper.motionComplete());
+  // the switch position is latched at the slow speed
+  TEST_ASSERT_EQUAL_FLOAT(100, stepper.speedInStepsPerSecond);
+}
+
+void test_homing_moves_to_latch_offset(void)
+{
+  ESPStepperMotorServer_HomingParameters parameters = createParameters();
+  parameters.latchOffsetSteps = 50;
+  stateMachine.start(&stepper, parameters);
+  simulate(MAX_ITERATIONS);
+
+  TEST_ASSERT_EQUAL(ESPServerHomingPhase_Completed, stateMachine.getPhase());
+  TEST_ASSERT_EQUAL(ESPServerHomingPhase_LatchOffset, phaseHistory[phaseHistoryCount - 2]);
+  TEST_ASSERT_EQUAL(0, stepper.getCurrentPositionInSteps());
+  TEST_ASSERT_EQUAL(SWITCH_POSITION + 50, getPhysicalPosition());
+}
+
+void test_homing_starting_on_the_switch(void)
+{
+  physicalOffset = SWITCH_POSITION - 5;
+  stateMachine.start(&stepper, createParameters());
+  simulate(MAX_ITERATIONS);
+
+  TEST_ASSERT_EQUAL(ESPServerHomingPhase_Completed, stateMachine.getPhase());
+  TEST_ASSERT_EQUAL(SWITCH_POSITION, getPhysicalPosition());
+}
+
+void test_homing_fails_if_switch_is_not_reached(void)
+{
+  switchPosition = -5000;
+  stateMachine.start(&stepper, createParameters());
+  simulate(MAX_ITERATIONS);
+
+  TEST_ASSERT_EQUAL(ESPServerHomingPhase_Failed, stateMachine.getPhase());
+  TEST_ASSERT_EQUAL(2, phaseHistoryCount);
+  TEST_ASSERT_EQUAL(-2000, getPhysicalPosition());
+}
+
+void test_homing_fails_if_switch_is_not_released(void)
+{
+  isSwitchStuck = true;
+  stateMachine.start(&stepper, createParameters());
+  simulate(MAX_ITERATIONS);
+
+  TEST_ASSERT_EQUAL(ESPServerHomingPhase_Failed, stateMachine.getPhase());
+  TEST_ASSERT_EQUAL(ESPServerHomingPhase_BackOff, phaseHistory[phaseHistoryCount - 2]);
+}
+
+void test_abort_stops_the_stepper(void)
+{
+  stateMachine.start(&stepper, createParameters());
+  simulate(100);
+  TEST_ASSERT_EQUAL(ESPServerHomingPhase_FastSeek, stateMachine.getPhase());
+
+  stateMachine.abort();
+  TEST_ASSERT_EQUAL(ESPServerHomingPhase_Aborted, stateMachine.getPhase());
+  TEST_ASSERT_FALSE(stateMachine.isActive());
+  while (!stepper.processMovement())
+  {
+  }
+  TEST_ASSERT_EQUAL(-100 - STOP_DISTANCE, stepper.getCurrentPositionInSteps());
+  // process() does not touch the stepper anymore once the homing has been aborted
+  TEST_ASSERT_FALSE(stateMachine.process(true));
+  TEST_ASSERT_TRUE(stepper.motionComplete());
+}
+
+void test_cancel_releases_the_stepper(void)
+{
+  stateMachine.start(&stepper, createParameters());
+  simulate(100);
+
+  stateMachine.cancel();
+  TEST_ASSERT_EQUAL(ESPServerHomingPhase_Aborted, stateMachine.getPhase());
+  TEST_ASSERT_NULL(stateMachine.getFlexyStepper());
+  // the stepper is not accessed, so the target of the fast seek is still set
+  TEST_ASSERT_FALSE(stepper.motionComplete());
+  stateMachine.abort();
+  TEST_ASSERT_FALSE(stepper.motionComplete());
+}
+
+void test_phase_names(void)
+{
+  TEST_ASSERT_EQUAL_STRING("idle", ESPStepperMotorServer_HomingStateMachine::getPhaseName(ESPServerHomingPhase_Idle));
+  TEST_ASSERT_EQUAL_STRING("fastseek", ESPStepperMotorServer_HomingStateMachine::getPhaseName(ESPServerHomingPhase_FastSeek));
+  TEST_ASSERT_EQUAL_STRING("completed", ESPStepperMotorServer_HomingStateMachine::getPhaseName(ESPServerHomingPhase_Completed));
+  TEST_ASSERT_EQUAL_STRING("aborted", ESPStepperMotorServer_HomingStateMachine::getPhaseName(ESPServerHomingPhase_Aborted));
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_homing_latches_switch_position);
+  RUN_TEST(test_homing_moves_to_latch_offset);
+  RUN_TEST(test_homing_starting_on_the_switch);
+  RUN_TEST(test_homing_fails_if_switch_is_not_reached);
+  RUN_TEST(test_homing_fails_if_switch_is_not_released);
+  RUN_TEST(test_abort_stops_the_stepper);
+  RUN_TEST(test_cancel_releases_the_stepper);
+  RUN_TEST(test_phase_names);
+  return UNITY_END();
+}
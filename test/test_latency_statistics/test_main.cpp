@@ -0,0 +1,81 @@
+// host tests for the latency statistics of the macro executor.
+// Run with: pio test -e native -f test_latency_statistics
+#include <unity.h>
+#include <ESPStepperMotorServer_LatencyStatistics.h>
+
+ESPStepperMotorServer_LatencyStatistics statistics;
+
+void setUp(void)
+{
+  statistics.reset();
+}
+
+void tearDown(void)
+{
+}
+
+void test_without_samples_everything_is_zero(void)
+{
+  TEST_ASSERT_EQUAL_UINT32(0, statistics.getSampleCount());
+  TEST_ASSERT_EQUAL_UINT32(0, statistics.getMinMicros());
+  TEST_ASSERT_EQUAL_UINT32(0, statistics.getAverageMicros());
+  TEST_ASSERT_EQUAL_UINT32(0, statistics.getMaxMicros());
+  TEST_ASSERT_EQUAL_UINT32(0, statistics.getLastMicros());
+}
+
+void test_min_average_max_and_last(void)
+{
+  const unsigned long samples[] = {120, 80, 400, 95, 105};
+  for (unsigned int i = 0; i < sizeof(samples) / sizeof(samples[0]); i++)
+  {
+    statistics.addSample(samples[i]);
+  }
+  TEST_ASSERT_EQUAL_UINT32(5, statistics.getSampleCount());
+  TEST_ASSERT_EQUAL_UINT32(80, statistics.getMinMicros());
+  TEST_ASSERT_EQUAL_UINT32(160, statistics.getAverageMicros());
+  TEST_ASSERT_EQUAL_UINT32(400, statistics.getMaxMicros());
+  TEST_ASSERT_EQUAL_UINT32(105, statistics.getLastMicros());
+}
+
+void test_first_sample_sets_the_minimum(void)
+{
+  // the minimum starts at 0, so the first sample must replace it even though it is larger
+  statistics.addSample(250);
+  TEST_ASSERT_EQUAL_UINT32(250, statistics.getMinMicros());
+  TEST_ASSERT_EQUAL_UINT32(250, statistics.getMaxMicros());
+  statistics.addSample(0);
+  TEST_ASSERT_EQUAL_UINT32(0, statistics.getMinMicros());
+  TEST_ASSERT_EQUAL_UINT32(125, statistics.getAverageMicros());
+}
+
+void test_average_of_large_latencies_does_not_overflow(void)
+{
+  for (int i = 0; i < 10; i++)
+  {
+    statistics.addSample(0xF0000000UL);
+  }
+  TEST_ASSERT_EQUAL_UINT32(0xF0000000UL, statistics.getAverageMicros());
+}
+
+void test_reset(void)
+{
+  statistics.addSample(10);
+  statistics.addSample(20);
+  statistics.reset();
+  TEST_ASSERT_EQUAL_UINT32(0, statistics.getSampleCount());
+  statistics.addSample(30);
+  TEST_ASSERT_EQUAL_UINT32(30, statistics.getMinMicros());
+  TEST_ASSERT_EQUAL_UINT32(30, statistics.getAverageMicros());
+  TEST_ASSERT_EQUAL_UINT32(30, statistics.getMaxMicros());
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_without_samples_everything_is_zero);
+  RUN_TEST(test_min_average_max_and_last);
+  RUN_TEST(test_first_sample_sets_the_minimum);
+  RUN_TEST(test_average_of_large_latencies_does_not_overflow);
+  RUN_TEST(test_reset);
+  return UNITY_END();
+}
@@ -0,0 +1,210 @@
+// host tests for the ring buffer of the logger.
+// Run with: pio test -e native -f test_log_ring
+#include <unity.h>
+#include <ESPStepperMotorServer_LogRing.h>
+
+#define RECORD_ALIGNMENT alignof(ESPStepperMotorServer_LogRecord)
+
+ESPStepperMotorServer_LogRing *ring;
+
+void setUp(void)
+{
+  ring = new ESPStepperMotorServer_LogRing();
+}
+
+void tearDown(void)
+{
+  delete ring;
+}
+
+// stores a record with a message of the given length, the message is filled with the pattern of the sequence number
+static bool push(uint32_t sequence, size_t messageLength)
+{
+  const size_t recordLength = ESPStepperMotorServer_LogRing::getRecordLength(messageLength + 1);
+  byte *recordStorage = ring->reserve(recordLength);
+  if (recordStorage == NULL)
+  {
+    return false;
+  }
+  ESPStepperMotorServer_LogRecord record = {};
+  record.length = recordLength;
+  record.arguments[0] = sequence;
+  record.arguments[1] = messageLength;
+  memcpy(recordStorage, &record, sizeof(record));
+  char *message = (char *)&recordStorage[sizeof(record)];
+  for (size_t i = 0; i < messageLength; i++)
+  {
+    message[i] = 'a' + (sequence + i) % 26;
+  }
+  message[messageLength] = '\0';
+  return true;
+}
+
+// takes the oldest record out of the ring and checks its sequence number and message
+static void popAndAssert(uint32_t expectedSequence)
+{
+  const ESPStepperMotorServer_LogRecord *record = ring->peek();
+  TEST_ASSERT_NOT_NULL(record);
+  TEST_ASSERT_EQUAL_UINT32(expectedSequence, record->arguments[0]);
+  TEST_ASSERT_EQUAL(0, ((size_t)record) % RECORD_ALIGNMENT);
+  const size_t messageLength = record->arguments[1];
+  const char *message = (const char *)&record[1];
+  for (size_t i = 0; i < messageLength; i++)
+  {
+    TEST_ASSERT_EQUAL('a' + (expectedSequence + i) % 26, message[i]);
+  }
+  TEST_ASSERT_EQUAL('\0', message[messageLength]);
+  ring->release(record);
+}
+
+void test_record_length_is_aligned(void)
+{
+  TEST_ASSERT_EQUAL(sizeof(ESPStepperMotorServer_LogRecord), ESPStepperMotorServer_LogRing::getRecordLength(0));
+  TEST_ASSERT_EQUAL(sizeof(ESPStepperMotorServer_LogRecord) + RECORD_ALIGNMENT, ESPStepperMotorServer_LogRing::getRecordLength(1));
+  TEST_ASSERT_EQUAL(sizeof(ESPStepperMotorServer_LogRecord) + RECORD_ALIGNMENT, ESPStepperMotorServer_LogRing::getRecordLength(RECORD_ALIGNMENT));
+  TEST_ASSERT_EQUAL(sizeof(ESPStepperMotorServer_LogRecord) + 2 * RECORD_ALIGNMENT, ESPStepperMotorServer_LogRing::getRecordLength(RECORD_ALIGNMENT + 1));
+}
+
+void test_empty_ring(void)
+{
+  TEST_ASSERT_TRUE(ring->isEmpty());
+  TEST_ASSERT_NULL(ring->peek());
+  TEST_ASSERT_TRUE(push(1, 10));
+  TEST_ASSERT_FALSE(ring->isEmpty());
+  popAndAssert(1);
+  TEST_ASSERT_TRUE(ring->isEmpty());
+  TEST_ASSERT_NULL(ring->peek());
+}
+
+void test_full_ring_drops_records(void)
+{
+  const size_t messageLength = 40;
+  const size_t recordLength = ESPStepperMotorServer_LogRing::getRecordLength(messageLength + 1);
+  // one byte always stays unused, so the head can not catch up with the tail
+  const size_t capacity = (ESPServerLogBufferSize - 1) / recordLength;
+  for (size_t i = 0; i < capacity; i++)
+  {
+    TEST_ASSERT_TRUE(push(i, messageLength));
+  }
+  TEST_ASSERT_FALSE(push(capacity, messageLength));
+  TEST_ASSERT_FALSE(push(capacity, 0));
+
+  // the next record does not fit into the rest of the buffer, it is stored at the start once two records have been released
+  popAndAssert(0);
+  popAndAssert(1);
+  TEST_ASSERT_TRUE(push(capacity, messageLength));
+  for (size_t i = 2; i <= capacity; i++)
+  {
+    popAndAssert(i);
+  }
+  TEST_ASSERT_TRUE(ring->isEmpty());
+}
+
+void test_record_that_exactly_fills_the_end(void)
+{
+  const size_t headerLength = sizeof(ESPStepperMotorServer_LogRecord);
+  TEST_ASSERT_TRUE(push(0, 0));
+  // a record that ends at the last byte of the buffer while the tail is at the start would make the ring look empty
+  const size_t remainingLength = ESPServerLogBufferSize - ESPStepperMotorServer_LogRing::getRecordLength(1);
+  TEST_ASSERT_FALSE(push(1, remainingLength - headerLength - 1));
+  popAndAssert(0);
+  // once the tail moved away from the start, the same record fits
+  TEST_ASSERT_TRUE(push(1, remainingLength - headerLength - 1));
+  // the head is back at the start and directly behind it is the tail
+  TEST_ASSERT_FALSE(push(2, 0));
+  popAndAssert(1);
+  TEST_ASSERT_TRUE(push(2, 0));
+  popAndAssert(2);
+  TEST_ASSERT_TRUE(ring->isEmpty());
+}
+
+void test_wraparound_with_padding_keeps_the_order(void)
+{
+  const size_t messageLength = 100;
+  const size_t recordLength = ESPStepperMotorServer_LogRing::getRecordLength(messageLength + 1);
+  const size_t recordsUntilEnd = ESPServerLogBufferSize / recordLength;
+  for (size_t i = 0; i < recordsUntilEnd; i++)
+  {
+    TEST_ASSERT_TRUE(push(i, messageLength));
+  }
+  // the space at the end is too small for the next record, it is stored at the start once there is space there
+  TEST_ASSERT_TRUE(ESPServerLogBufferSize % recordLength < recordLength);
+  TEST_ASSERT_FALSE(push(recordsUntilEnd, messageLength));
+  popAndAssert(0);
+  popAndAssert(1);
+  TEST_ASSERT_TRUE(push(recordsUntilEnd, messageLength));
+  for (size_t i = 2; i <= recordsUntilEnd; i++)
+  {
+    popAndAssert(i);
+  }
+  TEST_ASSERT_TRUE(ring->isEmpty());
+}
+
+void test_mixed_workload(void)
+{
+  // pseudo random producer and consumer with a shadow queue of the sequence numbers that have been accepted
+  const size_t shadowSize = ESPServerLogBufferSize;
+  static uint32_t shadow[ESPServerLogBufferSize];
+  size_t shadowHead = 0;
+  size_t shadowTail = 0;
+  uint32_t random = 12345;
+  uint32_t sequence = 0;
+  uint32_t droppedCount = 0;
+  uint32_t wrapCount = 0;
+  const ESPStepperMotorServer_LogRecord *lastRecord = NULL;
+  for (int i = 0; i < 200000; i++)
+  {
+    random = random * 1103515245 + 12345;
+    const uint32_t action = (random >> 16) % 8;
+    if (action < 4)
+    {
+      const size_t messageLength = (random >> 8) % 200;
+      if (push(sequence, messageLength))
+      {
+        shadow[shadowHead] = sequence;
+        shadowHead = (shadowHead + 1) % shadowSize;
+      }
+      else
+      {
+        droppedCount++;
+      }
+      sequence++;
+    }
+    else if (shadowTail != shadowHead)
+    {
+      const ESPStepperMotorServer_LogRecord *record = ring->peek();
+      if (lastRecord != NULL && record < lastRecord)
+      {
+        wrapCount++;
+      }
+      lastRecord = record;
+      popAndAssert(shadow[shadowTail]);
+      shadowTail = (shadowTail + 1) % shadowSize;
+    }
+    else
+    {
+      TEST_ASSERT_TRUE(ring->isEmpty());
+    }
+  }
+  while (shadowTail != shadowHead)
+  {
+    popAndAssert(shadow[shadowTail]);
+    shadowTail = (shadowTail + 1) % shadowSize;
+  }
+  TEST_ASSERT_TRUE(ring->isEmpty());
+  // the workload has to run into both the full ring and the end of the buffer
+  TEST_ASSERT_TRUE(droppedCount > 0);
+  TEST_ASSERT_TRUE(wrapCount > 100);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_record_length_is_aligned);
+  RUN_TEST(test_empty_ring);
+  RUN_TEST(test_full_ring_drops_records);
+  RUN_TEST(test_record_that_exactly_fills_the_end);
+  RUN_TEST(test_wraparound_with_padding_keeps_the_order);
+  RUN_TEST(test_mixed_workload);
+  return UNITY_END();
+}
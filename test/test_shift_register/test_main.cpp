@@ -0,0 +1,129 @@
+// host tests for the bit stream of the shift register output.
+// Run with: pio test -e native -f test_shift_register
+#include <unity.h>
+#include <ESPStepperMotorServer_ShiftRegisterStream.h>
+
+// with the default word rate of 125000 words per second each word lasts 8us
+#define WORD_MICROS 8
+#define BLOCK_START 1000
+#define STEP_A 0x01
+#define STEP_B 0x04
+#define DIRECTION_A 0x02
+
+ESPStepperMotorServer_ShiftRegisterStream stream;
+uint32_t words[ESPServerShiftRegisterWordsPerCycle];
+
+void setUp(void)
+{
+  stream.reset(BLOCK_START, 0);
+  memset(words, 0xAA, sizeof(words));
+}
+
+void tearDown(void)
+{
+}
+
+static ESPStepperMotorServer_ShiftRegisterStep createStep(int word, uint32_t stepMask, uint32_t outputState)
+{
+  ESPStepperMotorServer_ShiftRegisterStep step = {(uint32_t)(BLOCK_START + word * WORD_MICROS), stepMask, outputState};
+  return step;
+}
+
+void test_block_without_steps_keeps_the_direction_outputs(void)
+{
+  stream.reset(BLOCK_START, DIRECTION_A);
+  TEST_ASSERT_EQUAL(0, stream.buildCycleWords(NULL, 0, words));
+  for (int i = 0; i < ESPServerShiftRegisterWordsPerCycle; i++)
+  {
+    TEST_ASSERT_EQUAL_HEX32(DIRECTION_A, words[i]);
+  }
+  TEST_ASSERT_EQUAL_UINT32(BLOCK_START + ESPServerShiftRegisterCycleMicros, stream.getBlockStartMicros());
+}
+
+void test_pulse_starts_at_the_word_of_its_time(void)
+{
+  ESPStepperMotorServer_ShiftRegisterStep step = createStep(3, STEP_A, 0);
+  TEST_ASSERT_EQUAL(1, stream.buildCycleWords(&step, 1, words));
+  const uint32_t expectedWords[] = {0, 0, 0, STEP_A, STEP_A, 0, 0, 0};
+  TEST_ASSERT_EQUAL_HEX32_ARRAY(expectedWords, words, ESPServerShiftRegisterWordsPerCycle);
+  TEST_ASSERT_FALSE(stream.isPulseActive());
+}
+
+void test_direction_is_set_one_word_before_the_step(void)
+{
+  ESPStepperMotorServer_ShiftRegisterStep step = createStep(2, STEP_A, DIRECTION_A);
+  TEST_ASSERT_EQUAL(1, stream.buildCycleWords(&step, 1, words));
+  const uint32_t expectedWords[] = {0, 0, DIRECTION_A, DIRECTION_A | STEP_A, DIRECTION_A | STEP_A, DIRECTION_A, DIRECTION_A, DIRECTION_A};
+  TEST_ASSERT_EQUAL_HEX32_ARRAY(expectedWords, words, ESPServerShiftRegisterWordsPerCycle);
+  TEST_ASSERT_EQUAL_HEX32(DIRECTION_A, stream.getOutputState());
+}
+
+void test_close_steps_are_separated_by_a_low_word(void)
+{
+  ESPStepperMotorServer_ShiftRegisterStep steps[] = {createStep(0, STEP_A, 0), createStep(1, STEP_B, 0), createStep(2, STEP_A, 0)};
+  TEST_ASSERT_EQUAL(3, stream.buildCycleWords(steps, 3, words));
+  const uint32_t expectedWords[] = {STEP_A, STEP_A, 0, STEP_B, STEP_B, 0, STEP_A, STEP_A};
+  TEST_ASSERT_EQUAL_HEX32_ARRAY(expectedWords, words, ESPServerShiftRegisterWordsPerCycle);
+}
+
+void test_pulse_continues_in_the_next_block(void)
+{
+  ESPStepperMotorServer_ShiftRegisterStep steps[] = {createStep(7, STEP_A, 0), createStep(8, STEP_B, 0)};
+  TEST_ASSERT_EQUAL(1, stream.buildCycleWords(steps, 2, words));
+  TEST_ASSERT_EQUAL_HEX32(STEP_A, words[7]);
+  TEST_ASSERT_TRUE(stream.isPulseActive());
+
+  // the second step is due at the first word of the next block, but has to wait for the end of the first pulse and the low word
+  TEST_ASSERT_EQUAL(1, stream.buildCycleWords(&steps[1], 1, words));
+  const uint32_t expectedWords[] = {STEP_A, 0, STEP_B, STEP_B, 0, 0, 0, 0};
+  TEST_ASSERT_EQUAL_HEX32_ARRAY(expectedWords, words, ESPServerShiftRegisterWordsPerCycle);
+}
+
+void test_future_steps_are_kept_for_the_next_block(void)
+{
+  ESPStepperMotorServer_ShiftRegisterStep steps[] = {createStep(5, STEP_A, 0), createStep(ESPServerShiftRegisterWordsPerCycle + 2, STEP_B, 0)};
+  TEST_ASSERT_EQUAL(1, stream.buildCycleWords(steps, 2, words));
+  TEST_ASSERT_EQUAL(1, stream.buildCycleWords(&steps[1], 1, words));
+  const uint32_t expectedWords[] = {0, 0, STEP_B, STEP_B, 0, 0, 0, 0};
+  TEST_ASSERT_EQUAL_HEX32_ARRAY(expectedWords, words, ESPServerShiftRegisterWordsPerCycle);
+}
+
+void test_late_steps_are_sent_right_away(void)
+{
+  ESPStepperMotorServer_ShiftRegisterStep step = createStep(-20, STEP_A, 0);
+  TEST_ASSERT_EQUAL(1, stream.buildCycleWords(&step, 1, words));
+  TEST_ASSERT_EQUAL_HEX32(STEP_A, words[0]);
+  TEST_ASSERT_EQUAL_HEX32(STEP_A, words[1]);
+  TEST_ASSERT_EQUAL_HEX32(0, words[2]);
+}
+
+void test_direction_only_step(void)
+{
+  stream.reset(BLOCK_START, DIRECTION_A);
+  ESPStepperMotorServer_ShiftRegisterStep steps[] = {createStep(1, 0, 0), createStep(1, STEP_A, 0)};
+  TEST_ASSERT_EQUAL(2, stream.buildCycleWords(steps, 2, words));
+  const uint32_t expectedWords[] = {DIRECTION_A, 0, STEP_A, STEP_A, 0, 0, 0, 0};
+  TEST_ASSERT_EQUAL_HEX32_ARRAY(expectedWords, words, ESPServerShiftRegisterWordsPerCycle);
+}
+
+void test_word_index_wraps_around(void)
+{
+  stream.reset(0xFFFFFFF0, 0);
+  TEST_ASSERT_EQUAL(4, stream.getWordIndex(0x00000010));
+  TEST_ASSERT_EQUAL(-2, stream.getWordIndex(0xFFFFFFE0));
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_block_without_steps_keeps_the_direction_outputs);
+  RUN_TEST(test_pulse_starts_at_the_word_of_its_time);
+  RUN_TEST(test_direction_is_set_one_word_before_the_step);
+  RUN_TEST(test_close_steps_are_separated_by_a_low_word);
+  RUN_TEST(test_pulse_continues_in_the_next_block);
+  RUN_TEST(test_future_steps_are_kept_for_the_next_block);
+  RUN_TEST(test_late_steps_are_sent_right_away);
+  RUN_TEST(test_direction_only_step);
+  RUN_TEST(test_word_index_wraps_around);
+  return UNITY_END();
+}
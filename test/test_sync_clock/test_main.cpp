@@ -0,0 +1,292 @@
+// host tests for the follower clock of the sync controller: a simulated master and follower with drifting clocks
+// exchange the sync packets over a loopback transport with a jittering delay.
+// Run with: pio test -e native -f test_sync_clock
+#include <unity.h>
+#include <math.h>
+#include <stdio.h>
+#include <ESPStepperMotorServer_SyncClock.h>
+
+#define TICK_MICROS 50
+#define CLOCK_INTERVAL_MICROS 100000
+#define ROUND_TRIP_INTERVAL_MICROS 1000000
+#define SEGMENT_INTERVAL_MICROS 250000
+#define LEAD_TIME_MICROS 20000
+#define MAX_PACKETS_IN_FLIGHT 16
+#define MAX_SEGMENTS 400
+
+// a local clock running at (1 + ppm / 10^6) times the real time, starting at offsetMicros
+struct SimulatedClock
+{
+  double ppm;
+  uint32_t offsetMicros;
+
+  uint32_t getMicros(double realMicros) const
+  {
+    return this->offsetMicros + (uint32_t)(uint64_t)llround(realMicros * (1.0 + this->ppm / 1000000.0));
+  }
+};
+
+struct Packet
+{
+  byte data[ESPServerSyncPacketMaxLength];
+  size_t length;
+  double deliveryMicros;
+  bool isForMaster;
+};
+
+// the loopback transport delivers the packets after the base delay plus a random jitter
+Packet packets[MAX_PACKETS_IN_FLIGHT];
+int packetCount;
+uint32_t randomState;
+double baseDelayMicros;
+double maxJitterMicros;
+
+SimulatedClock masterClock;
+SimulatedClock followerClock;
+ESPStepperMotorServer_SyncClock masterSyncClock;
+ESPStepperMotorServer_SyncClock followerSyncClock;
+
+// the real time each segment has been started on the master and on the follower, -1 if it has not been started (yet)
+uint32_t segmentStartMasterMicros[MAX_SEGMENTS];
+double masterStartMicros[MAX_SEGMENTS];
+double followerStartMicros[MAX_SEGMENTS];
+int segmentCount;
+
+static double nextRandom()
+{
+  randomState = randomState * 1664525UL + 1013904223UL;
+  return (double)(randomState >> 8) / (double)(1UL << 24);
+}
+
+static void sendPacket(const byte *data, size_t length, double nowMicros, bool isForMaster)
+{
+  TEST_ASSERT_TRUE(packetCount < MAX_PACKETS_IN_FLIGHT);
+  Packet &packet = packets[packetCount++];
+  memcpy(packet.data, data, length);
+  packet.length = length;
+  packet.deliveryMicros = nowMicros + baseDelayMicros + nextRandom() * maxJitterMicros;
+  packet.isForMaster = isForMaster;
+}
+
+static void handleMasterPacket(const Packet &packet, double nowMicros)
+{
+  ESPStepperMotorServer_SyncClockExchange exchange;
+  TEST_ASSERT_TRUE(ESPStepperMotorServer_SyncPacket::decodeClockRequest(packet.data, packet.length, exchange.nodeId, exchange.followerSendMicros));
+  exchange.masterReceiveMicros = masterClock.getMicros(nowMicros);
+  exchange.masterSendMicros = exchange.masterReceiveMicros + 30;
+  byte response[ESPServerSyncPacketClockResponseLength];
+  sendPacket(response, ESPStepperMotorServer_SyncPacket::encodeClockResponse(exchange, response), nowMicros + 30, false);
+}
+
+static void handleFollowerPacket(const Packet &packet, double nowMicros)
+{
+  const uint32_t localMicros = followerClock.getMicros(nowMicros);
+  uint32_t masterMicros;
+  bool isEmergencyStopActive;
+  ESPStepperMotorServer_SyncClockExchange exchange;
+  ESPStepperMotorServer_SyncSegment segment;
+  if (ESPStepperMotorServer_SyncPacket::decodeClock(packet.data, packet.length, masterMicros, isEmergencyStopActive))
+  {
+    followerSyncClock.update(masterMicros, localMicros);
+  }
+  else if (ESPStepperMotorServer_SyncPacket::decodeClockResponse(packet.data, packet.length, exchange))
+  {
+    followerSyncClock.updateNetworkDelay(exchange, localMicros);
+  }
+  else
+  {
+    TEST_ASSERT_TRUE(ESPStepperMotorServer_SyncPacket::decodeSegment(packet.data, packet.length, segment));
+    TEST_ASSERT_TRUE(followerSyncClock.isValid());
+  }
+}
+
+static void deliverPackets(double nowMicros)
+{
+  for (int i = 0; i < packetCount;)
+  {
+    if (packets[i].deliveryMicros > nowMicros)
+    {
+      i++;
+      continue;
+    }
+    const Packet packet = packets[i];
+    packets[i] = packets[--packetCount];
+    if (packet.isForMaster)
+    {
+      handleMasterPacket(packet, nowMicros);
+    }
+    else
+    {
+      handleFollowerPacket(packet, nowMicros);
+    }
+  }
+}
+
+// both controllers check their waiting segments in each tick, like the sync task does
+static void startDueSegments(double nowMicros)
+{
+  long startDelayMicros;
+  for (int i = 0; i < segmentCount; i++)
+  {
+    if (masterStartMicros[i] < 0 && masterSyncClock.isSegmentDue(segmentStartMasterMicros[i], masterClock.getMicros(nowMicros), startDelayMicros))
+    {
+      masterStartMicros[i] = nowMicros;
+    }
+    if (followerStartMicros[i] < 0 && followerSyncClock.isSegmentDue(segmentStartMasterMicros[i], followerClock.getMicros(nowMicros), startDelayMicros))
+    {
+      followerStartMicros[i] = nowMicros;
+    }
+  }
+}
+
+// run the master and the follower for the given real time. If rebootMicros is given, the master clock restarts at 0 at that time
+static void simulate(double durationMicros, double rebootMicros = -1)
+{
+  double nextClockMicros = 0;
+  double nextRoundTripMicros = 0;
+  double nextSegmentMicros = SEGMENT_INTERVAL_MICROS;
+  for (double now = 0; now < durationMicros; now += TICK_MICROS)
+  {
+    if (rebootMicros >= 0 && now >= rebootMicros)
+    {
+      masterClock.offsetMicros = -masterClock.getMicros(now) + masterClock.offsetMicros;
+      rebootMicros = -1;
+      // the master loses its waiting segments, they are not compared
+      for (int i = 0; i < segmentCount; i++)
+      {
+        if (masterStartMicros[i] < 0 || followerStartMicros[i] < 0)
+        {
+          masterStartMicros[i] = followerStartMicros[i] = 0;
+        }
+      }
+    }
+    if (now >= nextClockMicros)
+    {
+      byte packet[ESPServerSyncPacketClockLength];
+      sendPacket(packet, ESPStepperMotorServer_SyncPacket::encodeClock(masterClock.getMicros(now), false, packet), now, false);
+      nextClockMicros += CLOCK_INTERVAL_MICROS;
+    }
+    if (followerSyncClock.isValid() && now >= nextRoundTripMicros)
+    {
+      byte packet[ESPServerSyncPacketClockRequestLength];
+      sendPacket(packet, ESPStepperMotorServer_SyncPacket::encodeClockRequest(1, followerClock.getMicros(now), packet), now, true);
+      nextRoundTripMicros = now + ROUND_TRIP_INTERVAL_MICROS;
+    }
+    if (now >= nextSegmentMicros && segmentCount < MAX_SEGMENTS)
+    {
+      ESPStepperMotorServer_SyncSegment segment = {};
+      segment.segmentId = segmentCount + 1;
+      segment.startMasterMicros = masterClock.getMicros(now) + LEAD_TIME_MICROS;
+      segment.moveCount = 1;
+      segment.moves[0].nodeId = 1;
+      byte packet[ESPServerSyncPacketMaxLength];
+      sendPacket(packet, ESPStepperMotorServer_SyncPacket::encodeSegment(segment, packet), now, false);
+      segmentStartMasterMicros[segmentCount] = segment.startMasterMicros;
+      masterStartMicros[segmentCount] = followerStartMicros[segmentCount] = -1;
+      segmentCount++;
+      nextSegmentMicros += SEGMENT_INTERVAL_MICROS;
+    }
+    deliverPackets(now);
+    startDueSegments(now);
+  }
+}
+
+// the largest difference between the real start times on the master and on the follower of the segments sent within the given time range
+static double getMaxStartErrorMicros(double fromMicros, double toMicros)
+{
+  double maxErrorMicros = 0;
+  int checkedSegments = 0;
+  for (int i = 0; i < segmentCount; i++)
+  {
+    const double sendMicros = (i + 1) * (double)SEGMENT_INTERVAL_MICROS;
+    if (sendMicros < fromMicros || sendMicros >= toMicros)
+    {
+      continue;
+    }
+    TEST_ASSERT_TRUE_MESSAGE(masterStartMicros[i] > 0 && followerStartMicros[i] > 0, "segment has not been started");
+    maxErrorMicros = fmax(maxErrorMicros, fabs(followerStartMicros[i] - masterStartMicros[i]));
+    checkedSegments++;
+  }
+  TEST_ASSERT_TRUE(checkedSegments > 0);
+  return maxErrorMicros;
+}
+
+void setUp(void)
+{
+  packetCount = 0;
+  segmentCount = 0;
+  randomState = 12345;
+  baseDelayMicros = 1500;
+  maxJitterMicros = 1000;
+  // the master clock wraps around after about 1 s
+  masterClock = {40, 0xFFF00000};
+  followerClock = {-35, 0x12345678};
+  masterSyncClock.reset(true);
+  followerSyncClock.reset(false);
+}
+
+void tearDown(void)
+{
+}
+
+void test_follower_is_not_synchronized_before_the_first_clock_packet(void)
+{
+  long startDelayMicros;
+  TEST_ASSERT_FALSE(followerSyncClock.isValid());
+  TEST_ASSERT_FALSE(followerSyncClock.isSegmentDue(0, 0, startDelayMicros));
+  TEST_ASSERT_TRUE(masterSyncClock.isValid());
+  TEST_ASSERT_EQUAL_UINT32(1234, masterSyncClock.getMasterMicros(1234));
+  TEST_ASSERT_TRUE(masterSyncClock.isSegmentDue(0xFFFFFFF0, 0x10, startDelayMicros));
+  TEST_ASSERT_EQUAL(0x20, startDelayMicros);
+}
+
+void test_start_time_error_converges_with_drift_and_jitter(void)
+{
+  simulate(60000000);
+  TEST_ASSERT_EQUAL(0, followerSyncClock.getResyncCount());
+  // the relative drift of the two clocks is 75 ppm, the mean one way delay 2 ms. The drift estimate still follows the jitter of the clock packets a bit
+  TEST_ASSERT_FLOAT_WITHIN(75, 75, followerSyncClock.getClockDriftPpm());
+  TEST_ASSERT_INT_WITHIN(200, 2000, followerSyncClock.getNetworkDelayMicros());
+  const double maxErrorMicros = getMaxStartErrorMicros(10000000, 60000000);
+  printf("max start time error after convergence: %.0f us (jitter %.0f us, tick %d us)\n", maxErrorMicros, maxJitterMicros, TICK_MICROS);
+  TEST_ASSERT_TRUE(maxErrorMicros <= 400);
+}
+
+void test_start_time_error_without_jitter(void)
+{
+  maxJitterMicros = 0;
+  simulate(30000000);
+  TEST_ASSERT_TRUE(getMaxStartErrorMicros(10000000, 30000000) <= 2 * TICK_MICROS);
+}
+
+void test_master_reboot_triggers_resync(void)
+{
+  simulate(60000000, 30000000);
+  TEST_ASSERT_EQUAL(1, followerSyncClock.getResyncCount());
+  TEST_ASSERT_TRUE(followerSyncClock.isValid());
+  TEST_ASSERT_TRUE(getMaxStartErrorMicros(10000000, 30000000) <= 400);
+  TEST_ASSERT_TRUE(getMaxStartErrorMicros(40000000, 60000000) <= 400);
+}
+
+void test_delayed_clock_exchange_is_not_used_for_the_network_delay(void)
+{
+  ESPStepperMotorServer_SyncClockExchange exchange = {1, 1000, 50000, 50100};
+  TEST_ASSERT_TRUE(followerSyncClock.updateNetworkDelay(exchange, 3100));
+  TEST_ASSERT_EQUAL(1000, followerSyncClock.getNetworkDelayMicros());
+  TEST_ASSERT_FALSE(followerSyncClock.updateNetworkDelay(exchange, 1000 + ESPServerSyncMaxRoundTripMicros + 1));
+  TEST_ASSERT_EQUAL(1000, followerSyncClock.getNetworkDelayMicros());
+  // further measurements are filtered
+  TEST_ASSERT_TRUE(followerSyncClock.updateNetworkDelay(exchange, 11100));
+  TEST_ASSERT_EQUAL(1000 + 4000 / ESPServerSyncNetworkDelayFilter, followerSyncClock.getNetworkDelayMicros());
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_follower_is_not_synchronized_before_the_first_clock_packet);
+  RUN_TEST(test_start_time_error_converges_with_drift_and_jitter);
+  RUN_TEST(test_start_time_error_without_jitter);
+  RUN_TEST(test_master_reboot_triggers_resync);
+  RUN_TEST(test_delayed_clock_exchange_is_not_used_for_the_network_delay);
+  return UNITY_END();
+}
@@ -0,0 +1,182 @@
+// host tests for the UDP packets of the sync controller.
+// Run with: pio test -e native -f test_sync_packet
+#include <unity.h>
+#include <ESPStepperMotorServer_SyncPacket.h>
+
+byte packet[ESPServerSyncPacketMaxLength];
+
+void setUp(void)
+{
+  memset(packet, 0, sizeof(packet));
+}
+
+void tearDown(void)
+{
+}
+
+static ESPStepperMotorServer_SyncSegment createSegment(byte moveCount)
+{
+  ESPStepperMotorServer_SyncSegment segment = {};
+  segment.segmentId = 0xBEEF;
+  segment.startMasterMicros = 0xFFFFFF00;
+  segment.moveCount = moveCount;
+  for (byte i = 0; i < moveCount; i++)
+  {
+    segment.moves[i].nodeId = i;
+    segment.moves[i].stepperId = 7 - i;
+    segment.moves[i].targetPositionInSteps = (i % 2) ? -2000000L * i : 1000L * i;
+    segment.moves[i].speedInStepsPerSecond = 800.5f + i;
+    segment.moves[i].accelerationInStepsPerSecondPerSecond = 0.25f * i;
+  }
+  return segment;
+}
+
+static void assertSegmentsEqual(const ESPStepperMotorServer_SyncSegment &expected, const ESPStepperMotorServer_SyncSegment &actual)
+{
+  TEST_ASSERT_EQUAL_UINT16(expected.segmentId, actual.segmentId);
+  TEST_ASSERT_EQUAL_UINT32(expected.startMasterMicros, actual.startMasterMicros);
+  TEST_ASSERT_EQUAL(expected.moveCount, actual.moveCount);
+  for (byte i = 0; i < expected.moveCount; i++)
+  {
+    TEST_ASSERT_EQUAL(expected.moves[i].nodeId, actual.moves[i].nodeId);
+    TEST_ASSERT_EQUAL(expected.moves[i].stepperId, actual.moves[i].stepperId);
+    TEST_ASSERT_EQUAL(expected.moves[i].targetPositionInSteps, actual.moves[i].targetPositionInSteps);
+    TEST_ASSERT_EQUAL_FLOAT(expected.moves[i].speedInStepsPerSecond, actual.moves[i].speedInStepsPerSecond);
+    TEST_ASSERT_EQUAL_FLOAT(expected.moves[i].accelerationInStepsPerSecondPerSecond, actual.moves[i].accelerationInStepsPerSecondPerSecond);
+  }
+}
+
+void test_segment_round_trip(void)
+{
+  for (byte moveCount = 1; moveCount <= ESPServerSyncMaxSegmentMoves; moveCount++)
+  {
+    ESPStepperMotorServer_SyncSegment segment = createSegment(moveCount);
+    size_t length = ESPStepperMotorServer_SyncPacket::encodeSegment(segment, packet);
+    TEST_ASSERT_EQUAL(ESPServerSyncPacketHeaderLength + 7 + moveCount * ESPServerSyncPacketMoveLength + ESPServerSyncPacketCrcLength, length);
+    TEST_ASSERT_TRUE(length <= ESPServerSyncPacketMaxLength);
+    TEST_ASSERT_TRUE(ESPStepperMotorServer_SyncPacket::isValid(packet, length));
+    TEST_ASSERT_EQUAL(ESPServerSyncPacket_Segment, ESPStepperMotorServer_SyncPacket::getType(packet));
+
+    ESPStepperMotorServer_SyncSegment decodedSegment = {};
+    TEST_ASSERT_TRUE(ESPStepperMotorServer_SyncPacket::decodeSegment(packet, length, decodedSegment));
+    assertSegmentsEqual(segment, decodedSegment);
+  }
+}
+
+void test_segment_layout_is_little_endian(void)
+{
+  ESPStepperMotorServer_SyncSegment segment = createSegment(1);
+  segment.moves[0].targetPositionInSteps = -2;
+  ESPStepperMotorServer_SyncPacket::encodeSegment(segment, packet);
+  const byte expectedStart[] = {ESPServerSyncPacketMagic, ESPServerSyncPacketVersion, ESPServerSyncPacket_Segment, 0xEF, 0xBE, 0x00, 0xFF, 0xFF, 0xFF, 1, 0, 7, 0xFE, 0xFF, 0xFF, 0xFF};
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(expectedStart, packet, sizeof(expectedStart));
+}
+
+void test_segment_with_invalid_move_count_is_rejected(void)
+{
+  ESPStepperMotorServer_SyncSegment segment = createSegment(2);
+  size_t length = ESPStepperMotorServer_SyncPacket::encodeSegment(segment, packet);
+  ESPStepperMotorServer_SyncSegment decodedSegment;
+  // truncated or too long packets
+  TEST_ASSERT_FALSE(ESPStepperMotorServer_SyncPacket::decodeSegment(packet, length - 1, decodedSegment));
+  TEST_ASSERT_FALSE(ESPStepperMotorServer_SyncPacket::decodeSegment(packet, length + ESPServerSyncPacketMoveLength, decodedSegment));
+  TEST_ASSERT_FALSE(ESPStepperMotorServer_SyncPacket::decodeSegment(packet, ESPServerSyncPacketHeaderLength + 6, decodedSegment));
+  // move count 0 and more than the maximum
+  packet[ESPServerSyncPacketHeaderLength + 6] = 0;
+  TEST_ASSERT_FALSE(ESPStepperMotorServer_SyncPacket::decodeSegment(packet, ESPServerSyncPacketHeaderLength + 7 + ESPServerSyncPacketCrcLength, decodedSegment));
+  packet[ESPServerSyncPacketHeaderLength + 6] = ESPServerSyncMaxSegmentMoves + 1;
+  TEST_ASSERT_FALSE(ESPStepperMotorServer_SyncPacket::decodeSegment(packet, ESPServerSyncPacketMaxLength, decodedSegment));
+}
+
+void test_other_packet_types_are_not_decoded_as_segment(void)
+{
+  size_t length = ESPStepperMotorServer_SyncPacket::encodeClock(1234, false, packet);
+  ESPStepperMotorServer_SyncSegment segment;
+  TEST_ASSERT_FALSE(ESPStepperMotorServer_SyncPacket::decodeSegment(packet, length, segment));
+  uint32_t masterMicros;
+  bool isEmergencyStopActive;
+  length = ESPStepperMotorServer_SyncPacket::encodeClockRequest(1, 1234, packet);
+  TEST_ASSERT_FALSE(ESPStepperMotorServer_SyncPacket::decodeClock(packet, length, masterMicros, isEmergencyStopActive));
+}
+
+void test_corrupted_packets_are_invalid(void)
+{
+  ESPStepperMotorServer_SyncSegment segment = createSegment(3);
+  size_t length = ESPStepperMotorServer_SyncPacket::encodeSegment(segment, packet);
+  for (size_t i = 0; i < length; i++)
+  {
+    packet[i] ^= 0x10;
+    TEST_ASSERT_FALSE(ESPStepperMotorServer_SyncPacket::isValid(packet, length));
+    packet[i] ^= 0x10;
+  }
+  TEST_ASSERT_TRUE(ESPStepperMotorServer_SyncPacket::isValid(packet, length));
+  TEST_ASSERT_FALSE(ESPStepperMotorServer_SyncPacket::isValid(packet, length - 1));
+  TEST_ASSERT_FALSE(ESPStepperMotorServer_SyncPacket::isValid(packet, ESPServerSyncPacketHeaderLength + 1));
+}
+
+void test_clock_round_trip(void)
+{
+  uint32_t masterMicros = 0;
+  bool isEmergencyStopActive = false;
+  size_t length = ESPStepperMotorServer_SyncPacket::encodeClock(0xDEADBEEF, true, packet);
+  TEST_ASSERT_EQUAL(ESPServerSyncPacketClockLength, length);
+  TEST_ASSERT_TRUE(ESPStepperMotorServer_SyncPacket::isValid(packet, length));
+  TEST_ASSERT_TRUE(ESPStepperMotorServer_SyncPacket::decodeClock(packet, length, masterMicros, isEmergencyStopActive));
+  TEST_ASSERT_EQUAL_UINT32(0xDEADBEEF, masterMicros);
+  TEST_ASSERT_TRUE(isEmergencyStopActive);
+
+  length = ESPStepperMotorServer_SyncPacket::encodeClock(5, false, packet);
+  TEST_ASSERT_TRUE(ESPStepperMotorServer_SyncPacket::decodeClock(packet, length, masterMicros, isEmergencyStopActive));
+  TEST_ASSERT_EQUAL_UINT32(5, masterMicros);
+  TEST_ASSERT_FALSE(isEmergencyStopActive);
+}
+
+void test_clock_request_and_response_round_trip(void)
+{
+  byte nodeId = 0;
+  uint32_t followerSendMicros = 0;
+  size_t length = ESPStepperMotorServer_SyncPacket::encodeClockRequest(12, 0x01020304, packet);
+  TEST_ASSERT_EQUAL(ESPServerSyncPacketClockRequestLength, length);
+  TEST_ASSERT_TRUE(ESPStepperMotorServer_SyncPacket::isValid(packet, length));
+  TEST_ASSERT_TRUE(ESPStepperMotorServer_SyncPacket::decodeClockRequest(packet, length, nodeId, followerSendMicros));
+  TEST_ASSERT_EQUAL(12, nodeId);
+  TEST_ASSERT_EQUAL_UINT32(0x01020304, followerSendMicros);
+
+  ESPStepperMotorServer_SyncClockExchange exchange = {12, 0x01020304, 0xFFFFFFF0, 0x00000010};
+  ESPStepperMotorServer_SyncClockExchange decodedExchange = {};
+  length = ESPStepperMotorServer_SyncPacket::encodeClockResponse(exchange, packet);
+  TEST_ASSERT_EQUAL(ESPServerSyncPacketClockResponseLength, length);
+  TEST_ASSERT_TRUE(ESPStepperMotorServer_SyncPacket::isValid(packet, length));
+  TEST_ASSERT_FALSE(ESPStepperMotorServer_SyncPacket::decodeClockRequest(packet, length, nodeId, followerSendMicros));
+  TEST_ASSERT_TRUE(ESPStepperMotorServer_SyncPacket::decodeClockResponse(packet, length, decodedExchange));
+  TEST_ASSERT_EQUAL(12, decodedExchange.nodeId);
+  TEST_ASSERT_EQUAL_UINT32(0x01020304, decodedExchange.followerSendMicros);
+  TEST_ASSERT_EQUAL_UINT32(0xFFFFFFF0, decodedExchange.masterReceiveMicros);
+  TEST_ASSERT_EQUAL_UINT32(0x00000010, decodedExchange.masterSendMicros);
+}
+
+void test_one_way_delay(void)
+{
+  // 3 ms round trip, of which the master needed 1 ms to answer
+  ESPStepperMotorServer_SyncClockExchange exchange = {1, 1000, 50000, 51000};
+  TEST_ASSERT_EQUAL(1000, ESPStepperMotorServer_SyncPacket::calculateOneWayDelayMicros(exchange, 4000));
+  // the clocks of the follower and the master wrap around during the exchange: 1280 us round trip, 256 us on the master
+  exchange.followerSendMicros = 0xFFFFFF00;
+  exchange.masterReceiveMicros = 0xFFFFFFF0;
+  exchange.masterSendMicros = 0x000000F0;
+  TEST_ASSERT_EQUAL(512, ESPStepperMotorServer_SyncPacket::calculateOneWayDelayMicros(exchange, 0x00000400));
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_segment_round_trip);
+  RUN_TEST(test_segment_layout_is_little_endian);
+  RUN_TEST(test_segment_with_invalid_move_count_is_rejected);
+  RUN_TEST(test_other_packet_types_are_not_decoded_as_segment);
+  RUN_TEST(test_corrupted_packets_are_invalid);
+  RUN_TEST(test_clock_round_trip);
+  RUN_TEST(test_clock_request_and_response_round_trip);
+  RUN_TEST(test_one_way_delay);
+  return UNITY_END();
+}
@@ -0,0 +1,237 @@
+// host tests for the samples and the replay timeline of the trajectory recorder, driving the simulated steppers of test/stubs.
+// Run with: pio test -e native -f test_trajectory_recorder
+#include <unity.h>
+#include <ESP_FlexyStepper.h>
+#include <ESPStepperMotorServer_TrajectoryTimeline.h>
+
+#define STEPPER_COUNT 2
+// stop a replay that does not complete within this time
+#define MAX_REPLAY_MILLIS 10000
+
+// a target position change of the recorded moves
+struct ScriptedMove
+{
+  unsigned long timeMs;
+  byte stepperId;
+  long targetPosition;
+};
+
+const ScriptedMove recordedMoves[] = {{10, 0, 50}, {30, 1, 80}, {100, 0, -20}, {200, 1, 150}};
+const int recordedMoveCount = sizeof(recordedMoves) / sizeof(recordedMoves[0]);
+// the start positions and the moves above, in the order they have to be recorded
+const ESPStepperMotorServer_TrajectorySample expectedSamples[] = {{0, 0, 0}, {0, 100, 1}, {10, 50, 0}, {30, 80, 1}, {100, -20, 0}, {200, 150, 1}};
+const unsigned int expectedSampleCount = sizeof(expectedSamples) / sizeof(expectedSamples[0]);
+
+ESPStepperMotorServer_TrajectoryTimeline timeline;
+ESP_FlexyStepper steppers[STEPPER_COUNT];
+
+// the samples in the order they have been sent to the steppers during the replay and the time they have been sent
+ESPStepperMotorServer_TrajectorySample replayedSamples[expectedSampleCount];
+unsigned long replayMillis[expectedSampleCount];
+unsigned int replayedSampleCount;
+
+static void moveStepperTo(byte stepperId, long position)
+{
+  steppers[stepperId].setCurrentPositionInSteps(position);
+  steppers[stepperId].setTargetPositionInSteps(position);
+}
+
+static bool areAllSteppersIdle()
+{
+  for (int i = 0; i < STEPPER_COUNT; i++)
+  {
+    if (!steppers[i].motionComplete())
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+static void processMovement()
+{
+  for (int i = 0; i < STEPPER_COUNT; i++)
+  {
+    steppers[i].processMovement();
+  }
+}
+
+// one cycle of the motion controller per millisecond, the steppers move one step per cycle
+static void recordMoves(unsigned long durationMs)
+{
+  moveStepperTo(0, 0);
+  moveStepperTo(1, 100);
+  timeline.startRecording(0);
+  for (unsigned long now = 0; now < durationMs; now++)
+  {
+    for (int i = 0; i < recordedMoveCount; i++)
+    {
+      if (recordedMoves[i].timeMs == now)
+      {
+        steppers[recordedMoves[i].stepperId].setTargetPositionInSteps(recordedMoves[i].targetPosition);
+      }
+    }
+    for (byte stepperId = 0; stepperId < STEPPER_COUNT; stepperId++)
+    {
+      const long position = (now == 0) ? steppers[stepperId].getCurrentPositionInSteps() : steppers[stepperId].getTargetPositionInSteps();
+      TEST_ASSERT_TRUE(timeline.recordTargetPosition(now, stepperId, position, now == 0));
+    }
+    processMovement();
+  }
+}
+
+static void sendSamples(const ESPStepperMotorServer_TrajectorySample *samples, unsigned int count, unsigned long now)
+{
+  for (unsigned int i = 0; i < count; i++)
+  {
+    TEST_ASSERT_TRUE(replayedSampleCount < expectedSampleCount);
+    replayedSamples[replayedSampleCount] = samples[i];
+    replayMillis[replayedSampleCount] = now;
+    replayedSampleCount++;
+    steppers[samples[i].stepperId].setTargetPositionInSteps(samples[i].targetPositionInSteps);
+  }
+}
+
+// replay from other positions than the recording started at, returns the time the replay completed
+static unsigned long replay(float timeScale)
+{
+  moveStepperTo(0, 500);
+  moveStepperTo(1, -500);
+  replayedSampleCount = 0;
+  timeline.startReplay(timeScale);
+  unsigned int count = 0;
+  const ESPStepperMotorServer_TrajectorySample *samples = timeline.getStartSamples(count);
+  TEST_ASSERT_EQUAL(STEPPER_COUNT, count);
+  sendSamples(samples, count, 0);
+  for (unsigned long now = 0; now < MAX_REPLAY_MILLIS; now++)
+  {
+    const bool isIdle = areAllSteppersIdle();
+    samples = timeline.getDueSamples(now, isIdle, count);
+    if (timeScale == 0)
+    {
+      TEST_ASSERT_TRUE(count <= 1);
+      TEST_ASSERT_TRUE(count == 0 || isIdle);
+    }
+    sendSamples(samples, count, now);
+    if (isIdle && count == 0 && timeline.isReplayCompleted())
+    {
+      return now;
+    }
+    processMovement();
+  }
+  TEST_FAIL_MESSAGE("the replay did not complete");
+  return 0;
+}
+
+static void assertReplayedInRecordedOrder()
+{
+  TEST_ASSERT_EQUAL(expectedSampleCount, replayedSampleCount);
+  for (unsigned int i = 0; i < expectedSampleCount; i++)
+  {
+    TEST_ASSERT_EQUAL(expectedSamples[i].stepperId, replayedSamples[i].stepperId);
+    TEST_ASSERT_EQUAL(expectedSamples[i].targetPositionInSteps, replayedSamples[i].targetPositionInSteps);
+    TEST_ASSERT_EQUAL_UINT32(expectedSamples[i].timeMs, replayedSamples[i].timeMs);
+  }
+  TEST_ASSERT_EQUAL(-20, steppers[0].getCurrentPositionInSteps());
+  TEST_ASSERT_EQUAL(150, steppers[1].getCurrentPositionInSteps());
+}
+
+// the samples after the start positions must be sent at their recorded time divided by the time scale, relative to the first of them
+static void assertReplayTiming(float timeScale)
+{
+  for (unsigned int i = STEPPER_COUNT + 1; i < replayedSampleCount; i++)
+  {
+    const unsigned long expectedDelay = (unsigned long)((replayedSamples[i].timeMs - replayedSamples[STEPPER_COUNT].timeMs) / timeScale);
+    TEST_ASSERT_EQUAL(expectedDelay, replayMillis[i] - replayMillis[STEPPER_COUNT]);
+  }
+}
+
+void setUp(void)
+{
+  recordMoves(400);
+}
+
+void tearDown(void)
+{
+}
+
+void test_recording_contains_start_positions_and_changes_in_order(void)
+{
+  TEST_ASSERT_EQUAL(expectedSampleCount, timeline.getSampleCount());
+  TEST_ASSERT_FALSE(timeline.isSampleBufferOverflown());
+  const ESPStepperMotorServer_TrajectorySample *samples = timeline.getSamples();
+  for (unsigned int i = 0; i < expectedSampleCount; i++)
+  {
+    TEST_ASSERT_EQUAL_UINT32(expectedSamples[i].timeMs, samples[i].timeMs);
+    TEST_ASSERT_EQUAL(expectedSamples[i].targetPositionInSteps, samples[i].targetPositionInSteps);
+    TEST_ASSERT_EQUAL(expectedSamples[i].stepperId, samples[i].stepperId);
+  }
+}
+
+void test_replay_in_real_time(void)
+{
+  replay(1);
+  assertReplayedInRecordedOrder();
+  assertReplayTiming(1);
+  // the timeline starts once both steppers reached their start positions, stepper 1 needs the longest with 600 steps
+  TEST_ASSERT_EQUAL(600 + 10, replayMillis[STEPPER_COUNT]);
+}
+
+void test_replay_with_half_speed(void)
+{
+  replay(0.5);
+  assertReplayedInRecordedOrder();
+  assertReplayTiming(0.5);
+  TEST_ASSERT_EQUAL(600 + 20, replayMillis[STEPPER_COUNT]);
+}
+
+void test_replay_as_fast_as_possible(void)
+{
+  const unsigned long completedMillis = replay(0);
+  assertReplayedInRecordedOrder();
+  // each sample is sent once the previous target has been reached: 600 steps to the start positions, then 50, 20, 70 and 70 steps
+  const unsigned long expectedMillis[] = {0, 0, 600, 650, 670, 740};
+  for (unsigned int i = 0; i < expectedSampleCount; i++)
+  {
+    TEST_ASSERT_EQUAL(expectedMillis[i], replayMillis[i]);
+  }
+  TEST_ASSERT_EQUAL(810, completedMillis);
+}
+
+void test_replay_can_be_repeated(void)
+{
+  replay(1);
+  replay(2);
+  assertReplayedInRecordedOrder();
+  assertReplayTiming(2);
+}
+
+void test_full_sample_buffer_stops_the_recording(void)
+{
+  timeline.startRecording(0);
+  for (unsigned int i = 0; i < ESPServerTrajectoryMaxSamples; i++)
+  {
+    TEST_ASSERT_TRUE(timeline.recordTargetPosition(i, 0, i + 1, false));
+  }
+  // unchanged positions do not need a sample
+  TEST_ASSERT_TRUE(timeline.recordTargetPosition(ESPServerTrajectoryMaxSamples, 0, ESPServerTrajectoryMaxSamples, false));
+  TEST_ASSERT_FALSE(timeline.recordTargetPosition(ESPServerTrajectoryMaxSamples, 0, -1, false));
+  TEST_ASSERT_TRUE(timeline.isSampleBufferOverflown());
+  TEST_ASSERT_EQUAL(ESPServerTrajectoryMaxSamples, timeline.getSampleCount());
+
+  timeline.startRecording(0);
+  TEST_ASSERT_FALSE(timeline.isSampleBufferOverflown());
+  TEST_ASSERT_EQUAL(0, timeline.getSampleCount());
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_recording_contains_start_positions_and_changes_in_order);
+  RUN_TEST(test_replay_in_real_time);
+  RUN_TEST(test_replay_with_half_speed);
+  RUN_TEST(test_replay_as_fast_as_possible);
+  RUN_TEST(test_replay_can_be_repeated);
+  RUN_TEST(test_full_sample_buffer_stops_the_recording);
+  return UNITY_END();
+}
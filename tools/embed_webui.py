@@ -0,0 +1,101 @@
+#!/usr/bin/env python3
+#
+# ESP-StepperMotor-Server web UI embedding tool
+# Copyright (c) Paul Kerspe, 2019
+#
+# MIT License, see LICENSE.txt
+#
+# Compresses all files of the web UI (the contents of the data folder of the
+# ESP-StepperMotor-Server-UI repository) and writes them as byte arrays into a
+# header file, so the web UI can be served directly from flash when the library
+# is compiled with -D ESPStepperMotorServer_USE_EMBEDDED_WEB_UI.
+#
+# Usage:
+#   python3 tools/embed_webui.py <path to data folder> [<output header file>]
+#
+# The output defaults to src/ESPStepperMotorServer_EmbeddedWebUI.h of this library.
+# When used as PlatformIO extra script (extra_scripts = pre:<path to this file>),
+# the data folder of the project is embedded and the header is written to the
+# include folder of the project.
+
+import gzip
+import os
+import sys
+
+HEADER_NAME = "ESPStepperMotorServer_EmbeddedWebUI.h"
+# files in the data folder that are not part of the web UI
+EXCLUDED_FILES = ["/config.json"]
+# files that are already well compressed are embedded as they are
+UNCOMPRESSED_EXTENSIONS = [".gz", ".png", ".jpg", ".jpeg", ".gif"]
+
+
+def fnv1a(data):
+    # must match the ETag calculation in ESPStepperMotorServer_WebInterface::loadWebAssetFromSpiffs
+    hash_value = 2166136261
+    for byte in data:
+        hash_value = ((hash_value ^ byte) * 16777619) & 0xFFFFFFFF
+    return hash_value
+
+
+def collect_files(data_folder):
+    files = []
+    for root, _, file_names in os.walk(data_folder):
+        for file_name in sorted(file_names):
+            file_path = os.path.join(root, file_name)
+            spiffs_path = "/" + os.path.relpath(file_path, data_folder).replace(os.sep, "/")
+            if spiffs_path not in EXCLUDED_FILES and not file_name.startswith("."):
+                files.append((spiffs_path, file_path))
+    return sorted(files)
+
+
+def format_byte_array(data):
+    lines = []
+    for offset in range(0, len(data), 16):
+        lines.append("    " + ", ".join("0x%02x" % byte for byte in data[offset:offset + 16]) + ",")
+    return "\n".join(lines)
+
+
+def generate_header(data_folder, output_file):
+    files = collect_files(data_folder)
+    if not files:
+        raise SystemExit("No web UI files found in %s" % data_folder)
+
+    arrays = []
+    entries = []
+    total_size = 0
+    for index, (spiffs_path, file_path) in enumerate(files):
+        with open(file_path, "rb") as input_file:
+            content = input_file.read()
+        is_gzipped = spiffs_path.endswith(".gz")
+        if os.path.splitext(spiffs_path)[1].lower() not in UNCOMPRESSED_EXTENSIONS:
+            # mtime is fixed, so the output (and the ETag) only changes if the content changes
+            content = gzip.compress(content, compresslevel=9, mtime=0)
+            is_gzipped = True
+        total_size += len(content)
+        array_name = "ESPStepperMotorServer_embeddedWebFile%i" % index
+        arrays.append("// %s\nstatic const uint8_t %s[] PROGMEM = {\n%s\n};\n" % (spiffs_path, array_name, format_byte_array(content)))
+        entries.append('    {"%s", %s, sizeof(%s), %s, "\\"%08x-%x\\""},' % (spiffs_path, array_name, array_name, "true" if is_gzipped else "false", fnv1a(content), len(content)))
+
+    with open(output_file, "w") as output:
+        output.write("// generated by tools/embed_webui.py from %i files (%i bytes), do not edit\n\n" % (len(files), total_size))
+        output.write("#ifndef ESPStepperMotorServer_EmbeddedWebUI_h\n#define ESPStepperMotorServer_EmbeddedWebUI_h\n\n")
+        output.write("#include <Arduino.h>\n\n")
+        output.write("\n".join(arrays))
+        output.write("\nstatic const ESPStepperMotorServer_EmbeddedWebFile ESPStepperMotorServer_embeddedWebFiles[] = {\n%s\n};\n\n" % "\n".join(entries))
+        output.write("#endif\n")
+    print("Embedded %i web UI files (%i bytes) into %s" % (len(files), total_size, output_file))
+
+
+def main(arguments):
+    if len(arguments) < 2:
+        raise SystemExit("Usage: %s <path to data folder> [<output header file>]" % arguments[0])
+    default_output = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "src", HEADER_NAME)
+    generate_header(arguments[1], arguments[2] if len(arguments) > 2 else default_output)
+
+
+try:
+    Import("env")  # noqa: F821 - only defined when running as PlatformIO extra script
+    generate_header(env.subst("$PROJECT_DATA_DIR"), os.path.join(env.subst("$PROJECT_INCLUDE_DIR"), HEADER_NAME))  # noqa: F821
+except NameError:
+    if __name__ == "__main__":
+        main(sys.argv)
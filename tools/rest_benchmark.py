@@ -0,0 +1,123 @@
+#!/usr/bin/env python3
+#
+# ESP-StepperMotor-Server REST API benchmark tool
+# Copyright (c) Paul Kerspe, 2019
+#
+# MIT License, see LICENSE.txt
+#
+# Sends synthetic requests to the REST API of a running server and measures the
+# request rate, the response times and the heap usage of the server while
+# handling them (heap statistics are read from /api/status before and after
+# each scenario).
+#
+# Usage:
+#   python3 tools/rest_benchmark.py <ip address of the server> [options]
+#
+# Options:
+#   --requests N     number of requests per scenario (default: 500)
+#   --clients N      number of parallel connections (default: 1)
+#   --stepper ID     id of the stepper used for the stepper requests (default: 0)
+#
+# The move requests use a distance of 0 steps, so no stepper is moved while the
+# benchmark is running. A configured stepper is needed for all scenarios except
+# "status" and "invalid number".
+
+import argparse
+import json
+import sys
+import threading
+import time
+import urllib.error
+import urllib.request
+
+REQUEST_TIMEOUT_SECONDS = 5
+
+
+def scenarios(stepper_id):
+    # name, HTTP method, path (including the query string)
+    return [
+        ("status", "GET", "/api/status"),
+        ("get stepper", "GET", "/api/steppers?id=%i" % stepper_id),
+        ("get position", "GET", "/api/steppers/position?id=%i" % stepper_id),
+        ("move by", "POST", "/api/steppers/moveby?id=%i&unit=steps&value=0&speed=1000&accel=1000&decel=1000" % stepper_id),
+        ("invalid number", "POST", "/api/steppers/moveby?id=%i&unit=steps&value=nan" % stepper_id),
+    ]
+
+
+def send_request(base_url, method, path):
+    request = urllib.request.Request(base_url + path, method=method, data=(b"" if method == "POST" else None))
+    try:
+        with urllib.request.urlopen(request, timeout=REQUEST_TIMEOUT_SECONDS) as response:
+            response.read()
+            return response.status
+    except urllib.error.HTTPError as error:
+        error.read()
+        return error.code
+    except (urllib.error.URLError, OSError):
+        return None
+
+
+def read_heap_status(base_url):
+    with urllib.request.urlopen(base_url + "/api/status", timeout=REQUEST_TIMEOUT_SECONDS) as response:
+        status = json.loads(response.read().decode("utf-8"))
+    if "heap" not in status:
+        sys.exit("The server does not report heap statistics in /api/status, please update the firmware")
+    return status["heap"]
+
+
+def run_scenario(base_url, method, path, request_count, client_count):
+    durations = []
+    status_codes = {}
+    lock = threading.Lock()
+    requests_per_client = [request_count // client_count + (1 if i < request_count % client_count else 0) for i in range(client_count)]
+
+    def client(count):
+        for _ in range(count):
+            start = time.perf_counter()
+            status = send_request(base_url, method, path)
+            duration = time.perf_counter() - start
+            with lock:
+                durations.append(duration)
+                status_codes[status] = status_codes.get(status, 0) + 1
+
+    threads = [threading.Thread(target=client, args=(count,)) for count in requests_per_client]
+    start = time.perf_counter()
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+    return time.perf_counter() - start, sorted(durations), status_codes
+
+
+def percentile(sorted_values, fraction):
+    if not sorted_values:
+        return 0
+    return sorted_values[min(len(sorted_values) - 1, int(len(sorted_values) * fraction))]
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Benchmark the REST API of an ESP-StepperMotor-Server")
+    parser.add_argument("host", help="ip address or host name of the server, optionally with port")
+    parser.add_argument("--requests", type=int, default=500)
+    parser.add_argument("--clients", type=int, default=1)
+    parser.add_argument("--stepper", type=int, default=0)
+    args = parser.parse_args()
+    base_url = args.host if args.host.startswith("http") else "http://" + args.host
+
+    print("%-16s %10s %10s %10s %12s %12s  %s" % ("scenario", "req/s", "p50 ms", "p95 ms", "heap delta", "min free", "status codes"))
+    for name, method, path in scenarios(args.stepper):
+        heap_before = read_heap_status(base_url)
+        elapsed, durations, status_codes = run_scenario(base_url, method, path, args.requests, args.clients)
+        heap_after = read_heap_status(base_url)
+        print("%-16s %10.1f %10.1f %10.1f %12i %12i  %s" % (
+            name,
+            len(durations) / elapsed,
+            percentile(durations, 0.5) * 1000,
+            percentile(durations, 0.95) * 1000,
+            heap_after["free"] - heap_before["free"],
+            heap_after["minFree"],
+            ", ".join("%s: %i" % (code if code else "failed", count) for code, count in sorted(status_codes.items(), key=lambda item: str(item[0])))))
+
+
+if __name__ == "__main__":
+    main()